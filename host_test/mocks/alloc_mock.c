@@ -0,0 +1,34 @@
+/**
+ * @file alloc_mock.c
+ * @brief Heap allocation counter (the build links with -Wl,--wrap=malloc,calloc,realloc).
+ */
+
+#include "mock.h"       // mock_alloc_count()
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+static _Atomic uint64_t allocs = 0;
+
+void *__wrap_malloc(size_t size) {
+    allocs++;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    allocs++;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    allocs++;
+    return __real_realloc(ptr, size);
+}
+
+uint64_t mock_alloc_count(void) {
+    return allocs;
+}
@@ -0,0 +1,75 @@
+/**
+ * @file app_mocks.c
+ * @brief Modules the host build leaves out: Wi-Fi, sign-in, streams, display, scan policy
+ *        and the stack report.
+ */
+
+#include "display.h"
+#include "firebase_auth.h"
+#include "firebase_stream.h"
+#include "rfid_scan.h"
+#include "task_layout.h"
+#include "wifi.h"
+#include "mock.h"              // mock_wifi_set_connected(), mock_display_count()
+
+#include <stdatomic.h>
+
+static _Atomic bool wifi_connected = true;
+static _Atomic uint32_t display_requests[COLOR_CHIP + 1];
+
+const char *const firebase_root_cert = "host-test-root-cert";
+
+bool wifi_is_connected(void) {
+    return wifi_connected;
+}
+
+void mock_wifi_set_connected(bool connected) {
+    wifi_connected = connected;
+}
+
+const char *firebase_auth_get_token(void) {
+    return "host-test-token";
+}
+
+void firebase_auth_invalidate(const char *token) {
+    (void)token;
+}
+
+bool firebase_stream_is_live(void) {
+    return false; // The uploader polls
+}
+
+bool firebase_stream_settings_live(void) {
+    return false;
+}
+
+esp_err_t display_show(CardColor state, uint32_t hold_ms, int64_t tap_us) {
+    (void)hold_ms;
+    (void)tap_us;
+    if (state <= COLOR_CHIP) {
+        display_requests[state]++;
+    }
+    return ESP_OK;
+}
+
+uint32_t mock_display_count(CardColor state) {
+    return (state <= COLOR_CHIP) ? display_requests[state] : 0;
+}
+
+esp_err_t rfid_scan_init(const rc522_handle_t *scanners, size_t count) {
+    (void)scanners;
+    (void)count;
+    return ESP_OK; // Always in fast mode
+}
+
+void rfid_scan_on_detection(void) {
+}
+
+esp_err_t rfid_scan_apply_settings(void) {
+    return ESP_OK;
+}
+
+void task_layout_register(TaskHandle_t task, uint32_t stack_size) {
+    (void)task;
+    (void)stack_size;
+}
@@ -0,0 +1,48 @@
+#ifndef cJSON__h
+#define cJSON__h
+
+/**
+ * @file cJSON.h
+ * @brief Host link stub of cJSON: every document fails to parse.
+ *
+ * Only linked when no cJSON source was found (see CMakeLists.txt). The
+ * firmware treats an unparsable response like "null" (no allowlist deltas,
+ * no settings document), so the access path and the uploader still run;
+ * the JSON sync tests are not built.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef struct cJSON {
+    struct cJSON *next;
+    struct cJSON *prev;
+    struct cJSON *child;
+    int type;
+    char *valuestring;
+    int valueint;
+    double valuedouble;
+    char *string;
+} cJSON;
+
+typedef struct cJSON_Hooks {
+    void *(*malloc_fn)(size_t sz);
+    void (*free_fn)(void *ptr);
+} cJSON_Hooks;
+
+void cJSON_InitHooks(cJSON_Hooks *hooks);
+cJSON *cJSON_Parse(const char *value);
+void cJSON_Delete(cJSON *item);
+int cJSON_GetArraySize(const cJSON *array);
+cJSON *cJSON_GetObjectItem(const cJSON *object, const char *string);
+cJSON *cJSON_GetObjectItemCaseSensitive(const cJSON *object, const char *string);
+char *cJSON_GetStringValue(const cJSON *item);
+bool cJSON_IsNull(const cJSON *item);
+bool cJSON_IsNumber(const cJSON *item);
+bool cJSON_IsString(const cJSON *item);
+bool cJSON_IsObject(const cJSON *item);
+
+#define cJSON_ArrayForEach(element, array) \
+    for (element = (array != NULL) ? (array)->child : NULL; element != NULL; element = element->next)
+
+#endif // cJSON__h
@@ -0,0 +1,61 @@
+/**
+ * @file cjson_mock.c
+ * @brief cJSON link stub: nothing parses, so every lookup finds nothing (see cJSON.h).
+ */
+
+#include "cJSON.h"
+
+void cJSON_InitHooks(cJSON_Hooks *hooks) {
+    (void)hooks;
+}
+
+cJSON *cJSON_Parse(const char *value) {
+    (void)value;
+    return NULL;
+}
+
+void cJSON_Delete(cJSON *item) {
+    (void)item;
+}
+
+int cJSON_GetArraySize(const cJSON *array) {
+    (void)array;
+    return 0;
+}
+
+cJSON *cJSON_GetObjectItem(const cJSON *object, const char *string) {
+    (void)object;
+    (void)string;
+    return NULL;
+}
+
+cJSON *cJSON_GetObjectItemCaseSensitive(const cJSON *object, const char *string) {
+    (void)object;
+    (void)string;
+    return NULL;
+}
+
+char *cJSON_GetStringValue(const cJSON *item) {
+    (void)item;
+    return NULL;
+}
+
+bool cJSON_IsNull(const cJSON *item) {
+    (void)item;
+    return false;
+}
+
+bool cJSON_IsNumber(const cJSON *item) {
+    (void)item;
+    return false;
+}
+
+bool cJSON_IsString(const cJSON *item) {
+    (void)item;
+    return false;
+}
+
+bool cJSON_IsObject(const cJSON *item) {
+    (void)item;
+    return false;
+}
@@ -0,0 +1,18 @@
+/**
+ * @file compat.c
+ * @brief strlcpy() for C libraries without it (see host_compat.h).
+ */
+
+#include "host_compat.h"
+
+#include <string.h>
+
+size_t strlcpy(char *dst, const char *src, size_t size) {
+    size_t len = strlen(src);
+    if (size > 0) {
+        size_t n = (len < size - 1) ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
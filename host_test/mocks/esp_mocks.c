@@ -0,0 +1,140 @@
+/**
+ * @file esp_mocks.c
+ * @brief ESP-IDF basics on the host: logging, esp_timer, ROM CRC, MAC, RNG, restart hooks
+ *        and error names.
+ */
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_random.h"
+#include "esp_rom_crc.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "mock.h"          // mock_time_advance_us(), mock_esp_restart()
+
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <string.h>        // For memcpy()
+#include <time.h>          // For clock_gettime()
+
+static esp_log_level_t log_level = ESP_LOG_WARN;
+
+// Virtual time added to the monotonic clock
+static _Atomic int64_t time_offset_us = 0;
+static struct timespec start_time;
+
+// Handlers esp_restart() would run, in registration order
+#define MAX_SHUTDOWN_HANDLERS 5
+static shutdown_handler_t shutdown_handlers[MAX_SHUTDOWN_HANDLERS];
+static int shutdown_handler_count = 0;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) {
+    (void)tag;
+    log_level = level;
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...) {
+    static const char letters[] = { 'N', 'E', 'W', 'I', 'D', 'V' };
+    if (level > log_level) {
+        return;
+    }
+
+    char line[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    fprintf(stderr, "%c (%lld) %s: %s\n", letters[level], (long long)(esp_timer_get_time() / 1000), tag,
+            line);
+}
+
+/**
+ * @brief Time origin of esp_timer: program start, like boot on the target.
+ */
+__attribute__((constructor)) static void timer_start(void) {
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+}
+
+int64_t esp_timer_get_time(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)(now.tv_sec - start_time.tv_sec) * 1000000 + (now.tv_nsec - start_time.tv_nsec) / 1000 +
+           time_offset_us;
+}
+
+void mock_time_advance_us(int64_t us) {
+    time_offset_us += us;
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len) {
+    // Reflected CRC-32 (polynomial 0xEDB88320), inverted in and out like the ROM routine
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type) {
+    static const uint8_t station[6] = { 0x24, 0xA1, 0x60, 0xC0, 0xFF, 0xEE };
+    (void)type;
+    memcpy(mac, station, sizeof(station));
+    return ESP_OK;
+}
+
+uint32_t esp_random(void) {
+    // xorshift32 from a fixed seed: push keys are the same on every run
+    static _Atomic uint32_t state = 2463534242u;
+    uint32_t x = state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    state = x;
+    return x;
+}
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handler) {
+    for (int i = 0; i < shutdown_handler_count; i++) {
+        if (shutdown_handlers[i] == handler) {
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+    if (shutdown_handler_count == MAX_SHUTDOWN_HANDLERS) {
+        return ESP_ERR_NO_MEM;
+    }
+    shutdown_handlers[shutdown_handler_count++] = handler;
+    return ESP_OK;
+}
+
+void mock_esp_restart(void) {
+    // esp_restart() runs the handlers last registered first
+    for (int i = shutdown_handler_count - 1; i >= 0; i--) {
+        shutdown_handlers[i]();
+    }
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_NOT_SUPPORTED: return "ESP_ERR_NOT_SUPPORTED";
+        case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_INVALID_RESPONSE: return "ESP_ERR_INVALID_RESPONSE";
+        case ESP_ERR_INVALID_CRC: return "ESP_ERR_INVALID_CRC";
+        case ESP_ERR_INVALID_VERSION: return "ESP_ERR_INVALID_VERSION";
+        case ESP_ERR_INVALID_MAC: return "ESP_ERR_INVALID_MAC";
+        case ESP_ERR_NOT_FINISHED: return "ESP_ERR_NOT_FINISHED";
+        case ESP_ERR_NOT_ALLOWED: return "ESP_ERR_NOT_ALLOWED";
+        case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+        default: return "UNKNOWN ERROR";
+    }
+}
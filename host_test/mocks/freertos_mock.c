@@ -0,0 +1,354 @@
+/**
+ * @file freertos_mock.c
+ * @brief FreeRTOS tasks, queues, semaphores and critical sections on POSIX threads.
+ */
+
+#define _GNU_SOURCE             // For PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "mock.h"               // mock_freertos_wait_idle()
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>             // For calloc(), free()
+#include <string.h>             // For memcpy(), strlcpy()
+#include <time.h>               // For clock_gettime(), nanosleep()
+
+/**
+ * @brief One task: a detached thread.
+ */
+struct mock_task {
+    pthread_t thread;
+    TaskFunction_t fn;
+    void *arg;
+    uint32_t stack_depth;
+    char name[configMAX_TASK_NAME_LEN];
+};
+
+// Queues and task bookkeeping: one lock, one condition for every state change
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t changed;
+static pthread_once_t changed_once = PTHREAD_ONCE_INIT;
+static struct mock_queue *queues = NULL;
+static unsigned tasks_alive = 0;   // Tasks created and not deleted
+static unsigned tasks_blocked = 0; // Tasks waiting in xQueueReceive()/xQueueSend()
+
+// Critical sections (portMUX): one recursive lock for all of them
+static pthread_mutex_t critical_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+static __thread struct mock_task *current_task = NULL;
+static struct timespec start_time;
+
+/**
+ * @brief Condition variable on the monotonic clock, and the tick origin.
+ */
+static void init_once(void) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&changed, &attr);
+    pthread_condattr_destroy(&attr);
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+}
+
+static void ensure_init(void) {
+    pthread_once(&changed_once, init_once);
+}
+
+/**
+ * @brief Absolute monotonic time ticks from now.
+ */
+static struct timespec deadline_after(TickType_t ticks) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    t.tv_sec += ticks / 1000;
+    t.tv_nsec += (long)(ticks % 1000) * 1000000L;
+    if (t.tv_nsec >= 1000000000L) {
+        t.tv_sec++;
+        t.tv_nsec -= 1000000000L;
+    }
+    return t;
+}
+
+/**
+ * @brief Wait for a state change (call with lock held).
+ *
+ * @return false once the deadline has passed.
+ */
+static bool wait_changed(TickType_t ticks, const struct timespec *deadline) {
+    int rc = 0;
+    if (current_task != NULL) {
+        tasks_blocked++;
+        pthread_cond_broadcast(&changed); // Idle waiters re-check
+    }
+    if (ticks == portMAX_DELAY) {
+        pthread_cond_wait(&changed, &lock);
+    } else {
+        rc = pthread_cond_timedwait(&changed, &lock, deadline);
+    }
+    if (current_task != NULL) {
+        tasks_blocked--;
+    }
+    return rc != ETIMEDOUT;
+}
+
+void vPortEnterCritical(portMUX_TYPE *mux) {
+    (void)mux;
+    pthread_mutex_lock(&critical_lock);
+}
+
+void vPortExitCritical(portMUX_TYPE *mux) {
+    (void)mux;
+    pthread_mutex_unlock(&critical_lock);
+}
+
+// --- Tasks ---
+
+static void *task_entry(void *arg) {
+    struct mock_task *task = arg;
+    current_task = task;
+    task->fn(task->arg);
+    vTaskDelete(NULL); // A FreeRTOS task must not return; treat it as deleting itself
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *created, BaseType_t core_id) {
+    (void)priority;
+    (void)core_id;
+    ensure_init();
+
+    struct mock_task *task = calloc(1, sizeof(*task));
+    if (task == NULL) {
+        return pdFAIL;
+    }
+    task->fn = fn;
+    task->arg = arg;
+    task->stack_depth = stack_depth;
+    strlcpy(task->name, name, sizeof(task->name));
+
+    pthread_mutex_lock(&lock);
+    tasks_alive++;
+    pthread_mutex_unlock(&lock);
+
+    if (pthread_create(&task->thread, NULL, task_entry, task) != 0) {
+        pthread_mutex_lock(&lock);
+        tasks_alive--;
+        pthread_mutex_unlock(&lock);
+        free(task);
+        return pdFAIL;
+    }
+    pthread_detach(task->thread);
+    if (created != NULL) {
+        *created = task;
+    }
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    // Only self-deletion is supported: threads cannot be stopped from outside
+    if (task != NULL && task != current_task) {
+        abort();
+    }
+    struct mock_task *self = current_task;
+    if (self == NULL) {
+        abort();
+    }
+    current_task = NULL;
+
+    pthread_mutex_lock(&lock);
+    tasks_alive--;
+    pthread_cond_broadcast(&changed);
+    pthread_mutex_unlock(&lock);
+
+    free(self);
+    pthread_exit(NULL);
+}
+
+void vTaskDelay(TickType_t ticks) {
+    struct timespec t = { .tv_sec = ticks / 1000, .tv_nsec = (long)(ticks % 1000) * 1000000L };
+    while (nanosleep(&t, &t) == -1 && errno == EINTR) {
+    }
+}
+
+TickType_t xTaskGetTickCount(void) {
+    ensure_init();
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (TickType_t)((now.tv_sec - start_time.tv_sec) * 1000 +
+                        (now.tv_nsec - start_time.tv_nsec) / 1000000);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return current_task;
+}
+
+const char *pcTaskGetName(TaskHandle_t task) {
+    if (task == NULL) {
+        task = current_task;
+    }
+    return task != NULL ? task->name : "main";
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    if (task == NULL) {
+        task = current_task;
+    }
+    return task != NULL ? task->stack_depth : 0; // Host threads have their own stacks
+}
+
+// --- Queues and semaphores ---
+
+static QueueHandle_t queue_setup(struct mock_queue *q, UBaseType_t length, UBaseType_t item_size,
+                                 uint8_t *storage, UBaseType_t initial_count, bool dynamic) {
+    ensure_init();
+    *q = (struct mock_queue) {
+        .storage = storage,
+        .length = length,
+        .item_size = item_size,
+        .count = initial_count,
+        .dynamic = dynamic,
+    };
+
+    pthread_mutex_lock(&lock);
+    q->next = queues;
+    queues = q;
+    pthread_mutex_unlock(&lock);
+    return q;
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size, uint8_t *storage,
+                                 StaticQueue_t *queue) {
+    return queue_setup(queue, length, item_size, storage, 0, false);
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    struct mock_queue *q = calloc(1, sizeof(*q) + (size_t)length * item_size);
+    if (q == NULL) {
+        return NULL;
+    }
+    return queue_setup(q, length, item_size, (uint8_t *)(q + 1), 0, true);
+}
+
+void vQueueDelete(QueueHandle_t queue) {
+    if (queue == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&lock);
+    for (struct mock_queue **p = &queues; *p != NULL; p = &(*p)->next) {
+        if (*p == queue) {
+            *p = queue->next;
+            break;
+        }
+    }
+    pthread_cond_broadcast(&changed);
+    pthread_mutex_unlock(&lock);
+
+    if (queue->dynamic) {
+        free(queue);
+    }
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks_to_wait) {
+    struct timespec deadline = deadline_after(ticks_to_wait);
+    BaseType_t sent = pdFALSE;
+
+    pthread_mutex_lock(&lock);
+    while (queue->count >= queue->length) {
+        if (ticks_to_wait == 0 || !wait_changed(ticks_to_wait, &deadline)) {
+            break;
+        }
+    }
+    if (queue->count < queue->length) {
+        UBaseType_t tail = (queue->head + queue->count) % queue->length;
+        if (queue->item_size > 0) {
+            memcpy(queue->storage + (size_t)tail * queue->item_size, item, queue->item_size);
+        }
+        queue->count++;
+        sent = pdTRUE;
+        pthread_cond_broadcast(&changed);
+    }
+    pthread_mutex_unlock(&lock);
+    return sent;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *higher_priority_task_woken) {
+    if (higher_priority_task_woken != NULL) {
+        *higher_priority_task_woken = pdFALSE;
+    }
+    return xQueueSend(queue, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *buffer, TickType_t ticks_to_wait) {
+    struct timespec deadline = deadline_after(ticks_to_wait);
+    BaseType_t received = pdFALSE;
+
+    pthread_mutex_lock(&lock);
+    while (queue->count == 0) {
+        if (ticks_to_wait == 0 || !wait_changed(ticks_to_wait, &deadline)) {
+            break;
+        }
+    }
+    if (queue->count > 0) {
+        if (queue->item_size > 0) {
+            memcpy(buffer, queue->storage + (size_t)queue->head * queue->item_size, queue->item_size);
+        }
+        queue->head = (queue->head + 1) % queue->length;
+        queue->count--;
+        received = pdTRUE;
+        pthread_cond_broadcast(&changed);
+    }
+    pthread_mutex_unlock(&lock);
+    return received;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    pthread_mutex_lock(&lock);
+    UBaseType_t count = queue->count;
+    pthread_mutex_unlock(&lock);
+    return count;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer) {
+    return queue_setup(buffer, 1, 0, NULL, 0, false);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer) {
+    return queue_setup(buffer, 1, 0, NULL, 1, false);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    struct mock_queue *q = calloc(1, sizeof(*q));
+    return q != NULL ? queue_setup(q, 1, 0, NULL, 0, true) : NULL;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    struct mock_queue *q = calloc(1, sizeof(*q));
+    return q != NULL ? queue_setup(q, 1, 0, NULL, 1, true) : NULL;
+}
+
+// --- Test control ---
+
+/**
+ * @brief true if no queue holds items and every task is blocked (call with lock held).
+ */
+static bool idle(void) {
+    for (const struct mock_queue *q = queues; q != NULL; q = q->next) {
+        if (q->item_size > 0 && q->count > 0) {
+            return false;
+        }
+    }
+    return tasks_blocked == tasks_alive;
+}
+
+void mock_freertos_wait_idle(void) {
+    ensure_init();
+    pthread_mutex_lock(&lock);
+    while (!idle()) {
+        pthread_cond_wait(&changed, &lock);
+    }
+    pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,221 @@
+/**
+ * @file http_client_mock.c
+ * @brief esp_http_client answered in process: writes succeed, reads return "null" unless
+ *        the test set a response for the path.
+ */
+
+#include "esp_http_client.h"
+#include "mock.h"               // mock_http_*()
+
+#include <pthread.h>
+#include <stdio.h>              // For snprintf()
+#include <string.h>             // For memcpy(), strlen(), strstr(), strlcpy()
+
+// Body of a GET with no response set: nothing stored at the path
+#define MOCK_HTTP_READ_BODY "null"
+
+// Paths with a response set at one time
+#define MOCK_HTTP_MAX_RESPONSES 4
+
+/**
+ * @brief The one client the firmware keeps open, and its request being built.
+ */
+struct esp_http_client {
+    esp_http_client_config_t config;
+    esp_http_client_method_t method;
+    char url[512];
+    const char *body;
+    int body_len;
+    int status;
+    bool connected;
+};
+
+static struct esp_http_client client;
+static bool client_in_use;
+
+// Server side, shared with the test (lock)
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static mock_http_stats_t stats;
+static esp_err_t next_error = ESP_OK;
+static int next_status = 200;
+static char last_body[8192];
+static esp_http_client_method_t last_method = HTTP_METHOD_GET;
+
+// Stored documents: "/<path>.json" in the URL selects the body
+static struct {
+    char match[128];
+    char body[8192];
+} responses[MOCK_HTTP_MAX_RESPONSES];
+static char read_body[8192]; // Body of the request being answered
+
+/**
+ * @brief Body stored at the URL's path. Call with lock held.
+ */
+static const char *response_for(const char *url) {
+    for (size_t i = 0; i < MOCK_HTTP_MAX_RESPONSES; i++) {
+        if (responses[i].match[0] != '\0' && strstr(url, responses[i].match) != NULL) {
+            return responses[i].body;
+        }
+    }
+    return MOCK_HTTP_READ_BODY;
+}
+
+static void emit(esp_http_client_handle_t c, esp_http_client_event_id_t id, void *data, int len) {
+    if (c->config.event_handler == NULL) {
+        return;
+    }
+    esp_http_client_event_t evt = {
+        .event_id = id,
+        .client = c,
+        .data = data,
+        .data_len = len,
+        .user_data = c->config.user_data,
+    };
+    c->config.event_handler(&evt);
+}
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config) {
+    if (client_in_use) {
+        return NULL; // The firmware keeps a single long-lived client here
+    }
+    client = (struct esp_http_client) { .config = *config, .method = config->method };
+    client_in_use = true;
+    return &client;
+}
+
+esp_err_t esp_http_client_perform(esp_http_client_handle_t c) {
+    pthread_mutex_lock(&lock);
+    esp_err_t err = next_error;
+    int status = next_status;
+    bool connect = !c->connected;
+    stats.requests++;
+    stats.connects += connect;
+    if (c->method == HTTP_METHOD_GET) {
+        stats.gets++;
+    } else {
+        stats.writes++;
+        stats.body_bytes += (uint64_t)c->body_len;
+        size_t n = (size_t)c->body_len < sizeof(last_body) - 1 ? (size_t)c->body_len : sizeof(last_body) - 1;
+        memcpy(last_body, c->body != NULL ? c->body : "", n);
+        last_body[n] = '\0';
+    }
+    last_method = c->method;
+    if (c->method == HTTP_METHOD_GET) {
+        strlcpy(read_body, response_for(c->url), sizeof(read_body));
+    }
+    if (err != ESP_OK || status < 200 || status >= 300) {
+        stats.failures++;
+    }
+    pthread_mutex_unlock(&lock);
+
+    if (err != ESP_OK) {
+        c->connected = false;
+        return err;
+    }
+    if (connect) {
+        c->connected = true;
+        emit(c, HTTP_EVENT_ON_CONNECTED, NULL, 0);
+    }
+    c->status = status;
+    if (c->method == HTTP_METHOD_GET && status == 200) {
+        emit(c, HTTP_EVENT_ON_DATA, read_body, (int)strlen(read_body));
+    }
+    emit(c, HTTP_EVENT_ON_FINISH, NULL, 0);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t c, const char *url) {
+    strlcpy(c->url, url, sizeof(c->url));
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t c, esp_http_client_method_t method) {
+    c->method = method;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t c, const char *key, const char *value) {
+    (void)c;
+    (void)key;
+    (void)value;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_post_field(esp_http_client_handle_t c, const char *data, int len) {
+    c->body = data;
+    c->body_len = len;
+    return ESP_OK;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t c) {
+    return c->status;
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t c) {
+    c->connected = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t c) {
+    (void)c;
+    client_in_use = false;
+    return ESP_OK;
+}
+
+void mock_http_reset(void) {
+    pthread_mutex_lock(&lock);
+    stats = (mock_http_stats_t) { 0 };
+    next_error = ESP_OK;
+    next_status = 200;
+    last_body[0] = '\0';
+    memset(responses, 0, sizeof(responses));
+    pthread_mutex_unlock(&lock);
+}
+
+void mock_http_set_response(const char *path, const char *body) {
+    pthread_mutex_lock(&lock);
+    char match[sizeof(responses[0].match)];
+    snprintf(match, sizeof(match), "/%s.json", path);
+    size_t slot = MOCK_HTTP_MAX_RESPONSES;
+    for (size_t i = 0; i < MOCK_HTTP_MAX_RESPONSES; i++) {
+        if (strcmp(responses[i].match, match) == 0 ||
+            (slot == MOCK_HTTP_MAX_RESPONSES && responses[i].match[0] == '\0')) {
+            slot = i;
+        }
+    }
+    if (slot < MOCK_HTTP_MAX_RESPONSES) {
+        if (body != NULL) {
+            strlcpy(responses[slot].match, match, sizeof(responses[slot].match));
+            strlcpy(responses[slot].body, body, sizeof(responses[slot].body));
+        } else {
+            responses[slot].match[0] = '\0';
+        }
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+void mock_http_set_error(esp_err_t err) {
+    pthread_mutex_lock(&lock);
+    next_error = err;
+    pthread_mutex_unlock(&lock);
+}
+
+void mock_http_set_status(int status) {
+    pthread_mutex_lock(&lock);
+    next_status = status;
+    pthread_mutex_unlock(&lock);
+}
+
+void mock_http_get_stats(mock_http_stats_t *out) {
+    pthread_mutex_lock(&lock);
+    *out = stats;
+    pthread_mutex_unlock(&lock);
+}
+
+const char *mock_http_last_body(void) {
+    return last_body;
+}
+
+esp_http_client_method_t mock_http_last_method(void) {
+    return last_method;
+}
@@ -0,0 +1,14 @@
+#ifndef DRIVER_GPIO_H
+#define DRIVER_GPIO_H
+
+/**
+ * @file gpio.h
+ * @brief Host mock of the GPIO types used in pin definitions.
+ */
+
+#include "esp_err.h"
+#include <stdint.h>
+
+typedef int gpio_num_t;
+
+#endif // DRIVER_GPIO_H
@@ -0,0 +1,22 @@
+#ifndef RC522_SPI_H
+#define RC522_SPI_H
+
+/**
+ * @file rc522_spi.h
+ * @brief Host mock of the rc522 SPI transport: records the wiring of each reader.
+ */
+
+#include "rc522.h"
+#include "driver/spi_master.h"
+
+typedef struct {
+    spi_host_device_t host_id;
+    spi_bus_config_t *bus_config;            // NULL: the bus is already initialized
+    spi_device_interface_config_t dev_config;
+    int dma_chan;
+    int rst_io_num;
+} rc522_spi_config_t;
+
+esp_err_t rc522_spi_create(const rc522_spi_config_t *config, rc522_driver_handle_t *driver);
+
+#endif // RC522_SPI_H
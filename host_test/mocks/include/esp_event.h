@@ -0,0 +1,16 @@
+#ifndef ESP_EVENT_H
+#define ESP_EVENT_H
+
+/**
+ * @file esp_event.h
+ * @brief Host mock of the esp_event handler types used by the rc522 driver.
+ */
+
+#include "esp_err.h"
+#include <stdint.h>
+
+typedef const char *esp_event_base_t;
+typedef void (*esp_event_handler_t)(void *event_handler_arg, esp_event_base_t event_base,
+                                    int32_t event_id, void *event_data);
+
+#endif // ESP_EVENT_H
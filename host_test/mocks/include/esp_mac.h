@@ -0,0 +1,21 @@
+#ifndef ESP_MAC_H
+#define ESP_MAC_H
+
+/**
+ * @file esp_mac.h
+ * @brief Host mock of esp_read_mac(): a fixed station MAC.
+ */
+
+#include "esp_err.h"
+#include <stdint.h>
+
+typedef enum {
+    ESP_MAC_WIFI_STA,
+    ESP_MAC_WIFI_SOFTAP,
+    ESP_MAC_BT,
+    ESP_MAC_ETH,
+} esp_mac_type_t;
+
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type);
+
+#endif // ESP_MAC_H
@@ -0,0 +1,13 @@
+#ifndef ESP_RANDOM_H
+#define ESP_RANDOM_H
+
+/**
+ * @file esp_random.h
+ * @brief Host mock of the hardware RNG (seeded, so runs are repeatable).
+ */
+
+#include <stdint.h>
+
+uint32_t esp_random(void);
+
+#endif // ESP_RANDOM_H
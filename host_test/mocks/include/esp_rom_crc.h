@@ -0,0 +1,13 @@
+#ifndef ESP_ROM_CRC_H
+#define ESP_ROM_CRC_H
+
+/**
+ * @file esp_rom_crc.h
+ * @brief Host mock of the ROM CRC32 (little-endian, same results as the ESP32 ROM).
+ */
+
+#include <stdint.h>
+
+uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len);
+
+#endif // ESP_ROM_CRC_H
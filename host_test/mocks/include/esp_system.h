@@ -0,0 +1,15 @@
+#ifndef ESP_SYSTEM_H
+#define ESP_SYSTEM_H
+
+/**
+ * @file esp_system.h
+ * @brief Host mock of the restart hooks (mock_esp_restart() runs the shutdown handlers).
+ */
+
+#include "esp_err.h"
+
+typedef void (*shutdown_handler_t)(void);
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handler);
+
+#endif // ESP_SYSTEM_H
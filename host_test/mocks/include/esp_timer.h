@@ -0,0 +1,16 @@
+#ifndef ESP_TIMER_H
+#define ESP_TIMER_H
+
+/**
+ * @file esp_timer.h
+ * @brief Host mock of esp_timer: the monotonic clock plus a virtual offset (mock.h).
+ */
+
+#include <stdint.h>
+
+/**
+ * @brief Microseconds since the program started, plus mock_time_advance_us() jumps.
+ */
+int64_t esp_timer_get_time(void);
+
+#endif // ESP_TIMER_H
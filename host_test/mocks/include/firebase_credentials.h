@@ -0,0 +1,12 @@
+#ifndef FIREBASE_CREDENTIALS_H
+#define FIREBASE_CREDENTIALS_H
+
+/**
+ * @file firebase_credentials.h
+ * @brief Placeholder credentials for the host build (nothing leaves the process).
+ */
+
+#define FIREBASE_API_KEY    "host-api-key"
+#define FIREBASE_PROJECT_ID "host-test"
+
+#endif // FIREBASE_CREDENTIALS_H
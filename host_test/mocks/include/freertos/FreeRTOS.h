@@ -0,0 +1,85 @@
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+/**
+ * @file FreeRTOS.h
+ * @brief Host mock of the FreeRTOS kernel on POSIX threads.
+ *
+ * Tasks are threads, queues and semaphores share one mutex and condition
+ * variable, and every critical section takes one global recursive mutex.
+ * Priorities and core affinity are ignored. The tick is 1 ms of monotonic
+ * time; esp_timer virtual time (mock.h) does not move it.
+ */
+
+#include "sdkconfig.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint8_t StackType_t;
+
+#define pdTRUE  ((BaseType_t)1)
+#define pdFALSE ((BaseType_t)0)
+#define pdPASS  pdTRUE
+#define pdFAIL  pdFALSE
+
+#define configTICK_RATE_HZ      1000
+#define configMAX_PRIORITIES    25
+#define configMAX_TASK_NAME_LEN 16
+#define portTICK_PERIOD_MS      1
+#define portMAX_DELAY           ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(ms))
+#define pdTICKS_TO_MS(ticks)    ((uint32_t)(ticks))
+#define tskNO_AFFINITY          0x7FFFFFFF
+
+#define configASSERT(x) assert(x)
+
+/**
+ * @brief Spinlock placeholder: all critical sections share one lock on the host.
+ */
+typedef struct {
+    int unused;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+
+void vPortEnterCritical(portMUX_TYPE *mux);
+void vPortExitCritical(portMUX_TYPE *mux);
+
+#define portENTER_CRITICAL(mux)      vPortEnterCritical(mux)
+#define portEXIT_CRITICAL(mux)       vPortExitCritical(mux)
+#define portENTER_CRITICAL_ISR(mux)  vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_ISR(mux)   vPortExitCritical(mux)
+#define portENTER_CRITICAL_SAFE(mux) vPortEnterCritical(mux)
+#define portEXIT_CRITICAL_SAFE(mux)  vPortExitCritical(mux)
+#define portYIELD_FROM_ISR(x)        ((void)(x))
+
+/**
+ * @brief Queue (and semaphore: item_size 0) state, also the static storage for one.
+ */
+struct mock_queue {
+    uint8_t *storage;        // length * item_size bytes (NULL for semaphores)
+    UBaseType_t length;      // Capacity in items
+    UBaseType_t item_size;   // Bytes per item
+    UBaseType_t head;        // Index of the oldest item
+    UBaseType_t count;       // Items waiting (semaphore count)
+    bool dynamic;            // Allocated by xQueueCreate()
+    struct mock_queue *next; // All live queues (mock_freertos_wait_idle())
+};
+
+typedef struct mock_queue StaticQueue_t;
+typedef struct mock_queue StaticSemaphore_t;
+
+/**
+ * @brief Task storage for xTaskCreateStatic() (unused placeholder).
+ */
+typedef struct {
+    int unused;
+} StaticTask_t;
+
+#include <assert.h>
+
+#endif // INC_FREERTOS_H
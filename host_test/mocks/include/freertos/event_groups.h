@@ -0,0 +1,14 @@
+#ifndef EVENT_GROUPS_H
+#define EVENT_GROUPS_H
+
+/**
+ * @file event_groups.h
+ * @brief Host mock of the FreeRTOS event group types (declared by wifi.h; not implemented).
+ */
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct mock_event_group *EventGroupHandle_t;
+typedef uint32_t EventBits_t;
+
+#endif // EVENT_GROUPS_H
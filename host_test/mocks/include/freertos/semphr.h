@@ -0,0 +1,26 @@
+#ifndef SEMAPHORE_H
+#define SEMAPHORE_H
+
+/**
+ * @file semphr.h
+ * @brief Host mock of FreeRTOS semaphores: queues of zero-size items.
+ *
+ * A mutex is a binary semaphore created given; there is no priority
+ * inheritance and no owner check.
+ */
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic(StaticSemaphore_t *buffer);
+SemaphoreHandle_t xSemaphoreCreateMutexStatic(StaticSemaphore_t *buffer);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+
+#define xSemaphoreTake(sem, ticks) xQueueReceive(sem, NULL, ticks)
+#define xSemaphoreGive(sem)        xQueueSend(sem, NULL, 0)
+#define vSemaphoreDelete(sem)      vQueueDelete(sem)
+
+#endif // SEMAPHORE_H
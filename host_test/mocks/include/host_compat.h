@@ -0,0 +1,15 @@
+#ifndef HOST_COMPAT_H
+#define HOST_COMPAT_H
+
+/**
+ * @file host_compat.h
+ * @brief Newlib functions the firmware uses that older C libraries lack.
+ *
+ * Force-included by CMakeLists.txt only when the C library has no strlcpy().
+ */
+
+#include <stddef.h>
+
+size_t strlcpy(char *dst, const char *src, size_t size);
+
+#endif // HOST_COMPAT_H
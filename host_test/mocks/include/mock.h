@@ -0,0 +1,160 @@
+#ifndef MOCK_H
+#define MOCK_H
+
+/**
+ * @file mock.h
+ * @brief Controls of the host mocks: virtual time, restart, card taps, the mocked RTDB server,
+ *        flash and heap counters.
+ */
+
+#include "esp_err.h"
+#include "esp_http_client.h"
+#include "lcd_display.h" // For CardColor
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// --- Time ---
+
+/**
+ * @brief Move esp_timer time forward without waiting (dedupe windows, uptime stamps).
+ */
+void mock_time_advance_us(int64_t us);
+
+// --- Restart ---
+
+/**
+ * @brief Run the esp_register_shutdown_handler() handlers, as esp_restart() does before the reset.
+ */
+void mock_esp_restart(void);
+
+// --- FreeRTOS ---
+
+/**
+ * @brief Wait until every queue is empty and every task is blocked on a queue or semaphore.
+ *
+ * Gives the access path time to finish all reads handed to it so far.
+ */
+void mock_freertos_wait_idle(void);
+
+// --- rc522 driver ---
+
+/**
+ * @brief Present a card to a reader: the driver reports it active, on the calling thread.
+ *
+ * @return ESP_ERR_INVALID_STATE if the reader has no event handler yet.
+ */
+esp_err_t mock_rc522_tap(uint8_t reader, const uint8_t *uid, uint8_t uid_len);
+
+/**
+ * @brief Report a card leaving the field (a state change the firmware ignores).
+ */
+esp_err_t mock_rc522_remove(uint8_t reader, const uint8_t *uid, uint8_t uid_len);
+
+/**
+ * @brief Whether rc522_start() was called for the reader.
+ */
+bool mock_rc522_started(uint8_t reader);
+
+// --- Mocked RTDB server (esp_http_client) ---
+
+/**
+ * @brief Requests seen by the mocked server since mock_http_reset().
+ */
+typedef struct {
+    uint32_t requests;  // esp_http_client_perform() calls
+    uint32_t connects;  // Requests that opened a connection
+    uint32_t failures;  // Requests answered with a transport error or a non-2xx status
+    uint32_t gets;      // GET requests
+    uint32_t writes;    // POST, PUT and PATCH requests
+    uint64_t body_bytes; // Request body bytes sent
+} mock_http_stats_t;
+
+/**
+ * @brief Clear the counters, the failure setting and the responses, keep the connection.
+ */
+void mock_http_reset(void);
+
+/**
+ * @brief Answer every following request with a transport error (ESP_OK: answer normally).
+ */
+void mock_http_set_error(esp_err_t err);
+
+/**
+ * @brief Status code of the following requests (200 by default).
+ */
+void mock_http_set_status(int status);
+
+/**
+ * @brief Get the counters.
+ */
+void mock_http_get_stats(mock_http_stats_t *stats);
+
+/**
+ * @brief Body of the latest write request (NUL-terminated, "" if none).
+ */
+const char *mock_http_last_body(void);
+
+/**
+ * @brief Method of the latest request.
+ */
+esp_http_client_method_t mock_http_last_method(void);
+
+/**
+ * @brief Answer GET requests for a database path with a body instead of "null".
+ *
+ * @param path Path as the firmware requests it, e.g. "allowlist/deltas".
+ * @param body JSON document, or NULL to store nothing at the path again.
+ */
+void mock_http_set_response(const char *path, const char *body);
+
+// --- Flash ---
+
+/**
+ * @brief Erase every partition (first boot) and make all of them present.
+ */
+void mock_partition_reset(void);
+
+/**
+ * @brief Add or remove a partition from the table, by label.
+ */
+void mock_partition_set_present(const char *label, bool present);
+
+/**
+ * @brief Let the next n writes succeed, then fail every write (-1: never fail).
+ *
+ * A failing write programs the first half of its data before returning
+ * ESP_FAIL, like a program operation that was interrupted.
+ */
+void mock_partition_fail_writes_after(int n);
+
+// --- NVS ---
+
+/**
+ * @brief Forget everything stored in NVS.
+ */
+void mock_nvs_reset(void);
+
+// --- Modules the host build does not compile ---
+
+/**
+ * @brief Wi-Fi state reported by wifi_is_connected() (connected by default).
+ */
+void mock_wifi_set_connected(bool connected);
+
+/**
+ * @brief Number of display_show() calls for a state since the start.
+ */
+uint32_t mock_display_count(CardColor state);
+
+// --- Heap ---
+
+/**
+ * @brief malloc(), calloc() and realloc() calls made by the firmware and mocks so far.
+ *
+ * Counted by linking with -Wl,--wrap for the allocator functions; allocations
+ * inside the C library itself are not seen.
+ */
+uint64_t mock_alloc_count(void);
+
+#endif // MOCK_H
@@ -0,0 +1,11 @@
+#ifndef RC522_MIFARE_H
+#define RC522_MIFARE_H
+
+/**
+ * @file rc522_mifare.h
+ * @brief Host mock: MIFARE helpers are not used, only the PICC types.
+ */
+
+#include "picc/rc522_picc.h"
+
+#endif // RC522_MIFARE_H
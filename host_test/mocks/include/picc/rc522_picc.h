@@ -0,0 +1,43 @@
+#ifndef RC522_PICC_H
+#define RC522_PICC_H
+
+/**
+ * @file rc522_picc.h
+ * @brief Host mock of the rc522 card (PICC) types.
+ */
+
+#include "esp_err.h"
+#include <stdint.h>
+
+#define RC522_PICC_UID_SIZE_MAX            10
+#define RC522_PICC_UID_STR_BUFFER_SIZE_MAX (RC522_PICC_UID_SIZE_MAX * 3)
+
+typedef struct {
+    uint8_t value[RC522_PICC_UID_SIZE_MAX];
+    uint8_t length;
+} rc522_picc_uid_t;
+
+typedef enum {
+    RC522_PICC_STATE_IDLE = 0,
+    RC522_PICC_STATE_READY,
+    RC522_PICC_STATE_ACTIVE,
+    RC522_PICC_STATE_HALT,
+} rc522_picc_state_t;
+
+typedef struct {
+    rc522_picc_uid_t uid;
+    rc522_picc_state_t state;
+    int type;
+} rc522_picc_t;
+
+typedef struct {
+    rc522_picc_t *picc;
+    rc522_picc_state_t old_state;
+} rc522_picc_state_changed_event_t;
+
+/**
+ * @brief Format a UID as upper-case hex bytes separated by spaces ("99 B6 B3 02").
+ */
+esp_err_t rc522_picc_uid_to_str(const rc522_picc_uid_t *uid, char *buffer, uint32_t buffer_size);
+
+#endif // RC522_PICC_H
@@ -0,0 +1,38 @@
+#ifndef RC522_H
+#define RC522_H
+
+/**
+ * @file rc522.h
+ * @brief Host mock of the rc522 driver: cards are presented with mock_rc522_tap() (mock.h).
+ */
+
+#include "esp_err.h"
+#include "esp_event.h"
+#include "picc/rc522_picc.h"
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct rc522_driver *rc522_driver_handle_t;
+typedef struct rc522 *rc522_handle_t;
+
+typedef struct {
+    rc522_driver_handle_t driver;
+    uint32_t poll_interval_ms;
+    size_t task_stack_size;
+    uint32_t task_priority;
+} rc522_config_t;
+
+typedef enum {
+    RC522_EVENT_ANY = -1,
+    RC522_EVENT_NONE = 0,
+    RC522_EVENT_PICC_STATE_CHANGED,
+} rc522_event_t;
+
+esp_err_t rc522_driver_install(rc522_driver_handle_t driver);
+esp_err_t rc522_create(const rc522_config_t *config, rc522_handle_t *out_rc522);
+esp_err_t rc522_register_events(rc522_handle_t rc522, rc522_event_t event, esp_event_handler_t handler,
+                                void *arg);
+esp_err_t rc522_start(rc522_handle_t rc522);
+esp_err_t rc522_pause(rc522_handle_t rc522);
+
+#endif // RC522_H
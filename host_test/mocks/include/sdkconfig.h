@@ -0,0 +1,71 @@
+#ifndef SDKCONFIG_H
+#define SDKCONFIG_H
+
+/**
+ * @file sdkconfig.h
+ * @brief Host build configuration: the Kconfig.projbuild defaults of the modules built here.
+ *
+ * Keep in step with main/Kconfig.projbuild. Options left undefined are off,
+ * as in a default menuconfig.
+ */
+
+// Offline journal and allowlist
+#define CONFIG_JOURNAL_PARTITION_LABEL "journal"
+#define CONFIG_JOURNAL_RETRY_INTERVAL_MS 30000
+#define CONFIG_AUTHZ_PARTITION_A_LABEL "allow_a"
+#define CONFIG_AUTHZ_PARTITION_B_LABEL "allow_b"
+#define CONFIG_AUTHZ_SYNC_INTERVAL_S 300
+#define CONFIG_AUTHZ_SYNC_PAGE_DELTAS 8
+#define CONFIG_AUTHZ_SYNC_MAX_OPS 512
+#define CONFIG_AUTHZ_SYNC_RESPONSE_MAX 16384
+#define CONFIG_AUTHZ_BLOOM_BITS 8192
+#define CONFIG_AUTHZ_BLOOM_HASHES 4
+
+// RFID readers
+#define CONFIG_RFID_READER_COUNT 1
+#define CONFIG_RFID_DEDUPE_WINDOW_MS 2000
+#define CONFIG_RFID_DEDUPE_CACHE_SIZE 8
+#define CONFIG_RFID_POLL_INTERVAL_MS 125
+#define CONFIG_RFID_IDLE_INTERVAL_MS 1000
+#define CONFIG_RFID_IDLE_WINDOW_MS 250
+#define CONFIG_RFID_FAST_HOLD_MS 10000
+#define CONFIG_RFID_BUSY_START_HOUR 7
+#define CONFIG_RFID_BUSY_END_HOUR 19
+#define CONFIG_DISPLAY_HOLD_MS 3000
+
+// Firebase uploader
+#define CONFIG_FIREBASE_AUTH_REFRESH_MARGIN_S 300
+#define CONFIG_FIREBASE_LOG_QUEUE_LEN 32
+#define CONFIG_FIREBASE_BATCH_UPLOAD 1
+#define CONFIG_FIREBASE_BATCH_MAX_ENTRIES 16
+#define CONFIG_FIREBASE_BATCH_FLUSH_MS 1000
+#define CONFIG_FIREBASE_SHUTDOWN_FLUSH_MS 2000
+#define CONFIG_FIREBASE_STREAM 1
+#define CONFIG_FIREBASE_STREAM_SETTINGS 1
+#define CONFIG_WIFI_RETRY_BASE_MS 500
+#define CONFIG_WIFI_RETRY_MAX_MS 60000
+
+// Time
+#define CONFIG_TIMEBASE_TZ "IST-2IDT,M3.4.4/26,M10.5.0"
+#define CONFIG_TIME_SYNC_UPLOAD_HOLD_S 30
+
+// Diagnostics and memory
+#define CONFIG_TRACE_LATENCY 1
+#define CONFIG_TRACE_METRICS_INTERVAL_S 0
+#define CONFIG_MEM_STATIC_POOLS 1
+#define CONFIG_MEM_POOL_JSON_SMALL_BLOCKS 512
+#define CONFIG_MEM_POOL_JSON_LARGE_BLOCKS 8
+
+// Task layout
+#define CONFIG_TASK_LAYOUT_NET_CORE 0
+#define CONFIG_TASK_LAYOUT_ACCESS_CORE 1
+#define CONFIG_RFID_ACCESS_TASK_STACK_SIZE 4096
+#define CONFIG_RFID_ACCESS_TASK_PRIORITY 10
+#define CONFIG_RFID_ACCESS_QUEUE_LEN 8
+#define CONFIG_RFID_DRIVER_TASK_STACK_SIZE 4096
+#define CONFIG_RFID_DRIVER_TASK_PRIORITY 9
+#define CONFIG_FIREBASE_UPLOADER_STACK_SIZE 8192
+#define CONFIG_FIREBASE_UPLOADER_PRIORITY 5
+#define CONFIG_TASK_STACK_REPORT_INTERVAL_S 600
+
+#endif // SDKCONFIG_H
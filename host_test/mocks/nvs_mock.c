@@ -0,0 +1,162 @@
+/**
+ * @file nvs_mock.c
+ * @brief NVS as a small table of blobs in RAM.
+ */
+
+#include "nvs.h"
+#include "mock.h"       // mock_nvs_reset()
+
+#include <pthread.h>
+#include <string.h>     // For memcpy(), strcmp(), strlcpy()
+
+#define NVS_MOCK_ENTRIES  16
+#define NVS_MOCK_NAME_LEN 16
+#define NVS_MOCK_VALUE_MAX 1024
+
+/**
+ * @brief One stored key (u16 values are stored as 2-byte blobs).
+ */
+typedef struct {
+    char ns[NVS_MOCK_NAME_LEN];
+    char key[NVS_MOCK_NAME_LEN];
+    uint8_t value[NVS_MOCK_VALUE_MAX];
+    size_t len;
+    bool used;
+} nvs_entry_t;
+
+/**
+ * @brief One open handle.
+ */
+typedef struct {
+    char ns[NVS_MOCK_NAME_LEN];
+    bool writable;
+    bool open;
+} nvs_session_t;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static nvs_entry_t entries[NVS_MOCK_ENTRIES];
+static nvs_session_t sessions[4];
+
+static nvs_entry_t *find(const char *ns, const char *key) {
+    for (size_t i = 0; i < NVS_MOCK_ENTRIES; i++) {
+        if (entries[i].used && strcmp(entries[i].ns, ns) == 0 && strcmp(entries[i].key, key) == 0) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+static bool namespace_exists(const char *ns) {
+    for (size_t i = 0; i < NVS_MOCK_ENTRIES; i++) {
+        if (entries[i].used && strcmp(entries[i].ns, ns) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static nvs_session_t *session(nvs_handle_t handle) {
+    if (handle == 0 || handle > sizeof(sessions) / sizeof(sessions[0]) || !sessions[handle - 1].open) {
+        return NULL;
+    }
+    return &sessions[handle - 1];
+}
+
+esp_err_t nvs_open(const char *namespace_name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle) {
+    esp_err_t err = ESP_ERR_NO_MEM;
+    pthread_mutex_lock(&lock);
+    if (open_mode == NVS_READONLY && !namespace_exists(namespace_name)) {
+        err = ESP_ERR_NVS_NOT_FOUND;
+    } else {
+        for (size_t i = 0; i < sizeof(sessions) / sizeof(sessions[0]); i++) {
+            if (!sessions[i].open) {
+                strlcpy(sessions[i].ns, namespace_name, sizeof(sessions[i].ns));
+                sessions[i].writable = (open_mode == NVS_READWRITE);
+                sessions[i].open = true;
+                *out_handle = (nvs_handle_t)(i + 1);
+                err = ESP_OK;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    return err;
+}
+
+void nvs_close(nvs_handle_t handle) {
+    pthread_mutex_lock(&lock);
+    nvs_session_t *s = session(handle);
+    if (s != NULL) {
+        s->open = false;
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    return session(handle) != NULL ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length) {
+    esp_err_t err = ESP_OK;
+    pthread_mutex_lock(&lock);
+    nvs_session_t *s = session(handle);
+    nvs_entry_t *e = s != NULL ? find(s->ns, key) : NULL;
+    if (s == NULL) {
+        err = ESP_ERR_INVALID_ARG;
+    } else if (e == NULL) {
+        err = ESP_ERR_NVS_NOT_FOUND;
+    } else if (out_value == NULL) {
+        *length = e->len;
+    } else if (*length < e->len) {
+        err = ESP_ERR_INVALID_SIZE;
+    } else {
+        memcpy(out_value, e->value, e->len);
+        *length = e->len;
+    }
+    pthread_mutex_unlock(&lock);
+    return err;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length) {
+    esp_err_t err = ESP_OK;
+    pthread_mutex_lock(&lock);
+    nvs_session_t *s = session(handle);
+    nvs_entry_t *e = s != NULL ? find(s->ns, key) : NULL;
+    if (s == NULL || !s->writable) {
+        err = ESP_ERR_INVALID_ARG;
+    } else if (length > NVS_MOCK_VALUE_MAX) {
+        err = ESP_ERR_INVALID_SIZE;
+    } else {
+        for (size_t i = 0; e == NULL && i < NVS_MOCK_ENTRIES; i++) {
+            if (!entries[i].used) {
+                e = &entries[i];
+                e->used = true;
+                strlcpy(e->ns, s->ns, sizeof(e->ns));
+                strlcpy(e->key, key, sizeof(e->key));
+            }
+        }
+        if (e == NULL) {
+            err = ESP_ERR_NO_MEM;
+        } else {
+            memcpy(e->value, value, length);
+            e->len = length;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    return err;
+}
+
+esp_err_t nvs_get_u16(nvs_handle_t handle, const char *key, uint16_t *out_value) {
+    size_t len = sizeof(*out_value);
+    return nvs_get_blob(handle, key, out_value, &len);
+}
+
+esp_err_t nvs_set_u16(nvs_handle_t handle, const char *key, uint16_t value) {
+    return nvs_set_blob(handle, key, &value, sizeof(value));
+}
+
+void mock_nvs_reset(void) {
+    pthread_mutex_lock(&lock);
+    memset(entries, 0, sizeof(entries));
+    pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,148 @@
+/**
+ * @file partition_mock.c
+ * @brief RAM-backed data partitions with NOR flash write semantics.
+ */
+
+#include "esp_partition.h"
+#include "mock.h"          // mock_partition_*()
+
+#include <string.h>        // For memset(), strcmp()
+
+// Data partitions of partitions.csv
+#define JOURNAL_SIZE   0x40000
+#define ALLOWLIST_SIZE 0x80000
+
+/**
+ * @brief One partition and its contents.
+ */
+typedef struct {
+    esp_partition_t info;
+    uint8_t *data;
+    bool present;
+} mock_partition_t;
+
+static uint8_t journal_data[JOURNAL_SIZE];
+static uint8_t allow_a_data[ALLOWLIST_SIZE];
+static uint8_t allow_b_data[ALLOWLIST_SIZE];
+
+static mock_partition_t table[] = {
+    { { ESP_PARTITION_TYPE_DATA, 0x40, 0x190000, JOURNAL_SIZE, SPI_FLASH_SEC_SIZE, "journal", false },
+      journal_data, true },
+    { { ESP_PARTITION_TYPE_DATA, 0x41, 0x1D0000, ALLOWLIST_SIZE, SPI_FLASH_SEC_SIZE, "allow_a", false },
+      allow_a_data, true },
+    { { ESP_PARTITION_TYPE_DATA, 0x41, 0x250000, ALLOWLIST_SIZE, SPI_FLASH_SEC_SIZE, "allow_b", false },
+      allow_b_data, true },
+};
+
+#define PARTITION_COUNT (sizeof(table) / sizeof(table[0]))
+
+// Writes left before writes start failing (-1: unlimited)
+static int writes_left = -1;
+
+// First boot: flash is erased
+__attribute__((constructor)) static void erase_on_start(void) {
+    mock_partition_reset();
+}
+
+static mock_partition_t *lookup(const esp_partition_t *partition) {
+    for (size_t i = 0; i < PARTITION_COUNT; i++) {
+        if (&table[i].info == partition) {
+            return &table[i];
+        }
+    }
+    return NULL;
+}
+
+static bool in_range(const mock_partition_t *p, size_t offset, size_t size) {
+    return p != NULL && offset <= p->info.size && size <= p->info.size - offset;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label) {
+    for (size_t i = 0; i < PARTITION_COUNT; i++) {
+        const mock_partition_t *p = &table[i];
+        if (p->present && p->info.type == type &&
+            (subtype == ESP_PARTITION_SUBTYPE_ANY || p->info.subtype == subtype) &&
+            (label == NULL || strcmp(p->info.label, label) == 0)) {
+            return &p->info;
+        }
+    }
+    return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size) {
+    mock_partition_t *p = lookup(partition);
+    if (!in_range(p, src_offset, size)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(dst, p->data + src_offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size) {
+    mock_partition_t *p = lookup(partition);
+    if (!in_range(p, dst_offset, size)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    // A failing write is cut off halfway: the first half is programmed
+    bool fail = writes_left == 0;
+    if (writes_left > 0) {
+        writes_left--;
+    }
+
+    // Programming can only clear bits
+    const uint8_t *bytes = src;
+    for (size_t i = 0; i < (fail ? size / 2 : size); i++) {
+        p->data[dst_offset + i] &= bytes[i];
+    }
+    return fail ? ESP_FAIL : ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size) {
+    mock_partition_t *p = lookup(partition);
+    if (!in_range(p, offset, size)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (offset % p->info.erase_size != 0 || size % p->info.erase_size != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(p->data + offset, 0xFF, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t *partition, size_t offset, size_t size,
+                             esp_partition_mmap_memory_t memory, const void **out_ptr,
+                             esp_partition_mmap_handle_t *out_handle) {
+    (void)memory;
+    mock_partition_t *p = lookup(partition);
+    if (!in_range(p, offset, size)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_ptr = p->data + offset;
+    *out_handle = (esp_partition_mmap_handle_t)(p - table) + 1;
+    return ESP_OK;
+}
+
+void esp_partition_munmap(esp_partition_mmap_handle_t handle) {
+    (void)handle; // The data stays where it is
+}
+
+void mock_partition_reset(void) {
+    for (size_t i = 0; i < PARTITION_COUNT; i++) {
+        memset(table[i].data, 0xFF, table[i].info.size);
+        table[i].present = true;
+    }
+    writes_left = -1;
+}
+
+void mock_partition_set_present(const char *label, bool present) {
+    for (size_t i = 0; i < PARTITION_COUNT; i++) {
+        if (strcmp(table[i].info.label, label) == 0) {
+            table[i].present = present;
+        }
+    }
+}
+
+void mock_partition_fail_writes_after(int n) {
+    writes_left = n;
+}
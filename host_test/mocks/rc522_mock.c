@@ -0,0 +1,124 @@
+/**
+ * @file rc522_mock.c
+ * @brief rc522 driver and SPI transport without hardware: taps come from mock_rc522_tap().
+ */
+
+#include "rc522.h"
+#include "driver/rc522_spi.h"
+#include "mock.h"             // mock_rc522_*()
+
+#include <stdio.h>            // For snprintf()
+#include <string.h>           // For memcpy()
+
+#define MOCK_READERS 4
+
+/**
+ * @brief SPI transport of one reader.
+ */
+struct rc522_driver {
+    rc522_spi_config_t config;
+    bool installed;
+};
+
+/**
+ * @brief One scanner and the handler the firmware registered.
+ */
+struct rc522 {
+    rc522_config_t config;
+    esp_event_handler_t handler;
+    void *handler_arg;
+    bool started;
+};
+
+static struct rc522_driver drivers[MOCK_READERS];
+static struct rc522 scanners[MOCK_READERS];
+static size_t driver_count;
+static size_t scanner_count;
+
+esp_err_t rc522_spi_create(const rc522_spi_config_t *config, rc522_driver_handle_t *driver) {
+    if (driver_count >= MOCK_READERS) {
+        return ESP_ERR_NO_MEM;
+    }
+    drivers[driver_count].config = *config;
+    drivers[driver_count].config.bus_config = NULL; // Points into the caller's stack
+    *driver = &drivers[driver_count++];
+    return ESP_OK;
+}
+
+esp_err_t rc522_driver_install(rc522_driver_handle_t driver) {
+    driver->installed = true;
+    return ESP_OK;
+}
+
+esp_err_t rc522_create(const rc522_config_t *config, rc522_handle_t *out_rc522) {
+    if (scanner_count >= MOCK_READERS || config->driver == NULL || !config->driver->installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    scanners[scanner_count].config = *config;
+    *out_rc522 = &scanners[scanner_count++];
+    return ESP_OK;
+}
+
+esp_err_t rc522_register_events(rc522_handle_t rc522, rc522_event_t event, esp_event_handler_t handler,
+                                void *arg) {
+    if (event != RC522_EVENT_PICC_STATE_CHANGED && event != RC522_EVENT_ANY) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    rc522->handler = handler;
+    rc522->handler_arg = arg;
+    return ESP_OK;
+}
+
+esp_err_t rc522_start(rc522_handle_t rc522) {
+    rc522->started = true;
+    return ESP_OK;
+}
+
+esp_err_t rc522_pause(rc522_handle_t rc522) {
+    rc522->started = false;
+    return ESP_OK;
+}
+
+esp_err_t rc522_picc_uid_to_str(const rc522_picc_uid_t *uid, char *buffer, uint32_t buffer_size) {
+    if (buffer_size < (uint32_t)uid->length * 3 || uid->length == 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    for (uint8_t i = 0; i < uid->length; i++) {
+        snprintf(buffer + i * 3, buffer_size - i * 3u, i + 1 < uid->length ? "%02X " : "%02X", uid->value[i]);
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Send one state change of a card to the reader's handler.
+ */
+static esp_err_t report(uint8_t reader, const uint8_t *uid, uint8_t uid_len, rc522_picc_state_t old_state,
+                        rc522_picc_state_t state) {
+    if (reader >= scanner_count || scanners[reader].handler == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (uid_len == 0 || uid_len > RC522_PICC_UID_SIZE_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    rc522_picc_t picc = { .state = state };
+    memcpy(picc.uid.value, uid, uid_len);
+    picc.uid.length = uid_len;
+    rc522_picc_state_changed_event_t event = { .picc = &picc, .old_state = old_state };
+
+    struct rc522 *s = &scanners[reader];
+    s->handler(s->handler_arg, "RC522_EVENTS", RC522_EVENT_PICC_STATE_CHANGED, &event);
+    return ESP_OK;
+}
+
+esp_err_t mock_rc522_tap(uint8_t reader, const uint8_t *uid, uint8_t uid_len) {
+    return report(reader, uid, uid_len, RC522_PICC_STATE_IDLE, RC522_PICC_STATE_ACTIVE);
+}
+
+esp_err_t mock_rc522_remove(uint8_t reader, const uint8_t *uid, uint8_t uid_len) {
+    return report(reader, uid, uid_len, RC522_PICC_STATE_ACTIVE, RC522_PICC_STATE_IDLE);
+}
+
+bool mock_rc522_started(uint8_t reader) {
+    return reader < scanner_count && scanners[reader].started;
+}
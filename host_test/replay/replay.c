@@ -0,0 +1,419 @@
+/**
+ * @file replay.c
+ * @brief Replays synthetic tap traces through the access path and the uploader.
+ *
+ * Taps enter at the mocked rc522 driver and take the firmware's own path:
+ * duplicate filter, local decision (authz index), display request, offline
+ * journal, log serializer and the batched upload to the mocked RTDB server.
+ *
+ * Per scenario it reports throughput, exact p50/p99 latencies from the tap to
+ * the decision and to the upload queue, and heap allocations per event. With
+ * --check it exits non-zero if the counters differ from what the trace implies.
+ *
+ *   replay_bench [--cards N] [--check]
+ */
+
+#include "authz.h"
+#include "decision.h"
+#include "firebase.h"
+#include "journal.h"
+#include "mem_pool.h"
+#include "rfid.h"
+#include "settings.h"
+#include "timebase.h"
+#include "trace.h"
+#include "esp_log.h"
+#include "mock.h"
+
+#include <stdio.h>
+#include <stdlib.h>   // For qsort(), strtoul()
+#include <string.h>
+#include <time.h>     // For clock_gettime()
+
+// Read queue of the access task: taps per burst that can never be dropped
+#define BURST CONFIG_RFID_ACCESS_QUEUE_LEN
+
+// Longest trace of one scenario
+#define MAX_SAMPLES 65536
+
+// Known cards: 4-byte UIDs; every 10th one is blocked
+#define MAX_CARDS     4096
+#define DEFAULT_CARDS 500
+#define BLOCKED_EVERY 10
+
+// Repeat reads of one held badge, and the time between them
+#define HELD_READS      10
+#define HELD_PERIOD_US  100000
+
+// 2023-11-14T22:13:20Z
+#define REFERENCE_US 1700000000000000LL
+
+/**
+ * @brief Exact latencies of one span, collected by the trace_record() wrapper.
+ */
+typedef struct {
+    uint32_t us[MAX_SAMPLES];
+    size_t count;
+} samples_t;
+
+static samples_t decision_samples;
+static samples_t upload_samples;
+
+static uint32_t card_count = DEFAULT_CARDS;
+static bool check = false;
+static int failures = 0;
+
+// Linked with -Wl,--wrap=trace_record: every span the firmware records also lands here
+void __real_trace_record(trace_span_t span, int64_t tap_us);
+
+void __wrap_trace_record(trace_span_t span, int64_t tap_us) {
+    samples_t *s = (span == TRACE_SPAN_DECISION) ? &decision_samples :
+                   (span == TRACE_SPAN_UPLOAD_QUEUED) ? &upload_samples : NULL;
+    if (s != NULL && tap_us != 0 && s->count < MAX_SAMPLES) {
+        s->us[s->count++] = (uint32_t)(esp_timer_get_time() - tap_us); // Access task only
+    }
+    __real_trace_record(span, tap_us);
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Nearest-rank percentile of the samples (sorts them).
+ */
+static uint32_t percentile(samples_t *s, uint32_t pct) {
+    if (s->count == 0) {
+        return 0;
+    }
+    qsort(s->us, s->count, sizeof(s->us[0]), compare_u32);
+    size_t rank = (s->count * pct + 99) / 100;
+    return s->us[rank > 0 ? rank - 1 : 0];
+}
+
+static double wall_seconds(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec / 1e9;
+}
+
+static void known_uid(uint32_t i, uint8_t uid[4]) {
+    uid[0] = 0xC0;
+    uid[1] = (uint8_t)(i >> 16);
+    uid[2] = (uint8_t)(i >> 8);
+    uid[3] = (uint8_t)i;
+}
+
+static void unknown_uid(uint32_t i, uint8_t uid[7]) {
+    static const uint8_t prefix[3] = { 0x04, 0x5E, 0x77 };
+    memcpy(uid, prefix, sizeof(prefix));
+    uid[3] = (uint8_t)(i >> 24);
+    uid[4] = (uint8_t)(i >> 16);
+    uid[5] = (uint8_t)(i >> 8);
+    uid[6] = (uint8_t)i;
+}
+
+static void tap_known(uint32_t i) {
+    uint8_t uid[4];
+    known_uid(i, uid);
+    mock_rc522_tap(0, uid, sizeof(uid));
+}
+
+static void tap_unknown(uint32_t i) {
+    uint8_t uid[7];
+    unknown_uid(i, uid);
+    mock_rc522_tap(0, uid, sizeof(uid));
+}
+
+/**
+ * @brief Counters a scenario is checked against.
+ */
+typedef struct {
+    uint32_t taps;
+    uint32_t events;
+    uint32_t suppressed;
+    uint32_t granted;
+    bool may_drop; // Taps faster than the access task: drops allowed
+} expected_t;
+
+/**
+ * @brief Counter snapshot around a scenario.
+ */
+typedef struct {
+    rfid_stats_t rfid;
+    decision_stats_t decision;
+    firebase_upload_stats_t upload;
+    mock_http_stats_t http;
+    uint64_t allocs;
+    double wall;
+} snapshot_t;
+
+static void take_snapshot(snapshot_t *s) {
+    rfid_get_stats(&s->rfid);
+    decision_get_stats(&s->decision);
+    firebase_get_upload_stats(&s->upload);
+    mock_http_get_stats(&s->http);
+    s->allocs = mock_alloc_count();
+    s->wall = wall_seconds();
+}
+
+#define EXPECT(what, actual, expected) do {                                              \
+        if (check && (uint64_t)(actual) != (uint64_t)(expected)) {                       \
+            fprintf(stderr, "%s: %s is %llu, expected %llu\n", name, what,               \
+                    (unsigned long long)(actual), (unsigned long long)(expected));       \
+            failures++;                                                                  \
+        }                                                                                \
+    } while (0)
+
+/**
+ * @brief Run one trace, wait for the access path and the uploader, report and check.
+ */
+static void run_scenario(const char *name, void (*trace)(expected_t *)) {
+    decision_samples.count = 0;
+    upload_samples.count = 0;
+    mock_time_advance_us(10000000); // Every earlier card out of the dedupe window
+
+    snapshot_t before, access, after;
+    expected_t expected = { 0 };
+    take_snapshot(&before);
+    trace(&expected);
+    mock_freertos_wait_idle();
+    take_snapshot(&access);
+    esp_err_t flushed = firebase_flush_logs(pdMS_TO_TICKS(10000));
+    take_snapshot(&after);
+
+    uint32_t reads = access.rfid.reads - before.rfid.reads;
+    uint32_t events = access.rfid.events - before.rfid.events;
+    uint32_t suppressed = access.rfid.suppressed - before.rfid.suppressed;
+    uint32_t dropped = access.rfid.dropped - before.rfid.dropped;
+    uint32_t granted = access.decision.granted - before.decision.granted;
+    uint32_t uploaded = after.upload.uploaded - before.upload.uploaded;
+    uint64_t access_allocs = access.allocs - before.allocs;
+    uint64_t upload_allocs = after.allocs - access.allocs;
+    double seconds = access.wall - before.wall;
+    uint32_t decision_p50 = percentile(&decision_samples, 50), decision_p99 = percentile(&decision_samples, 99);
+    uint32_t upload_p50 = percentile(&upload_samples, 50), upload_p99 = percentile(&upload_samples, 99);
+
+    printf("%-8s %6u %6u %6u %6u %6u %6u %10.0f %7u %7u %7u %7u %6.2f %6.2f %6u %6u\n", name,
+           expected.taps, reads, events, suppressed, dropped, granted,
+           seconds > 0 ? events / seconds : 0.0, decision_p50, decision_p99, upload_p50, upload_p99,
+           events ? (double)access_allocs / events : 0.0, events ? (double)upload_allocs / events : 0.0,
+           uploaded, after.http.requests - before.http.requests);
+
+    EXPECT("flush", flushed, ESP_OK);
+    EXPECT("reads + dropped", reads + dropped, expected.taps);
+    if (expected.may_drop) {
+        // Only taps that reached the access task become events; all are distinct unknown cards
+        EXPECT("events", events, reads);
+        EXPECT("granted", granted, 0);
+    } else {
+        EXPECT("dropped", dropped, 0);
+        EXPECT("events", events, expected.events);
+        EXPECT("suppressed", suppressed, expected.suppressed);
+        EXPECT("granted", granted, expected.granted);
+    }
+    EXPECT("decision samples", decision_samples.count, events);
+    EXPECT("upload samples", upload_samples.count, events);
+    EXPECT("uploaded", uploaded, events);
+    EXPECT("queue failures", access.decision.queue_failures - before.decision.queue_failures, 0);
+    EXPECT("upload failures", after.upload.failed - before.upload.failed, 0);
+    EXPECT("access path allocations", access_allocs, 0);
+    EXPECT("upload allocations", upload_allocs, 0);
+}
+
+/**
+ * @brief Every known card once, in bursts of one read queue.
+ */
+static void trace_known(expected_t *e) {
+    for (uint32_t i = 0; i < card_count; i++) {
+        tap_known(i);
+        if ((i + 1) % BURST == 0) {
+            mock_freertos_wait_idle();
+        }
+        e->granted += (i % BLOCKED_EVERY) != 0;
+    }
+    e->taps = e->events = card_count;
+}
+
+/**
+ * @brief Badges held on the reader: HELD_READS reads each, HELD_PERIOD_US apart.
+ */
+static void trace_held(expected_t *e) {
+    uint32_t badges = card_count < 64 ? card_count : 64;
+    for (uint32_t i = 0; i < badges; i++) {
+        for (uint32_t r = 0; r < HELD_READS; r++) {
+            tap_known(i);
+            mock_freertos_wait_idle(); // The filter compares the time the access task sees the read
+            mock_time_advance_us(HELD_PERIOD_US);
+        }
+        e->granted += (i % BLOCKED_EVERY) != 0;
+    }
+    e->taps = badges * HELD_READS;
+    e->events = badges;
+    e->suppressed = badges * (HELD_READS - 1);
+}
+
+/**
+ * @brief Unknown cards only (the Bloom filter path), in bursts of one read queue.
+ */
+static void trace_unknown(expected_t *e) {
+    uint32_t count = card_count * 4;
+    for (uint32_t i = 0; i < count; i++) {
+        tap_unknown(i);
+        if ((i + 1) % BURST == 0) {
+            mock_freertos_wait_idle();
+        }
+    }
+    e->taps = e->events = count;
+}
+
+/**
+ * @brief Groups of a known card, an unknown card, a bounce of the known card
+ *        and a blocked card, each group 3 s after the previous one.
+ */
+static void trace_mixed(expected_t *e) {
+    uint32_t groups = card_count / 2;
+    for (uint32_t g = 0; g < groups; g++) {
+        uint32_t user = 1 + g % (card_count - 1);
+        if (user % BLOCKED_EVERY == 0) {
+            user--;
+        }
+        uint32_t blocked = (g % (card_count / BLOCKED_EVERY)) * BLOCKED_EVERY;
+        tap_known(user);
+        tap_unknown(0x10000 + g);
+        tap_known(user); // Bounce: still within the dedupe window
+        tap_known(blocked);
+        mock_freertos_wait_idle();
+        mock_time_advance_us(3000000);
+    }
+    e->taps = groups * 4;
+    e->events = groups * 3;
+    e->suppressed = groups;
+    e->granted = groups;
+}
+
+/**
+ * @brief Bursts of four read queues at once: drops are expected and must be counted.
+ */
+static void trace_overload(expected_t *e) {
+    uint32_t count = 0;
+    esp_log_level_set("rfid_reader", ESP_LOG_ERROR); // One warning per dropped read
+    for (uint32_t b = 0; b < 16; b++) {
+        for (uint32_t i = 0; i < 4 * BURST; i++) {
+            tap_unknown(0x20000 + count++);
+        }
+        mock_freertos_wait_idle();
+    }
+    esp_log_level_set("rfid_reader", ESP_LOG_WARN);
+    e->taps = count;
+    e->may_drop = true;
+}
+
+/**
+ * @brief A few taps, then a restart: the shutdown handler uploads them before the reset.
+ */
+static void check_restart(void) {
+    const char *name = "restart";
+    mock_time_advance_us(10000000);
+
+    firebase_upload_stats_t before, after;
+    firebase_get_upload_stats(&before);
+    for (uint32_t i = 1; i <= 3; i++) {
+        tap_known(i);
+    }
+    mock_freertos_wait_idle();
+    mock_esp_restart(); // Well inside the batch deadline
+    firebase_get_upload_stats(&after);
+    EXPECT("uploaded", after.uploaded - before.uploaded, 3);
+}
+
+/**
+ * @brief Boot the modules the access path needs, in the order app_main() does.
+ */
+static bool setup(void) {
+    if (mem_pool_json_init() != ESP_OK) {
+        return false;
+    }
+    settings_init();
+    timebase_init();
+    timebase_resync(REFERENCE_US); // Uploads wait for the clock
+
+    if (authz_init() != ESP_OK) {
+        return false;
+    }
+    static authz_entry_t ops[MAX_CARDS];
+    for (uint32_t i = 0; i < card_count; i++) {
+        uint8_t uid[4];
+        known_uid(i, uid);
+        authz_make_entry(uid, sizeof(uid), (i % BLOCKED_EVERY) ? AUTHZ_ROLE_USER : AUTHZ_ROLE_BLOCKED, &ops[i]);
+    }
+    if (authz_apply_delta(ops, card_count, 1) != ESP_OK) {
+        return false;
+    }
+
+    journal_init();
+    return firebase_uploader_start() == ESP_OK && rfid_reader_init() == ESP_OK &&
+           mock_rc522_started(0);
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--check") == 0) {
+            check = true;
+        } else if (strcmp(argv[i], "--cards") == 0 && i + 1 < argc) {
+            card_count = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else {
+            fprintf(stderr, "usage: %s [--cards N] [--check]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (card_count < BLOCKED_EVERY || card_count > MAX_CARDS) {
+        fprintf(stderr, "--cards must be %d..%d\n", BLOCKED_EVERY, MAX_CARDS);
+        return 2;
+    }
+
+    if (!setup()) {
+        fprintf(stderr, "setup failed\n");
+        return 1;
+    }
+    firebase_flush_logs(pdMS_TO_TICKS(10000)); // Boot-time syncs out of the way
+
+    printf("%u known cards, read queue %d, dedupe window %u ms\n", card_count, BURST,
+           (unsigned)settings_get()->rfid_dedupe_window_ms);
+    printf("%-8s %6s %6s %6s %6s %6s %6s %10s %7s %7s %7s %7s %6s %6s %6s %6s\n", "trace", "taps", "reads",
+           "events", "supp", "drop", "grant", "events/s", "dec_p50", "dec_p99", "upl_p50", "upl_p99",
+           "alloc", "ualloc", "upload", "reqs");
+    printf("%64s%s\n", "", "(latencies in us from the tap; allocations per event)");
+
+    run_scenario("known", trace_known);
+    run_scenario("held", trace_held);
+    run_scenario("unknown", trace_unknown);
+    run_scenario("mixed", trace_mixed);
+    run_scenario("overload", trace_overload);
+    check_restart();
+
+    firebase_upload_stats_t upload;
+    mock_http_stats_t http;
+    authz_filter_stats_t filter;
+    firebase_get_upload_stats(&upload);
+    mock_http_get_stats(&http);
+    authz_get_filter_stats(&filter);
+    printf("uploaded %u records in %u batches, %llu body bytes (%.1f per record), journal pending %u\n",
+           upload.uploaded, upload.batches, (unsigned long long)http.body_bytes,
+           upload.uploaded ? (double)http.body_bytes / upload.uploaded : 0.0, journal_pending_count());
+    printf("bloom filter: %u rejects, %u table lookups, %u false positives\n", filter.rejects,
+           filter.lookups, filter.false_positives);
+
+    const char *name = "total";
+    EXPECT("journal pending", journal_pending_count(), 0);
+#if CONFIG_JOURNAL_ALL_DECISIONS
+    EXPECT("journaled", upload.journaled, upload.enqueued); // Write-behind
+#else
+    EXPECT("journaled", upload.journaled, 0); // No upload failed
+#endif
+    if (check) {
+        printf("%s\n", failures ? "CHECK FAILED" : "CHECK PASSED");
+    }
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,145 @@
+/**
+ * @file test_authz.c
+ * @brief Tests of the allowlist index (authz.h) on mocked A/B flash partitions.
+ *
+ * authz_init() runs once per process, so the tests build on each other:
+ * first boot on erased flash, then a sequence of deltas.
+ */
+
+#include "authz.h"
+#include "mock.h"
+#include "sdkconfig.h"
+#include "test_util.h"
+
+static const uint8_t CARD[] = { 0x99, 0xB6, 0xB3, 0x02 };  // Built-in user
+static const uint8_t CHIP[] = { 0x25, 0x0F, 0xC5, 0x01 };  // Built-in user
+static const uint8_t NEW7[] = { 0x04, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66 };
+static const uint8_t NEW10[] = { 0x08, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+
+static authz_entry_t entry(const uint8_t *uid, uint8_t len, uint8_t role) {
+    authz_entry_t e;
+    authz_make_entry(uid, len, role, &e);
+    return e;
+}
+
+static void test_make_entry(void) {
+    authz_entry_t e;
+    CHECK(authz_make_entry(NEW7, sizeof(NEW7), AUTHZ_ROLE_USER, &e));
+    CHECK_INT(e.uid_len, 7);
+    CHECK_INT(e.uid[6], 0x66);
+    CHECK_INT(e.uid[7], 0); // Zero padding
+    CHECK_INT(e.role, AUTHZ_ROLE_USER);
+    CHECK(!authz_make_entry(NEW7, 0, AUTHZ_ROLE_USER, &e));
+    CHECK(!authz_make_entry(NEW7, AUTHZ_UID_MAX_LEN + 1, AUTHZ_ROLE_USER, &e));
+}
+
+static void test_first_boot(void) {
+    CHECK(!authz_lookup(CARD, sizeof(CARD), NULL)); // Not initialized yet
+    CHECK_INT(authz_init(), ESP_OK);
+    CHECK_INT(authz_get_version(), 0);
+    CHECK_INT(authz_count(), 2);
+
+    authz_role_t role = AUTHZ_ROLE_BLOCKED;
+    CHECK(authz_lookup(CARD, sizeof(CARD), &role));
+    CHECK_INT(role, AUTHZ_ROLE_USER);
+    role = AUTHZ_ROLE_BLOCKED;
+    CHECK(authz_lookup(CHIP, sizeof(CHIP), &role));
+    CHECK_INT(role, AUTHZ_ROLE_USER);
+    CHECK(authz_lookup(CHIP, sizeof(CHIP), NULL));
+}
+
+static void test_delta_add_remove(void) {
+    authz_entry_t ops[] = {
+        entry(NEW10, sizeof(NEW10), AUTHZ_ROLE_USER),
+        entry(CHIP, sizeof(CHIP), AUTHZ_ROLE_REMOVE),
+        entry(NEW7, sizeof(NEW7), AUTHZ_ROLE_BLOCKED),
+    };
+    CHECK_INT(authz_apply_delta(ops, 3, 5), ESP_OK); // Written to B
+    CHECK_INT(authz_get_version(), 5);
+    CHECK_INT(authz_count(), 3);
+
+    authz_role_t role = AUTHZ_ROLE_USER;
+    CHECK(authz_lookup(NEW7, sizeof(NEW7), &role));
+    CHECK_INT(role, AUTHZ_ROLE_BLOCKED);
+    CHECK(authz_lookup(NEW10, sizeof(NEW10), &role));
+    CHECK_INT(role, AUTHZ_ROLE_USER);
+    CHECK(authz_lookup(CARD, sizeof(CARD), NULL));
+    CHECK(!authz_lookup(CHIP, sizeof(CHIP), NULL));
+
+    // Back to A: update a role, remove a card that is not there
+    authz_entry_t ops2[] = {
+        entry(NEW7, sizeof(NEW7), AUTHZ_ROLE_USER),
+        entry(CHIP, sizeof(CHIP), AUTHZ_ROLE_REMOVE),
+    };
+    CHECK_INT(authz_apply_delta(ops2, 2, 6), ESP_OK);
+    CHECK_INT(authz_get_version(), 6);
+    CHECK_INT(authz_count(), 3);
+    CHECK(authz_lookup(NEW7, sizeof(NEW7), &role));
+    CHECK_INT(role, AUTHZ_ROLE_USER);
+}
+
+static void test_stale_version(void) {
+    authz_entry_t op = entry(CHIP, sizeof(CHIP), AUTHZ_ROLE_USER);
+    CHECK_INT(authz_apply_delta(&op, 1, 6), ESP_ERR_INVALID_VERSION);
+    CHECK_INT(authz_apply_delta(&op, 1, 2), ESP_ERR_INVALID_VERSION);
+    CHECK_INT(authz_get_version(), 6);
+    CHECK(!authz_lookup(CHIP, sizeof(CHIP), NULL));
+}
+
+static void test_failed_write_keeps_table(void) {
+    authz_entry_t op = entry(CHIP, sizeof(CHIP), AUTHZ_ROLE_USER);
+    mock_partition_fail_writes_after(0);
+    CHECK(authz_apply_delta(&op, 1, 7) != ESP_OK);
+    mock_partition_fail_writes_after(-1);
+
+    CHECK_INT(authz_get_version(), 6);
+    CHECK_INT(authz_count(), 3);
+    CHECK(!authz_lookup(CHIP, sizeof(CHIP), NULL));
+    CHECK(authz_lookup(NEW10, sizeof(NEW10), NULL));
+
+    // The same version applies once flash works again
+    CHECK_INT(authz_apply_delta(&op, 1, 7), ESP_OK);
+    CHECK(authz_lookup(CHIP, sizeof(CHIP), NULL));
+}
+
+static void test_large_table(void) {
+    // 500 4-byte UIDs in one delta; every one found, others mostly rejected by the filter
+    static authz_entry_t ops[500];
+    for (uint32_t i = 0; i < 500; i++) {
+        uint8_t uid[4] = { 0xA0, (uint8_t)(i >> 16), (uint8_t)(i >> 8), (uint8_t)i };
+        ops[i] = entry(uid, sizeof(uid), AUTHZ_ROLE_USER);
+    }
+    CHECK_INT(authz_apply_delta(ops, 500, 8), ESP_OK);
+    CHECK_INT(authz_count(), 504); // 4 cards from the earlier deltas
+
+    bool all_found = true;
+    for (uint32_t i = 0; i < 500; i++) {
+        uint8_t uid[4] = { 0xA0, (uint8_t)(i >> 16), (uint8_t)(i >> 8), (uint8_t)i };
+        all_found &= authz_lookup(uid, sizeof(uid), NULL);
+    }
+    CHECK(all_found);
+
+    authz_filter_stats_t before, after;
+    authz_get_filter_stats(&before);
+    uint32_t found = 0;
+    for (uint32_t i = 0; i < 10000; i++) {
+        uint8_t uid[4] = { 0x5A, (uint8_t)(i >> 16), (uint8_t)(i >> 8), (uint8_t)i };
+        found += authz_lookup(uid, sizeof(uid), NULL);
+    }
+    authz_get_filter_stats(&after);
+    CHECK_INT(found, 0);
+    CHECK_INT((after.rejects - before.rejects) + (after.lookups - before.lookups), 10000);
+    CHECK_INT(after.false_positives - before.false_positives, after.lookups - before.lookups);
+    CHECK(after.rejects - before.rejects > 9800); // Most unknown cards never reach the table
+    CHECK_INT(after.bits, CONFIG_AUTHZ_BLOOM_BITS);
+}
+
+int main(void) {
+    RUN_TEST(test_make_entry);
+    RUN_TEST(test_first_boot);
+    RUN_TEST(test_delta_add_remove);
+    RUN_TEST(test_stale_version);
+    RUN_TEST(test_failed_write_keeps_table);
+    RUN_TEST(test_large_table);
+    return TEST_RESULT();
+}
@@ -0,0 +1,164 @@
+/**
+ * @file test_firebase.c
+ * @brief Tests of the allowlist and settings sync (firebase.h) against the mocked database.
+ *
+ * The uploader is started once, as app_main() does, so the tests build on
+ * each other: a delta page pulled by the uploader, then stream events on
+ * top of it, then a settings pull.
+ */
+
+#include "authz.h"
+#include "firebase.h"
+#include "journal.h"
+#include "mem_pool.h"
+#include "settings.h"
+#include "timebase.h"
+#include "mock.h"
+#include "sdkconfig.h"
+#include "test_util.h"
+
+#include <stdio.h>
+
+static const uint8_t UID1[] = { 0xC0, 0x00, 0x00, 0x01 };
+static const uint8_t UID2[] = { 0xC0, 0x00, 0x00, 0x02 };
+static const uint8_t UID7[] = { 0x04, 0xA1, 0xB2, 0xC3, 0xD4, 0xE5, 0xF6 };
+static const uint8_t UID9[] = { 0xC0, 0x00, 0x00, 0x09 };
+
+/**
+ * @brief Role of a UID in the local allowlist, -1 if it is not listed.
+ */
+static int role_of(const uint8_t *uid, uint8_t len) {
+    authz_role_t role;
+    return authz_lookup(uid, len, &role) ? (int)role : -1;
+}
+
+/**
+ * @brief Let the uploader handle the requests queued so far.
+ */
+static void wait_uploader(void) {
+    CHECK_INT(firebase_flush_logs(pdMS_TO_TICKS(1000)), ESP_OK);
+    mock_freertos_wait_idle();
+}
+
+static void test_start(void) {
+    mock_partition_reset();
+    mock_nvs_reset();
+    CHECK_INT(mem_pool_json_init(), ESP_OK);
+    CHECK_INT(settings_init(), ESP_OK);
+    timebase_init();
+    timebase_resync(1700000000000000LL);
+    CHECK_INT(authz_init(), ESP_OK);
+    journal_init();
+    CHECK_INT(firebase_uploader_start(), ESP_OK);
+    wait_uploader(); // First sync: the database is empty ("null")
+    CHECK_INT(authz_get_version(), 0);
+}
+
+static void test_pull_deltas(void) {
+    // Unordered, as the REST API returns them; v2 blocks what v1 granted
+    mock_http_set_response("allowlist/deltas",
+                           "{\"2\": {\"C0000002\": \"blocked\", \"bad-uid\": \"user\"},"
+                           " \"1\": {\"C0000001\": \"user\", \"C0000002\": \"user\"}}");
+    firebase_request_allowlist_sync();
+    wait_uploader();
+
+    CHECK_INT(authz_get_version(), 2);
+    CHECK_INT(role_of(UID1, sizeof(UID1)), AUTHZ_ROLE_USER);
+    CHECK_INT(role_of(UID2, sizeof(UID2)), AUTHZ_ROLE_BLOCKED);
+
+    // The next page starts after the local version; the same deltas again change nothing
+    firebase_request_allowlist_sync();
+    wait_uploader();
+    CHECK_INT(authz_get_version(), 2);
+    mock_http_set_response("allowlist/deltas", NULL);
+}
+
+static void test_stream_one_version(void) {
+    CHECK_INT(firebase_apply_allowlist_event(
+                  "{\"path\": \"/3\", \"data\": {\"C0000001\": \"removed\", \"04A1B2C3D4E5F6\": \"user\"}}"),
+              ESP_OK);
+    CHECK_INT(authz_get_version(), 3);
+    CHECK_INT(role_of(UID1, sizeof(UID1)), -1);
+    CHECK_INT(role_of(UID7, sizeof(UID7)), AUTHZ_ROLE_USER);
+
+    // Replayed by the stream after a reconnect: already applied
+    CHECK_INT(firebase_apply_allowlist_event("{\"path\": \"/2\", \"data\": {\"C0000009\": \"user\"}}"), ESP_OK);
+    CHECK_INT(authz_get_version(), 3);
+    CHECK_INT(role_of(UID9, sizeof(UID9)), -1);
+}
+
+static void test_stream_snapshot(void) {
+    CHECK_INT(firebase_apply_allowlist_event(
+                  "{\"path\": \"/\", \"data\": {\"5\": {\"C0000009\": \"blocked\"},"
+                  " \"3\": {\"C0000001\": \"user\"}, \"4\": {\"C0000009\": \"user\"}}}"),
+              ESP_OK);
+    CHECK_INT(authz_get_version(), 5);
+    CHECK_INT(role_of(UID1, sizeof(UID1)), -1); // v3 was applied before
+    CHECK_INT(role_of(UID9, sizeof(UID9)), AUTHZ_ROLE_BLOCKED);
+
+    // More versions than one pass takes: left to the uploader's paged pull
+    char json[512];
+    size_t len = (size_t)snprintf(json, sizeof(json), "{\"path\": \"/\", \"data\": {");
+    for (int v = 6; v < 6 + CONFIG_AUTHZ_SYNC_PAGE_DELTAS + 1; v++) {
+        len += (size_t)snprintf(json + len, sizeof(json) - len, "%s\"%d\": {\"C0000001\": \"user\"}",
+                                v == 6 ? "" : ", ", v);
+    }
+    snprintf(json + len, sizeof(json) - len, "}}");
+    CHECK_INT(firebase_apply_allowlist_event(json), ESP_ERR_NOT_FINISHED);
+    CHECK_INT(authz_get_version(), 5);
+}
+
+static void test_stream_ignored(void) {
+    // One UID changed inside a version node: not a new version
+    CHECK_INT(firebase_apply_allowlist_event("{\"path\": \"/5/C0000001\", \"data\": \"user\"}"), ESP_OK);
+    CHECK_INT(firebase_apply_allowlist_event("{\"path\": \"/\", \"data\": null}"), ESP_OK);
+    CHECK_INT(authz_get_version(), 5);
+    CHECK_INT(role_of(UID1, sizeof(UID1)), -1);
+
+    CHECK_INT(firebase_apply_allowlist_event("{\"data\": {}}"), ESP_ERR_INVALID_ARG);
+    CHECK_INT(firebase_apply_allowlist_event("not json"), ESP_ERR_INVALID_ARG);
+}
+
+static void test_pull_settings(void) {
+    char path[64];
+    snprintf(path, sizeof(path), "device_config/%s", firebase_device_id());
+    mock_http_set_response(path, "{\"schema\": 1, \"revision\": 2, \"display_hold_ms\": 1500}");
+    firebase_request_settings_sync();
+    wait_uploader();
+    CHECK_INT(settings_get()->revision, 2);
+    CHECK_INT(settings_get()->display_hold_ms, 1500);
+}
+
+static void test_stream_settings(void) {
+    CHECK_INT(firebase_apply_settings_event(
+                  "{\"path\": \"/\", \"data\": {\"revision\": 3, \"display_hold_ms\": 2500}}", false),
+              ESP_OK);
+    CHECK_INT(settings_get()->revision, 3);
+    CHECK_INT(settings_get()->display_hold_ms, 2500);
+
+    CHECK_INT(firebase_apply_settings_event(
+                  "{\"path\": \"/\", \"data\": {\"revision\": 4, \"display_hold_ms\": 1}}", false),
+              ESP_ERR_INVALID_RESPONSE);
+    CHECK_INT(settings_get()->display_hold_ms, 2500);
+
+    // A patch of some keys: the whole document has to be pulled
+    CHECK_INT(firebase_apply_settings_event("{\"path\": \"/display_hold_ms\", \"data\": 900}", true),
+              ESP_ERR_NOT_FINISHED);
+    CHECK_INT(settings_get()->revision, 3);
+
+    // The document was deleted: back to menuconfig
+    CHECK_INT(firebase_apply_settings_event("{\"path\": \"/\", \"data\": null}", false), ESP_OK);
+    CHECK_INT(settings_get()->revision, 0);
+    CHECK_INT(settings_get()->display_hold_ms, CONFIG_DISPLAY_HOLD_MS);
+}
+
+int main(void) {
+    RUN_TEST(test_start);
+    RUN_TEST(test_pull_deltas);
+    RUN_TEST(test_stream_one_version);
+    RUN_TEST(test_stream_snapshot);
+    RUN_TEST(test_stream_ignored);
+    RUN_TEST(test_pull_settings);
+    RUN_TEST(test_stream_settings);
+    return TEST_RESULT();
+}
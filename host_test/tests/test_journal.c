@@ -0,0 +1,187 @@
+/**
+ * @file test_journal.c
+ * @brief Tests of the offline journal (journal.h) on a mocked NOR flash partition.
+ *
+ * Calling journal_init() again stands in for a reboot: the runtime state is
+ * rebuilt from the partition contents alone.
+ */
+
+#include "journal.h"
+#include "mock.h"
+#include "test_util.h"
+
+// 2023-11-14T22:13:20.123456Z
+#define EPOCH_US 1700000000123456LL
+
+// Geometry of the mocked partition: 256 KiB of 4 KiB sectors, 32-byte records
+#define SLOTS_PER_SECTOR 128
+#define TOTAL_SLOTS      8192
+
+static journal_entry_t make_entry(uint8_t n) {
+    journal_entry_t e = {
+        .epoch_us = EPOCH_US + n * 1000000LL,
+        .uid = { 0x04, 0xA1, n },
+        .uid_len = 3,
+        .result = 1,
+        .reader_id = n % 2,
+    };
+    return e;
+}
+
+static void test_not_initialized(void) {
+    journal_entry_t e = make_entry(0);
+    size_t count = 1;
+    CHECK_INT(journal_append(&e), ESP_ERR_INVALID_STATE);
+    CHECK_INT(journal_read_pending(&e, 1, &count), ESP_ERR_INVALID_STATE);
+    CHECK_INT(count, 0);
+    CHECK_INT(journal_pending_count(), 0);
+
+    mock_partition_set_present("journal", false);
+    CHECK_INT(journal_init(), ESP_ERR_NOT_FOUND);
+    mock_partition_set_present("journal", true);
+}
+
+static void test_append_read_ack(void) {
+    CHECK_INT(journal_init(), ESP_OK);
+    journal_stats_t stats;
+    journal_get_stats(&stats);
+    CHECK_INT(stats.capacity, TOTAL_SLOTS);
+    CHECK_INT(stats.pending, 0);
+
+    journal_entry_t e = make_entry(0);
+    e.uid_len = 0;
+    CHECK_INT(journal_append(&e), ESP_ERR_INVALID_ARG);
+    e.uid_len = JOURNAL_UID_MAX_LEN + 1;
+    CHECK_INT(journal_append(&e), ESP_ERR_INVALID_ARG);
+
+    uint32_t seqs[3];
+    for (uint8_t i = 0; i < 3; i++) {
+        e = make_entry(i);
+        e.flags = (i == 2) ? JOURNAL_FLAG_UNSYNCED : 0;
+        CHECK_INT(journal_append(&e), ESP_OK);
+        seqs[i] = e.seq;
+    }
+    CHECK(seqs[1] == seqs[0] + 1 && seqs[2] == seqs[1] + 1);
+    CHECK_INT(journal_pending_count(), 3);
+    CHECK(journal_seq_this_boot(seqs[0]));
+
+    // Reading does not consume
+    journal_entry_t out[4];
+    size_t count;
+    for (int pass = 0; pass < 2; pass++) {
+        CHECK_INT(journal_read_pending(out, 4, &count), ESP_OK);
+        CHECK_INT(count, 3);
+    }
+    CHECK_INT(out[0].seq, seqs[0]);
+    CHECK_INT(out[0].epoch_us, EPOCH_US - 456); // Stored to the millisecond
+    CHECK_INT(out[1].uid_len, 3);
+    CHECK_INT(out[1].uid[2], 1);
+    CHECK_INT(out[1].reader_id, 1);
+    CHECK_INT(out[1].result, 1);
+    CHECK_INT(out[2].flags, JOURNAL_FLAG_UNSYNCED);
+
+    CHECK_INT(journal_read_pending(out, 1, &count), ESP_OK);
+    CHECK_INT(count, 1);
+
+    CHECK_INT(journal_ack(seqs[1]), ESP_OK);
+    CHECK_INT(journal_pending_count(), 1);
+    CHECK_INT(journal_read_pending(out, 4, &count), ESP_OK);
+    CHECK_INT(count, 1);
+    CHECK_INT(out[0].seq, seqs[2]);
+
+    journal_get_stats(&stats);
+    CHECK_INT(stats.appended, 3);
+    CHECK_INT(stats.acked, 2);
+}
+
+static void test_recovery(void) {
+    // Reboot with one record pending from test_append_read_ack()
+    journal_entry_t out[4];
+    size_t count;
+    CHECK_INT(journal_init(), ESP_OK);
+    CHECK_INT(journal_pending_count(), 1);
+    CHECK_INT(journal_read_pending(out, 4, &count), ESP_OK);
+    CHECK_INT(count, 1);
+    uint32_t old_seq = out[0].seq;
+    CHECK_INT(out[0].flags, JOURNAL_FLAG_UNSYNCED);
+    CHECK(!journal_seq_this_boot(old_seq)); // Its uptime stamp belongs to the previous boot
+
+    journal_entry_t e = make_entry(9);
+    CHECK_INT(journal_append(&e), ESP_OK);
+    CHECK(e.seq > old_seq + 1); // After the ack record too
+    CHECK(journal_seq_this_boot(e.seq));
+
+    journal_stats_t stats;
+    journal_get_stats(&stats);
+    CHECK_INT(stats.pending, 2);
+    CHECK_INT(stats.appended, 1);
+    CHECK_INT(stats.corrupt, 0);
+
+    CHECK_INT(journal_ack(e.seq), ESP_OK);
+    CHECK_INT(journal_init(), ESP_OK);
+    CHECK_INT(journal_pending_count(), 0);
+    CHECK_INT(journal_read_pending(out, 4, &count), ESP_OK);
+    CHECK_INT(count, 0);
+}
+
+static void test_wrap(void) {
+    // Two sectors more than fit: the two oldest sectors are reclaimed
+    mock_partition_reset();
+    CHECK_INT(journal_init(), ESP_OK);
+    bool all_ok = true;
+    for (uint32_t i = 0; i < TOTAL_SLOTS + 2 * SLOTS_PER_SECTOR; i++) {
+        journal_entry_t e = make_entry((uint8_t)i);
+        all_ok &= journal_append(&e) == ESP_OK;
+    }
+    CHECK(all_ok);
+
+    journal_stats_t stats;
+    journal_get_stats(&stats);
+    CHECK_INT(stats.overwritten, 2 * SLOTS_PER_SECTOR);
+    CHECK_INT(stats.pending, TOTAL_SLOTS); // Every slot holds a pending record
+    CHECK_INT(stats.pending + stats.overwritten, stats.appended);
+
+    journal_entry_t out[1];
+    size_t count;
+    CHECK_INT(journal_read_pending(out, 1, &count), ESP_OK);
+    CHECK_INT(out[0].seq, 2 * SLOTS_PER_SECTOR + 1);
+
+    // The same state after a reboot
+    CHECK_INT(journal_init(), ESP_OK);
+    CHECK_INT(journal_pending_count(), stats.pending);
+    CHECK_INT(journal_read_pending(out, 1, &count), ESP_OK);
+    CHECK_INT(out[0].seq, 2 * SLOTS_PER_SECTOR + 1);
+}
+
+static void test_write_failure(void) {
+    mock_partition_reset();
+    CHECK_INT(journal_init(), ESP_OK);
+    journal_entry_t a = make_entry(1), b = make_entry(2), c = make_entry(3);
+    CHECK_INT(journal_append(&a), ESP_OK);
+
+    mock_partition_fail_writes_after(0);
+    CHECK(journal_append(&b) != ESP_OK);
+    mock_partition_fail_writes_after(-1);
+    CHECK_INT(journal_pending_count(), 1);
+
+    // The half-written slot is skipped, later records are found
+    CHECK_INT(journal_append(&c), ESP_OK);
+    journal_entry_t out[4];
+    size_t count;
+    CHECK_INT(journal_read_pending(out, 4, &count), ESP_OK);
+    CHECK_INT(count, 2);
+    CHECK_INT(out[0].seq, a.seq);
+    CHECK_INT(out[1].seq, c.seq);
+
+    CHECK_INT(journal_ack(c.seq), ESP_OK);
+    CHECK_INT(journal_pending_count(), 0);
+}
+
+int main(void) {
+    RUN_TEST(test_not_initialized);
+    RUN_TEST(test_append_read_ack);
+    RUN_TEST(test_recovery);
+    RUN_TEST(test_wrap);
+    RUN_TEST(test_write_failure);
+    return TEST_RESULT();
+}
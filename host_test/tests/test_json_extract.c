@@ -0,0 +1,143 @@
+/**
+ * @file test_json_extract.c
+ * @brief Tests of the streaming top-level field extractor (json_extract.h).
+ */
+
+#include "json_extract.h"
+#include "test_util.h"
+
+/**
+ * @brief Fields of a sign-in response, as firebase_auth.c reads them.
+ */
+typedef struct {
+    char token[32];
+    char expires[16];
+    json_field_t fields[2];
+    json_extractor_t x;
+} auth_fields_t;
+
+static void auth_init(auth_fields_t *a) {
+    a->fields[0] = (json_field_t) { .key = "idToken", .out = a->token, .cap = sizeof(a->token) };
+    a->fields[1] = (json_field_t) { .key = "expiresIn", .out = a->expires, .cap = sizeof(a->expires) };
+    json_extract_init(&a->x, a->fields, 2);
+}
+
+static void feed_str(json_extractor_t *x, const char *s) {
+    json_extract_feed(x, s, strlen(s));
+}
+
+static const char *RESPONSE =
+    "{\"kind\":\"identitytoolkit#VerifyPasswordResponse\",\"idToken\":\"eyJhbGci.x\","
+    "\"providerUserInfo\":[{\"idToken\":\"nested\"}],\"expiresIn\": \"3600\" ,\"registered\":true}";
+
+static void test_whole_document(void) {
+    auth_fields_t a;
+    auth_init(&a);
+    feed_str(&a.x, RESPONSE);
+    CHECK(json_extract_complete(&a.x));
+    CHECK(a.fields[0].found);
+    CHECK_STR(a.token, "eyJhbGci.x"); // Not the nested member of the same name
+    CHECK(a.fields[1].found);
+    CHECK_STR(a.expires, "3600");
+}
+
+static void test_byte_by_byte(void) {
+    // Chunks may end anywhere, also inside names, escapes and values
+    auth_fields_t a;
+    auth_init(&a);
+    for (const char *p = RESPONSE; *p != '\0'; p++) {
+        json_extract_feed(&a.x, p, 1);
+    }
+    CHECK(json_extract_complete(&a.x));
+    CHECK_STR(a.token, "eyJhbGci.x");
+    CHECK_STR(a.expires, "3600");
+}
+
+static void test_primitives_and_escapes(void) {
+    char num[16], lit[8], text[32];
+    json_field_t fields[] = {
+        { .key = "n", .out = num, .cap = sizeof(num) },
+        { .key = "b", .out = lit, .cap = sizeof(lit) },
+        { .key = "s", .out = text, .cap = sizeof(text) },
+    };
+    json_extractor_t x;
+    json_extract_init(&x, fields, 3);
+    feed_str(&x, "{\"n\":-12.5e3,\"b\":false,\"s\":\"a\\\"b\\\\c\\n\\u0041\\u00e9\"}");
+    CHECK(json_extract_complete(&x));
+    CHECK_STR(num, "-12.5e3");
+    CHECK_STR(lit, "false");
+    CHECK_STR(text, "a\"b\\c\nA?"); // Non-ASCII code units become '?'
+}
+
+static void test_missing_and_truncated(void) {
+    char small[4], other[8];
+    json_field_t fields[] = {
+        { .key = "idToken", .out = small, .cap = sizeof(small) },
+        { .key = "absent", .out = other, .cap = sizeof(other) },
+    };
+    json_extractor_t x;
+    json_extract_init(&x, fields, 2);
+    feed_str(&x, "{\"idToken\":\"abcdefgh\"}");
+    CHECK(json_extract_complete(&x));
+    CHECK(fields[0].found);
+    CHECK(fields[0].truncated);
+    CHECK_STR(small, "abc");
+    CHECK(!fields[1].found);
+    CHECK_STR(other, "");
+}
+
+static void test_nested_value_not_extracted(void) {
+    char out[16];
+    json_field_t field = { .key = "data", .out = out, .cap = sizeof(out) };
+    json_extractor_t x;
+    json_extract_init(&x, &field, 1);
+    feed_str(&x, "{\"data\":{\"data\":\"inner\"},\"after\":1}");
+    CHECK(json_extract_complete(&x));
+    CHECK(!field.found);
+}
+
+static void test_not_an_object(void) {
+    char out[8];
+    json_field_t field = { .key = "a", .out = out, .cap = sizeof(out) };
+    json_extractor_t x;
+
+    json_extract_init(&x, &field, 1);
+    feed_str(&x, "[{\"a\":1}]");
+    CHECK(!json_extract_complete(&x));
+    CHECK(!field.found);
+
+    json_extract_init(&x, &field, 1);
+    feed_str(&x, "null");
+    CHECK(!json_extract_complete(&x));
+
+    json_extract_init(&x, &field, 1);
+    feed_str(&x, "{\"a\":1"); // Cut off
+    CHECK(!json_extract_complete(&x));
+}
+
+static void test_long_key_never_matches(void) {
+    // A name of JSON_EXTRACT_KEY_MAX_LEN characters or more is skipped, even if it starts like a field
+    char key[JSON_EXTRACT_KEY_MAX_LEN + 8];
+    memset(key, 'k', sizeof(key) - 1);
+    key[sizeof(key) - 1] = '\0';
+    char out[8];
+    json_field_t field = { .key = "kkkk", .out = out, .cap = sizeof(out) };
+    json_extractor_t x;
+    json_extract_init(&x, &field, 1);
+    feed_str(&x, "{\"");
+    feed_str(&x, key);
+    feed_str(&x, "\":\"v\"}");
+    CHECK(json_extract_complete(&x));
+    CHECK(!field.found);
+}
+
+int main(void) {
+    RUN_TEST(test_whole_document);
+    RUN_TEST(test_byte_by_byte);
+    RUN_TEST(test_primitives_and_escapes);
+    RUN_TEST(test_missing_and_truncated);
+    RUN_TEST(test_nested_value_not_extracted);
+    RUN_TEST(test_not_an_object);
+    RUN_TEST(test_long_key_never_matches);
+    return TEST_RESULT();
+}
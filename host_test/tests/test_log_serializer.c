@@ -0,0 +1,110 @@
+/**
+ * @file test_log_serializer.c
+ * @brief Tests of the allocation-free log record encoder (log_serializer.h), full form.
+ */
+
+#include "log_serializer.h"
+#include "test_util.h"
+
+// 2023-11-14T22:13:20.123Z
+#define EPOCH_US 1700000000123456LL
+
+static firebase_log_record_t make_record(const char *uid, int64_t epoch_us, uint8_t reader, uint8_t flags) {
+    firebase_log_record_t r = { .epoch_us = epoch_us, .reader_id = reader, .flags = flags };
+    strlcpy(r.uid, uid, sizeof(r.uid));
+    return r;
+}
+
+static const char *write_one(const firebase_log_record_t *r, char *buf, size_t cap) {
+    log_writer_t w;
+    log_writer_init(&w, buf, cap);
+    log_write_record(&w, r);
+    return log_writer_finish(&w) > 0 ? buf : NULL;
+}
+
+static void test_record(void) {
+    char buf[LOG_SERIALIZER_RECORD_MAX_LEN];
+    firebase_log_record_t r = make_record("99 B6 B3 02", EPOCH_US, 1, 0);
+    const char *out = write_one(&r, buf, sizeof(buf));
+    CHECK(out != NULL);
+    CHECK_STR(buf, "{\"uid\":\"99 B6 B3 02\",\"timestamp\":\"2023-11-14T22:13:20.123Z\",\"reader\":1}");
+}
+
+static void test_flags(void) {
+    char buf[LOG_SERIALIZER_RECORD_MAX_LEN];
+    firebase_log_record_t r = make_record("04 A1", EPOCH_US, 0, FIREBASE_LOG_FLAG_CONFLICT);
+    write_one(&r, buf, sizeof(buf));
+    CHECK_STR(buf, "{\"uid\":\"04 A1\",\"timestamp\":\"2023-11-14T22:13:20.123Z\",\"reader\":0,\"conflict\":true}");
+
+    // Undated: the uptime in milliseconds instead of a timestamp
+    r = make_record("04 A1", 1234567, 0, FIREBASE_LOG_FLAG_UNSYNCED);
+    write_one(&r, buf, sizeof(buf));
+    CHECK_STR(buf, "{\"uid\":\"04 A1\",\"unsynced\":true,\"uptime_ms\":1234,\"reader\":0}");
+}
+
+static void test_escaping(void) {
+    char buf[LOG_SERIALIZER_RECORD_MAX_LEN];
+    firebase_log_record_t r = make_record("a\"b\\c\x01", 0, 255, 0);
+    write_one(&r, buf, sizeof(buf));
+    CHECK_STR(buf, "{\"uid\":\"a\\\"b\\\\c\\u0001\",\"timestamp\":\"1970-01-01T00:00:00.000Z\",\"reader\":255}");
+}
+
+static void test_longest_record_fits(void) {
+    // Longest UID, largest reader index, every flag: LOG_SERIALIZER_RECORD_MAX_LEN is enough
+    char uid[FIREBASE_LOG_UID_MAX_LEN];
+    memset(uid, 'F', sizeof(uid) - 1);
+    uid[sizeof(uid) - 1] = '\0';
+    char buf[LOG_SERIALIZER_RECORD_MAX_LEN];
+    firebase_log_record_t r = make_record(uid, 253402300799999999LL, 255, FIREBASE_LOG_FLAG_CONFLICT);
+    CHECK(write_one(&r, buf, sizeof(buf)) != NULL); // 9999-12-31T23:59:59.999Z
+    r.flags |= FIREBASE_LOG_FLAG_UNSYNCED;
+    r.epoch_us = 9999999999999999LL;
+    CHECK(write_one(&r, buf, sizeof(buf)) != NULL);
+}
+
+static void test_batch(void) {
+    char buf[2 * LOG_SERIALIZER_ENTRY_MAX_LEN(8) + 2];
+    firebase_log_record_t a = make_record("01 02", EPOCH_US, 0, 0);
+    firebase_log_record_t b = make_record("03 04", EPOCH_US + 1000, 1, FIREBASE_LOG_FLAG_CONFLICT);
+
+    log_writer_t w;
+    log_writer_init(&w, buf, sizeof(buf));
+    log_write_batch_begin(&w);
+    log_write_batch_entry(&w, "dev/k1", &a);
+    log_write_batch_entry(&w, "dev/k2", &b);
+    log_write_batch_end(&w);
+    CHECK_INT(log_writer_finish(&w), strlen(buf));
+    CHECK_STR(buf,
+              "{\"dev/k1\":{\"uid\":\"01 02\",\"timestamp\":\"2023-11-14T22:13:20.123Z\",\"reader\":0},"
+              "\"dev/k2\":{\"uid\":\"03 04\",\"timestamp\":\"2023-11-14T22:13:20.124Z\",\"reader\":1,"
+              "\"conflict\":true}}");
+}
+
+static void test_overflow(void) {
+    char buf[LOG_SERIALIZER_RECORD_MAX_LEN];
+    firebase_log_record_t r = make_record("99 B6 B3 02", EPOCH_US, 1, 0);
+    write_one(&r, buf, sizeof(buf));
+    size_t len = strlen(buf);
+
+    // Exactly enough room (with the terminator), then one byte short
+    char exact[LOG_SERIALIZER_RECORD_MAX_LEN];
+    CHECK(write_one(&r, exact, len + 1) != NULL);
+    CHECK_STR(exact, buf);
+    CHECK(write_one(&r, exact, len) == NULL);
+    CHECK(strlen(exact) < len); // Still terminated
+
+    log_writer_t w;
+    log_writer_init(&w, exact, 0);
+    log_write_record(&w, &r);
+    CHECK_INT(log_writer_finish(&w), 0);
+}
+
+int main(void) {
+    RUN_TEST(test_record);
+    RUN_TEST(test_flags);
+    RUN_TEST(test_escaping);
+    RUN_TEST(test_longest_record_fits);
+    RUN_TEST(test_batch);
+    RUN_TEST(test_overflow);
+    return TEST_RESULT();
+}
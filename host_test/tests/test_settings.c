@@ -0,0 +1,121 @@
+/**
+ * @file test_settings.c
+ * @brief Tests of the remote settings documents (settings.h) on a mocked NVS.
+ *
+ * The tests build on each other: defaults on an empty NVS, a sequence of
+ * documents, then restarts (settings_init() again) that load the stored copy.
+ */
+
+#include "mem_pool.h"
+#include "settings.h"
+#include "mock.h"
+#include "sdkconfig.h"
+#include "test_util.h"
+
+static void test_defaults(void) {
+    mock_nvs_reset();
+    CHECK_INT(mem_pool_json_init(), ESP_OK);
+    CHECK_INT(settings_init(), ESP_OK);
+    const settings_t *s = settings_get();
+    CHECK_INT(s->revision, 0);
+    CHECK_INT(s->display_hold_ms, CONFIG_DISPLAY_HOLD_MS);
+    CHECK_INT(s->rfid_poll_interval_ms, CONFIG_RFID_POLL_INTERVAL_MS);
+    CHECK_STR(s->timezone, CONFIG_TIMEBASE_TZ);
+
+    CHECK_INT(settings_apply_json("null"), SETTINGS_UNCHANGED); // Nothing to revert
+}
+
+static void test_apply(void) {
+    const settings_t *before = settings_get();
+    CHECK_INT(settings_apply_json("{\"schema\": 1, \"revision\": 3, \"display_hold_ms\": 2000,"
+                                  " \"upload_batch_max\": 8, \"rfid_poll_interval_ms\": 50,"
+                                  " \"timezone\": \"UTC0\", \"future_key\": 1}"),
+              SETTINGS_APPLIED);
+    const settings_t *s = settings_get();
+    CHECK_INT(s->revision, 3);
+    CHECK_INT(s->display_hold_ms, 2000);
+    CHECK_INT(s->upload_batch_max, 8);
+    // Boot settings wait for the restart
+    CHECK_INT(s->rfid_poll_interval_ms, CONFIG_RFID_POLL_INTERVAL_MS);
+    CHECK_STR(s->timezone, CONFIG_TIMEBASE_TZ);
+    // Published as a new copy: a reader of the old one still sees one revision
+    CHECK(before != s);
+    CHECK_INT(before->revision, 0);
+    CHECK_INT(before->display_hold_ms, CONFIG_DISPLAY_HOLD_MS);
+
+    // Same revision: already applied, whatever the values
+    CHECK_INT(settings_apply_json("{\"revision\": 3, \"display_hold_ms\": 5000}"), SETTINGS_UNCHANGED);
+    CHECK_INT(settings_get()->display_hold_ms, 2000);
+}
+
+static void test_rejected(void) {
+    const char *invalid[] = {
+        "{\"display_hold_ms\": 2000}",                                    // No revision
+        "{\"revision\": 0, \"display_hold_ms\": 2000}",
+        "[1, 2]",
+        "{\"revision\": 4, \"display_hold_ms\": 50}",                     // Below the range
+        "{\"revision\": 4, \"upload_batch_max\": 17}",                    // Above the range
+        "{\"revision\": 4, \"display_hold_ms\": \"2000\"}",               // Not a number
+        "{\"revision\": 4, \"timezone\": 0}",                             // Not a string
+        "{\"revision\": 4, \"wifi_retry_base_ms\": 5000, \"wifi_retry_max_ms\": 1000}",
+        "{\"revision\": 4, \"scan_idle_interval_ms\": 1000, \"scan_idle_window_ms\": 50}",
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        if (settings_apply_json(invalid[i]) != SETTINGS_REJECTED) {
+            fprintf(stderr, "%s:%d: not rejected: %s\n", __FILE__, __LINE__, invalid[i]);
+            test_failures++;
+        }
+    }
+    // Nothing of them applied
+    const settings_t *s = settings_get();
+    CHECK_INT(s->revision, 3);
+    CHECK_INT(s->display_hold_ms, 2000);
+    CHECK_INT(s->upload_batch_max, 8);
+    CHECK_INT(s->wifi_retry_base_ms, CONFIG_WIFI_RETRY_BASE_MS);
+}
+
+static void test_omitted_keys_revert(void) {
+    CHECK_INT(settings_apply_json("{\"revision\": 5, \"upload_batch_max\": 4, \"rfid_poll_interval_ms\": 50}"),
+              SETTINGS_APPLIED);
+    const settings_t *s = settings_get();
+    CHECK_INT(s->revision, 5);
+    CHECK_INT(s->display_hold_ms, CONFIG_DISPLAY_HOLD_MS);
+    CHECK_INT(s->upload_batch_max, 4);
+}
+
+static void test_restart(void) {
+    CHECK_INT(settings_init(), ESP_OK); // Stored copy of revision 5
+    const settings_t *s = settings_get();
+    CHECK_INT(s->revision, 5);
+    CHECK_INT(s->upload_batch_max, 4);
+    CHECK_INT(s->rfid_poll_interval_ms, 50);
+    CHECK_STR(s->timezone, CONFIG_TIMEBASE_TZ); // Set by revision 3 only
+
+    // The poll interval of this boot bounds the scan window at once
+    CHECK_INT(settings_apply_json("{\"revision\": 6, \"scan_idle_interval_ms\": 1000,"
+                                  " \"scan_idle_window_ms\": 60, \"rfid_poll_interval_ms\": 50}"),
+              SETTINGS_APPLIED);
+    CHECK_INT(settings_get()->scan_idle_window_ms, 60);
+}
+
+static void test_null_reverts(void) {
+    CHECK_INT(settings_apply_json("null"), SETTINGS_APPLIED);
+    const settings_t *s = settings_get();
+    CHECK_INT(s->revision, 0);
+    CHECK_INT(s->upload_batch_max, CONFIG_FIREBASE_BATCH_MAX_ENTRIES);
+    CHECK_INT(s->rfid_poll_interval_ms, 50); // Until the restart
+    CHECK_INT(settings_apply_json("null"), SETTINGS_UNCHANGED);
+
+    CHECK_INT(settings_init(), ESP_OK);
+    CHECK_INT(settings_get()->rfid_poll_interval_ms, CONFIG_RFID_POLL_INTERVAL_MS);
+}
+
+int main(void) {
+    RUN_TEST(test_defaults);
+    RUN_TEST(test_apply);
+    RUN_TEST(test_rejected);
+    RUN_TEST(test_omitted_keys_revert);
+    RUN_TEST(test_restart);
+    RUN_TEST(test_null_reverts);
+    return TEST_RESULT();
+}
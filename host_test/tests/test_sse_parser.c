@@ -0,0 +1,134 @@
+/**
+ * @file test_sse_parser.c
+ * @brief Tests of the Server-Sent Events parser (sse_parser.h) on RTDB stream traffic.
+ */
+
+#include "sse_parser.h"
+#include "test_util.h"
+
+#define MAX_EVENTS 8
+
+/**
+ * @brief Events delivered to the callback.
+ */
+typedef struct {
+    size_t count;
+    char event[MAX_EVENTS][SSE_EVENT_MAX_LEN];
+    char data[MAX_EVENTS][128];
+    size_t len[MAX_EVENTS];
+    bool overflow[MAX_EVENTS];
+} captured_t;
+
+static void on_event(const char *event, const char *data, size_t len, bool overflow, void *arg) {
+    captured_t *c = arg;
+    if (c->count < MAX_EVENTS) {
+        strlcpy(c->event[c->count], event, sizeof(c->event[0]));
+        strlcpy(c->data[c->count], data, sizeof(c->data[0]));
+        c->len[c->count] = len;
+        c->overflow[c->count] = overflow;
+    }
+    c->count++;
+}
+
+static void feed_str(sse_parser_t *p, const char *s) {
+    sse_parser_feed(p, s, strlen(s));
+}
+
+static const char *STREAM =
+    ": connected\n"
+    "event: put\n"
+    "data: {\"path\":\"/\",\"data\":{\"v\":3}}\n"
+    "\n"
+    "event: keep-alive\n"
+    "data: null\n"
+    "\n"
+    "event: patch\n"
+    "data: {\"path\":\"/a\",\n"
+    "data: \"data\":1}\n"
+    "\n";
+
+static void check_stream(const captured_t *c) {
+    CHECK_INT(c->count, 3);
+    CHECK_STR(c->event[0], "put");
+    CHECK_STR(c->data[0], "{\"path\":\"/\",\"data\":{\"v\":3}}");
+    CHECK_INT(c->len[0], strlen(c->data[0]));
+    CHECK_STR(c->event[1], "keep-alive");
+    CHECK_STR(c->data[1], "null");
+    CHECK_STR(c->event[2], "patch");
+    CHECK_STR(c->data[2], "{\"path\":\"/a\",\n\"data\":1}"); // Data lines joined with '\n'
+    CHECK(!c->overflow[0] && !c->overflow[1] && !c->overflow[2]);
+}
+
+static void test_rtdb_events(void) {
+    char buf[256];
+    captured_t c = { 0 };
+    sse_parser_t p;
+    sse_parser_init(&p, buf, sizeof(buf), on_event, &c);
+    feed_str(&p, STREAM);
+    check_stream(&c);
+}
+
+static void test_byte_by_byte(void) {
+    char buf[256];
+    captured_t c = { 0 };
+    sse_parser_t p;
+    sse_parser_init(&p, buf, sizeof(buf), on_event, &c);
+    for (const char *s = STREAM; *s != '\0'; s++) {
+        sse_parser_feed(&p, s, 1);
+    }
+    check_stream(&c);
+}
+
+static void test_line_endings(void) {
+    char buf[64];
+    captured_t c = { 0 };
+    sse_parser_t p;
+    sse_parser_init(&p, buf, sizeof(buf), on_event, &c);
+    feed_str(&p, "event: put\r\ndata: a\r\n\r\n");
+    feed_str(&p, "event: put\rdata: b\r\r");
+    // A CRLF split between two chunks is still one line end
+    feed_str(&p, "data: c\r");
+    feed_str(&p, "\n\r");
+    feed_str(&p, "\n");
+    CHECK_INT(c.count, 3);
+    CHECK_STR(c.data[0], "a");
+    CHECK_STR(c.data[1], "b");
+    CHECK_STR(c.data[2], "c");
+    CHECK_STR(c.event[2], "message"); // No event field: default type
+}
+
+static void test_overflow(void) {
+    char buf[8];
+    captured_t c = { 0 };
+    sse_parser_t p;
+    sse_parser_init(&p, buf, sizeof(buf), on_event, &c);
+    feed_str(&p, "event: put\ndata: 0123456789\n\ndata: ok\n\n");
+    CHECK_INT(c.count, 2);
+    CHECK(c.overflow[0]);
+    CHECK_STR(c.data[0], "0123456"); // Cut at the buffer, still terminated
+    CHECK(!c.overflow[1]); // The next event starts clean
+    CHECK_STR(c.data[1], "ok");
+}
+
+static void test_ignored_lines(void) {
+    char buf[32];
+    captured_t c = { 0 };
+    sse_parser_t p;
+    sse_parser_init(&p, buf, sizeof(buf), on_event, &c);
+    // Comments, unknown fields and an event without data dispatch nothing
+    feed_str(&p, ":comment\nid: 7\nretry: 1000\n\nevent: put\n\n");
+    CHECK_INT(c.count, 0);
+    // Only one space after the colon is stripped; "data" with no colon is an empty line of data
+    feed_str(&p, "data:  x\ndata\n\n");
+    CHECK_INT(c.count, 1);
+    CHECK_STR(c.data[0], " x\n");
+}
+
+int main(void) {
+    RUN_TEST(test_rtdb_events);
+    RUN_TEST(test_byte_by_byte);
+    RUN_TEST(test_line_endings);
+    RUN_TEST(test_overflow);
+    RUN_TEST(test_ignored_lines);
+    return TEST_RESULT();
+}
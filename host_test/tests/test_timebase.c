@@ -0,0 +1,106 @@
+/**
+ * @file test_timebase.c
+ * @brief Tests of the UTC clock and ISO 8601 formatting (timebase.h).
+ *
+ * Virtual time (mock_time_advance_us()) moves the clock in large steps; real
+ * time still passes between two readings, so comparisons allow TOLERANCE_US.
+ */
+
+#include "timebase.h"
+#include "settings.h"
+#include "esp_timer.h"
+#include "mock.h"
+#include "test_util.h"
+
+#define TOLERANCE_US 20000
+
+// 2023-11-14T22:13:20Z
+#define REFERENCE_US 1700000000000000LL
+
+static bool near(int64_t actual, int64_t expected) {
+    int64_t diff = actual - expected;
+    if (diff < -TOLERANCE_US || diff > TOLERANCE_US) {
+        fprintf(stderr, "%lld is not within %d us of %lld\n", (long long)actual, TOLERANCE_US,
+                (long long)expected);
+        return false;
+    }
+    return true;
+}
+
+static void test_format(void) {
+    char buf[TIMEBASE_ISO8601_MAX_LEN];
+    CHECK_INT(timebase_format_utc(REFERENCE_US + 123999, buf, sizeof(buf)), 24);
+    CHECK_STR(buf, "2023-11-14T22:13:20.123Z"); // Truncated, not rounded
+    timebase_format_utc(1709251199999000LL, buf, sizeof(buf));
+    CHECK_STR(buf, "2024-02-29T23:59:59.999Z");
+    timebase_format_utc(-5, buf, sizeof(buf));
+    CHECK_STR(buf, "1970-01-01T00:00:00.000Z");
+
+    CHECK_INT(timebase_format_utc(REFERENCE_US, buf, 25), 24);
+    CHECK_INT(timebase_format_utc(REFERENCE_US, buf, 24), 0);
+    CHECK_STR(buf, "");
+}
+
+static void test_first_sync_steps(void) {
+    CHECK(!timebase_is_synced());
+    timebase_resync(REFERENCE_US);
+    CHECK(timebase_is_synced());
+    CHECK(near(timebase_now_us(), REFERENCE_US));
+    CHECK(near(timebase_uptime_to_utc(esp_timer_get_time()), REFERENCE_US));
+
+    // Uptime stamps taken earlier map to earlier UTC times
+    int64_t uptime = esp_timer_get_time();
+    mock_time_advance_us(60000000);
+    CHECK(near(timebase_uptime_to_utc(uptime), REFERENCE_US));
+    CHECK(near(timebase_now_us(), REFERENCE_US + 60000000));
+}
+
+static void test_small_correction_slews(void) {
+    int64_t before = timebase_now_us();
+    int64_t correction = timebase_resync(before + 100000); // Clock 100 ms slow
+    CHECK(near(correction, 100000));
+    CHECK(near(timebase_now_us(), before)); // No jump
+
+    // 100 s at 500 ppm catch up 50 ms
+    mock_time_advance_us(100000000);
+    CHECK(near(timebase_now_us(), before + 100000000 + 50000));
+    mock_time_advance_us(100000000);
+    CHECK(near(timebase_now_us(), before + 200000000 + 100000));
+    mock_time_advance_us(100000000);
+    CHECK(near(timebase_now_us(), before + 300000000 + 100000)); // Done slewing
+}
+
+static void test_slow_down_is_monotonic(void) {
+    int64_t before = timebase_now_us();
+    CHECK(near(timebase_resync(before - 500000), -500000)); // Clock 500 ms fast
+
+    int64_t last = timebase_now_us();
+    bool monotonic = true;
+    for (int i = 0; i < 1000; i++) {
+        mock_time_advance_us(1000);
+        int64_t now = timebase_now_us();
+        monotonic &= now > last;
+        last = now;
+    }
+    CHECK(monotonic);
+    CHECK(near(last, before + 1000000 - 500)); // 1 s at -500 ppm
+}
+
+static void test_large_correction_steps(void) {
+    int64_t before = timebase_now_us();
+    CHECK(near(timebase_resync(before + 5000000), 5000000 + 499500)); // Includes the unslewed rest
+    CHECK(near(timebase_now_us(), before + 5000000));
+    mock_time_advance_us(10000000);
+    CHECK(near(timebase_now_us(), before + 15000000)); // Nothing left to slew
+}
+
+int main(void) {
+    settings_init(); // Time zone for timebase_init()
+    timebase_init();
+    RUN_TEST(test_format);
+    RUN_TEST(test_first_sync_steps);
+    RUN_TEST(test_small_correction_slews);
+    RUN_TEST(test_slow_down_is_monotonic);
+    RUN_TEST(test_large_correction_steps);
+    return TEST_RESULT();
+}
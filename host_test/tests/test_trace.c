@@ -0,0 +1,92 @@
+/**
+ * @file test_trace.c
+ * @brief Tests of the latency histograms (trace.h).
+ *
+ * Latencies are produced by backdating the tap stamp; the few microseconds
+ * of real time between stamp and record stay far from bucket limits.
+ */
+
+#include "trace.h"
+#include "mock.h"
+#include "test_util.h"
+
+static void record_latency(trace_span_t span, int64_t us) {
+    trace_record(span, trace_tap_now() - us);
+}
+
+static void test_bucket_limits(void) {
+    CHECK_INT(trace_bucket_limit_us(0), 128);
+    CHECK_INT(trace_bucket_limit_us(1), 256);
+    CHECK_INT(trace_bucket_limit_us(TRACE_BUCKETS - 2), 1u << 21);
+    CHECK_INT(trace_bucket_limit_us(TRACE_BUCKETS - 1), UINT32_MAX);
+    CHECK_STR(trace_span_name(TRACE_SPAN_DECISION), "decision");
+    CHECK_STR(trace_span_name(TRACE_SPAN_CLOUD_ACK), "cloud_ack");
+    CHECK_STR(trace_span_name(TRACE_SPAN_COUNT), "?");
+}
+
+static void test_record(void) {
+    trace_reset();
+    record_latency(TRACE_SPAN_DECISION, 50);
+    record_latency(TRACE_SPAN_DECISION, 200);
+    record_latency(TRACE_SPAN_DECISION, 100000);
+    record_latency(TRACE_SPAN_DECISION, 10000000); // Beyond the last bounded bucket
+    trace_record(TRACE_SPAN_DECISION, 0);          // Not traced
+    trace_record(TRACE_SPAN_COUNT, trace_tap_now());
+
+    trace_histogram_t h;
+    trace_get_histogram(TRACE_SPAN_DECISION, &h);
+    CHECK_INT(h.count, 4);
+    CHECK(h.min_us >= 50 && h.min_us < 100);
+    CHECK(h.max_us >= 10000000 && h.max_us < 10000100);
+    CHECK(h.total_us >= 10100250 && h.total_us < 10100650);
+    CHECK_INT(h.buckets[0], 1);
+    CHECK_INT(h.buckets[1], 1);
+    CHECK_INT(h.buckets[10], 1); // 65536..131071 us
+    CHECK_INT(h.buckets[TRACE_BUCKETS - 1], 1);
+
+    // A stamp from the future counts as 0
+    trace_record(TRACE_SPAN_UPLOAD_QUEUED, trace_tap_now() + 1000000);
+    trace_get_histogram(TRACE_SPAN_UPLOAD_QUEUED, &h);
+    CHECK_INT(h.count, 1);
+    CHECK_INT(h.max_us, 0);
+    CHECK_INT(h.buckets[0], 1);
+
+    trace_get_histogram(TRACE_SPAN_DISPLAY_DONE, &h);
+    CHECK_INT(h.count, 0);
+}
+
+static void test_format_json(void) {
+    trace_reset();
+    char buf[TRACE_JSON_MAX_LEN];
+    size_t len = trace_format_json(buf, sizeof(buf));
+    CHECK_INT(len, strlen(buf));
+    CHECK(strncmp(buf, "{\"decision\":{\"count\":0,\"min_us\":0,\"max_us\":0,\"avg_us\":0,\"buckets\":[0,0,",
+                  70) == 0);
+    CHECK(strstr(buf, ",\"cloud_ack\":{") != NULL);
+    CHECK_STR(buf + len - 4, "0]}}");
+
+    for (int i = 0; i < 1000; i++) {
+        for (int s = 0; s < TRACE_SPAN_COUNT; s++) {
+            record_latency(s, (int64_t)(i % TRACE_BUCKETS) << (i % TRACE_BUCKETS + 6));
+        }
+    }
+    len = trace_format_json(buf, sizeof(buf));
+    CHECK(len > 0 && len == strlen(buf));
+    CHECK(strstr(buf, "\"count\":1000,") != NULL);
+    CHECK_INT(trace_format_json(buf, len), 0);      // No room for the terminator
+    CHECK_INT(trace_format_json(buf, len + 1), len); // Exactly enough
+
+    trace_reset();
+    trace_histogram_t h;
+    trace_get_histogram(TRACE_SPAN_DISPLAY_QUEUED, &h);
+    CHECK_INT(h.count, 0);
+    CHECK_INT(h.buckets[3], 0);
+}
+
+int main(void) {
+    mock_time_advance_us(100000000); // Backdated stamps stay positive: 0 means "not traced"
+    RUN_TEST(test_bucket_limits);
+    RUN_TEST(test_record);
+    RUN_TEST(test_format_json);
+    return TEST_RESULT();
+}
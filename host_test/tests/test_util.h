@@ -0,0 +1,53 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+/**
+ * @file test_util.h
+ * @brief Minimal test helpers: failed checks are printed and counted, the process exit code
+ *        tells ctest the result.
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+static int test_failures = 0;
+
+#define CHECK(cond) do {                                                                 \
+        if (!(cond)) {                                                                   \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);     \
+            test_failures++;                                                             \
+        }                                                                                \
+    } while (0)
+
+#define CHECK_INT(actual, expected) do {                                                 \
+        long long actual_ = (long long)(actual);                                         \
+        long long expected_ = (long long)(expected);                                     \
+        if (actual_ != expected_) {                                                      \
+            fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__,    \
+                    #actual, actual_, expected_);                                        \
+            test_failures++;                                                             \
+        }                                                                                \
+    } while (0)
+
+#define CHECK_STR(actual, expected) do {                                                 \
+        const char *actual_ = (actual);                                                  \
+        const char *expected_ = (expected);                                              \
+        if (strcmp(actual_, expected_) != 0) {                                           \
+            fprintf(stderr, "%s:%d: %s is \"%s\", expected \"%s\"\n", __FILE__, __LINE__, \
+                    #actual, actual_, expected_);                                        \
+            test_failures++;                                                             \
+        }                                                                                \
+    } while (0)
+
+// Run one test function and name it in the output
+#define RUN_TEST(fn) do {                                                                \
+        int before_ = test_failures;                                                     \
+        fn();                                                                            \
+        printf("%s %s\n", test_failures == before_ ? "PASS" : "FAIL", #fn);              \
+    } while (0)
+
+// Exit code for main()
+#define TEST_RESULT() (test_failures == 0 ? 0 : 1)
+
+#endif // TEST_UTIL_H
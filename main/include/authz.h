@@ -0,0 +1,147 @@
+#ifndef AUTHZ_H
+#define AUTHZ_H
+
+/**
+ * @file authz.h
+ * @brief Local authorization index for RFID UIDs.
+ *
+ * Holds the allowlist as one contiguous, sorted table of fixed-width keys
+ * (UID length + UID bytes zero-padded to 10 bytes), so a lookup is a binary
+ * search over packed entries and never needs the network. 4-, 7- and 10-byte
+ * UIDs are supported.
+ *
+ * The table lives in one of two flash partitions (A/B) and is read in place
+ * through a memory mapping, so nothing is copied into RAM at boot. Updates
+ * are applied as deltas: the merged table is written to the inactive
+ * partition, and the switch happens only once that image is complete.
+ *
+ * A compile-time-sized Bloom filter in RAM is checked first, so most unknown
+ * UIDs are denied without reading the table at all.
+ */
+
+#include "esp_err.h" // For esp_err_t
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Longest supported UID (ISO 14443 triple-size UID)
+#define AUTHZ_UID_MAX_LEN 10
+
+/**
+ * @brief Role assigned to a known card.
+ *
+ * The role decides both the access result and the colour shown on the LCD.
+ */
+typedef enum {
+    AUTHZ_ROLE_USER = 0, // Access granted (green)
+    AUTHZ_ROLE_BLOCKED,  // Known card, access denied (red)
+} authz_role_t;
+
+// Role value used in a delta operation to delete the entry
+#define AUTHZ_ROLE_REMOVE 0xFF
+
+/**
+ * @brief One packed allowlist entry (12 bytes).
+ *
+ * uid_len and uid together form the sort key; unused uid bytes are zero.
+ * The same layout is used on flash and for delta operations.
+ */
+typedef struct {
+    uint8_t uid_len;                // Number of valid bytes in uid (4, 7 or 10)
+    uint8_t uid[AUTHZ_UID_MAX_LEN]; // UID bytes, zero-padded
+    uint8_t role;                   // authz_role_t, or AUTHZ_ROLE_REMOVE in a delta
+} authz_entry_t;
+
+/**
+ * @brief Bloom filter geometry and counters.
+ */
+typedef struct {
+    uint32_t bits;            // Filter size (CONFIG_AUTHZ_BLOOM_BITS)
+    uint32_t hashes;          // Bit positions per UID (CONFIG_AUTHZ_BLOOM_HASHES)
+    uint32_t set_bits;        // Bits currently set
+    uint32_t fpr_ppm;         // Estimated false-positive rate (parts per million)
+    uint32_t stale;           // Removed cards still present in the filter
+    uint32_t rejects;         // Lookups answered by the filter alone
+    uint32_t lookups;         // Lookups that reached the table
+    uint32_t false_positives; // Table lookups that found nothing
+} authz_filter_stats_t;
+
+/**
+ * @brief Map the newest valid allowlist partition.
+ *
+ * Picks the A/B partition with the highest valid version. If neither holds
+ * a valid image, the built-in cards are written to partition A. Without
+ * allowlist partitions, only the built-in cards are available.
+ *
+ * @return
+ *     - ESP_OK on success (including the built-in fallback).
+ *     - Other error codes if a partition could not be mapped.
+ */
+esp_err_t authz_init(void);
+
+/**
+ * @brief Look up a UID in the table.
+ *
+ * Checks the Bloom filter first; only possible matches do an O(log n)
+ * binary search over the mapped partition. Safe to call from any task.
+ *
+ * @param uid     UID bytes.
+ * @param uid_len Number of UID bytes.
+ * @param[out] role Role of the card if found (may be NULL).
+ *
+ * @return true if the UID is in the table.
+ */
+bool authz_lookup(const uint8_t *uid, uint8_t uid_len, authz_role_t *role);
+
+/**
+ * @brief Build an entry (key) from UID bytes.
+ *
+ * @param uid     UID bytes.
+ * @param uid_len Number of UID bytes (1..AUTHZ_UID_MAX_LEN).
+ * @param role    Role, or AUTHZ_ROLE_REMOVE for a delete operation.
+ * @param[out] entry Filled entry with zero padding.
+ *
+ * @return true if the UID length is valid.
+ */
+bool authz_make_entry(const uint8_t *uid, uint8_t uid_len, uint8_t role, authz_entry_t *entry);
+
+/**
+ * @brief Apply a set of changes and switch to the resulting table.
+ *
+ * Merges the current table with ops into the inactive partition, then makes
+ * it active. Lookups keep using the old table until the new image is
+ * completely written, so a power loss never leaves a half-written table.
+ *
+ * @param ops     Changes (add/update a role, or AUTHZ_ROLE_REMOVE); each UID at
+ *                most once. Sorted in place by this function.
+ * @param count   Number of operations.
+ * @param version Version of the allowlist after these changes; must be
+ *                newer than authz_get_version().
+ *
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_VERSION if version is not newer than the current one.
+ *     - ESP_ERR_NOT_SUPPORTED if there are no allowlist partitions.
+ *     - ESP_ERR_NO_MEM if the result does not fit in a partition.
+ *     - Other error codes if flash access fails.
+ */
+esp_err_t authz_apply_delta(authz_entry_t *ops, size_t count, uint32_t version);
+
+/**
+ * @brief Version of the active table (0 for the built-in table).
+ */
+uint32_t authz_get_version(void);
+
+/**
+ * @brief Number of entries in the active table.
+ */
+size_t authz_count(void);
+
+/**
+ * @brief Get a snapshot of the Bloom filter counters.
+ *
+ * @param[out] stats Filled with the current values.
+ */
+void authz_get_filter_stats(authz_filter_stats_t *stats);
+
+#endif // AUTHZ_H
@@ -0,0 +1,38 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/**
+ * @file bench.h
+ * @brief On-device load generator and self-benchmark.
+ *
+ * With CONFIG_BENCH_MODE enabled, a benchmark task waits for the network,
+ * then injects synthetic card reads at CONFIG_BENCH_RATE_HZ for
+ * CONFIG_BENCH_DURATION_S into the same queue the RC522 event handler uses
+ * (rfid_inject_read()). The reads go through deduplication, authorization,
+ * display feedback and the real upload pipeline over Wi-Fi and TLS. At the
+ * end of the run it drains the upload queue and prints sustained events/sec,
+ * queue depths, dropped events, the heap low-water mark, LCD timing and the
+ * tap latency histograms (trace.h).
+ *
+ * The synthetic UIDs are unknown cards, so they exercise the denied path;
+ * CONFIG_BENCH_KNOWN_UID adds a real allowlisted card now and then so the
+ * display path is measured too. Benchmark logs are uploaded like any other
+ * log: run it against a test project.
+ */
+
+#include "esp_err.h" // For esp_err_t
+
+/**
+ * @brief Start the benchmark task.
+ *
+ * Call at the end of app_main(), after the RFID reader and the uploader
+ * are running. Does nothing when CONFIG_BENCH_MODE is disabled.
+ *
+ * @return
+ *     - ESP_OK if the task is running (or the benchmark is disabled).
+ *     - ESP_ERR_INVALID_ARG if CONFIG_BENCH_KNOWN_UID is not a valid UID.
+ *     - ESP_FAIL if the task could not be created.
+ */
+esp_err_t bench_start(void);
+
+#endif // BENCH_H
@@ -0,0 +1,24 @@
+#ifndef BOOT_H
+#define BOOT_H
+
+/**
+ * @file boot.h
+ * @brief Boot stage timing.
+ *
+ * Startup is split into a local stage (display, storage, authorization and
+ * the RFID reader), after which the door works offline, and network stages
+ * (Wi-Fi, Firebase sign-in, time sync) that finish in the background. Each
+ * stage reports how long it took and when it completed.
+ */
+
+#include <stdint.h>
+
+/**
+ * @brief Log the duration of a boot stage and the time since power-on.
+ *
+ * @param stage    Stage name.
+ * @param start_us esp_timer_get_time() when the stage started.
+ */
+void boot_log_stage(const char *stage, int64_t start_us);
+
+#endif // BOOT_H
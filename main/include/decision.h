@@ -0,0 +1,98 @@
+#ifndef DECISION_H
+#define DECISION_H
+
+/**
+ * @file decision.h
+ * @brief Offline-first access decisions with write-behind cloud reconciliation.
+ *
+ * The access task asks this module for a decision and gets it from the
+ * local allowlist (authz.h) alone: the network is never on the decision
+ * path. The decision is then handed to the uploader. With
+ * CONFIG_JOURNAL_ALL_DECISIONS it is written to the offline journal before
+ * it is sent, so every decision survives a reset; otherwise only decisions
+ * whose upload failed are journaled.
+ *
+ * Records that waited in the journal are reconciled when they are replayed,
+ * after the allowlist has been brought up to date: if the current allowlist
+ * would decide differently (typically a card revoked while the door was
+ * offline, and let in), the record is uploaded with a conflict flag and
+ * counted.
+ */
+
+#include "authz.h"     // For authz_role_t
+#include "firebase.h"  // For access_result_t
+#include "esp_err.h"   // For esp_err_t
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief One access decision.
+ */
+typedef struct {
+    access_result_t result; // Granted or denied
+    bool known;             // UID is on the allowlist (role is valid)
+    authz_role_t role;      // Role of a known card
+} decision_t;
+
+/**
+ * @brief Decision and reconciliation counters.
+ */
+typedef struct {
+    uint32_t decisions;       // Decisions made
+    uint32_t granted;         // Decisions that granted access
+    uint32_t max_us;          // Slowest decision
+    uint32_t queue_failures;  // Decisions not handed to the uploader (queue full)
+    uint32_t reconciled;      // Journaled decisions checked against the current allowlist
+    uint32_t revoked_offline; // Granted, but the card is no longer allowed
+    uint32_t granted_later;   // Denied, but the card is allowed now
+} decision_stats_t;
+
+/**
+ * @brief Decide on a card from the local allowlist.
+ *
+ * Never touches the network or flash writes; safe to call from the access task.
+ *
+ * @param uid     UID bytes.
+ * @param uid_len Number of UID bytes.
+ * @param[out] out The decision.
+ */
+void decision_make(const uint8_t *uid, uint8_t uid_len, decision_t *out);
+
+/**
+ * @brief Hand a decision to the uploader (write-behind journal and upload).
+ *
+ * Never blocks.
+ *
+ * @param decision Decision from decision_make().
+ * @param uid_str  UID as shown in the logs ("99 B6 B3 02").
+ * @param reader   Reader that saw the card.
+ * @param tap_us   trace_tap_now() of the tap (0: not traced).
+ *
+ * @return
+ *     - ESP_OK if the record was queued.
+ *     - Errors from firebase_enqueue_rfid_log() otherwise.
+ */
+esp_err_t decision_record(const decision_t *decision, const char *uid_str, uint8_t reader,
+                          int64_t tap_us);
+
+/**
+ * @brief Check a journaled decision against the current allowlist.
+ *
+ * Call after the allowlist has been synced, just before the record is uploaded.
+ *
+ * @param uid     UID bytes.
+ * @param uid_len Number of UID bytes.
+ * @param result  Result that was recorded (access_result_t).
+ *
+ * @return true if the current allowlist decides differently (conflict).
+ */
+bool decision_reconcile(const uint8_t *uid, uint8_t uid_len, uint8_t result);
+
+/**
+ * @brief Get a snapshot of the counters.
+ *
+ * @param[out] stats Filled with the current values.
+ */
+void decision_get_stats(decision_stats_t *stats);
+
+#endif // DECISION_H
@@ -0,0 +1,28 @@
+#ifndef DIAG_CONSOLE_H
+#define DIAG_CONSOLE_H
+
+/**
+ * @file diag_console.h
+ * @brief Serial console with diagnostic commands.
+ *
+ * An esp_console REPL on the default UART. Commands:
+ * - latency [reset]  tap latency histograms (trace.h)
+ * - stacks           stack high-water marks (task_layout.h)
+ * - pools            buffer pool usage and peaks (mem_pool.h)
+ * - decisions        decision and reconciliation counters (decision.h)
+ */
+
+#include "esp_err.h" // For esp_err_t
+
+/**
+ * @brief Register the commands and start the REPL task.
+ *
+ * Does nothing when CONFIG_DIAG_CONSOLE is disabled.
+ *
+ * @return
+ *     - ESP_OK on success (or if the console is disabled).
+ *     - Other error codes if the REPL could not be created.
+ */
+esp_err_t diag_console_start(void);
+
+#endif // DIAG_CONSOLE_H
@@ -0,0 +1,47 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+/**
+ * @file display.h
+ * @brief Non-blocking access feedback on the LCD.
+ *
+ * A display task owns the LCD. Other tasks post the state to show and how
+ * long to hold it, and return immediately; an esp_timer reverts the screen
+ * to COLOR_WAITING once the hold time has passed. A new request pre-empts
+ * the current state (or extends it, if it is the same) right away.
+ */
+
+#include "esp_err.h"      // For esp_err_t
+#include "lcd_display.h"  // For CardColor
+#include <stdint.h>
+
+/**
+ * @brief Start the display task and show the "waiting" screen.
+ *
+ * lcd_init() must have been called first.
+ *
+ * @return
+ *     - ESP_OK on success (or if already started).
+ *     - ESP_ERR_NO_MEM if the task or timer could not be created.
+ */
+esp_err_t display_start(void);
+
+/**
+ * @brief Show a state for hold_ms, then return to COLOR_WAITING.
+ *
+ * Never blocks. The request replaces whatever is currently shown and
+ * restarts the revert timer.
+ *
+ * @param state   State to show.
+ * @param hold_ms How long to show it (0: keep until the next request).
+ * @param tap_us  trace_tap_now() of the tap that caused it, to record the
+ *                tap-to-screen latency (0: not traced).
+ *
+ * @return
+ *     - ESP_OK if the request was queued.
+ *     - ESP_ERR_INVALID_STATE if display_start() was not called.
+ *     - ESP_ERR_TIMEOUT if the display queue is full.
+ */
+esp_err_t display_show(CardColor state, uint32_t hold_ms, int64_t tap_us);
+
+#endif // DISPLAY_H
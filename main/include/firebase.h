@@ -2,40 +2,284 @@
 #define FIREBASE_H
 
 #include "esp_err.h" // For esp_err_t type (ESP-IDF standard error codes)
+#include "freertos/FreeRTOS.h" // For BaseType_t (ISR-safe enqueue)
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Maximum length (including terminator) of a UID string in a queued log record
+#define FIREBASE_LOG_UID_MAX_LEN       32
+
+// Device ID: Wi-Fi station MAC as 12 hex digits
+#define FIREBASE_DEVICE_ID_LEN 12
 
 /**
- * @brief Sign in to Firebase Authentication with email and password.
- *
- * This function performs a sign-in request to Firebase using predefined
- * credentials (email and password) to obtain an ID token (JWT).
- * 
- * The ID token will be used later to authorize access to Firebase services,
- * like Realtime Database writes.
+ * @brief Outcome of an access attempt, stored with each log entry.
+ */
+typedef enum {
+    ACCESS_RESULT_DENIED = 0,  // Unknown or rejected card
+    ACCESS_RESULT_GRANTED = 1, // Card accepted
+} access_result_t;
+
+/**
+ * @brief One access log entry waiting to be uploaded.
  *
- * @note This function must be called successfully before calling any function
- *       that requires authentication, such as send_rfid_log_to_firebase().
+ * Records are copied by value into a preallocated queue, so the caller's
+ * record does not need to outlive the enqueue call. The time is kept as a
+ * number; the uploader formats the "timestamp" field (ISO 8601 UTC).
+ */
+typedef struct {
+    char uid[FIREBASE_LOG_UID_MAX_LEN]; // UID of the scanned tag ("99 B6 B3 02")
+    int64_t epoch_us;                   // Time of the scan, microseconds since 1970-01-01 UTC (timebase_now_us()), or uptime with FIREBASE_LOG_FLAG_UNSYNCED
+    uint8_t result;                     // access_result_t
+    uint8_t reader_id;                  // Reader that saw the card (0 = first reader)
+    int64_t tap_us;                     // trace_tap_now() of the tap, for the cloud-ack latency (0: not traced)
+    uint8_t flags;                      // FIREBASE_LOG_FLAG_*
+} firebase_log_record_t;
+
+// The allowlist decides differently now than when the card was read (decision.h)
+#define FIREBASE_LOG_FLAG_CONFLICT 0x01
+// Scanned before the first time sync: epoch_us is esp_timer_get_time() (time_sync.h)
+#define FIREBASE_LOG_FLAG_UNSYNCED 0x02
+
+/**
+ * @brief Counters describing the state of the log upload queue.
+ */
+typedef struct {
+    uint32_t enqueued;    // Records accepted into the queue
+    uint32_t dropped;     // Records rejected because the queue was full
+    uint32_t uploaded;    // Records successfully sent to Firebase
+    uint32_t batches;     // Successful upload requests (one or more records each)
+    uint32_t failed;      // Records whose upload failed
+    uint32_t journaled;   // Records written to the offline journal (all of them with CONFIG_JOURNAL_ALL_DECISIONS)
+    uint32_t replayed;    // Journaled records uploaded after connectivity returned
+    uint32_t dated;       // Records stamped before the first time sync and dated afterwards
+    uint32_t queue_depth; // Records currently waiting in the queue
+    uint32_t high_water;  // Highest queue depth seen since boot
+} firebase_upload_stats_t;
+
+/**
+ * @brief Latency statistics for Realtime Database requests.
  *
- * @return
- *     - ESP_OK on successful sign-in and token retrieval.
- *     - ESP_FAIL or appropriate error code otherwise.
+ * Requests that reused the open keep-alive connection and requests that had
+ * to (re)connect are summed separately, so the handshake cost is visible as
+ * the difference between the two averages.
  */
-esp_err_t firebase_sign_in(void);
+typedef struct {
+    uint32_t requests;         // Total RTDB requests performed
+    uint32_t connects;         // Requests that opened a new connection
+    uint32_t last_us;          // Duration of the most recent request
+    uint32_t min_us;           // Fastest request
+    uint32_t max_us;           // Slowest request
+    uint64_t reused_total_us;  // Sum of durations of requests on a reused connection
+    uint64_t connect_total_us; // Sum of durations of requests that connected
+} firebase_latency_stats_t;
 
 /**
  * @brief Send an RFID log entry to the Firebase Realtime Database.
  *
  * This function uploads a new RFID scan log, containing the UID and timestamp,
- * to the specified Firebase Realtime Database.
+ * to the specified Firebase Realtime Database over a persistent keep-alive
+ * connection. It is not thread-safe; it is called by the uploader task.
  *
  * @param uid The UID of the scanned RFID tag (as a string).
- * @param timestamp The timestamp string representing when the RFID tag was scanned.
+ * @param epoch_us Time of the scan in microseconds since 1970-01-01 UTC.
+ *
+ * @note Requires a valid ID token from the token manager (firebase_auth.h).
+ *
+ * @return
+ *     - ESP_OK on successful data upload.
+ *     - ESP_FAIL if authentication token is missing or upload fails.
+ *     - ESP_ERR_INVALID_SIZE if uid is too long for a log record.
+ */
+esp_err_t send_rfid_log_to_firebase(const char *uid, int64_t epoch_us);
+
+/**
+ * @brief Send several RFID log entries in one multi-path PATCH request.
  *
- * @note The user must have successfully signed in using firebase_sign_in() first.
+ * Each record is stored under a client-generated push-style key in
+ * "rfid_logs", so entries keep their order exactly as with separate POSTs.
+ *
+ * @param records Records to upload, oldest first.
+ * @param count Number of records.
+ *
+ * @note Not thread-safe; called by the uploader task.
  *
  * @return
  *     - ESP_OK on successful data upload.
  *     - ESP_FAIL if authentication token is missing or upload fails.
+ *     - ESP_ERR_INVALID_SIZE if count exceeds the configured batch size.
+ */
+esp_err_t send_rfid_logs_to_firebase(const firebase_log_record_t *records, size_t count);
+
+/**
+ * @brief Pull allowlist changes from Firebase and apply them locally.
+ *
+ * Fetches allowlist/deltas/<version> nodes newer than the local allowlist
+ * version and merges them into the A/B allowlist partitions (see authz.h).
+ * Runs periodically on the uploader task, which owns the RTDB connection.
+ *
+ * @note Not thread-safe; called by the uploader task.
+ *
+ * @return
+ *     - ESP_OK when the local allowlist is up to date.
+ *     - ESP_ERR_NO_MEM if buffers could not be allocated or a delta is too large.
+ *     - Other error codes if the request or the flash update fails.
+ */
+esp_err_t firebase_sync_allowlist(void);
+
+/**
+ * @brief Pull this device's settings from Firebase and apply them (settings.h).
+ *
+ * Reads device_config/<Wi-Fi MAC> and hands it to settings_apply_json().
+ * Runs on the uploader task when it comes online, and with the allowlist
+ * sync while the settings stream is down or asks for a pull.
+ *
+ * @note Not thread-safe; called by the uploader task.
+ *
+ * @return
+ *     - ESP_OK when the settings are up to date.
+ *     - ESP_ERR_NO_MEM if the response buffer is in use.
+ *     - ESP_ERR_INVALID_RESPONSE if the document was rejected.
+ *     - Other error codes if the request fails.
+ */
+esp_err_t firebase_sync_settings(void);
+
+/**
+ * @brief Apply a settings change pushed by the RTDB stream (firebase_stream.h).
+ *
+ * A put of the whole document (path "/", also sent on connect) is applied
+ * directly; a patch or a put below the root changes some keys only and is
+ * left to a pull of the whole document.
+ *
+ * @param json  Data of a "put" or "patch" event on device_config/<Wi-Fi MAC>.
+ * @param patch Whether it is a "patch" event.
+ *
+ * Safe to call while the uploader syncs; updates are serialized.
+ *
+ * @return
+ *     - ESP_OK when the settings are up to date.
+ *     - ESP_ERR_NOT_FINISHED if only some keys changed; call
+ *       firebase_request_settings_sync() to pull the document.
+ *     - ESP_ERR_INVALID_RESPONSE if the document was rejected.
+ *     - ESP_ERR_INVALID_ARG if json is not a stream event.
+ */
+esp_err_t firebase_apply_settings_event(const char *json, bool patch);
+
+/**
+ * @brief Apply an allowlist change pushed by the RTDB stream (firebase_stream.h).
+ *
+ * @param json Data of a "put" or "patch" event on allowlist/deltas:
+ *             {"path": "/" or "/<version>", "data": ...}.
+ *
+ * Safe to call while the uploader syncs; updates are serialized.
+ *
+ * @return
+ *     - ESP_OK if the change was applied (or was already known).
+ *     - ESP_ERR_NOT_FINISHED if more deltas are pending than fit in one pass;
+ *       call firebase_request_allowlist_sync() to page through them.
+ *     - ESP_ERR_INVALID_ARG if json is not a stream event.
+ *     - Other error codes if the flash update fails.
+ */
+esp_err_t firebase_apply_allowlist_event(const char *json);
+
+/**
+ * @brief Ask the uploader task to run firebase_sync_allowlist() now.
+ *
+ * Never blocks. Used when a pushed change could not be applied directly.
+ */
+void firebase_request_allowlist_sync(void);
+
+/**
+ * @brief Ask the uploader task to run firebase_sync_settings() now.
+ *
+ * Never blocks. Used when a pushed settings change could not be applied directly.
+ */
+void firebase_request_settings_sync(void);
+
+/**
+ * @brief ID of this device: the Wi-Fi station MAC in hex ("24A160C0FFEE").
+ *
+ * Names the device's shard of rfid_logs and its device_config and
+ * device_metrics documents.
+ */
+const char *firebase_device_id(void);
+
+/**
+ * @brief Start the background task that uploads queued RFID logs.
+ *
+ * The task drains the log queue and uploads the records, so HTTPS traffic
+ * never runs on the caller's task. With CONFIG_FIREBASE_BATCH_UPLOAD enabled,
+ * records are gathered for up to CONFIG_FIREBASE_BATCH_MAX_ENTRIES entries or
+ * CONFIG_FIREBASE_BATCH_FLUSH_MS milliseconds and sent in one request.
+ *
+ * May be called before Wi-Fi is up: the task journals records while offline,
+ * and uploads the backlog once firebase_auth_start() has obtained an ID token.
+ * A shutdown handler flushes the queue (firebase_flush_logs()) on esp_restart().
+ *
+ * @return
+ *     - ESP_OK if the uploader is running (or was already started).
+ *     - ESP_FAIL if the task could not be created.
+ */
+esp_err_t firebase_uploader_start(void);
+
+/**
+ * @brief Queue an RFID log entry for asynchronous upload.
+ *
+ * Copies the record into a preallocated queue slot and returns immediately.
+ * Records that fail to upload are kept in the offline journal (see journal.h)
+ * and sent once connectivity returns.
+ *
+ * @param record The log entry to upload.
+ *
+ * @return
+ *     - ESP_OK if the record was queued.
+ *     - ESP_ERR_INVALID_STATE if firebase_uploader_start() was not called.
+ *     - ESP_ERR_INVALID_ARG if the UID is empty.
+ *     - ESP_ERR_NO_MEM if the queue is full (the record is dropped and counted).
+ */
+esp_err_t firebase_enqueue_rfid_log(const firebase_log_record_t *record);
+
+/**
+ * @brief ISR-safe variant of firebase_enqueue_rfid_log().
+ *
+ * @param record The log entry to upload.
+ * @param higher_priority_task_woken Set to pdTRUE if a context switch should be
+ *        requested before the ISR exits (may be NULL).
+ *
+ * @return Same as firebase_enqueue_rfid_log().
+ */
+esp_err_t firebase_enqueue_rfid_log_from_isr(const firebase_log_record_t *record,
+                                             BaseType_t *higher_priority_task_woken);
+
+/**
+ * @brief Upload all queued records now instead of waiting for the batch deadline.
+ *
+ * Runs automatically on esp_restart(); call it directly when power is about
+ * to be lost (e.g. a low-battery event) so that no gathered records are lost.
+ * Must not be called from the uploader task.
+ *
+ * @param timeout Maximum time to wait for the upload to finish.
+ *
+ * @return
+ *     - ESP_OK once all records queued before the call have been processed.
+ *     - ESP_ERR_INVALID_STATE if firebase_uploader_start() was not called.
+ *     - ESP_ERR_TIMEOUT if the flush did not complete in time.
+ */
+esp_err_t firebase_flush_logs(TickType_t timeout);
+
+/**
+ * @brief Get a snapshot of the upload queue counters.
+ *
+ * @param[out] stats Filled with the current counters.
+ */
+void firebase_get_upload_stats(firebase_upload_stats_t *stats);
+
+/**
+ * @brief Get a snapshot of the RTDB request latency statistics.
+ *
+ * @param[out] stats Filled with the current statistics.
  */
-esp_err_t send_rfid_log_to_firebase(const char *uid, const char *timestamp);
+void firebase_get_latency_stats(firebase_latency_stats_t *stats);
 
 #endif // FIREBASE_H
@@ -0,0 +1,98 @@
+#ifndef FIREBASE_AUTH_H
+#define FIREBASE_AUTH_H
+
+/**
+ * @file firebase_auth.h
+ * @brief Firebase ID token lifecycle (sign-in, proactive refresh).
+ *
+ * A background task signs in once Wi-Fi is connected and then keeps the ID
+ * token valid: CONFIG_FIREBASE_AUTH_REFRESH_MARGIN_S seconds before it
+ * expires, the token is renewed through the securetoken endpoint with the
+ * refresh token. A full email/password sign-in is only done at boot or when
+ * the refresh token is rejected.
+ *
+ * Tokens are double-buffered: readers take the current token without
+ * blocking while the task prepares the next one.
+ */
+
+#include "esp_err.h"                // For esp_err_t
+#include "freertos/FreeRTOS.h"      // For TickType_t
+#include <stdint.h>
+#include <stdbool.h>
+
+// Longest ID token (JWT) accepted from Firebase
+#define FIREBASE_ID_TOKEN_MAX_LEN 2048
+
+/**
+ * @brief Token manager counters.
+ */
+typedef struct {
+    uint32_t sign_ins;        // Successful email/password sign-ins
+    uint32_t refreshes;       // Successful refresh-token renewals
+    uint32_t failures;        // Failed sign-in or refresh attempts
+    uint32_t invalidations;   // Tokens rejected by a server (HTTP 401)
+    int64_t expires_in_us;    // Time left on the current token (0 if none)
+} firebase_auth_stats_t;
+
+// CA certificate for the Firebase endpoints (auth and Realtime Database)
+extern const char *const firebase_root_cert;
+
+/**
+ * @brief Start the token manager task.
+ *
+ * Call after wifi_init_sta(); the task waits for the connection itself.
+ *
+ * @return
+ *     - ESP_OK if the task is running (or was already started).
+ *     - ESP_FAIL if the task could not be created.
+ */
+esp_err_t firebase_auth_start(void);
+
+/**
+ * @brief Get the current ID token without blocking.
+ *
+ * The returned string stays valid until the token has been replaced twice
+ * (at least one token lifetime), so callers must not keep it across requests.
+ *
+ * @return The token, or NULL if no unexpired token is available.
+ */
+const char *firebase_auth_get_token(void);
+
+/**
+ * @brief Report that a server rejected a token, so it is renewed right away.
+ *
+ * @param token Token that was rejected (as returned by firebase_auth_get_token()).
+ *              Ignored if a newer token has already replaced it.
+ */
+void firebase_auth_invalidate(const char *token);
+
+/**
+ * @brief Wait until a valid ID token is available.
+ *
+ * @param timeout Maximum time to wait.
+ *
+ * @return true if a token is available.
+ */
+bool firebase_auth_wait(TickType_t timeout);
+
+/**
+ * @brief Sign in to Firebase Authentication using email and password.
+ *
+ * Obtains an ID token (JWT) and a refresh token. The token manager calls
+ * this itself; it is exposed for tools that need a token synchronously.
+ *
+ * @return
+ *     - ESP_OK on successful sign-in and token retrieval.
+ *     - ESP_ERR_NO_MEM if memory allocation fails.
+ *     - ESP_FAIL for HTTP or JSON parsing errors.
+ */
+esp_err_t firebase_sign_in(void);
+
+/**
+ * @brief Get a snapshot of the token manager counters.
+ *
+ * @param[out] stats Filled with the current counters.
+ */
+void firebase_auth_get_stats(firebase_auth_stats_t *stats);
+
+#endif // FIREBASE_AUTH_H
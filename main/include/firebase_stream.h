@@ -0,0 +1,69 @@
+#ifndef FIREBASE_STREAM_H
+#define FIREBASE_STREAM_H
+
+/**
+ * @file firebase_stream.h
+ * @brief Allowlist and settings changes pushed over Realtime Database event streams.
+ *
+ * A background task keeps one HTTPS request to allowlist/deltas open with
+ * "Accept: text/event-stream" (RTDB REST streaming). On connect the server
+ * sends every delta newer than the local version; afterwards each new delta
+ * (a grant, revocation or removal) arrives within seconds and is merged into
+ * the allowlist right away.
+ *
+ * With CONFIG_FIREBASE_STREAM_SETTINGS, a second task streams this device's
+ * settings document (device_config/<Wi-Fi MAC>, see settings.h) the same
+ * way: the document is applied on connect and whenever it is rewritten;
+ * changes to single keys are pulled by the uploader.
+ *
+ * While a stream is live, the uploader skips its periodic pull of that
+ * location; if the stream drops, polling takes over until it is back.
+ */
+
+#include "esp_err.h"  // For esp_err_t
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Stream counters.
+ */
+typedef struct {
+    uint32_t connects;   // Streams opened (HTTP 200)
+    uint32_t events;     // put/patch events received
+    uint32_t keepalives; // keep-alive events received
+    uint32_t applied;    // Events that changed or confirmed the allowlist or the settings
+    uint32_t resyncs;    // Events handed to the uploader as a pull sync
+    uint32_t failures;   // Connection attempts or streams that ended with an error
+} firebase_stream_stats_t;
+
+/**
+ * @brief Start the stream tasks.
+ *
+ * Call after firebase_uploader_start() and firebase_auth_start(); the tasks
+ * wait for Wi-Fi and an ID token themselves. Does nothing when
+ * CONFIG_FIREBASE_STREAM is disabled.
+ *
+ * @return
+ *     - ESP_OK if the tasks are running (or streaming is disabled).
+ *     - ESP_FAIL if a task could not be created.
+ */
+esp_err_t firebase_stream_start(void);
+
+/**
+ * @brief Whether the allowlist stream is connected and has delivered its initial snapshot.
+ */
+bool firebase_stream_is_live(void);
+
+/**
+ * @brief Whether the settings stream is connected and has delivered the document.
+ */
+bool firebase_stream_settings_live(void);
+
+/**
+ * @brief Get a snapshot of the stream counters.
+ *
+ * @param[out] stats Filled with the current values.
+ */
+void firebase_stream_get_stats(firebase_stream_stats_t *stats);
+
+#endif // FIREBASE_STREAM_H
@@ -0,0 +1,128 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+/**
+ * @file journal.h
+ * @brief Offline store-and-forward journal for access logs.
+ *
+ * Access records that could not be uploaded are appended to a dedicated
+ * flash partition as fixed-size binary records. The partition is used as a
+ * circular log, one sector after another, so every sector is erased at the
+ * same rate (wear levelling). Uploaded records are marked by appending an
+ * acknowledgement record; nothing is ever rewritten in place.
+ */
+
+#include "esp_err.h" // For esp_err_t
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Longest UID stored in a journal record (ISO 14443 triple-size UID)
+#define JOURNAL_UID_MAX_LEN 10
+
+/**
+ * @brief One access record as stored in (and read back from) the journal.
+ */
+typedef struct {
+    uint32_t seq;                     // Sequence number, assigned by journal_append()
+    int64_t epoch_us;                 // Time of the scan (microseconds since 1970-01-01 UTC, or uptime with JOURNAL_FLAG_UNSYNCED; stored to the millisecond)
+    uint8_t uid[JOURNAL_UID_MAX_LEN]; // UID bytes
+    uint8_t uid_len;                  // Number of valid bytes in uid
+    uint8_t result;                   // Access result code (access_result_t)
+    uint8_t reader_id;                // Reader that saw the card
+    uint8_t flags;                    // JOURNAL_FLAG_*
+} journal_entry_t;
+
+// Scanned before the clock was set: epoch_us is the uptime of the boot that wrote the record
+#define JOURNAL_FLAG_UNSYNCED 0x01
+
+/**
+ * @brief Journal counters and occupancy.
+ */
+typedef struct {
+    uint32_t pending;     // Records appended but not yet acknowledged
+    uint32_t appended;    // Records appended since boot
+    uint32_t acked;       // Records acknowledged since boot
+    uint32_t overwritten; // Pending records lost because the journal wrapped
+    uint32_t corrupt;     // Slots skipped during recovery because of a bad CRC
+    uint32_t capacity;    // Total record slots in the partition
+} journal_stats_t;
+
+/**
+ * @brief Open the journal partition and recover its state.
+ *
+ * Performs one sequential scan of the partition to find the write position
+ * and the oldest record that has not been acknowledged.
+ *
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_NOT_FOUND if the journal partition does not exist.
+ *     - Other error codes if flash access fails.
+ */
+esp_err_t journal_init(void);
+
+/**
+ * @brief Append one record to the journal.
+ *
+ * @param[in,out] entry Record to store; entry->seq is set on success.
+ *
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_STATE if journal_init() did not succeed.
+ *     - ESP_ERR_INVALID_ARG if the UID is empty or too long.
+ *     - Other error codes if flash access fails.
+ */
+esp_err_t journal_append(journal_entry_t *entry);
+
+/**
+ * @brief Read the oldest records that have not been acknowledged yet.
+ *
+ * Reading does not consume records; call journal_ack() after they have been
+ * uploaded. Calling again without an ack returns the same records.
+ *
+ * @param[out] entries Array receiving up to max records, oldest first.
+ * @param max          Capacity of entries.
+ * @param[out] count   Number of records returned.
+ *
+ * @return
+ *     - ESP_OK on success (count may be 0).
+ *     - ESP_ERR_INVALID_STATE if journal_init() did not succeed.
+ */
+esp_err_t journal_read_pending(journal_entry_t *entries, size_t max, size_t *count);
+
+/**
+ * @brief Mark every record up to and including last_seq as uploaded.
+ *
+ * @param last_seq Sequence number of the last uploaded record, as returned
+ *                 by the most recent journal_read_pending().
+ *
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_STATE if journal_init() did not succeed.
+ *     - Other error codes if flash access fails.
+ */
+esp_err_t journal_ack(uint32_t last_seq);
+
+/**
+ * @brief Number of records waiting to be uploaded (0 if the journal is unavailable).
+ */
+uint32_t journal_pending_count(void);
+
+/**
+ * @brief Check whether a record was written since this boot.
+ *
+ * Uptime stamps (JOURNAL_FLAG_UNSYNCED) can only be dated in the boot that
+ * wrote them.
+ *
+ * @param seq Sequence number of the record.
+ */
+bool journal_seq_this_boot(uint32_t seq);
+
+/**
+ * @brief Get a snapshot of the journal counters.
+ *
+ * @param[out] stats Filled with the current counters.
+ */
+void journal_get_stats(journal_stats_t *stats);
+
+#endif // JOURNAL_H
@@ -0,0 +1,80 @@
+#ifndef JSON_EXTRACT_H
+#define JSON_EXTRACT_H
+
+/**
+ * @file json_extract.h
+ * @brief Streaming extraction of top-level fields from a JSON object.
+ *
+ * The extractor is fed the response body chunk by chunk (for example from
+ * HTTP_EVENT_ON_DATA) and copies only the values of the requested top-level
+ * members into caller buffers. No document tree is built and nothing is
+ * buffered beyond the current key, so memory use does not depend on the
+ * size of the response. Nested objects and arrays are skipped.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Longest member name that can be matched (longer names are skipped)
+#define JSON_EXTRACT_KEY_MAX_LEN 32
+
+/**
+ * @brief One member to extract.
+ *
+ * String values are unescaped (\uXXXX outside ASCII becomes '?'); numbers
+ * and literals are copied as written.
+ */
+typedef struct {
+    const char *key; // Member name
+    char *out;       // Value buffer (NUL-terminated)
+    size_t cap;      // Size of out
+    bool found;      // Member was present with a string or primitive value
+    bool truncated;  // Value did not fit in out
+} json_field_t;
+
+/**
+ * @brief Parser state (opaque to callers; reset with json_extract_init()).
+ */
+typedef struct {
+    json_field_t *fields;
+    size_t count;
+    json_field_t *current;   // Field receiving the current value, if any
+    size_t out_len;          // Bytes written to current->out
+    char key[JSON_EXTRACT_KEY_MAX_LEN];
+    size_t key_len;          // Bytes in key (JSON_EXTRACT_KEY_MAX_LEN: too long)
+    unsigned depth;          // Object/array nesting depth
+    unsigned unicode_left;   // Hex digits left in a \u escape
+    unsigned unicode_value;  // Code unit being read from a \u escape
+    bool in_string;
+    bool escape;             // Previous character was a backslash
+    bool in_key;             // Current string is a top-level member name
+    bool in_primitive;       // Inside a top-level number or literal
+    bool expect_key;         // Next top-level string is a member name
+    bool done;               // Top-level object closed
+    bool error;              // Input is not a JSON object
+} json_extractor_t;
+
+/**
+ * @brief Prepare an extractor.
+ *
+ * @param x      Extractor to initialize.
+ * @param fields Members to extract; their found/truncated flags and buffers are reset.
+ * @param count  Number of fields.
+ */
+void json_extract_init(json_extractor_t *x, json_field_t *fields, size_t count);
+
+/**
+ * @brief Feed the next chunk of the document.
+ *
+ * @param x    Extractor.
+ * @param data Chunk bytes (need not end on a token boundary).
+ * @param len  Number of bytes.
+ */
+void json_extract_feed(json_extractor_t *x, const char *data, size_t len);
+
+/**
+ * @brief Check whether a complete top-level object was read.
+ */
+bool json_extract_complete(const json_extractor_t *x);
+
+#endif // JSON_EXTRACT_H
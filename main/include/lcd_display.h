@@ -3,6 +3,7 @@
 
 // Standard integer types (uint16_t, etc.)
 #include <stdint.h>
+#include <stddef.h>
 
 // ESP-IDF headers for SPI and GPIO control
 #include "driver/spi_master.h"
@@ -28,9 +29,6 @@
 #define LCD_H_RES   128   // Horizontal resolution (pixels)
 #define LCD_V_RES   160   // Vertical resolution (pixels)
 
-// Number of rows to update at once (buffered)
-#define BUF_HEIGHT  40
-
 // --- RGB565 Color Definitions (16-bit) ---
 
 #define RGB565_GRAY   0x8410  // Gray color in RGB565 format
@@ -53,6 +51,29 @@ static const uint16_t card_colors[] = {
     [COLOR_CHIP]    = RGB565_RED
 };
 
+// --- Compressed Images ---
+// Palette + RLE image in flash, generated from PNG assets by main/tools/gen_screens.py.
+// Each data byte is (palette index << 4) | n: a run of n pixels (1..15), or for
+// n == 0 a run of 16 + the LEB128 value that follows.
+typedef struct {
+    uint16_t width;          // Width in pixels
+    uint16_t height;         // Height in pixels
+    const uint16_t *palette; // RGB565 colors, byte-swapped for the panel
+    uint8_t palette_size;    // Number of palette entries (up to 16)
+    const uint8_t *data;     // RLE stream, row by row
+    size_t data_len;         // Length of data in bytes
+} lcd_image_t;
+
+// --- Drawing Statistics ---
+// Counters kept by the driver since boot
+typedef struct {
+    uint32_t fills;         // Full-screen fills sent
+    uint32_t windows;       // CASET/RASET/RAMWR windows sent
+    uint32_t tiles_skipped; // 8x8 tiles not sent because they were unchanged
+    uint64_t bytes_sent;    // Command and pixel bytes sent over SPI
+    uint32_t last_fill_us;  // Duration of the last full-screen fill
+} lcd_stats_t;
+
 // --- LCD API Declarations ---
 
 /**
@@ -63,10 +84,66 @@ void lcd_init(void);
 /**
  * @brief Fill the entire LCD screen with a specified color.
  *
+ * Uses queued DMA transactions and returns once the frame is on the panel.
+ * The drawing functions must be called from one task at a time (the display task).
+ *
  * @param color RGB565 color value to fill the screen with.
  */
 void fill_screen(uint16_t color);
 
+/**
+ * @brief Fill a rectangle with a solid color.
+ *
+ * Only the 8x8 tiles whose content changes are sent; the rectangle is
+ * clipped to the screen.
+ *
+ * @param x     Left edge.
+ * @param y     Top edge.
+ * @param w     Width in pixels.
+ * @param h     Height in pixels.
+ * @param color RGB565 color value.
+ */
+void lcd_draw_rect(int x, int y, int w, int h, uint16_t color);
+
+/**
+ * @brief Copy a block of pixels (e.g. rendered text) to the screen.
+ *
+ * The CASET/RASET window is set to the exact dirty area. Tiles that are
+ * fully covered and unchanged since the last draw are skipped, so updating
+ * a short text line sends only the changed glyphs.
+ *
+ * @param x   Left edge.
+ * @param y   Top edge.
+ * @param w   Width of buf in pixels.
+ * @param h   Height of buf in pixels.
+ * @param buf w * h RGB565 pixels, row by row (any memory; copied into DMA buffers).
+ */
+void lcd_blit(int x, int y, int w, int h, const uint16_t *buf);
+
+/**
+ * @brief Draw a compressed image, decoding it straight into the SPI DMA buffers.
+ *
+ * The image is expanded one chunk at a time; no framebuffer is needed.
+ * Drawing the same image at the same place again sends nothing.
+ *
+ * @param x   Left edge.
+ * @param y   Top edge.
+ * @param img Image; must fit on the screen at (x, y).
+ *
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if the image does not fit or its data is inconsistent.
+ *     - ESP_ERR_INVALID_STATE if the LCD is not initialized.
+ */
+esp_err_t lcd_draw_image(int x, int y, const lcd_image_t *img);
+
+/**
+ * @brief Get a snapshot of the drawing counters (including the last fill time).
+ *
+ * @param[out] stats Filled with the current counters.
+ */
+void lcd_get_stats(lcd_stats_t *stats);
+
 /**
  * @brief Get the RGB565 color associated with a CardColor state.
  *
@@ -0,0 +1,90 @@
+#ifndef LOG_SERIALIZER_H
+#define LOG_SERIALIZER_H
+
+/**
+ * @file log_serializer.h
+ * @brief Allocation-free JSON encoding of access log records.
+ *
+ * The rfid_logs schema is fixed ({"uid": ..., "timestamp": ..., "reader": ...}, plus
+ * "conflict": true on reconciled records that the allowlist now decides differently, and
+ * "unsynced": true, "uptime_ms": ... in place of the timestamp for scans that could not be
+ * dated), so the request bodies are written directly into a caller-provided
+ * buffer instead of building a cJSON tree. Nothing is allocated per record; a body that does
+ * not fit is reported instead of being truncated.
+ */
+
+#include "firebase.h" // For firebase_log_record_t
+#include "timebase.h" // For TIMEBASE_ISO8601_MAX_LEN
+#include <stddef.h>
+#include <stdbool.h>
+
+// Longest body of one record: {"uid":"<uid>","timestamp":"<timestamp>","reader":<0-255>,"conflict":true}
+#define LOG_SERIALIZER_RECORD_MAX_LEN \
+    (sizeof("{\"uid\":\"\",\"timestamp\":\"\",\"reader\":255,\"conflict\":true}") + FIREBASE_LOG_UID_MAX_LEN + \
+     TIMEBASE_ISO8601_MAX_LEN)
+
+// Compact form (CONFIG_FIREBASE_LOG_COMPACT): {"u":"<hex uid>","t":<epoch ms>,"r":<0-255>,"c":1},
+// with "m":<uptime ms> instead of "t" for an undated scan.
+// It is always shorter than the full form, so the limits above cover both. The undated form
+// (at most 16 digits of uptime) is no longer than a timestamp either.
+
+// Longest batch entry: "<key>":<record>, (key of key_len characters)
+#define LOG_SERIALIZER_ENTRY_MAX_LEN(key_len) ((key_len) + 4 + LOG_SERIALIZER_RECORD_MAX_LEN)
+
+/**
+ * @brief Output buffer state.
+ *
+ * Once a write does not fit, overflow stays set and later writes are ignored,
+ * so the caller checks for errors once at the end.
+ */
+typedef struct {
+    char *buf;     // Output buffer (always NUL-terminated)
+    size_t cap;    // Size of buf
+    size_t len;    // Bytes written, excluding the terminator
+    bool overflow; // A write did not fit
+} log_writer_t;
+
+/**
+ * @brief Start writing into a buffer.
+ *
+ * @param w   Writer to initialize.
+ * @param buf Output buffer.
+ * @param cap Size of buf (at least 1).
+ */
+void log_writer_init(log_writer_t *w, char *buf, size_t cap);
+
+/**
+ * @brief Write one record as a JSON object (body of a POST to rfid_logs).
+ *
+ * The "timestamp" member is the record time formatted as ISO 8601 UTC with
+ * milliseconds, so entries sort chronologically as strings. With
+ * CONFIG_FIREBASE_LOG_COMPACT the compact form is written instead.
+ */
+void log_write_record(log_writer_t *w, const firebase_log_record_t *record);
+
+/**
+ * @brief Open a multi-path update object ("{").
+ */
+void log_write_batch_begin(log_writer_t *w);
+
+/**
+ * @brief Write one "<key>":{record} member of a multi-path update.
+ *
+ * @param key Child key or relative path ("<device>/<day>/<push key>");
+ *            must not need JSON escaping.
+ */
+void log_write_batch_entry(log_writer_t *w, const char *key, const firebase_log_record_t *record);
+
+/**
+ * @brief Close a multi-path update object ("}").
+ */
+void log_write_batch_end(log_writer_t *w);
+
+/**
+ * @brief Finish writing.
+ *
+ * @return Length of the output, or 0 if it did not fit in the buffer.
+ */
+size_t log_writer_finish(const log_writer_t *w);
+
+#endif // LOG_SERIALIZER_H
@@ -0,0 +1,123 @@
+#ifndef MEM_POOL_H
+#define MEM_POOL_H
+
+/**
+ * @file mem_pool.h
+ * @brief Fixed-size block pools with peak-usage accounting.
+ *
+ * Buffers that used to be malloc'd per request (allowlist sync responses,
+ * change lists, cJSON nodes) come from pools instead. With
+ * CONFIG_MEM_STATIC_POOLS, each pool takes one heap allocation for all of its
+ * blocks when it is initialized at boot and never returns it, so the heap
+ * stops changing shape once the device is up. Without it, blocks are
+ * malloc'd and freed on demand as before, but are still counted, so the
+ * reported peaks show how large each pool would have to be.
+ *
+ * Every pool keeps its current and peak usage; mem_pool_report() (console
+ * "pools") lists them.
+ */
+
+#include "esp_err.h"            // For esp_err_t
+#include "freertos/FreeRTOS.h"  // For portMUX_TYPE
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Most pools that can be listed by mem_pool_report()
+#define MEM_POOL_MAX_POOLS 8
+
+// Block sizes of the cJSON pools: nodes and short strings, longer strings and print buffers
+#define MEM_POOL_JSON_SMALL_SIZE 48
+#define MEM_POOL_JSON_LARGE_SIZE 256
+
+/**
+ * @brief A pool of equal-sized blocks.
+ *
+ * Declare with MEM_POOL_INIT() and call mem_pool_init() once before use.
+ */
+typedef struct {
+    const char *name;     // Name in the report
+    size_t block_size;    // Bytes per block (rounded up to pointer alignment)
+    uint16_t block_count; // Blocks in the pool
+    uint8_t *storage;     // All blocks, allocated by mem_pool_init() (static pools only)
+    void *free_list;      // Next free block (static pools only)
+    uint16_t used;        // Blocks handed out
+    uint16_t peak;        // Most blocks handed out at once
+    uint32_t failures;    // Allocations refused because the pool was empty
+    portMUX_TYPE lock;
+} mem_pool_t;
+
+// Static initializer: MEM_POOL_INIT("name", block_size, block_count)
+#define MEM_POOL_INIT(pool_name, size, count) { \
+    .name = (pool_name),                        \
+    .block_size = (size),                       \
+    .block_count = (count),                     \
+    .lock = portMUX_INITIALIZER_UNLOCKED,       \
+}
+
+/**
+ * @brief Usage counters of one pool.
+ */
+typedef struct {
+    uint16_t block_count; // Blocks in the pool
+    uint16_t used;        // Blocks handed out
+    uint16_t peak;        // Most blocks handed out at once
+    uint32_t failures;    // Allocations refused because the pool was empty
+} mem_pool_stats_t;
+
+/**
+ * @brief Reserve the pool's storage and add it to the report.
+ *
+ * Calling it again for the same pool does nothing.
+ *
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_NO_MEM if the storage could not be allocated.
+ */
+esp_err_t mem_pool_init(mem_pool_t *pool);
+
+/**
+ * @brief Take one block.
+ *
+ * Safe to call from any task; never blocks.
+ *
+ * @return The block (block_size bytes, not cleared), or NULL if the pool is empty.
+ */
+void *mem_pool_alloc(mem_pool_t *pool);
+
+/**
+ * @brief Return a block taken from this pool (NULL is ignored).
+ */
+void mem_pool_free(mem_pool_t *pool, void *block);
+
+/**
+ * @brief Get a snapshot of the pool's counters.
+ *
+ * @param pool Pool.
+ * @param[out] stats Filled with the current values.
+ */
+void mem_pool_get_stats(mem_pool_t *pool, mem_pool_stats_t *stats);
+
+/**
+ * @brief Log the usage of every initialized pool and of the cJSON allocator.
+ */
+void mem_pool_report(void);
+
+/**
+ * @brief Route cJSON allocations through two block pools.
+ *
+ * Nodes and strings up to MEM_POOL_JSON_LARGE_SIZE bytes come from the pools
+ * (sized by CONFIG_MEM_POOL_JSON_SMALL_BLOCKS / _LARGE_BLOCKS); larger ones,
+ * or any once a pool is empty, fall back to the heap and are counted.
+ * Call once at boot, before anything uses cJSON. Does nothing without
+ * CONFIG_MEM_STATIC_POOLS.
+ *
+ * Strings printed by cJSON must then be released with cJSON_free().
+ *
+ * @return
+ *     - ESP_OK on success (or if static pools are disabled).
+ *     - ESP_ERR_NO_MEM if the pools could not be allocated.
+ */
+esp_err_t mem_pool_json_init(void);
+
+#endif // MEM_POOL_H
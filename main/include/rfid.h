@@ -4,6 +4,7 @@
 // Include the ESP-IDF error codes header.
 // esp_err_t is the return type for functions that report success or standard error codes.
 #include "esp_err.h"  // For esp_err_t
+#include <stdint.h>   // For fixed-width counters
 
 // Define the GPIO pin numbers for the SPI connection to the RC522 RFID scanner.
 // These constants make the code more readable and easier to maintain.
@@ -13,9 +14,40 @@
 #define RC522_SPI_SCANNER_GPIO_SDA 22 // SPI Chip Select (SDA) pin for RC522
 #define RC522_SCANNER_GPIO_RST 21     // Reset (RST) pin for RC522
 
+// Second reader (e.g. the exit side of the door), sharing the SPI bus above.
+// Used when CONFIG_RFID_READER_COUNT is 2.
+#define RC522_SPI_SCANNER1_GPIO_SDA 5 // SPI Chip Select (SDA) pin for the second RC522
+#define RC522_SCANNER1_GPIO_RST 17    // Reset (RST) pin for the second RC522
+
+// Number of reader slots in the wiring table (rfid.c)
+#define RFID_MAX_READERS 2
+
 // Declare the initialization function for the RFID reader.
-// This function sets up and starts the RFID reader, returning ESP_OK on success or an error code.
+// This function sets up and starts the CONFIG_RFID_READER_COUNT readers, returning ESP_OK on
+// success or an error code. Every access event carries the index of the reader it came from.
 esp_err_t rfid_reader_init(void);
 
+// Counters of the duplicate-tap filter.
+// A card held on the reader produces many reads; only the first one within
+// CONFIG_RFID_DEDUPE_WINDOW_MS becomes an access event (display + upload).
+typedef struct {
+    uint32_t reads;      // Card reads reported by the RC522 driver
+    uint32_t events;     // Reads that became access events
+    uint32_t suppressed; // Repeat reads folded into an earlier event
+    uint32_t max_dwell;  // Most reads folded into a single event
+    uint32_t dropped;    // Reads lost because the access task queue was full
+    uint32_t queue_high_water; // Most reads waiting for the access task at once
+    uint32_t reader_events[RFID_MAX_READERS]; // Access events per reader
+} rfid_stats_t;
+
+// Copy the current counters into *stats.
+void rfid_get_stats(rfid_stats_t *stats);
+
+// Hand a synthetic card read to the access task, exactly as the RC522 event handler
+// does for a real card (used by the benchmark mode, bench.h). Never blocks.
+// Returns ESP_ERR_INVALID_ARG for a bad reader index or UID length, ESP_ERR_INVALID_STATE
+// before rfid_reader_init(), and ESP_ERR_TIMEOUT if the read was dropped (queue full).
+esp_err_t rfid_inject_read(uint8_t reader, const uint8_t *uid, uint8_t uid_len);
+
 // End of include guard
 #endif // RFID_READER_H
@@ -0,0 +1,127 @@
+#ifndef RFID_SCAN_H
+#define RFID_SCAN_H
+
+/**
+ * @file rfid_scan.h
+ * @brief Adaptive RC522 polling policy for low-power readers.
+ *
+ * In fast mode the RC522 driver polls continuously every
+ * rfid_poll_interval_ms (settings.h). When the reader has been idle for a while
+ * (and it is outside the configured busy hours), the policy switches to idle
+ * mode: the scanner is paused and only resumed for a short scan window every
+ * idle interval. While it is paused the CPU may slow down and enter light
+ * sleep; while it scans it runs at full clock. A detection switches back to
+ * fast mode immediately.
+ *
+ * Per-mode counters relate the expected detection latency to the average
+ * current draw, so the trade-off of a policy can be checked in the field.
+ */
+
+#include "esp_err.h"   // For esp_err_t
+#include "rc522.h"     // For rc522_handle_t
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @brief Scanning modes.
+ */
+typedef enum {
+    RFID_SCAN_MODE_FAST = 0, // Continuous polling
+    RFID_SCAN_MODE_IDLE,     // Short scan windows separated by sleep
+    RFID_SCAN_MODE_COUNT,
+} rfid_scan_mode_t;
+
+/**
+ * @brief Runtime scan policy.
+ */
+typedef struct {
+    uint32_t idle_interval_ms; // Scanner paused for this long between idle windows (0: always fast)
+    uint32_t idle_window_ms;   // Scanner runs for this long per idle wake-up
+    uint32_t fast_hold_ms;     // Stay in fast mode this long after a detection
+    uint8_t busy_start_hour;   // Local hour [0, 23] from which polling is always fast
+    uint8_t busy_end_hour;     // Local hour at which the busy period ends (same as start: none)
+} rfid_scan_policy_t;
+
+/**
+ * @brief Counters of one scan mode.
+ */
+typedef struct {
+    uint64_t time_ms;        // Time spent in this mode
+    uint64_t scan_ms;        // Part of time_ms with the scanner running
+    uint32_t detections;     // Access events detected in this mode
+    uint32_t wakeups;        // Idle scan windows started (idle mode only)
+    uint32_t est_latency_ms; // Expected delay from card presented to detection
+    uint32_t avg_current_ua; // Average current from the measured scan duty cycle
+} rfid_scan_mode_stats_t;
+
+/**
+ * @brief Scan policy counters.
+ */
+typedef struct {
+    rfid_scan_mode_t mode;                              // Current mode
+    rfid_scan_mode_stats_t modes[RFID_SCAN_MODE_COUNT]; // Per-mode counters
+} rfid_scan_stats_t;
+
+/**
+ * @brief Start applying the scan policy to running scanners.
+ *
+ * The initial policy comes from the settings (settings.h). Called by
+ * rfid_reader_init().
+ * All readers switch modes together.
+ *
+ * @param scanners Scanners created and started by the caller.
+ * @param count    Number of scanners.
+ *
+ * @return
+ *     - ESP_OK on success.
+ *     - Other error codes if the policy timer could not be created.
+ */
+esp_err_t rfid_scan_init(const rc522_handle_t *scanners, size_t count);
+
+/**
+ * @brief Report an access event, switching to fast mode.
+ *
+ * Called from the RC522 event handler.
+ */
+void rfid_scan_on_detection(void);
+
+/**
+ * @brief Replace the scan policy.
+ *
+ * Takes effect immediately.
+ *
+ * @param policy New policy.
+ *
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_ARG if an hour is out of range or the idle window is
+ *       shorter than the poll interval.
+ *     - ESP_ERR_INVALID_STATE if rfid_scan_init() has not run.
+ */
+esp_err_t rfid_scan_set_policy(const rfid_scan_policy_t *policy);
+
+/**
+ * @brief Replace the scan policy with the one in the settings (settings.h).
+ *
+ * Called after remote settings have been applied.
+ *
+ * @return Same as rfid_scan_set_policy().
+ */
+esp_err_t rfid_scan_apply_settings(void);
+
+/**
+ * @brief Get the current scan policy.
+ *
+ * @param[out] policy Filled with the current policy.
+ */
+void rfid_scan_get_policy(rfid_scan_policy_t *policy);
+
+/**
+ * @brief Get a snapshot of the scan policy counters.
+ *
+ * @param[out] stats Filled with the current counters.
+ */
+void rfid_scan_get_stats(rfid_scan_stats_t *stats);
+
+#endif // RFID_SCAN_H
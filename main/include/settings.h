@@ -0,0 +1,131 @@
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+/**
+ * @file settings.h
+ * @brief Tunable settings: menuconfig defaults, NVS copy and remote overrides.
+ *
+ * The values start from menuconfig, are overlaid at boot with the copy
+ * stored in NVS, and can be overridden from Firebase (device_config/<Wi-Fi
+ * MAC>, pushed over the settings event stream, or pulled by the uploader
+ * with the allowlist sync while the stream is down). Everything is
+ * parsed and range-checked once into one flat settings_t; code that uses a
+ * setting reads the field through settings_get(), with no lookup.
+ *
+ * Live settings (rates, batch sizes, poll intervals) take effect on their
+ * next use. Boot settings (SPI clock, time zone, RC522 poll interval) are
+ * stored and take effect after the next restart.
+ *
+ * The stored copy is versioned (SETTINGS_SCHEMA_VERSION) and fields are only
+ * ever appended to settings_t, so copies written by an older or a newer
+ * firmware still load after an OTA update or a rollback: fields that are
+ * missing keep their defaults, fields this firmware does not know are
+ * ignored.
+ *
+ * Pins and buffer sizes stay compile-time: they describe the hardware and
+ * the static allocations, not performance knobs.
+ */
+
+#include "esp_err.h" // For esp_err_t
+#include "cJSON.h"   // For cJSON
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Version of the settings_t layout and of the remote key set
+#define SETTINGS_SCHEMA_VERSION 1
+
+// Longest POSIX TZ string, including the terminator
+#define SETTINGS_TZ_MAX_LEN 64
+
+/**
+ * @brief All tunable settings. Append new fields at the end only.
+ */
+typedef struct {
+    uint32_t revision;                // Remote revision last applied (0: none, menuconfig defaults)
+
+    // Boot settings (applied at the next restart)
+    uint32_t lcd_spi_hz;              // LCD SPI clock
+    uint32_t rfid_poll_interval_ms;   // RC522 poll interval in fast mode
+    char timezone[SETTINGS_TZ_MAX_LEN]; // POSIX TZ for local-time formatting
+
+    // Live settings
+    uint32_t rfid_dedupe_window_ms;   // Repeat reads of a card within this window are one tap
+    uint32_t display_hold_ms;         // Access screen shown this long
+    uint32_t upload_batch_max;        // Most records per upload request
+    uint32_t upload_batch_flush_ms;   // Longest wait for a batch to fill
+    uint32_t authz_sync_interval_s;   // Allowlist (and settings) poll interval
+    uint32_t journal_retry_interval_ms; // Retry interval for journaled records
+    uint32_t wifi_retry_base_ms;      // First reconnect delay
+    uint32_t wifi_retry_max_ms;       // Longest reconnect delay
+    uint32_t scan_idle_interval_ms;   // Scan policy: pause between idle windows (0: always fast)
+    uint32_t scan_idle_window_ms;     // Scan policy: scan window length
+    uint32_t scan_fast_hold_ms;       // Scan policy: fast mode hold after a detection
+    uint8_t scan_busy_start_hour;     // Scan policy: busy hours start (local hour)
+    uint8_t scan_busy_end_hour;       // Scan policy: busy hours end (local hour)
+} settings_t;
+
+/**
+ * @brief Result of applying a remote settings document.
+ */
+typedef enum {
+    SETTINGS_UNCHANGED = 0, // Same revision as applied before, or no document and nothing to revert
+    SETTINGS_APPLIED,       // New values in effect (boot settings after a restart)
+    SETTINGS_REJECTED,      // Invalid document: nothing applied
+} settings_result_t;
+
+/**
+ * @brief Load the settings: menuconfig defaults overlaid with the NVS copy.
+ *
+ * Call once at boot, after nvs_flash_init() and before the first module
+ * that reads settings is started (and before any update is applied). Invalid stored values keep their defaults.
+ *
+ * @return ESP_OK (a missing or unreadable NVS copy is not an error).
+ */
+esp_err_t settings_init(void);
+
+/**
+ * @brief The settings in effect.
+ *
+ * Updates build a complete copy and publish it by switching between two
+ * buffers, so the fields read through one pointer always belong to the same
+ * revision (wifi_retry_base_ms never exceeds wifi_retry_max_ms). Call it
+ * again for each use instead of keeping the pointer: a pointer held across
+ * two updates would see its buffer rewritten. Boot fields keep the values
+ * this boot started with.
+ */
+const settings_t *settings_get(void);
+
+/**
+ * @brief Apply a remote settings document and store it in NVS.
+ *
+ * The document is a JSON object such as
+ * {"schema":1,"revision":7,"upload_batch_max":32,"display_hold_ms":2000}.
+ * A new revision is applied on top of the menuconfig defaults, so keys that
+ * are left out revert to them; "null" (no document) reverts all overrides.
+ * Unknown keys are logged and skipped; a value out of range, or values that
+ * contradict each other, reject the whole document.
+ *
+ * Updates are serialized: safe to call from the uploader and the stream task.
+ *
+ * @param json Response body (NUL-terminated).
+ *
+ * @return What happened to the settings.
+ */
+settings_result_t settings_apply_json(const char *json);
+
+/**
+ * @brief Apply a parsed remote settings document (see settings_apply_json()).
+ *
+ * @param doc The document; NULL or a JSON null reverts all overrides.
+ *
+ * @return What happened to the settings.
+ */
+settings_result_t settings_apply_document(const cJSON *doc);
+
+/**
+ * @brief Log the settings in effect.
+ */
+void settings_report(void);
+
+#endif // SETTINGS_H
@@ -0,0 +1,74 @@
+#ifndef SSE_PARSER_H
+#define SSE_PARSER_H
+
+/**
+ * @file sse_parser.h
+ * @brief Incremental parser for text/event-stream (Server-Sent Events).
+ *
+ * The parser is fed the response body as it arrives, in chunks of any size,
+ * and calls back once per complete event with its type and data. Only the
+ * "event" and "data" fields are used; "id", "retry" and comments are
+ * skipped. The data of one event is collected into a caller buffer, so its
+ * size bounds the largest event that can be delivered intact.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Longest event type that is kept (longer types are truncated)
+#define SSE_EVENT_MAX_LEN 24
+
+/**
+ * @brief Called for every complete event.
+ *
+ * @param event    Event type ("message" if the event had none).
+ * @param data     Event data, NUL-terminated (lines joined with '\n').
+ * @param len      Length of data.
+ * @param overflow Data did not fit in the buffer; data holds only the start.
+ * @param arg      User argument from sse_parser_init().
+ */
+typedef void (*sse_event_cb_t)(const char *event, const char *data, size_t len, bool overflow,
+                               void *arg);
+
+/**
+ * @brief Parser state (opaque to callers; reset with sse_parser_init()).
+ */
+typedef struct {
+    sse_event_cb_t cb;
+    void *arg;
+    char *data;                     // Data buffer (caller-owned)
+    size_t cap;                     // Size of data
+    size_t len;                     // Bytes in data
+    bool overflow;                  // Data of the current event was cut off
+    bool has_data;                  // At least one data line in the current event
+    char event[SSE_EVENT_MAX_LEN];  // Type of the current event
+    size_t event_len;
+    char field[8];                  // Name of the field being read
+    size_t field_len;               // Bytes in field (sizeof(field): unknown field)
+    bool after_cr;                  // Previous character ended a line with '\r'
+    enum { SSE_FIELD, SSE_VALUE_START, SSE_VALUE } state;
+} sse_parser_t;
+
+/**
+ * @brief Prepare a parser.
+ *
+ * @param p    Parser to initialize.
+ * @param buf  Buffer for the data of one event.
+ * @param cap  Size of buf.
+ * @param cb   Event callback.
+ * @param arg  User argument passed to cb.
+ */
+void sse_parser_init(sse_parser_t *p, char *buf, size_t cap, sse_event_cb_t cb, void *arg);
+
+/**
+ * @brief Feed the next chunk of the stream.
+ *
+ * Calls the callback for every event completed by this chunk.
+ *
+ * @param p    Parser.
+ * @param data Chunk bytes (need not end on a line boundary).
+ * @param len  Number of bytes.
+ */
+void sse_parser_feed(sse_parser_t *p, const char *data, size_t len);
+
+#endif // SSE_PARSER_H
@@ -0,0 +1,71 @@
+#ifndef TASK_LAYOUT_H
+#define TASK_LAYOUT_H
+
+/**
+ * @file task_layout.h
+ * @brief Core assignment of the application tasks and stack usage report.
+ *
+ * The network side (Wi-Fi, lwIP, the Firebase uploader and token manager)
+ * runs on one core, so TLS handshakes and HTTP I/O never compete with a
+ * tap. The access path (RFID event handling, authorization and the display)
+ * runs on the other core at a higher priority. Cores, priorities and stack
+ * sizes are set in the "Task layout" menu.
+ *
+ * Application tasks register here after creation (and unregister before
+ * they delete themselves); their stack high-water marks are logged
+ * periodically so stack sizes can be trimmed.
+ */
+
+#include "esp_err.h"            // For esp_err_t
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"      // For TaskHandle_t
+#include <stdint.h>
+
+// Core of the network tasks and of the access path (both 0 on single-core builds)
+#if CONFIG_FREERTOS_UNICORE
+#define TASK_LAYOUT_NET_CORE    0
+#define TASK_LAYOUT_ACCESS_CORE 0
+#else
+#define TASK_LAYOUT_NET_CORE    CONFIG_TASK_LAYOUT_NET_CORE
+#define TASK_LAYOUT_ACCESS_CORE CONFIG_TASK_LAYOUT_ACCESS_CORE
+#endif
+
+// Most tasks that can be registered for the stack report
+#define TASK_LAYOUT_MAX_TASKS 8
+
+/**
+ * @brief Add a task to the stack report.
+ *
+ * @param task       Handle of the created task.
+ * @param stack_size Stack size it was created with (bytes).
+ */
+void task_layout_register(TaskHandle_t task, uint32_t stack_size);
+
+/**
+ * @brief Remove a task from the stack report.
+ *
+ * A task that deletes itself must call this first: once it returns, no
+ * report reads the task any more.
+ *
+ * @param task Handle of a registered task.
+ */
+void task_layout_unregister(TaskHandle_t task);
+
+/**
+ * @brief Log the stack high-water mark of every registered task.
+ *
+ * With CONFIG_FREERTOS_USE_TRACE_FACILITY, the remaining system tasks
+ * (Wi-Fi, lwIP, timers, RC522 driver, ...) are listed as well.
+ */
+void task_layout_report_stacks(void);
+
+/**
+ * @brief Log the stack report every CONFIG_TASK_STACK_REPORT_INTERVAL_S seconds.
+ *
+ * @return
+ *     - ESP_OK on success (or if the report is disabled).
+ *     - ESP_ERR_NO_MEM if the report timer could not be created.
+ */
+esp_err_t task_layout_start_report(void);
+
+#endif // TASK_LAYOUT_H
@@ -0,0 +1,57 @@
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+/**
+ * @file time_sync.h
+ * @brief Background SNTP synchronization with drift tracking.
+ *
+ * SNTP runs in the background from boot: nothing waits for it. The first
+ * answer sets the clock; after that the server is polled again every
+ * CONFIG_TIME_SYNC_INTERVAL_S and each answer is handed to timebase.h, which
+ * slews the event clock, while the system clock is adjusted smoothly
+ * (SNTP_SYNC_MODE_SMOOTH). The correction found at each resync, divided by
+ * the time since the previous one, is the drift of the local oscillator.
+ *
+ * Events stamped before the first sync carry FIREBASE_LOG_FLAG_UNSYNCED and
+ * their uptime instead of a date; the uploader dates them once the clock is
+ * set.
+ */
+
+#include "esp_err.h" // For esp_err_t
+#include <stdint.h>
+
+/**
+ * @brief Synchronization counters.
+ */
+typedef struct {
+    uint32_t syncs;             // SNTP answers applied since boot
+    uint32_t steps;             // Resyncs whose correction was too large to slew
+    int64_t first_sync_us;      // esp_timer time of the first answer (0: never synced)
+    int64_t last_sync_us;       // esp_timer time of the last answer (0: never synced)
+    int64_t last_correction_us; // Correction applied by the last resync (first sync excluded)
+    int32_t drift_ppb;          // Drift measured at the last slewed resync (positive: local clock slow)
+} time_sync_stats_t;
+
+/**
+ * @brief Start SNTP in the background.
+ *
+ * Call once at boot, after timebase_init(). SNTP polls once the network is
+ * up.
+ *
+ * @return ESP_OK.
+ */
+esp_err_t time_sync_start(void);
+
+/**
+ * @brief Get a snapshot of the counters.
+ *
+ * @param[out] stats Filled with the current values.
+ */
+void time_sync_get_stats(time_sync_stats_t *stats);
+
+/**
+ * @brief Log the sync state, the last correction and the drift.
+ */
+void time_sync_report(void);
+
+#endif // TIME_SYNC_H
@@ -0,0 +1,84 @@
+#ifndef TIMEBASE_H
+#define TIMEBASE_H
+
+/**
+ * @file timebase.h
+ * @brief Wall-clock timestamps for access events.
+ *
+ * Events are stamped with a 64-bit UTC time in microseconds, computed as the
+ * monotonic esp_timer clock plus an epoch offset. The offset is corrected
+ * on every SNTP sync (time_sync.h), so stamping an event costs one timer
+ * read and never touches the time zone. Formatting to text happens later,
+ * on the uploader task, always in UTC.
+ *
+ * The first sync after boot steps the offset. Later corrections of up to
+ * TIMEBASE_STEP_THRESHOLD_US are slewed in at TIMEBASE_SLEW_PPM instead, so
+ * consecutive timestamps never jump or run backwards.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Buffer size for timebase_format_utc() ("2026-01-31T23:59:59.123Z" + terminator)
+#define TIMEBASE_ISO8601_MAX_LEN 32
+
+// Larger corrections step the clock instead of slewing it
+#define TIMEBASE_STEP_THRESHOLD_US 1000000
+// Slew rate: the clock runs at most this much faster or slower while catching up
+#define TIMEBASE_SLEW_PPM 500
+
+/**
+ * @brief Configure the time zone (settings.h, CONFIG_TIMEBASE_TZ by default) and the epoch offset.
+ *
+ * Call once at boot, after settings_init() and before any event is stamped.
+ */
+void timebase_init(void);
+
+/**
+ * @brief Correct the clock to a new UTC reference (SNTP sync callback).
+ *
+ * @param utc_us Current UTC time in microseconds since 1970-01-01.
+ *
+ * @return Correction in microseconds: the reference minus the time the clock
+ *         would have shown once any earlier slew had finished (positive: the
+ *         clock was slow).
+ */
+int64_t timebase_resync(int64_t utc_us);
+
+/**
+ * @brief Check whether the clock has been set by SNTP since boot.
+ */
+bool timebase_is_synced(void);
+
+/**
+ * @brief Current UTC time in microseconds since 1970-01-01.
+ *
+ * Cheap enough for the card event path; safe from any task or ISR.
+ */
+int64_t timebase_now_us(void);
+
+/**
+ * @brief UTC time of an earlier esp_timer reading of this boot.
+ *
+ * Used to date events that were stamped with their uptime before the first
+ * sync.
+ *
+ * @param uptime_us esp_timer_get_time() at the event.
+ *
+ * @return Time in microseconds since 1970-01-01 UTC.
+ */
+int64_t timebase_uptime_to_utc(int64_t uptime_us);
+
+/**
+ * @brief Format a timestamp as ISO 8601 UTC with milliseconds.
+ *
+ * @param epoch_us Time in microseconds since 1970-01-01 UTC.
+ * @param[out] buf Output buffer (TIMEBASE_ISO8601_MAX_LEN bytes is always enough).
+ * @param cap      Size of buf.
+ *
+ * @return Length of the string, or 0 if it did not fit.
+ */
+size_t timebase_format_utc(int64_t epoch_us, char *buf, size_t cap);
+
+#endif // TIMEBASE_H
@@ -0,0 +1,111 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+/**
+ * @file trace.h
+ * @brief Latency histograms for the tap hot path.
+ *
+ * Every access event is stamped when the RC522 driver reports the card
+ * (the "tap"), and the stamp travels with the event: in the access task's
+ * queue entry, in the display request and in the upload record. Each later
+ * stage records the time elapsed since the tap into a fixed-bucket
+ * histogram in RAM. Recording never allocates and never blocks.
+ *
+ * Stamps come from esp_timer (microseconds). The CPU cycle counters are
+ * per core and not synchronized, and the stages of one tap run on
+ * different cores (task_layout.h).
+ */
+
+#include "esp_err.h"      // For esp_err_t
+#include "esp_timer.h"    // For esp_timer_get_time()
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief Stages measured from the tap.
+ */
+typedef enum {
+    TRACE_SPAN_DECISION = 0,   // Tap -> authorization decided
+    TRACE_SPAN_DISPLAY_QUEUED, // Tap -> display request queued
+    TRACE_SPAN_DISPLAY_DONE,   // Tap -> new screen sent over SPI
+    TRACE_SPAN_UPLOAD_QUEUED,  // Tap -> log record queued for upload
+    TRACE_SPAN_CLOUD_ACK,      // Tap -> Firebase acknowledged the record
+    TRACE_SPAN_COUNT,
+} trace_span_t;
+
+// Histogram buckets: bucket i holds latencies below 2^(i + TRACE_BUCKET_SHIFT) us;
+// the last bucket holds everything slower
+#define TRACE_BUCKETS      16
+#define TRACE_BUCKET_SHIFT 7 // First bucket: < 128 us; last bounded bucket: < 2^21 us (~2 s)
+
+// Longest output of trace_format_json()
+#define TRACE_JSON_MAX_LEN (TRACE_SPAN_COUNT * (120 + TRACE_BUCKETS * 11) + 2)
+
+/**
+ * @brief Latency histogram of one stage.
+ */
+typedef struct {
+    uint32_t count;                  // Samples recorded
+    uint32_t min_us;                 // Fastest sample
+    uint32_t max_us;                 // Slowest sample
+    uint64_t total_us;               // Sum of all samples
+    uint32_t buckets[TRACE_BUCKETS]; // Samples per bucket
+} trace_histogram_t;
+
+/**
+ * @brief Timestamp of a tap (0 is reserved for "not traced").
+ */
+static inline int64_t trace_tap_now(void) {
+    return esp_timer_get_time();
+}
+
+/**
+ * @brief Record the time since a tap for one stage.
+ *
+ * Safe to call from any task. Does nothing if tap_us is 0 or tracing is
+ * disabled (CONFIG_TRACE_LATENCY).
+ *
+ * @param span   Stage that was just reached.
+ * @param tap_us trace_tap_now() of the tap.
+ */
+void trace_record(trace_span_t span, int64_t tap_us);
+
+/**
+ * @brief Get a snapshot of one histogram.
+ *
+ * @param span Stage.
+ * @param[out] out Filled with the histogram.
+ */
+void trace_get_histogram(trace_span_t span, trace_histogram_t *out);
+
+/**
+ * @brief Clear all histograms.
+ */
+void trace_reset(void);
+
+/**
+ * @brief Short name of a stage ("decision", "display_queued", ...).
+ */
+const char *trace_span_name(trace_span_t span);
+
+/**
+ * @brief Upper bound of a bucket in microseconds (UINT32_MAX for the last one).
+ */
+uint32_t trace_bucket_limit_us(size_t bucket);
+
+/**
+ * @brief Print all histograms to the log (console "latency" command).
+ */
+void trace_print(void);
+
+/**
+ * @brief Format all histograms as a JSON object for the device_metrics node.
+ *
+ * @param buf Output buffer.
+ * @param cap Size of buf.
+ *
+ * @return Length of the JSON text, or 0 if it did not fit.
+ */
+size_t trace_format_json(char *buf, size_t cap);
+
+#endif // TRACE_H
@@ -5,17 +5,23 @@
  *
  * This header declares functions for initializing Wi-Fi in station mode
  * and managing Wi-Fi connection status using FreeRTOS event groups.
+ *
+ * Lost connections are retried with jittered exponential backoff. The BSSID
+ * and channel of the last access point are cached in NVS, so the first
+ * attempt after boot or after a drop skips the full channel scan.
  */
 
 #include "freertos/FreeRTOS.h"    // FreeRTOS core definitions
 #include "freertos/event_groups.h" // FreeRTOS event group API
+#include <stdbool.h>
+#include <stdint.h>
 
 /**
  * @brief Bit used to indicate a successful Wi-Fi connection.
  *
  * This bit will be set in the event group when the ESP32 connects to the Wi-Fi access point
- * and receives an IP address. Other parts of the program can wait on this bit to detect
- * when Wi-Fi is ready.
+ * and receives an IP address, and cleared again when the connection is lost. Other parts of
+ * the program can wait on this bit to detect when Wi-Fi is ready.
  */
 #define WIFI_CONNECTED_BIT BIT0
 
@@ -25,11 +31,46 @@
  * This function:
  * - Initializes the TCP/IP stack.
  * - Configures the Wi-Fi driver in station mode.
- * - Connects to the specified access point.
+ * - Connects to the specified access point (fast connect if a cached BSSID exists).
  * - Registers event handlers to automatically reconnect if disconnected.
  */
 void wifi_init_sta(void);
 
+/**
+ * @brief Connection counters.
+ */
+typedef struct {
+    uint32_t connects;         // Successful associations (IP assigned)
+    uint32_t disconnects;      // Lost connections and failed attempts
+    uint32_t fast_connects;    // Associations that used the cached BSSID and channel
+    uint32_t fast_misses;      // Fast attempts that failed and fell back to a full scan
+    uint32_t retry_delay_ms;   // Delay before the pending (or last) retry
+    uint8_t last_reason;       // wifi_err_reason_t of the last disconnect
+} wifi_stats_t;
+
+/**
+ * @brief Whether the station is connected and has an IP address.
+ *
+ * Never blocks. Returns false before wifi_init_sta() has been called.
+ */
+bool wifi_is_connected(void);
+
+/**
+ * @brief Wait until the station is connected.
+ *
+ * @param timeout Maximum time to wait, in ticks.
+ *
+ * @return true if connected when the function returns.
+ */
+bool wifi_wait_connected(TickType_t timeout);
+
+/**
+ * @brief Get a snapshot of the connection counters.
+ *
+ * @param[out] stats Filled with the current values.
+ */
+void wifi_get_stats(wifi_stats_t *stats);
+
 /**
  * @brief Get the Wi-Fi event group handle.
  *
@@ -0,0 +1,604 @@
+/**
+ * @file authz.c
+ * @brief Memory-mapped allowlist with binary-search lookup and A/B delta updates.
+ *
+ * The allowlist is stored in one of two flash partitions as a small header
+ * followed by packed authz_entry_t records sorted by their fixed-width key.
+ * The active partition is mapped into the address space with
+ * esp_partition_mmap() and searched in place, so boot does not copy or
+ * parse anything.
+ *
+ * A delta is applied by merging the active table with the sorted changes
+ * and streaming the result into the inactive partition. The header is
+ * written last; only an image with a valid header is ever selected, so the
+ * switch from one partition to the other is atomic across power loss.
+ *
+ * A Bloom filter in RAM sits in front of the table. Most taps come from
+ * unknown cards, and those are rejected by a few bit tests without touching
+ * the mapped flash. Deltas only add bits; removed cards leave stale bits
+ * (extra false positives, never false negatives) until enough removals
+ * have accumulated to rebuild the filter from the new table.
+ */
+
+#include "authz.h"            // Our public header
+
+#include "esp_partition.h"    // A/B allowlist partitions
+#include "esp_rom_crc.h"      // CRC32 for image integrity
+#include "esp_log.h"          // ESP logging
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"  // Table locks
+
+#include <math.h>             // For powf()/expf() in the false-positive estimate
+#include <stdlib.h>           // For qsort()
+#include <string.h>           // For memory functions
+
+// Tag used for logging
+static const char *TAG = "authz";
+
+// Size of the sort key: uid_len followed by the zero-padded UID bytes
+#define AUTHZ_KEY_SIZE (1 + AUTHZ_UID_MAX_LEN)
+
+// Image header identification
+#define AUTHZ_IMAGE_MAGIC  0x54534C41 // "ALST"
+#define AUTHZ_IMAGE_FORMAT 1
+
+// Entries buffered in RAM while streaming a new image to flash
+#define AUTHZ_WRITE_CHUNK_ENTRIES 64
+
+// Bloom filter geometry (compile time)
+#define BLOOM_BITS   CONFIG_AUTHZ_BLOOM_BITS
+#define BLOOM_WORDS  (BLOOM_BITS / 32)
+#define BLOOM_HASHES CONFIG_AUTHZ_BLOOM_HASHES
+
+// Rebuild the filter once removals exceed 1/BLOOM_REBUILD_DIVISOR of the table
+#define BLOOM_REBUILD_DIVISOR 8
+
+_Static_assert((BLOOM_BITS & (BLOOM_BITS - 1)) == 0, "CONFIG_AUTHZ_BLOOM_BITS must be a power of two");
+
+/**
+ * @brief Header at offset 0 of an allowlist partition (32 bytes).
+ */
+typedef struct {
+    uint32_t magic;       // AUTHZ_IMAGE_MAGIC
+    uint16_t format;      // AUTHZ_IMAGE_FORMAT
+    uint16_t entry_size;  // sizeof(authz_entry_t)
+    uint32_t version;     // Allowlist version (delta sync cursor)
+    uint32_t count;       // Number of entries following the header
+    uint32_t entries_crc; // CRC32 of all entries
+    uint8_t reserved[8];  // Written as 0xFF
+    uint32_t header_crc;  // CRC32 of all preceding header bytes
+} authz_image_header_t;
+
+_Static_assert(sizeof(authz_image_header_t) == 32, "allowlist header must be 32 bytes");
+_Static_assert(sizeof(authz_entry_t) == 12, "allowlist entry must be 12 bytes");
+
+// Cards known at build time, sorted by key (used until a partition image exists).
+// Both tags were recognized before the allowlist existed, so both are granted;
+// the chip shows the granted screen now that red means denied.
+static const authz_entry_t builtin_entries[] = {
+    { .uid_len = 4, .uid = { 0x25, 0x0F, 0xC5, 0x01 }, .role = AUTHZ_ROLE_USER }, // Chip
+    { .uid_len = 4, .uid = { 0x99, 0xB6, 0xB3, 0x02 }, .role = AUTHZ_ROLE_USER }, // Card
+};
+
+#define BUILTIN_COUNT (sizeof(builtin_entries) / sizeof(builtin_entries[0]))
+
+// A/B partitions (NULL if missing) and the index of the active one (-1: built-in table)
+static const esp_partition_t *slots[2] = { NULL, NULL };
+static int active_slot = -1;
+static esp_partition_mmap_handle_t active_mmap;
+
+// Active table: either the mapped partition or builtin_entries
+static const authz_entry_t *table = builtin_entries;
+static size_t table_count = BUILTIN_COUNT;
+static uint32_t table_version = 0;
+
+// table_lock guards the table pointer during lookups and switches;
+// update_lock serializes delta updates
+static StaticSemaphore_t table_lock_struct;
+static StaticSemaphore_t update_lock_struct;
+static SemaphoreHandle_t table_lock = NULL;
+static SemaphoreHandle_t update_lock = NULL;
+
+/**
+ * @brief Streaming writer for a new image (buffered entries + running CRC).
+ */
+typedef struct {
+    const esp_partition_t *part;
+    size_t offset;
+    uint32_t crc;
+    uint32_t count;
+    size_t buffered;
+    authz_entry_t buf[AUTHZ_WRITE_CHUNK_ENTRIES];
+    esp_err_t err;
+} image_writer_t;
+
+// Only one image is written at a time (under update_lock), so the writer is static
+static image_writer_t writer;
+
+// Two filter buffers: lookups use bloom, rebuilds fill the other one and swap (under table_lock)
+static uint32_t bloom_buffers[2][BLOOM_WORDS];
+static uint32_t *bloom = bloom_buffers[0];
+static uint32_t bloom_stale = 0; // Removals since the last rebuild
+
+// Lookup counters (under table_lock)
+static uint32_t bloom_rejects = 0;
+static uint32_t bloom_false_positives = 0;
+static uint32_t table_lookups = 0;
+
+/**
+ * @brief Build the fixed-width key of a UID.
+ */
+bool authz_make_entry(const uint8_t *uid, uint8_t uid_len, uint8_t role, authz_entry_t *entry) {
+    if (uid_len == 0 || uid_len > AUTHZ_UID_MAX_LEN) {
+        return false;
+    }
+    memset(entry, 0, sizeof(*entry));
+    entry->uid_len = uid_len;
+    memcpy(entry->uid, uid, uid_len);
+    entry->role = role;
+    return true;
+}
+
+/**
+ * @brief Compare two entries by key (qsort/bsearch comparator).
+ */
+static int compare_keys(const void *a, const void *b) {
+    return memcmp(a, b, AUTHZ_KEY_SIZE);
+}
+
+/**
+ * @brief Binary search for a key in a sorted entry array.
+ *
+ * @return Pointer to the matching entry, or NULL.
+ */
+static const authz_entry_t *find(const authz_entry_t *entries, size_t count, const authz_entry_t *key) {
+    size_t lo = 0;
+    size_t hi = count;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = compare_keys(&entries[mid], key);
+        if (cmp == 0) {
+            return &entries[mid];
+        }
+        if (cmp < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Two independent 32-bit hashes of a key (FNV-1a and a murmur3 finalizer).
+ *
+ * The k filter positions are derived as h1 + i * h2 (double hashing).
+ */
+static void bloom_hash(const authz_entry_t *key, uint32_t *h1, uint32_t *h2) {
+    const uint8_t *bytes = (const uint8_t *)key;
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < AUTHZ_KEY_SIZE; i++) {
+        h = (h ^ bytes[i]) * 16777619u;
+    }
+    *h1 = h;
+
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    *h2 = h | 1; // Odd step, so the k positions differ
+}
+
+/**
+ * @brief Set the bits of one key in a filter.
+ */
+static void bloom_add(uint32_t *filter, const authz_entry_t *key) {
+    uint32_t h1, h2;
+    bloom_hash(key, &h1, &h2);
+    for (int i = 0; i < BLOOM_HASHES; i++) {
+        uint32_t bit = (h1 + (uint32_t)i * h2) & (BLOOM_BITS - 1);
+        filter[bit / 32] |= 1u << (bit % 32);
+    }
+}
+
+/**
+ * @brief Check whether a key may be in a filter.
+ *
+ * @return false if the key is certainly not in the table.
+ */
+static bool bloom_may_contain(const uint32_t *filter, const authz_entry_t *key) {
+    uint32_t h1, h2;
+    bloom_hash(key, &h1, &h2);
+    for (int i = 0; i < BLOOM_HASHES; i++) {
+        uint32_t bit = (h1 + (uint32_t)i * h2) & (BLOOM_BITS - 1);
+        if ((filter[bit / 32] & (1u << (bit % 32))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Fill factor of the active filter and the resulting false-positive rate.
+ *
+ * The rate is estimated from the actual fill, (set bits / bits)^k, so stale
+ * bits left by removals are accounted for.
+ */
+static float bloom_fpr(uint32_t *set_bits) {
+    uint32_t set = 0;
+    for (size_t i = 0; i < BLOOM_WORDS; i++) {
+        set += __builtin_popcount(bloom[i]);
+    }
+    if (set_bits != NULL) {
+        *set_bits = set;
+    }
+    return powf((float)set / BLOOM_BITS, BLOOM_HASHES);
+}
+
+/**
+ * @brief Log the filter geometry and its false-positive rate.
+ */
+static void bloom_report(const char *reason) {
+    uint32_t set;
+    float fpr = bloom_fpr(&set);
+    // Expected rate for a fresh filter with the current table size
+    float ideal = powf(1.0f - expf(-(float)BLOOM_HASHES * table_count / BLOOM_BITS), BLOOM_HASHES);
+
+    ESP_LOGI(TAG, "Bloom filter (%s): %d bits (%d bytes), k=%d, %u entries, %lu bits set, "
+             "FPR %.3f%% (ideal %.3f%%), %lu stale",
+             reason, BLOOM_BITS, BLOOM_BITS / 8, BLOOM_HASHES, (unsigned)table_count,
+             (unsigned long)set, fpr * 100.0f, ideal * 100.0f, (unsigned long)bloom_stale);
+}
+
+/**
+ * @brief Rebuild the filter from the active table and swap it in.
+ *
+ * Called with update_lock held, so the table cannot change underneath.
+ */
+static void bloom_rebuild(void) {
+    uint32_t *next = (bloom == bloom_buffers[0]) ? bloom_buffers[1] : bloom_buffers[0];
+
+    memset(next, 0, sizeof(bloom_buffers[0]));
+    for (size_t i = 0; i < table_count; i++) {
+        bloom_add(next, &table[i]);
+    }
+
+    xSemaphoreTake(table_lock, portMAX_DELAY);
+    bloom = next;
+    bloom_stale = 0;
+    xSemaphoreGive(table_lock);
+}
+
+/**
+ * @brief CRC over every header field except header_crc.
+ */
+static uint32_t header_crc(const authz_image_header_t *hdr) {
+    return esp_rom_crc32_le(0, (const uint8_t *)hdr, offsetof(authz_image_header_t, header_crc));
+}
+
+/**
+ * @brief Read and check the header of a partition.
+ *
+ * @return true if the partition holds a complete image.
+ */
+static bool read_header(const esp_partition_t *part, authz_image_header_t *hdr) {
+    if (part == NULL || esp_partition_read(part, 0, hdr, sizeof(*hdr)) != ESP_OK) {
+        return false;
+    }
+    return hdr->magic == AUTHZ_IMAGE_MAGIC &&
+           hdr->format == AUTHZ_IMAGE_FORMAT &&
+           hdr->entry_size == sizeof(authz_entry_t) &&
+           hdr->header_crc == header_crc(hdr) &&
+           sizeof(*hdr) + (size_t)hdr->count * sizeof(authz_entry_t) <= part->size;
+}
+
+/**
+ * @brief Map a partition and make it the active table.
+ *
+ * @param slot   Partition index (0 = A, 1 = B).
+ * @param hdr    Valid header of the image in that partition.
+ * @param verify Check the entries CRC before switching (done after writing
+ *               a new image; skipped at boot to keep startup free).
+ */
+static esp_err_t activate_slot(int slot, const authz_image_header_t *hdr, bool verify) {
+    const void *ptr;
+    esp_partition_mmap_handle_t handle;
+    size_t map_size = sizeof(*hdr) + (size_t)hdr->count * sizeof(authz_entry_t);
+
+    esp_err_t err = esp_partition_mmap(slots[slot], 0, map_size, ESP_PARTITION_MMAP_DATA, &ptr, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to map %s: %s", slots[slot]->label, esp_err_to_name(err));
+        return err;
+    }
+
+    if (verify) {
+        uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)ptr + sizeof(*hdr),
+                                        hdr->count * sizeof(authz_entry_t));
+        if (crc != hdr->entries_crc) {
+            ESP_LOGE(TAG, "Allowlist image in '%s' failed verification", slots[slot]->label);
+            esp_partition_munmap(handle);
+            return ESP_ERR_INVALID_CRC;
+        }
+    }
+
+    xSemaphoreTake(table_lock, portMAX_DELAY);
+    int old_slot = active_slot;
+    esp_partition_mmap_handle_t old_mmap = active_mmap;
+
+    table = (const authz_entry_t *)((const uint8_t *)ptr + sizeof(*hdr));
+    table_count = hdr->count;
+    table_version = hdr->version;
+    active_slot = slot;
+    active_mmap = handle;
+    xSemaphoreGive(table_lock);
+
+    if (old_slot >= 0) {
+        esp_partition_munmap(old_mmap);
+    }
+
+    ESP_LOGI(TAG, "Allowlist v%lu active from '%s' (%lu entries)",
+             (unsigned long)hdr->version, slots[slot]->label, (unsigned long)hdr->count);
+    return ESP_OK;
+}
+
+/**
+ * @brief Write buffered entries to flash.
+ */
+static void writer_flush(void) {
+    if (writer.buffered == 0 || writer.err != ESP_OK) {
+        return;
+    }
+
+    size_t bytes = writer.buffered * sizeof(authz_entry_t);
+    writer.err = esp_partition_write(writer.part, writer.offset, writer.buf, bytes);
+    writer.crc = esp_rom_crc32_le(writer.crc, (const uint8_t *)writer.buf, bytes);
+    writer.offset += bytes;
+    writer.buffered = 0;
+}
+
+/**
+ * @brief Append one entry to the image being written.
+ */
+static void writer_put(const authz_entry_t *entry) {
+    writer.buf[writer.buffered++] = *entry;
+    writer.count++;
+    if (writer.buffered == AUTHZ_WRITE_CHUNK_ENTRIES) {
+        writer_flush();
+    }
+}
+
+/**
+ * @brief Write base merged with ops into a partition, header last.
+ *
+ * @param part       Target partition (erased here).
+ * @param base       Sorted current entries.
+ * @param base_count Number of current entries.
+ * @param ops        Sorted, unique changes.
+ * @param op_count   Number of changes.
+ * @param version    Version stored in the header.
+ * @param[out] hdr   Header of the written image.
+ */
+static esp_err_t write_image(const esp_partition_t *part,
+                             const authz_entry_t *base, size_t base_count,
+                             const authz_entry_t *ops, size_t op_count,
+                             uint32_t version, authz_image_header_t *hdr) {
+    size_t max_bytes = sizeof(*hdr) + (base_count + op_count) * sizeof(authz_entry_t);
+    if (max_bytes > part->size) {
+        ESP_LOGE(TAG, "Allowlist does not fit in '%s'", part->label);
+        return ESP_ERR_NO_MEM;
+    }
+
+    size_t erase_bytes = (max_bytes + part->erase_size - 1) / part->erase_size * part->erase_size;
+    esp_err_t err = esp_partition_erase_range(part, 0, erase_bytes);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    memset(&writer, 0, sizeof(writer));
+    writer.part = part;
+    writer.offset = sizeof(*hdr);
+
+    // Merge two sorted sequences; an op replaces or deletes the base entry with the same key
+    size_t i = 0;
+    size_t j = 0;
+    while (i < base_count || j < op_count) {
+        int cmp = (i == base_count) ? 1 : (j == op_count) ? -1 : compare_keys(&base[i], &ops[j]);
+        if (cmp < 0) {
+            writer_put(&base[i++]);
+        } else {
+            if (ops[j].role != AUTHZ_ROLE_REMOVE) {
+                writer_put(&ops[j]);
+            }
+            if (cmp == 0) {
+                i++;
+            }
+            j++;
+        }
+    }
+    writer_flush();
+    if (writer.err != ESP_OK) {
+        return writer.err;
+    }
+
+    memset(hdr, 0xFF, sizeof(*hdr));
+    hdr->magic = AUTHZ_IMAGE_MAGIC;
+    hdr->format = AUTHZ_IMAGE_FORMAT;
+    hdr->entry_size = sizeof(authz_entry_t);
+    hdr->version = version;
+    hdr->count = writer.count;
+    hdr->entries_crc = writer.crc;
+    hdr->header_crc = header_crc(hdr);
+
+    // Commit: the image becomes valid only once the header is on flash
+    return esp_partition_write(part, 0, hdr, sizeof(*hdr));
+}
+
+/**
+ * @brief Map the newest valid allowlist partition.
+ */
+esp_err_t authz_init(void) {
+    if (table_lock != NULL) {
+        return ESP_OK;
+    }
+
+    table_lock = xSemaphoreCreateMutexStatic(&table_lock_struct);
+    update_lock = xSemaphoreCreateMutexStatic(&update_lock_struct);
+
+    slots[0] = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                        CONFIG_AUTHZ_PARTITION_A_LABEL);
+    slots[1] = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                        CONFIG_AUTHZ_PARTITION_B_LABEL);
+    if (slots[0] == NULL || slots[1] == NULL) {
+        slots[0] = slots[1] = NULL;
+        ESP_LOGW(TAG, "Allowlist partitions missing, using %u built-in cards", (unsigned)BUILTIN_COUNT);
+        bloom_rebuild();
+        bloom_report("built-in");
+        return ESP_OK;
+    }
+
+    authz_image_header_t hdr[2];
+    bool valid[2] = { read_header(slots[0], &hdr[0]), read_header(slots[1], &hdr[1]) };
+
+    int slot = -1;
+    if (valid[0] && valid[1]) {
+        slot = ((int32_t)(hdr[1].version - hdr[0].version) > 0) ? 1 : 0;
+    } else if (valid[0] || valid[1]) {
+        slot = valid[0] ? 0 : 1;
+    }
+
+    if (slot < 0) {
+        // First boot: store the built-in cards as version 0
+        slot = 0;
+        esp_err_t err = write_image(slots[0], NULL, 0, builtin_entries, BUILTIN_COUNT, 0, &hdr[0]);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to write initial allowlist: %s", esp_err_to_name(err));
+            bloom_rebuild();
+            return ESP_OK; // Keep serving the built-in table from RAM
+        }
+    }
+
+    esp_err_t err = activate_slot(slot, &hdr[slot], false);
+    bloom_rebuild(); // One pass over the table; covers the built-in table on error
+    bloom_report("boot");
+    return err;
+}
+
+/**
+ * @brief Look up a UID in the table.
+ */
+bool authz_lookup(const uint8_t *uid, uint8_t uid_len, authz_role_t *role) {
+    authz_entry_t key;
+    if (table_lock == NULL || !authz_make_entry(uid, uid_len, 0, &key)) {
+        return false;
+    }
+
+    xSemaphoreTake(table_lock, portMAX_DELAY);
+    const authz_entry_t *entry = NULL;
+    if (!bloom_may_contain(bloom, &key)) {
+        bloom_rejects++; // Unknown card: no access to the mapped table
+    } else {
+        table_lookups++;
+        entry = find(table, table_count, &key);
+        if (entry == NULL) {
+            bloom_false_positives++;
+        } else if (role != NULL) {
+            *role = (authz_role_t)entry->role;
+        }
+    }
+    xSemaphoreGive(table_lock);
+
+    return entry != NULL;
+}
+
+/**
+ * @brief Apply a set of changes and switch to the resulting table.
+ */
+esp_err_t authz_apply_delta(authz_entry_t *ops, size_t count, uint32_t version) {
+    if (table_lock == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (slots[0] == NULL) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    xSemaphoreTake(update_lock, portMAX_DELAY);
+
+    esp_err_t err;
+    if ((int32_t)(version - table_version) <= 0) {
+        err = ESP_ERR_INVALID_VERSION;
+    } else {
+        qsort(ops, count, sizeof(authz_entry_t), compare_keys);
+
+        // Added cards must pass the filter before the new table goes live;
+        // removed ones just leave stale bits
+        uint32_t removals = 0;
+        xSemaphoreTake(table_lock, portMAX_DELAY);
+        for (size_t i = 0; i < count; i++) {
+            if (ops[i].role == AUTHZ_ROLE_REMOVE) {
+                removals++;
+            } else {
+                bloom_add(bloom, &ops[i]);
+            }
+        }
+        bloom_stale += removals;
+        xSemaphoreGive(table_lock);
+
+        // The active table is only replaced below, under update_lock, so it stays valid here
+        int target = (active_slot == 0) ? 1 : 0;
+        authz_image_header_t hdr;
+        err = write_image(slots[target], table, table_count, ops, count, version, &hdr);
+        if (err == ESP_OK) {
+            err = activate_slot(target, &hdr, true);
+        } else {
+            ESP_LOGE(TAG, "Delta v%lu failed: %s", (unsigned long)version, esp_err_to_name(err));
+        }
+
+        if (err == ESP_OK) {
+            if (bloom_stale * BLOOM_REBUILD_DIVISOR > table_count) {
+                bloom_rebuild();
+                bloom_report("rebuilt");
+            } else {
+                bloom_report("updated");
+            }
+        }
+    }
+
+    xSemaphoreGive(update_lock);
+    return err;
+}
+
+/**
+ * @brief Version of the active table.
+ */
+uint32_t authz_get_version(void) {
+    return table_version;
+}
+
+/**
+ * @brief Number of entries in the active table.
+ */
+size_t authz_count(void) {
+    return table_count;
+}
+
+/**
+ * @brief Get the Bloom filter geometry and counters.
+ */
+void authz_get_filter_stats(authz_filter_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->bits = BLOOM_BITS;
+    stats->hashes = BLOOM_HASHES;
+    if (table_lock == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(table_lock, portMAX_DELAY);
+    stats->fpr_ppm = (uint32_t)(bloom_fpr(&stats->set_bits) * 1e6f);
+    stats->stale = bloom_stale;
+    stats->rejects = bloom_rejects;
+    stats->lookups = table_lookups;
+    stats->false_positives = bloom_false_positives;
+    xSemaphoreGive(table_lock);
+}
@@ -0,0 +1,266 @@
+/**
+ * @file bench.c
+ * @brief On-device load generator and self-benchmark.
+ *
+ * A periodic esp_timer injects the synthetic reads, so the load arrives at
+ * a steady rate from another task, as it does from the RC522 driver. The
+ * benchmark task only waits for the network, starts and stops the timer
+ * and prints the report from counter snapshots taken before and after.
+ */
+
+#include "bench.h"          // Our public header
+#include "rfid.h"           // Read injection, access queue counters
+#include "authz.h"          // UID length limit
+#include "firebase.h"       // Upload queue counters, draining the queue
+#include "firebase_auth.h"  // Wait for a token before the run
+#include "lcd_display.h"    // LCD counters
+#include "mem_pool.h"       // Pool peaks
+#include "settings.h"       // Dedupe window
+#include "task_layout.h"    // Benchmark task core and stack report
+#include "trace.h"          // Tap latency histograms
+#include "wifi.h"           // Wait for the connection before the run
+
+#include "esp_log.h"        // ESP logging
+#include "esp_random.h"     // Duplicate read mix
+#include "esp_system.h"     // Heap low-water mark
+#include "esp_timer.h"      // Injection timer
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"  // Benchmark task
+#include <ctype.h>          // For isxdigit()
+#include <stdlib.h>         // For strtoul()
+
+#if CONFIG_BENCH_MODE
+
+// Tag used for logging
+static const char *TAG = "bench";
+
+// How long to wait for Wi-Fi and a token before running anyway (offline path)
+#define BENCH_NET_WAIT_MS 60000
+// How long to wait for the upload queue to drain after the run
+#define BENCH_DRAIN_TIMEOUT_MS 60000
+
+// The benchmark task only sleeps and logs
+#define BENCH_TASK_STACK_SIZE 4096
+#define BENCH_TASK_PRIORITY   1
+
+/**
+ * @brief State of the load generator (esp_timer task only while running).
+ */
+typedef struct {
+    uint32_t seq;                           // Synthetic UIDs issued
+    uint8_t last_uid[4];                    // Previous synthetic UID, for duplicates
+    uint8_t last_reader;                    // Reader of the previous synthetic UID
+    uint8_t known_uid[AUTHZ_UID_MAX_LEN];   // CONFIG_BENCH_KNOWN_UID
+    uint8_t known_len;                      // 0: no known card
+    int64_t last_known_us;                  // Last injection of the known card
+    uint32_t injected;                      // Reads accepted by the access queue
+    uint32_t rejected;                      // Reads dropped because the queue was full
+    uint32_t known;                         // Known-card reads injected
+    uint32_t duplicates;                    // Repeat reads injected
+} bench_gen_t;
+
+static bench_gen_t gen;
+
+/**
+ * @brief Parse CONFIG_BENCH_KNOWN_UID ("99 B6 B3 02", "99:B6:B3:02" or "99B6B302").
+ *
+ * @return Number of UID bytes, 0 if the option is empty, or -1 if it is invalid.
+ */
+static int parse_known_uid(uint8_t *out) {
+    const char *p = CONFIG_BENCH_KNOWN_UID;
+    int len = 0;
+
+    while (*p != '\0') {
+        if (*p == ' ' || *p == ':') {
+            p++;
+            continue;
+        }
+        if (!isxdigit((unsigned char)p[0]) || !isxdigit((unsigned char)p[1]) ||
+            len == AUTHZ_UID_MAX_LEN) {
+            return -1;
+        }
+        char byte[3] = { p[0], p[1], '\0' };
+        out[len++] = (uint8_t)strtoul(byte, NULL, 16);
+        p += 2;
+    }
+    return len;
+}
+
+/**
+ * @brief Inject one read and count the outcome.
+ */
+static void inject(uint8_t reader, const uint8_t *uid, uint8_t uid_len) {
+    if (rfid_inject_read(reader, uid, uid_len) == ESP_OK) {
+        gen.injected++;
+    } else {
+        gen.rejected++;
+    }
+}
+
+/**
+ * @brief Timer callback: inject the next synthetic read.
+ *
+ * The known card (if any) is injected once the duplicate-tap window has
+ * passed since its last read, so every injection is a new access event.
+ * Otherwise a CONFIG_BENCH_DUPLICATE_PERCENT share of the reads repeats the
+ * previous UID (suppressed by the dedupe cache) and the rest are new
+ * unknown UIDs, spread over the readers.
+ */
+static void generate(void *arg) {
+    int64_t now = esp_timer_get_time();
+
+    if (gen.known_len > 0 &&
+        now - gen.last_known_us > (int64_t)(settings_get()->rfid_dedupe_window_ms + 500) * 1000) {
+        gen.last_known_us = now;
+        gen.known++;
+        inject(0, gen.known_uid, gen.known_len);
+        return;
+    }
+
+    if (gen.seq > 0 && esp_random() % 100 < CONFIG_BENCH_DUPLICATE_PERCENT) {
+        gen.duplicates++;
+        inject(gen.last_reader, gen.last_uid, sizeof(gen.last_uid));
+        return;
+    }
+
+    // 0xBE prefix and a 24-bit sequence number: distinct, and not a real card
+    gen.seq++;
+    gen.last_uid[0] = 0xBE;
+    gen.last_uid[1] = (uint8_t)(gen.seq >> 16);
+    gen.last_uid[2] = (uint8_t)(gen.seq >> 8);
+    gen.last_uid[3] = (uint8_t)gen.seq;
+    gen.last_reader = (uint8_t)(gen.seq % CONFIG_RFID_READER_COUNT);
+    inject(gen.last_reader, gen.last_uid, sizeof(gen.last_uid));
+}
+
+/**
+ * @brief Rate as "<integer>.<tenth>" from a count over a duration.
+ */
+static void rate_x10(uint32_t count, int64_t duration_us, uint32_t *whole, uint32_t *tenth) {
+    uint64_t x10 = duration_us > 0 ? (uint64_t)count * 10000000ULL / (uint64_t)duration_us : 0;
+    *whole = (uint32_t)(x10 / 10);
+    *tenth = (uint32_t)(x10 % 10);
+}
+
+/**
+ * @brief Print the results of a run from the counter snapshots.
+ */
+static void report(int64_t run_us, int64_t drain_us, esp_err_t drain_err,
+                   const rfid_stats_t *r0, const rfid_stats_t *r1,
+                   const firebase_upload_stats_t *u0, const firebase_upload_stats_t *u1,
+                   const lcd_stats_t *l0, const lcd_stats_t *l1) {
+    uint32_t events = r1->events - r0->events;
+    uint32_t uploaded = u1->uploaded - u0->uploaded;
+    uint32_t w, t;
+
+    ESP_LOGI(TAG, "--- Benchmark results (%lu ms run, %lu ms drain%s) ---",
+             (unsigned long)(run_us / 1000), (unsigned long)(drain_us / 1000),
+             drain_err == ESP_OK ? "" : ", upload queue NOT drained");
+    ESP_LOGI(TAG, "Injected: %lu reads (%lu known, %lu duplicates), %lu dropped at the access queue",
+             (unsigned long)(gen.injected + gen.rejected), (unsigned long)gen.known,
+             (unsigned long)gen.duplicates, (unsigned long)gen.rejected);
+
+    rate_x10(events, run_us, &w, &t);
+    ESP_LOGI(TAG, "Access: %lu events, %lu suppressed, %lu.%lu events/s, queue high water %lu/%d",
+             (unsigned long)events, (unsigned long)(r1->suppressed - r0->suppressed),
+             (unsigned long)w, (unsigned long)t, (unsigned long)r1->queue_high_water,
+             CONFIG_RFID_ACCESS_QUEUE_LEN);
+
+    rate_x10(uploaded, run_us + drain_us, &w, &t);
+    ESP_LOGI(TAG, "Upload: %lu queued, %lu dropped, %lu uploaded in %lu batches, %lu failed, "
+             "%lu journaled, %lu.%lu records/s, queue high water %lu",
+             (unsigned long)(u1->enqueued - u0->enqueued), (unsigned long)(u1->dropped - u0->dropped),
+             (unsigned long)uploaded, (unsigned long)(u1->batches - u0->batches),
+             (unsigned long)(u1->failed - u0->failed), (unsigned long)(u1->journaled - u0->journaled),
+             (unsigned long)w, (unsigned long)t, (unsigned long)u1->high_water);
+
+    ESP_LOGI(TAG, "LCD: %lu windows, %lu fills, %llu bytes sent, last full-screen fill %lu us",
+             (unsigned long)(l1->windows - l0->windows), (unsigned long)(l1->fills - l0->fills),
+             (unsigned long long)(l1->bytes_sent - l0->bytes_sent), (unsigned long)l1->last_fill_us);
+
+    ESP_LOGI(TAG, "Heap: %lu bytes free, low-water mark %lu bytes",
+             (unsigned long)esp_get_free_heap_size(), (unsigned long)esp_get_minimum_free_heap_size());
+
+    mem_pool_report();
+    trace_print(); // Decision, display and upload latency of this run
+}
+
+/**
+ * @brief Benchmark task: one run, then the report.
+ */
+static void bench_task(void *arg) {
+    esp_timer_handle_t timer = arg;
+
+    if (!wifi_wait_connected(pdMS_TO_TICKS(BENCH_NET_WAIT_MS)) ||
+        !firebase_auth_wait(pdMS_TO_TICKS(BENCH_NET_WAIT_MS))) {
+        ESP_LOGW(TAG, "Not online; benchmarking the offline path");
+    }
+
+    rfid_stats_t r0, r1;
+    firebase_upload_stats_t u0, u1;
+    lcd_stats_t l0, l1;
+    rfid_get_stats(&r0);
+    firebase_get_upload_stats(&u0);
+    lcd_get_stats(&l0);
+    trace_reset();
+
+    ESP_LOGI(TAG, "Injecting %d reads/s for %d s", CONFIG_BENCH_RATE_HZ, CONFIG_BENCH_DURATION_S);
+    int64_t start = esp_timer_get_time();
+    esp_timer_start_periodic(timer, 1000000 / CONFIG_BENCH_RATE_HZ);
+    vTaskDelay(pdMS_TO_TICKS(CONFIG_BENCH_DURATION_S * 1000));
+    esp_timer_stop(timer);
+    int64_t run_us = esp_timer_get_time() - start;
+
+    // Let the access task finish, then push everything still queued
+    vTaskDelay(pdMS_TO_TICKS(100));
+    start = esp_timer_get_time();
+    esp_err_t drain_err = firebase_flush_logs(pdMS_TO_TICKS(BENCH_DRAIN_TIMEOUT_MS));
+    int64_t drain_us = esp_timer_get_time() - start;
+
+    rfid_get_stats(&r1);
+    firebase_get_upload_stats(&u1);
+    lcd_get_stats(&l1);
+    report(run_us, drain_us, drain_err, &r0, &r1, &u0, &u1, &l0, &l1);
+
+    esp_timer_delete(timer);
+    task_layout_unregister(xTaskGetCurrentTaskHandle()); // Before the TCB is freed
+    vTaskDelete(NULL);
+}
+
+#endif // CONFIG_BENCH_MODE
+
+/**
+ * @brief Start the benchmark task.
+ */
+esp_err_t bench_start(void) {
+#if CONFIG_BENCH_MODE
+    int known_len = parse_known_uid(gen.known_uid);
+    if (known_len < 0) {
+        ESP_LOGE(TAG, "Invalid CONFIG_BENCH_KNOWN_UID \"%s\"", CONFIG_BENCH_KNOWN_UID);
+        return ESP_ERR_INVALID_ARG;
+    }
+    gen.known_len = (uint8_t)known_len;
+
+    esp_timer_handle_t timer;
+    const esp_timer_create_args_t timer_args = {
+        .callback = generate,
+        .name = "bench_gen",
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &timer);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    TaskHandle_t task;
+    if (xTaskCreatePinnedToCore(bench_task, "bench", BENCH_TASK_STACK_SIZE, timer,
+                                BENCH_TASK_PRIORITY, &task,
+                                TASK_LAYOUT_NET_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create benchmark task");
+        esp_timer_delete(timer);
+        return ESP_FAIL;
+    }
+    task_layout_register(task, BENCH_TASK_STACK_SIZE);
+    ESP_LOGW(TAG, "Benchmark mode: synthetic reads will be uploaded");
+#endif
+    return ESP_OK;
+}
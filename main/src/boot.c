@@ -0,0 +1,21 @@
+/**
+ * @file boot.c
+ * @brief Boot stage timing logs.
+ */
+
+#include "boot.h"          // Our public header
+
+#include "esp_log.h"       // ESP logging
+#include "esp_timer.h"     // Microsecond time since power-on
+
+// Tag used for logging
+static const char *TAG = "boot";
+
+/**
+ * @brief Log the duration of a boot stage and the time since power-on.
+ */
+void boot_log_stage(const char *stage, int64_t start_us) {
+    int64_t now = esp_timer_get_time();
+    ESP_LOGI(TAG, "%-14s %6lld ms (done at %lld ms)",
+             stage, (long long)((now - start_us) / 1000), (long long)(now / 1000));
+}
@@ -0,0 +1,110 @@
+/**
+ * @file decision.c
+ * @brief Offline-first access decisions with write-behind cloud reconciliation.
+ */
+
+#include "decision.h"      // Our public header
+#include "firebase.h"      // Queueing decisions for the uploader
+#include "timebase.h"      // Event timestamps
+
+#include "esp_log.h"       // ESP logging
+#include "esp_timer.h"     // Decision timing, uptime stamps
+#include "freertos/FreeRTOS.h"  // Stats lock
+#include <string.h>        // For strlcpy()
+
+// Tag used for logging
+static const char *TAG = "decision";
+
+static decision_stats_t stats;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Result the allowlist gives for a card right now.
+ */
+static access_result_t lookup(const uint8_t *uid, uint8_t uid_len, bool *known, authz_role_t *role) {
+    *known = authz_lookup(uid, uid_len, role);
+    return (*known && *role == AUTHZ_ROLE_USER) ? ACCESS_RESULT_GRANTED : ACCESS_RESULT_DENIED;
+}
+
+/**
+ * @brief Decide on a card from the local allowlist.
+ */
+void decision_make(const uint8_t *uid, uint8_t uid_len, decision_t *out) {
+    int64_t start = esp_timer_get_time();
+    out->result = lookup(uid, uid_len, &out->known, &out->role);
+    uint32_t elapsed_us = (uint32_t)(esp_timer_get_time() - start);
+
+    portENTER_CRITICAL(&stats_lock);
+    stats.decisions++;
+    if (out->result == ACCESS_RESULT_GRANTED) {
+        stats.granted++;
+    }
+    if (elapsed_us > stats.max_us) {
+        stats.max_us = elapsed_us;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+/**
+ * @brief Hand a decision to the uploader.
+ */
+esp_err_t decision_record(const decision_t *decision, const char *uid_str, uint8_t reader,
+                          int64_t tap_us) {
+    // 🕒 UTC time of the scan; formatting is left to the uploader
+    firebase_log_record_t record = {
+        .epoch_us = timebase_now_us(),
+        .result = decision->result,
+        .reader_id = reader,
+        .tap_us = tap_us,
+    };
+    if (!timebase_is_synced()) {
+        // No date yet: keep the uptime, the uploader dates it after the first sync
+        record.epoch_us = esp_timer_get_time();
+        record.flags = FIREBASE_LOG_FLAG_UNSYNCED;
+    }
+    strlcpy(record.uid, uid_str, sizeof(record.uid));
+
+    esp_err_t err = firebase_enqueue_rfid_log(&record);
+    if (err != ESP_OK) {
+        portENTER_CRITICAL(&stats_lock);
+        stats.queue_failures++;
+        portEXIT_CRITICAL(&stats_lock);
+    }
+    return err;
+}
+
+/**
+ * @brief Check a journaled decision against the current allowlist.
+ */
+bool decision_reconcile(const uint8_t *uid, uint8_t uid_len, uint8_t result) {
+    bool known;
+    authz_role_t role;
+    access_result_t now = lookup(uid, uid_len, &known, &role);
+    bool conflict = (now != result);
+
+    portENTER_CRITICAL(&stats_lock);
+    stats.reconciled++;
+    if (conflict && result == ACCESS_RESULT_GRANTED) {
+        stats.revoked_offline++;
+    } else if (conflict) {
+        stats.granted_later++;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+
+    if (conflict) {
+        ESP_LOGW(TAG, "Conflict: card was %s, allowlist v%lu says %s",
+                 result == ACCESS_RESULT_GRANTED ? "granted" : "denied",
+                 (unsigned long)authz_get_version(),
+                 now == ACCESS_RESULT_GRANTED ? "granted" : (known ? "blocked" : "unknown"));
+    }
+    return conflict;
+}
+
+/**
+ * @brief Get a snapshot of the counters.
+ */
+void decision_get_stats(decision_stats_t *out) {
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&stats_lock);
+}
@@ -0,0 +1,146 @@
+/**
+ * @file diag_console.c
+ * @brief Serial console with diagnostic commands.
+ *
+ * The REPL task runs on the network core at low priority, so typing on
+ * the console never delays a tap.
+ */
+
+#include "diag_console.h"   // Our public header
+#include "trace.h"          // Latency histograms
+#include "task_layout.h"    // Stack report, console core
+#include "mem_pool.h"       // Pool usage report
+#include "decision.h"       // Decision counters
+#include "time_sync.h"      // Clock sync and drift
+#include "settings.h"       // Settings in effect
+
+#include "esp_console.h"    // ESP-IDF console REPL
+#include "esp_log.h"        // ESP logging
+#include <string.h>         // For strcmp()
+
+#if CONFIG_DIAG_CONSOLE
+
+// Tag used for logging
+static const char *TAG = "console";
+
+/**
+ * @brief "latency [reset]": print (or clear) the tap latency histograms.
+ */
+static int cmd_latency(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "reset") == 0) {
+        trace_reset();
+        return 0;
+    }
+    trace_print();
+    return 0;
+}
+
+/**
+ * @brief "stacks": print the stack high-water marks.
+ */
+static int cmd_stacks(int argc, char **argv) {
+    task_layout_report_stacks();
+    return 0;
+}
+
+/**
+ * @brief "pools": print the usage and peak of every buffer pool.
+ */
+static int cmd_pools(int argc, char **argv) {
+    mem_pool_report();
+    return 0;
+}
+
+/**
+ * @brief "decisions": print the decision and reconciliation counters.
+ */
+static int cmd_decisions(int argc, char **argv) {
+    decision_stats_t s;
+    decision_get_stats(&s);
+    ESP_LOGI(TAG, "%lu decisions (%lu granted), slowest %lu us, %lu not queued",
+             (unsigned long)s.decisions, (unsigned long)s.granted, (unsigned long)s.max_us,
+             (unsigned long)s.queue_failures);
+    ESP_LOGI(TAG, "%lu reconciled: %lu revoked while offline, %lu allowed since",
+             (unsigned long)s.reconciled, (unsigned long)s.revoked_offline,
+             (unsigned long)s.granted_later);
+    return 0;
+}
+
+/**
+ * @brief "time": print the clock, the last SNTP correction and the drift.
+ */
+static int cmd_time(int argc, char **argv) {
+    time_sync_report();
+    return 0;
+}
+
+/**
+ * @brief "settings": print the settings in effect and the remote revision.
+ */
+static int cmd_settings(int argc, char **argv) {
+    settings_report();
+    return 0;
+}
+
+#endif // CONFIG_DIAG_CONSOLE
+
+/**
+ * @brief Register the commands and start the REPL task.
+ */
+esp_err_t diag_console_start(void) {
+#if CONFIG_DIAG_CONSOLE
+    esp_console_repl_t *repl = NULL;
+    esp_console_repl_config_t repl_config = ESP_CONSOLE_REPL_CONFIG_DEFAULT();
+    repl_config.prompt = "door>";
+    repl_config.task_core_id = TASK_LAYOUT_NET_CORE;
+    esp_console_dev_uart_config_t uart_config = ESP_CONSOLE_DEV_UART_CONFIG_DEFAULT();
+
+    esp_err_t err = esp_console_new_repl_uart(&uart_config, &repl_config, &repl);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create console: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    const esp_console_cmd_t commands[] = {
+        {
+            .command = "latency",
+            .help = "Tap latency histograms (decision, display, upload, cloud ack); 'reset' clears them",
+            .hint = "[reset]",
+            .func = cmd_latency,
+        },
+        {
+            .command = "stacks",
+            .help = "Stack high-water mark of every task",
+            .func = cmd_stacks,
+        },
+        {
+            .command = "pools",
+            .help = "Usage and peak of every buffer pool",
+            .func = cmd_pools,
+        },
+        {
+            .command = "decisions",
+            .help = "Access decision and offline reconciliation counters",
+            .func = cmd_decisions,
+        },
+        {
+            .command = "time",
+            .help = "Current UTC time, SNTP resyncs, last correction and clock drift",
+            .func = cmd_time,
+        },
+        {
+            .command = "settings",
+            .help = "Settings in effect, remote revision and values pending a restart",
+            .func = cmd_settings,
+        },
+    };
+    esp_console_register_help_command();
+    for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+        esp_console_cmd_register(&commands[i]);
+    }
+
+    return esp_console_start_repl(repl);
+#else
+    return ESP_OK;
+#endif
+}
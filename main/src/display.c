@@ -0,0 +1,181 @@
+/**
+ * @file display.c
+ * @brief LCD feedback state machine (display task + esp_timer revert).
+ *
+ * The task is the only user of the LCD. Each state is shown as a full-screen
+ * status image (generated at build time from main/assets/screens). The task
+ * receives show requests and revert events through one queue, applies every
+ * message that is already waiting, and only then repaints, so a burst of
+ * taps costs one repaint. Each show request sets a revert deadline; a revert event is applied
+ * only once that deadline has passed, so a timer that fired just before a
+ * newer request re-armed it cannot cut the new state short.
+ */
+
+#include "display.h"          // Our public header
+#include "status_screens.h"   // Generated status screen images
+#include "task_layout.h"      // Display task core and stack report
+#include "trace.h"            // Tap-to-screen latency
+
+#include "esp_timer.h"        // One-shot revert timer
+#include "esp_log.h"          // ESP logging
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"   // Display message queue
+#include "freertos/task.h"
+
+// Tag used for logging
+static const char *TAG = "display";
+
+/**
+ * @brief Message handled by the display task.
+ */
+typedef struct {
+    enum {
+        DISPLAY_MSG_SHOW,   // Show state for hold_ms
+        DISPLAY_MSG_REVERT, // Revert timer expired
+    } type;
+    CardColor state;
+    uint32_t hold_ms;
+    int64_t tap_us;   // Tap that caused a show request (0: not traced)
+} display_msg_t;
+
+// Status screen for each state
+static const lcd_image_t *const screens[] = {
+    [COLOR_WAITING] = &screen_waiting,
+    [COLOR_CARD]    = &screen_granted,
+    [COLOR_CHIP]    = &screen_denied,
+};
+
+/**
+ * @brief Draw the screen for a state (solid color if the image cannot be drawn).
+ */
+static void draw_state(CardColor state) {
+    if (lcd_draw_image(0, 0, screens[state]) != ESP_OK) {
+        fill_screen(get_color_for_card(state));
+    }
+}
+
+// Message queue (static storage)
+static StaticQueue_t queue_struct;
+static uint8_t queue_storage[CONFIG_DISPLAY_QUEUE_LEN * sizeof(display_msg_t)];
+static QueueHandle_t display_queue = NULL;
+
+static esp_timer_handle_t revert_timer = NULL;
+
+// When the current state expires (esp_timer time, 0: never); display task only
+static int64_t revert_deadline_us = 0;
+
+/**
+ * @brief Revert timer callback (esp_timer task): ask the display task to revert.
+ */
+static void revert_timer_cb(void *arg) {
+    display_msg_t msg = {
+        .type = DISPLAY_MSG_REVERT,
+        .state = COLOR_WAITING,
+    };
+    if (xQueueSend(display_queue, &msg, 0) != pdTRUE) {
+        // Queue full of newer requests: those will re-arm the timer anyway
+        ESP_LOGD(TAG, "Revert dropped, queue full");
+    }
+}
+
+/**
+ * @brief Update the target state (and the tap it answers) from one message.
+ */
+static void apply_msg(const display_msg_t *msg, CardColor *target, int64_t *tap_us) {
+    if (msg->type == DISPLAY_MSG_SHOW) {
+        *target = msg->state;
+        *tap_us = msg->tap_us;
+
+        // Pre-empt or extend: the hold time always restarts from the latest tap
+        esp_timer_stop(revert_timer);
+        revert_deadline_us = 0;
+        if (msg->hold_ms > 0 && msg->state != COLOR_WAITING) {
+            revert_deadline_us = esp_timer_get_time() + (int64_t)msg->hold_ms * 1000;
+            esp_timer_start_once(revert_timer, (uint64_t)msg->hold_ms * 1000);
+        }
+    } else if (revert_deadline_us != 0 && esp_timer_get_time() >= revert_deadline_us) {
+        *target = COLOR_WAITING;
+        *tap_us = 0;
+        revert_deadline_us = 0;
+    }
+}
+
+/**
+ * @brief Display task: coalesce pending messages, then repaint if needed.
+ */
+static void display_task(void *arg) {
+    CardColor shown = COLOR_WAITING;
+    CardColor target = COLOR_WAITING;
+    display_msg_t msg;
+
+    draw_state(shown);
+
+    while (true) {
+        int64_t tap_us = 0;
+        xQueueReceive(display_queue, &msg, portMAX_DELAY);
+        apply_msg(&msg, &target, &tap_us);
+        while (xQueueReceive(display_queue, &msg, 0) == pdTRUE) {
+            apply_msg(&msg, &target, &tap_us);
+        }
+
+        if (target != shown) {
+            draw_state(target); // Returns once the last SPI transaction is done
+            shown = target;
+        }
+        trace_record(TRACE_SPAN_DISPLAY_DONE, tap_us); // Also when the screen already showed it
+    }
+}
+
+/**
+ * @brief Start the display task and show the "waiting" screen.
+ */
+esp_err_t display_start(void) {
+    if (display_queue != NULL) {
+        return ESP_OK;
+    }
+
+    display_queue = xQueueCreateStatic(CONFIG_DISPLAY_QUEUE_LEN, sizeof(display_msg_t),
+                                       queue_storage, &queue_struct);
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = revert_timer_cb,
+        .name = "display_revert",
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &revert_timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create revert timer: %s", esp_err_to_name(err));
+        vQueueDelete(display_queue);
+        display_queue = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    TaskHandle_t task;
+    if (xTaskCreatePinnedToCore(display_task, "display", CONFIG_DISPLAY_TASK_STACK_SIZE, NULL,
+                                CONFIG_DISPLAY_TASK_PRIORITY, &task, TASK_LAYOUT_ACCESS_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create display task");
+        esp_timer_delete(revert_timer);
+        vQueueDelete(display_queue);
+        display_queue = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    task_layout_register(task, CONFIG_DISPLAY_TASK_STACK_SIZE);
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Show a state for hold_ms, then return to COLOR_WAITING.
+ */
+esp_err_t display_show(CardColor state, uint32_t hold_ms, int64_t tap_us) {
+    if (display_queue == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    display_msg_t msg = {
+        .type = DISPLAY_MSG_SHOW,
+        .state = state,
+        .hold_ms = hold_ms,
+        .tap_us = tap_us,
+    };
+    return xQueueSend(display_queue, &msg, 0) == pdTRUE ? ESP_OK : ESP_ERR_TIMEOUT;
+}
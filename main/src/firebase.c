@@ -1,76 +1,140 @@
 #include "firebase.h"              // Include our own header first
 #include "firebase_credentials.h"
+#include "journal.h"                // Offline store-and-forward of failed uploads
+#include "authz.h"                  // Allowlist delta sync
+#include "firebase_auth.h"          // ID token for RTDB requests
+#include "log_serializer.h"         // Request bodies without heap allocation
+#include "timebase.h"               // Push key timestamps
+#include "wifi.h"                   // Pause uploads while Wi-Fi is down
+#include "firebase_stream.h"        // Skip polling while allowlist changes are pushed
+#include "trace.h"                  // Cloud-ack latency, device_metrics push
+#include "esp_mac.h"                // Device ID for log shards and device_metrics
+#include "task_layout.h"            // Uploader core and stack report
+#include "mem_pool.h"               // Sync buffers
+#include "decision.h"               // Reconciling journaled decisions
+#include "settings.h"               // Batch size, poll intervals, remote settings
+#include "rfid_scan.h"              // Scan policy from remote settings
 #include "esp_http_client.h"        // ESP-IDF HTTP client
 #include "esp_log.h"                // ESP-IDF Logging
+#include "esp_timer.h"              // Request latency measurement, time sync hold
+#include "esp_system.h"             // Flush on restart
 #include <string.h>                 // C Standard library for string handling
-#include "cJSON.h"                  // Third-party library for JSON parsing and generation
+#include <inttypes.h>               // PRIu32 for latency logging
+#include "cJSON.h"                  // JSON parsing of allowlist deltas
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"         // Log upload queue
+#include "freertos/task.h"          // Uploader task
+#include "freertos/semphr.h"        // Flush synchronisation
+#include "esp_random.h"             // Random part of push keys
+#include <ctype.h>                  // isxdigit() for UID parsing
+#include <time.h>                   // gmtime_r() for per-day log shards
 
 // Tag used for ESP_LOG messages
 static const char *TAG = "firebase";
 
 
 
-// Size of the buffer used to store HTTP responses
-#define RESPONSE_BUFFER_SIZE 4096
-
-// DigiCert Global Root CA certificate (for HTTPS communication)
-static const char *firebase_root_cert = \
-"-----BEGIN CERTIFICATE-----\n"\
-"MIIFYjCCBEqgAwIBAgIQd70NbNs2+RrqIQ/E8FjTDTANBgkqhkiG9w0BAQsFADBX\n"\
-"MQswCQYDVQQGEwJCRTEZMBcGA1UEChMQR2xvYmFsU2lnbiBudi1zYTEQMA4GA1UE\n"\
-"CxMHUm9vdCBDQTEbMBkGA1UEAxMSR2xvYmFsU2lnbiBSb290IENBMB4XDTIwMDYx\n"\
-"OTAwMDA0MloXDTI4MDEyODAwMDA0MlowRzELMAkGA1UEBhMCVVMxIjAgBgNVBAoT\n"\
-"GUdvb2dsZSBUcnVzdCBTZXJ2aWNlcyBMTEMxFDASBgNVBAMTC0dUUyBSb290IFIx\n"\
-"MIICIjANBgkqhkiG9w0BAQEFAAOCAg8AMIICCgKCAgEAthECix7joXebO9y/lD63\n"\
-"ladAPKH9gvl9MgaCcfb2jH/76Nu8ai6Xl6OMS/kr9rH5zoQdsfnFl97vufKj6bwS\n"\
-"iV6nqlKr+CMny6SxnGPb15l+8Ape62im9MZaRw1NEDPjTrETo8gYbEvs/AmQ351k\n"\
-"KSUjB6G00j0uYODP0gmHu81I8E3CwnqIiru6z1kZ1q+PsAewnjHxgsHA3y6mbWwZ\n"\
-"DrXYfiYaRQM9sHmklCitD38m5agI/pboPGiUU+6DOogrFZYJsuB6jC511pzrp1Zk\n"\
-"j5ZPaK49l8KEj8C8QMALXL32h7M1bKwYUH+E4EzNktMg6TO8UpmvMrUpsyUqtEj5\n"\
-"cuHKZPfmghCN6J3Cioj6OGaK/GP5Afl4/Xtcd/p2h/rs37EOeZVXtL0m79YB0esW\n"\
-"CruOC7XFxYpVq9Os6pFLKcwZpDIlTirxZUTQAs6qzkm06p98g7BAe+dDq6dso499\n"\
-"iYH6TKX/1Y7DzkvgtdizjkXPdsDtQCv9Uw+wp9U7DbGKogPeMa3Md+pvez7W35Ei\n"\
-"Eua++tgy/BBjFFFy3l3WFpO9KWgz7zpm7AeKJt8T11dleCfeXkkUAKIAf5qoIbap\n"\
-"sZWwpbkNFhHax2xIPEDgfg1azVY80ZcFuctL7TlLnMQ/0lUTbiSw1nH69MG6zO0b\n"\
-"9f6BQdgAmD06yK56mDcYBZUCAwEAAaOCATgwggE0MA4GA1UdDwEB/wQEAwIBhjAP\n"\
-"BgNVHRMBAf8EBTADAQH/MB0GA1UdDgQWBBTkrysmcRorSCeFL1JmLO/wiRNxPjAf\n"\
-"BgNVHSMEGDAWgBRge2YaRQ2XyolQL30EzTSo//z9SzBgBggrBgEFBQcBAQRUMFIw\n"\
-"JQYIKwYBBQUHMAGGGWh0dHA6Ly9vY3NwLnBraS5nb29nL2dzcjEwKQYIKwYBBQUH\n"\
-"MAKGHWh0dHA6Ly9wa2kuZ29vZy9nc3IxL2dzcjEuY3J0MDIGA1UdHwQrMCkwJ6Al\n"\
-"oCOGIWh0dHA6Ly9jcmwucGtpLmdvb2cvZ3NyMS9nc3IxLmNybDA7BgNVHSAENDAy\n"\
-"MAgGBmeBDAECATAIBgZngQwBAgIwDQYLKwYBBAHWeQIFAwIwDQYLKwYBBAHWeQIF\n"\
-"AwMwDQYJKoZIhvcNAQELBQADggEBADSkHrEoo9C0dhemMXoh6dFSPsjbdBZBiLg9\n"\
-"NR3t5P+T4Vxfq7vqfM/b5A3Ri1fyJm9bvhdGaJQ3b2t6yMAYN/olUazsaL+yyEn9\n"\
-"WprKASOshIArAoyZl+tJaox118fessmXn1hIVw41oeQa1v1vg4Fv74zPl6/AhSrw\n"\
-"9U5pCZEt4Wi4wStz6dTZ/CLANx8LZh1J7QJVj2fhMtfTJr9w4z30Z209fOU0iOMy\n"\
-"+qduBmpvvYuR7hZL6Dupszfnw0Skfths18dG9ZKb59UhvmaSGZRVbNQpsg3BZlvi\n"\
-"d0lIKO2d1xozclOzgjXPYovJJIultzkMu34qQb9Sz/yilrbCgj8=\n"\
-"-----END CERTIFICATE-----\n";
-
-// Global buffers for HTTP response handling
-static char *response_buffer = NULL;
-static int response_len = 0;
-
-// Global buffer to store Firebase ID Token (JWT)
-static char id_token[2048]; 
-
-/**
- * @brief HTTP event handler for collecting response data.
- *
- * This handler is called automatically by the HTTP client during the request.
- * It accumulates chunks of data into the response buffer.
- */
-static esp_err_t _http_event_handler(esp_http_client_event_t *evt) {
+// Room for one batch (a batch of one entry is a plain POST); the size in use is upload_batch_max
+#if CONFIG_FIREBASE_BATCH_UPLOAD
+#define FIREBASE_BATCH_MAX_ENTRIES CONFIG_FIREBASE_BATCH_MAX_ENTRIES
+#else
+#define FIREBASE_BATCH_MAX_ENTRIES 1
+#endif
+
+// Length of a Firebase push key (8 timestamp characters + 12 random characters)
+#define FIREBASE_PUSH_KEY_LEN 20
+
+// Longest shard path below rfid_logs: "<device>/<yyyymmdd>" or "<device>/unsynced"
+#define FIREBASE_LOG_SHARD_DAY_LEN 8
+#define FIREBASE_LOG_SHARD_MAX_LEN (FIREBASE_DEVICE_ID_LEN + 1 + FIREBASE_LOG_SHARD_DAY_LEN)
+_Static_assert(sizeof("unsynced") - 1 <= FIREBASE_LOG_SHARD_DAY_LEN, "shard buffer too small");
+
+// Longest batch key below rfid_logs: "<shard>/<push key>"
+#define FIREBASE_LOG_KEY_MAX_LEN (FIREBASE_LOG_SHARD_MAX_LEN + 1 + FIREBASE_PUSH_KEY_LEN)
+
+// How often connectivity is checked while offline
+#define FIREBASE_OFFLINE_POLL_MS 1000
+
+// Base URL of the Realtime Database; all RTDB requests share one connection to this host
+#define FIREBASE_RTDB_BASE_URL "https://" FIREBASE_PROJECT_ID "-default-rtdb.firebaseio.com"
+
+// Longest request URL: base, path, ".json?auth=", ID token and query parameters
+#define FIREBASE_RTDB_URL_MAX_LEN (sizeof(FIREBASE_RTDB_BASE_URL) + FIREBASE_ID_TOKEN_MAX_LEN + 256)
+
+// Longest log upload body (a full batch of push-key entries)
+#define FIREBASE_LOG_BODY_MAX_LEN \
+    (2 + FIREBASE_BATCH_MAX_ENTRIES * LOG_SERIALIZER_ENTRY_MAX_LEN(FIREBASE_LOG_KEY_MAX_LEN))
+
+// Request URL and log upload body, reused by every request (uploader task only)
+static char rtdb_url[FIREBASE_RTDB_URL_MAX_LEN];
+static char log_body[FIREBASE_LOG_BODY_MAX_LEN];
+
+// Preallocated storage for the log upload queue (no heap use per record)
+static StaticQueue_t log_queue_struct;
+static uint8_t log_queue_storage[CONFIG_FIREBASE_LOG_QUEUE_LEN * sizeof(firebase_log_record_t)];
+static QueueHandle_t log_queue = NULL;
+
+// Flush requests: one at a time (flush_lock), completion signalled by the uploader (flush_done)
+static StaticSemaphore_t flush_lock_struct;
+static StaticSemaphore_t flush_done_struct;
+static SemaphoreHandle_t flush_lock = NULL;
+static SemaphoreHandle_t flush_done = NULL;
+
+// Serializes allowlist updates from the uploader (pull) and the stream task (push)
+static StaticSemaphore_t allowlist_lock_struct;
+static SemaphoreHandle_t allowlist_lock = NULL;
+
+// Allowlist sync buffers: one response (uploader), change lists for the uploader and the stream
+static mem_pool_t sync_resp_pool = MEM_POOL_INIT("fb_sync_resp", CONFIG_AUTHZ_SYNC_RESPONSE_MAX, 1);
+static mem_pool_t sync_ops_pool = MEM_POOL_INIT("fb_sync_ops",
+                                                CONFIG_AUTHZ_SYNC_MAX_OPS * sizeof(authz_entry_t), 2);
+
+// Control records share the log queue (empty UID); the result field tells them apart
+#define FIREBASE_MARKER_FLUSH    0 // firebase_flush_logs()
+#define FIREBASE_MARKER_SYNC     1 // firebase_request_allowlist_sync()
+#define FIREBASE_MARKER_SETTINGS 2 // firebase_request_settings_sync()
+
+// Long-lived RTDB client, owned by the uploader task (keeps the TLS connection open)
+static esp_http_client_handle_t rtdb_client = NULL;
+// Set by the RTDB event handler when a request had to open a new connection
+static bool rtdb_connected_during_request = false;
+
+// Response body capture for RTDB reads (buf == NULL: discard the body)
+static struct {
+    char *buf;
+    size_t cap;
+    size_t len;
+    bool overflow;
+} rtdb_response;
+
+// Per-request latency statistics for RTDB writes
+static firebase_latency_stats_t latency_stats;
+
+// Upload counters, shared between producers (tasks/ISRs) and the uploader task
+static firebase_upload_stats_t upload_stats;
+static portMUX_TYPE upload_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief HTTP event handler for the long-lived RTDB client.
+ *
+ * Notes when a request had to (re)connect so latency can be split into
+ * requests that reused the connection and requests that paid for a handshake,
+ * and collects the response body for reads.
+ */
+static esp_err_t _rtdb_event_handler(esp_http_client_event_t *evt) {
     switch (evt->event_id) {
+        case HTTP_EVENT_ON_CONNECTED:
+            rtdb_connected_during_request = true;
+            break;
         case HTTP_EVENT_ON_DATA:
-            if (evt->data && evt->data_len > 0) {
-                if (response_len + evt->data_len < RESPONSE_BUFFER_SIZE) {
-                    // Copy received data into the response buffer
-                    memcpy(response_buffer + response_len, evt->data, evt->data_len);
-                    response_len += evt->data_len;
+            // Collect the body only when the caller asked for it (reads)
+            if (rtdb_response.buf != NULL && evt->data_len > 0) {
+                if (rtdb_response.len + evt->data_len < rtdb_response.cap) {
+                    memcpy(rtdb_response.buf + rtdb_response.len, evt->data, evt->data_len);
+                    rtdb_response.len += evt->data_len;
+                    rtdb_response.buf[rtdb_response.len] = '\0';
                 } else {
-                    // Prevent buffer overflow
-                    ESP_LOGE(TAG, "Response buffer overflow");
+                    rtdb_response.overflow = true;
                 }
             }
             break;
@@ -81,149 +145,1369 @@ static esp_err_t _http_event_handler(esp_http_client_event_t *evt) {
 }
 
 /**
- * @brief Sign in to Firebase Authentication using email and password.
+ * @brief Create the long-lived RTDB client on first use.
  *
- * Sends a POST request to Firebase Authentication REST API to obtain
- * a JWT idToken, which is used for authenticating further requests.
+ * The client is never cleaned up between requests. esp_http_client keeps the
+ * socket open as long as the server allows (HTTP keep-alive) and reconnects
+ * transparently on the next perform after the server closes it. When TLS
+ * session tickets are enabled in menuconfig, those reconnects resume the
+ * previous TLS session instead of doing a full handshake.
  *
  * @return
- *     - ESP_OK if sign-in was successful and idToken is obtained.
- *     - ESP_ERR_NO_MEM if memory allocation fails.
- *     - ESP_FAIL for HTTP or JSON parsing errors.
- */
-esp_err_t firebase_sign_in(void) {
-    response_buffer = calloc(1, RESPONSE_BUFFER_SIZE);
-    response_len = 0;
-    if (response_buffer == NULL) {
-        ESP_LOGE(TAG, "Failed to allocate memory for response buffer");
-        return ESP_ERR_NO_MEM;
+ *     - ESP_OK if the client is ready.
+ *     - ESP_ERR_NO_MEM if the client could not be created.
+ */
+static esp_err_t rtdb_client_ensure(void) {
+    if (rtdb_client != NULL) {
+        return ESP_OK;
     }
 
-    // Configure the HTTP client
     esp_http_client_config_t config = {
-        .url = "https://identitytoolkit.googleapis.com/v1/accounts:signInWithPassword?key=" FIREBASE_API_KEY,
+        .url = FIREBASE_RTDB_BASE_URL "/.json",
         .method = HTTP_METHOD_POST,
         .cert_pem = firebase_root_cert,
-        .event_handler = _http_event_handler,
+        .event_handler = _rtdb_event_handler,
+        .buffer_size = 4096,     // Increase buffer size for larger payloads
+        .buffer_size_tx = 4096,
+        .keep_alive_enable = true, // TCP keep-alive so dead connections are detected
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        .save_client_session = true, // Resume the TLS session on reconnect
+#endif
     };
 
-    esp_http_client_handle_t client = esp_http_client_init(&config);
+    rtdb_client = esp_http_client_init(&config);
+    if (rtdb_client == NULL) {
+        ESP_LOGE(TAG, "Failed to create RTDB client");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
 
-    // Create JSON payload for the sign-in request
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "email", FIREBASE_EMAIL);
-    cJSON_AddStringToObject(root, "password", FIREBASE_PASSWORD);
-    cJSON_AddBoolToObject(root, "returnSecureToken", true);
+/**
+ * @brief Add one request's duration to the latency statistics.
+ *
+ * @param elapsed_us Duration of the request in microseconds.
+ * @param connected  true if the request had to open a new connection.
+ */
+static void record_latency(uint32_t elapsed_us, bool connected) {
+    portENTER_CRITICAL(&upload_stats_lock);
+    latency_stats.requests++;
+    latency_stats.last_us = elapsed_us;
+    if (latency_stats.min_us == 0 || elapsed_us < latency_stats.min_us) {
+        latency_stats.min_us = elapsed_us;
+    }
+    if (elapsed_us > latency_stats.max_us) {
+        latency_stats.max_us = elapsed_us;
+    }
+    if (connected) {
+        latency_stats.connects++;
+        latency_stats.connect_total_us += elapsed_us;
+    } else {
+        latency_stats.reused_total_us += elapsed_us;
+    }
+    portEXIT_CRITICAL(&upload_stats_lock);
+}
+
+/**
+ * @brief Perform one request on the RTDB client and record its latency.
+ *
+ * If the request fails on a connection the server has already closed, the
+ * connection is dropped and the request is retried once on a fresh one.
+ *
+ * @return Result of esp_http_client_perform().
+ */
+static esp_err_t rtdb_perform(void) {
+    esp_err_t err = ESP_FAIL;
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        rtdb_connected_during_request = false;
+        int64_t start = esp_timer_get_time();
 
-    char *json_str = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root); // Free the cJSON object
+        err = esp_http_client_perform(rtdb_client);
 
-    // Set HTTP headers and request body
-    esp_http_client_set_header(client, "Content-Type", "application/json");
-    esp_http_client_set_post_field(client, json_str, strlen(json_str));
+        record_latency((uint32_t)(esp_timer_get_time() - start), rtdb_connected_during_request);
+
+        if (err == ESP_OK || rtdb_connected_during_request) {
+            break; // Success, or a fresh connection failed too: do not retry
+        }
+
+        // Stale keep-alive connection: close it so the retry reconnects
+        ESP_LOGW(TAG, "RTDB connection lost (%s), reconnecting", esp_err_to_name(err));
+        esp_http_client_close(rtdb_client);
+    }
+
+    return err;
+}
+
+/**
+ * @brief Perform one request against a Realtime Database path.
+ *
+ * Builds the authenticated URL, sends the request on the shared keep-alive
+ * client and logs the result. Call only from the uploader task.
+ *
+ * @param method HTTP method (GET, POST to push a child, PATCH for multi-path updates).
+ * @param path   Database path without leading slash or ".json" (e.g. "rfid_logs").
+ * @param query  Extra URL-encoded query parameters ("a=b&c=d"), or NULL.
+ * @param body   JSON request body, or NULL.
+ * @param resp   Buffer for the response body (NUL-terminated), or NULL to discard it.
+ * @param resp_cap Size of resp.
+ *
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_FAIL if no valid idToken is available or the server rejected the request.
+ *     - ESP_ERR_INVALID_SIZE if the URL is too long or the response did not fit in resp.
+ */
+static esp_err_t rtdb_request(esp_http_client_method_t method, const char *path, const char *query,
+                              const char *body, char *resp, size_t resp_cap) {
+    // Non-blocking: the auth task keeps the token fresh
+    const char *id_token = firebase_auth_get_token();
+    if (id_token == NULL) {
+        ESP_LOGE(TAG, "No valid ID token, not signed in");
+        return ESP_FAIL;
+    }
+
+    esp_err_t err = rtdb_client_ensure();
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // Format the Firebase Realtime Database URL into the static buffer
+    int url_len = snprintf(rtdb_url, sizeof(rtdb_url), FIREBASE_RTDB_BASE_URL "/%s.json?auth=%s%s%s",
+                           path, id_token, query ? "&" : "", query ? query : "");
+    if (url_len < 0 || (size_t)url_len >= sizeof(rtdb_url)) {
+        ESP_LOGE(TAG, "URL for %s too long", path);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    // Same host on every request, so the open connection is kept
+    esp_http_client_set_url(rtdb_client, rtdb_url);
+    esp_http_client_set_method(rtdb_client, method);
+    if (body != NULL) {
+        esp_http_client_set_header(rtdb_client, "Content-Type", "application/json");
+        esp_http_client_set_post_field(rtdb_client, body, strlen(body));
+    } else {
+        esp_http_client_set_post_field(rtdb_client, NULL, 0);
+    }
+
+    rtdb_response.buf = resp;
+    rtdb_response.cap = resp_cap;
+    rtdb_response.len = 0;
+    rtdb_response.overflow = false;
+    if (resp != NULL && resp_cap > 0) {
+        resp[0] = '\0';
+    }
+
+    const char *method_name = (method == HTTP_METHOD_PATCH) ? "PATCH"
+                            : (method == HTTP_METHOD_GET)   ? "GET"
+                            : (method == HTTP_METHOD_PUT)   ? "PUT"
+                                                            : "POST";
 
     // Perform the HTTP request
-    esp_err_t err = esp_http_client_perform(client);
+    err = rtdb_perform();
     if (err == ESP_OK) {
-        int status_code = esp_http_client_get_status_code(client);
-        ESP_LOGI(TAG, "HTTP Status = %d", status_code);
-
-        // Parse JSON response to extract idToken
-        cJSON *response = cJSON_Parse(response_buffer);
-        if (response) {
-            cJSON *id_token_item = cJSON_GetObjectItem(response, "idToken");
-            if (id_token_item && cJSON_IsString(id_token_item)) {
-                strncpy(id_token, id_token_item->valuestring, sizeof(id_token) - 1);
-                id_token[sizeof(id_token) - 1] = '\0'; // Ensure null-termination
-                // ESP_LOGI(TAG, "ID Token: %s", id_token); // Debug: Commented out for security
-            } else {
-                ESP_LOGE(TAG, "No idToken in response");
-            }
-            cJSON_Delete(response); // Free the cJSON object
-        } else {
-            ESP_LOGE(TAG, "Failed to parse JSON");
+        int status_code = esp_http_client_get_status_code(rtdb_client);
+        ESP_LOGI(TAG, "%s Status = %d (%" PRIu32 " us)", method_name, status_code, latency_stats.last_us);
+        if (status_code == 401) {
+            firebase_auth_invalidate(id_token); // Rejected token: refresh now
+            err = ESP_FAIL;
+        } else if (status_code < 200 || status_code >= 300) {
+            err = ESP_FAIL;
+        } else if (rtdb_response.overflow) {
+            ESP_LOGE(TAG, "Response to %s larger than %u bytes", path, (unsigned)resp_cap);
+            err = ESP_ERR_INVALID_SIZE;
         }
     } else {
-        ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(err));
+        ESP_LOGE(TAG, "%s request failed: %s", method_name, esp_err_to_name(err));
     }
 
-    // Clean up resources
-    esp_http_client_cleanup(client);
-    free(json_str);
-    free(response_buffer);
-    response_buffer = NULL;
-    response_len = 0;
+    // The post field points at the caller's body; detach it before returning
+    esp_http_client_set_post_field(rtdb_client, NULL, 0);
+    rtdb_response.buf = NULL;
 
     return err;
 }
 
+/**
+ * @brief ID of this device: the Wi-Fi station MAC in hex ("24A160C0FFEE").
+ */
+const char *firebase_device_id(void) {
+    static char id[FIREBASE_DEVICE_ID_LEN + 1];
+    if (id[0] == '\0') {
+        uint8_t mac[6];
+        esp_read_mac(mac, ESP_MAC_WIFI_STA);
+        snprintf(id, sizeof(id), "%02X%02X%02X%02X%02X%02X",
+                 mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    }
+    return id;
+}
+
+/**
+ * @brief Shard of rfid_logs a record belongs to ("" without sharding).
+ *
+ * "<device>" with CONFIG_FIREBASE_LOG_SHARD_DEVICE, "<device>/<yyyymmdd>"
+ * (UTC date of the scan) with CONFIG_FIREBASE_LOG_SHARD_DAY as well, or
+ * "<device>/unsynced" for a scan that could not be dated.
+ *
+ * @param[out] shard Buffer of at least FIREBASE_LOG_SHARD_MAX_LEN + 1 bytes.
+ *
+ * @return Length of the shard.
+ */
+static size_t log_shard(const firebase_log_record_t *record, char *shard) {
+#if CONFIG_FIREBASE_LOG_SHARD_DAY
+    int len;
+    if (record->flags & FIREBASE_LOG_FLAG_UNSYNCED) {
+        len = snprintf(shard, FIREBASE_LOG_SHARD_MAX_LEN + 1, "%s/unsynced", firebase_device_id());
+    } else {
+        time_t secs = (time_t)(record->epoch_us / 1000000);
+        struct tm tm;
+        gmtime_r(&secs, &tm);
+        len = snprintf(shard, FIREBASE_LOG_SHARD_MAX_LEN + 1, "%s/%04d%02d%02d", firebase_device_id(),
+                       (tm.tm_year + 1900) % 10000, tm.tm_mon + 1, tm.tm_mday);
+    }
+    if (len > 0 && len <= FIREBASE_LOG_SHARD_MAX_LEN) {
+        return (size_t)len;
+    }
+    // gmtime_r() keeps the date fields in range, so this is not expected; keep the device shard
+    ESP_LOGE(TAG, "Log shard does not fit, using the device shard");
+    strcpy(shard, firebase_device_id());
+    return FIREBASE_DEVICE_ID_LEN;
+#elif CONFIG_FIREBASE_LOG_SHARD_DEVICE
+    strcpy(shard, firebase_device_id());
+    return FIREBASE_DEVICE_ID_LEN;
+#else
+    shard[0] = '\0';
+    return 0;
+#endif
+}
+
+/**
+ * @brief POST one log record to "rfid_logs" (or its shard).
+ *
+ * The body is written into the static log_body buffer, so nothing is
+ * allocated per record.
+ */
+static esp_err_t post_log_record(const firebase_log_record_t *record) {
+    log_writer_t w;
+    log_writer_init(&w, log_body, sizeof(log_body));
+    log_write_record(&w, record);
+    if (log_writer_finish(&w) == 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    char shard[FIREBASE_LOG_SHARD_MAX_LEN + 1];
+    char path[sizeof("rfid_logs/") + FIREBASE_LOG_SHARD_MAX_LEN];
+    size_t shard_len = log_shard(record, shard);
+    int path_len = snprintf(path, sizeof(path), "rfid_logs%s%s", shard_len ? "/" : "", shard);
+    if (path_len < 0 || (size_t)path_len >= sizeof(path)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return rtdb_request(HTTP_METHOD_POST, path, NULL, log_body, NULL, 0);
+}
+
 /**
  * @brief Send RFID log data to Firebase Realtime Database.
  *
  * Uploads a UID and timestamp to the Firebase Realtime Database
  * under the "rfid_logs" node. Requires a valid idToken for authentication.
+ * Requests reuse a single keep-alive connection; call only from one task
+ * (the uploader).
  *
  * @param uid       The UID of the RFID tag as a string.
- * @param timestamp Timestamp string for the log entry.
+ * @param epoch_us  Time of the scan (microseconds since 1970-01-01 UTC).
  *
  * @return
  *     - ESP_OK on success.
  *     - ESP_FAIL if no valid idToken is available.
- *     - ESP_ERR_NO_MEM if memory allocation fails.
+ *     - ESP_ERR_INVALID_SIZE if uid is too long.
  */
-esp_err_t send_rfid_log_to_firebase(const char *uid, const char *timestamp) {
-    if (strlen(id_token) == 0) {
-        ESP_LOGE(TAG, "No ID Token available, sign-in first.");
-        return ESP_FAIL;
+esp_err_t send_rfid_log_to_firebase(const char *uid, int64_t epoch_us) {
+    firebase_log_record_t record = { .epoch_us = epoch_us };
+    if (strlen(uid) >= sizeof(record.uid)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    strcpy(record.uid, uid);
+
+    return post_log_record(&record);
+}
+
+/**
+ * @brief Generate a Firebase-style push key.
+ *
+ * Same scheme as the Firebase SDKs: 8 characters of millisecond timestamp
+ * followed by 12 random characters, all from an alphabet that sorts in
+ * ASCII order. Keys generated within the same millisecond reuse the random
+ * part incremented by one, so keys always sort in creation order.
+ *
+ * @param[out] key Buffer of at least FIREBASE_PUSH_KEY_LEN + 1 bytes.
+ */
+static void generate_push_key(char *key) {
+    static const char alphabet[] =
+        "-0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ_abcdefghijklmnopqrstuvwxyz";
+    static int64_t last_ms = -1;
+    static uint8_t last_rand[12];
+
+    int64_t now_ms = timebase_now_us() / 1000;
+
+    if (now_ms <= last_ms) {
+        // Same (or earlier) millisecond: keep the timestamp, bump the random part
+        now_ms = last_ms;
+        int i = 11;
+        while (i >= 0 && last_rand[i] == 63) {
+            last_rand[i--] = 0;
+        }
+        if (i >= 0) {
+            last_rand[i]++;
+        }
+    } else {
+        for (int i = 0; i < 12; i++) {
+            last_rand[i] = esp_random() & 0x3F;
+        }
+    }
+    last_ms = now_ms;
+
+    int64_t ts = now_ms;
+    for (int i = 7; i >= 0; i--) {
+        key[i] = alphabet[ts & 0x3F];
+        ts >>= 6;
+    }
+    for (int i = 0; i < 12; i++) {
+        key[8 + i] = alphabet[last_rand[i]];
+    }
+    key[FIREBASE_PUSH_KEY_LEN] = '\0';
+}
+
+/**
+ * @brief Send several RFID log entries in a single multi-path PATCH.
+ *
+ * Each record is written under its own push-style key in "rfid_logs" (below
+ * its shard, see log_shard()), which yields the same layout as separate
+ * POSTs in one round trip. A batch that spans midnight lands in two days.
+ *
+ * @param records Records to upload, oldest first.
+ * @param count   Number of records.
+ *
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_FAIL if no valid idToken is available or the upload fails.
+ *     - ESP_ERR_INVALID_SIZE if count exceeds the batch size.
+ */
+esp_err_t send_rfid_logs_to_firebase(const firebase_log_record_t *records, size_t count) {
+    if (count == 0) {
+        return ESP_OK;
     }
 
-    // Calculate URL length and allocate memory
-    size_t url_len = strlen(FIREBASE_PROJECT_ID) + strlen(id_token) + 128;
-    char *url = malloc(url_len);
-    if (!url) {
-        ESP_LOGE(TAG, "Failed to allocate memory for URL");
+    log_writer_t w;
+    log_writer_init(&w, log_body, sizeof(log_body));
+    log_write_batch_begin(&w);
+    for (size_t i = 0; i < count; i++) {
+        char key[FIREBASE_LOG_KEY_MAX_LEN + 1];
+        size_t shard_len = log_shard(&records[i], key);
+        if (shard_len > 0) {
+            key[shard_len++] = '/';
+        }
+        generate_push_key(key + shard_len);
+        log_write_batch_entry(&w, key, &records[i]);
+    }
+    log_write_batch_end(&w);
+    if (log_writer_finish(&w) == 0) {
+        ESP_LOGE(TAG, "Batch of %u records does not fit in the request buffer", (unsigned)count);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    return rtdb_request(HTTP_METHOD_PATCH, "rfid_logs", NULL, log_body, NULL, 0);
+}
+
+/**
+ * @brief Get a snapshot of the RTDB request latency statistics.
+ *
+ * @param[out] stats Filled with the current statistics.
+ */
+void firebase_get_latency_stats(firebase_latency_stats_t *stats) {
+    portENTER_CRITICAL(&upload_stats_lock);
+    *stats = latency_stats;
+    portEXIT_CRITICAL(&upload_stats_lock);
+}
+
+/**
+ * @brief Update the enqueue/drop counters after a queue send attempt.
+ *
+ * @param queued pdTRUE if the record was accepted.
+ * @param depth  Queue depth observed right after the attempt.
+ *
+ * Safe to call from both task and ISR context.
+ */
+static void record_enqueue_result(BaseType_t queued, UBaseType_t depth) {
+    portENTER_CRITICAL_SAFE(&upload_stats_lock);
+    if (queued == pdTRUE) {
+        upload_stats.enqueued++;
+        if (depth > upload_stats.high_water) {
+            upload_stats.high_water = depth;
+        }
+    } else {
+        upload_stats.dropped++;
+    }
+    portEXIT_CRITICAL_SAFE(&upload_stats_lock);
+}
+
+/**
+ * @brief Check whether a queued record is a control marker rather than a log entry.
+ */
+static bool is_marker(const firebase_log_record_t *record) {
+    return record->uid[0] == '\0';
+}
+
+/**
+ * @brief Upload one gathered batch and update the counters.
+ *
+ * @param records Records to upload, oldest first.
+ * @param count   Number of records.
+ *
+ * @return Result of the upload request.
+ */
+static esp_err_t upload_batch(const firebase_log_record_t *records, size_t count) {
+    esp_err_t err;
+    if (count == 1) {
+        err = post_log_record(&records[0]);
+    } else {
+        err = send_rfid_logs_to_firebase(records, count);
+    }
+
+    portENTER_CRITICAL(&upload_stats_lock);
+    if (err == ESP_OK) {
+        upload_stats.uploaded += count;
+        upload_stats.batches++;
+    } else {
+        upload_stats.failed += count;
+    }
+    portEXIT_CRITICAL(&upload_stats_lock);
+
+    return err;
+}
+
+/**
+ * @brief Parse a UID string such as "99 B6 B3 02" into bytes.
+ *
+ * Any non-hex characters are treated as separators.
+ *
+ * @return Number of bytes written (0 if the string is not a valid UID).
+ */
+static uint8_t uid_str_to_bytes(const char *str, uint8_t *out, size_t out_size) {
+    uint8_t len = 0;
+    while (*str != '\0') {
+        if (!isxdigit((unsigned char)str[0])) {
+            str++;
+            continue;
+        }
+        if (!isxdigit((unsigned char)str[1]) || len == out_size) {
+            return 0;
+        }
+        char hex[3] = { str[0], str[1], '\0' };
+        out[len++] = (uint8_t)strtoul(hex, NULL, 16);
+        str += 2;
+    }
+    return len;
+}
+
+/**
+ * @brief Format UID bytes as "99 B6 B3 02" (same format as the RC522 driver).
+ */
+static void uid_bytes_to_str(const uint8_t *uid, uint8_t len, char *out, size_t out_size) {
+    size_t pos = 0;
+    out[0] = '\0';
+    for (uint8_t i = 0; i < len && pos + 4 <= out_size; i++) {
+        pos += snprintf(out + pos, out_size - pos, i ? " %02X" : "%02X", uid[i]);
+    }
+}
+
+/**
+ * @brief Parse one allowlist change ("99B6B302": "user") into a delta operation.
+ *
+ * @return false if the UID or role is not valid.
+ */
+static bool parse_allowlist_op(const cJSON *item, authz_entry_t *op) {
+    uint8_t uid[AUTHZ_UID_MAX_LEN];
+    uint8_t uid_len = uid_str_to_bytes(item->string, uid, sizeof(uid));
+    const char *value = cJSON_GetStringValue(item);
+    uint8_t role;
+
+    if (value == NULL) {
+        return false;
+    } else if (strcmp(value, "user") == 0) {
+        role = AUTHZ_ROLE_USER;
+    } else if (strcmp(value, "blocked") == 0) {
+        role = AUTHZ_ROLE_BLOCKED;
+    } else if (strcmp(value, "removed") == 0) {
+        role = AUTHZ_ROLE_REMOVE;
+    } else {
+        return false;
+    }
+    return authz_make_entry(uid, uid_len, role, op);
+}
+
+/**
+ * @brief Add an operation to the list; a later change to the same UID replaces the earlier one.
+ */
+static void add_allowlist_op(authz_entry_t *ops, size_t *count, const authz_entry_t *op) {
+    for (size_t i = 0; i < *count; i++) {
+        if (memcmp(&ops[i], op, offsetof(authz_entry_t, role)) == 0) {
+            ops[i].role = op->role;
+            return;
+        }
+    }
+    ops[(*count)++] = *op;
+}
+
+/**
+ * @brief One allowlist version and its changes.
+ */
+typedef struct {
+    uint32_t version;      // Numeric key of the delta node
+    const cJSON *changes;  // Map of UID hex string to role
+} delta_ref_t;
+
+/**
+ * @brief Order deltas by version (qsort comparator).
+ */
+static int compare_delta_versions(const void *a, const void *b) {
+    uint32_t va = ((const delta_ref_t *)a)->version;
+    uint32_t vb = ((const delta_ref_t *)b)->version;
+    return (va > vb) - (va < vb);
+}
+
+/**
+ * @brief Collect the delta nodes of an object keyed by version, in ascending order.
+ *
+ * REST query results and stream events are unordered.
+ *
+ * @return Number of deltas stored in page (at most max).
+ */
+static size_t collect_deltas(const cJSON *root, delta_ref_t *page, size_t max) {
+    size_t page_len = 0;
+    const cJSON *delta;
+    cJSON_ArrayForEach(delta, root) {
+        if (page_len < max && cJSON_IsObject(delta)) {
+            page[page_len].version = strtoul(delta->string, NULL, 10);
+            page[page_len].changes = delta;
+            page_len++;
+        }
+    }
+    qsort(page, page_len, sizeof(page[0]), compare_delta_versions);
+    return page_len;
+}
+
+/**
+ * @brief Merge deltas newer than the local allowlist and apply them in one flash update.
+ *
+ * Versions that are not newer than authz_get_version() are skipped, so the
+ * same delta arriving from both the stream and a pull is applied once.
+ *
+ * @param page      Deltas in ascending version order.
+ * @param page_len  Number of deltas.
+ * @param ops       Scratch space for CONFIG_AUTHZ_SYNC_MAX_OPS operations.
+ * @param[out] truncated Set if later deltas did not fit and must be fetched again.
+ *
+ * @return
+ *     - ESP_OK on success (including nothing to apply).
+ *     - ESP_ERR_NO_MEM if a single delta has more than CONFIG_AUTHZ_SYNC_MAX_OPS changes.
+ *     - Other error codes from authz_apply_delta().
+ */
+static esp_err_t apply_deltas(const delta_ref_t *page, size_t page_len, authz_entry_t *ops,
+                              bool *truncated) {
+    xSemaphoreTake(allowlist_lock, portMAX_DELAY);
+
+    uint32_t current = authz_get_version();
+    uint32_t new_version = current;
+    size_t op_count = 0;
+    *truncated = false;
+
+    for (size_t i = 0; i < page_len; i++) {
+        uint32_t version = page[i].version;
+        if ((int32_t)(version - current) <= 0) {
+            continue;
+        }
+        if (op_count + cJSON_GetArraySize(page[i].changes) > CONFIG_AUTHZ_SYNC_MAX_OPS) {
+            *truncated = true; // Apply what we have; the rest comes with the next page
+            break;
+        }
+
+        const cJSON *item;
+        cJSON_ArrayForEach(item, page[i].changes) {
+            authz_entry_t op;
+            if (parse_allowlist_op(item, &op)) {
+                add_allowlist_op(ops, &op_count, &op);
+            } else {
+                ESP_LOGW(TAG, "Ignoring invalid allowlist change '%s' in v%lu",
+                         item->string, (unsigned long)version);
+            }
+        }
+        new_version = version;
+    }
+
+    esp_err_t err = ESP_OK;
+    if (new_version != current) {
+        err = authz_apply_delta(ops, op_count, new_version);
+    } else if (*truncated) {
+        ESP_LOGE(TAG, "Allowlist delta v%lu exceeds %d changes",
+                 (unsigned long)current + 1, CONFIG_AUTHZ_SYNC_MAX_OPS);
+        err = ESP_ERR_NO_MEM;
+    }
+
+    xSemaphoreGive(allowlist_lock);
+    return err;
+}
+
+/**
+ * @brief Fetch allowlist changes newer than the local version and apply them.
+ *
+ * Deltas are stored in the database as allowlist/deltas/<version>, each a map
+ * of UID hex string to "user", "blocked" or "removed". They are fetched in pages of
+ * CONFIG_AUTHZ_SYNC_PAGE_DELTAS versions, starting after authz_get_version().
+ * Each page is merged into the inactive allowlist partition in one pass.
+ * Call only from the uploader task; deltas pushed by the stream task are
+ * applied under the same lock.
+ *
+ * @return
+ *     - ESP_OK when the local allowlist is up to date.
+ *     - ESP_ERR_NO_MEM if buffers could not be allocated or a delta is too large.
+ *     - Other error codes from the request or from authz_apply_delta().
+ */
+esp_err_t firebase_sync_allowlist(void) {
+    char *resp = mem_pool_alloc(&sync_resp_pool);
+    authz_entry_t *ops = mem_pool_alloc(&sync_ops_pool);
+    if (resp == NULL || ops == NULL) {
+        mem_pool_free(&sync_resp_pool, resp);
+        mem_pool_free(&sync_ops_pool, ops);
         return ESP_ERR_NO_MEM;
     }
 
-    // Format the Firebase Realtime Database URL
-    snprintf(url, url_len,
-             "https://%s-default-rtdb.firebaseio.com/rfid_logs.json?auth=%s",
-             FIREBASE_PROJECT_ID, id_token);
+    esp_err_t err = ESP_OK;
+    bool more = true;
 
-    // Create JSON payload for the RFID log
-    cJSON *root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "uid", uid);
-    cJSON_AddStringToObject(root, "timestamp", timestamp);
+    while (more && err == ESP_OK) {
+        uint32_t current = authz_get_version();
 
-    char *json_str = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root); // Free the cJSON object
+        // orderBy="$key"&startAt="<next version>"&limitToFirst=<page>, both numbers at most 10 digits
+        char query[sizeof("orderBy=%22%24key%22&startAt=%22%22&limitToFirst=") + 10 + 10];
+        int query_len = snprintf(query, sizeof(query),
+                                 "orderBy=%%22%%24key%%22&startAt=%%22%" PRIu32 "%%22&limitToFirst=%u",
+                                 current + 1, (unsigned)CONFIG_AUTHZ_SYNC_PAGE_DELTAS);
+        if (query_len < 0 || (size_t)query_len >= sizeof(query)) {
+            err = ESP_ERR_INVALID_SIZE;
+            break;
+        }
 
-    // Configure the HTTP client
-    esp_http_client_config_t config = {
-        .url = url,
-        .method = HTTP_METHOD_POST,
-        .cert_pem = firebase_root_cert,
-        .buffer_size = 4096,     // Increase buffer size for larger payloads
-        .buffer_size_tx = 4096,
-    };
+        err = rtdb_request(HTTP_METHOD_GET, "allowlist/deltas", query, NULL,
+                           resp, CONFIG_AUTHZ_SYNC_RESPONSE_MAX);
+        if (err != ESP_OK) {
+            break;
+        }
 
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    esp_http_client_set_header(client, "Content-Type", "application/json");
-    esp_http_client_set_post_field(client, json_str, strlen(json_str));
+        cJSON *root = cJSON_Parse(resp);
+        if (root == NULL || !cJSON_IsObject(root)) {
+            cJSON_Delete(root); // "null": no newer deltas
+            break;
+        }
 
-    // Perform the HTTP POST request
-    esp_err_t err = esp_http_client_perform(client);
+        delta_ref_t page[CONFIG_AUTHZ_SYNC_PAGE_DELTAS];
+        size_t page_len = collect_deltas(root, page, CONFIG_AUTHZ_SYNC_PAGE_DELTAS);
+        bool truncated;
+        err = apply_deltas(page, page_len, ops, &truncated);
+        cJSON_Delete(root);
+
+        if (authz_get_version() == current) {
+            break; // No progress (nothing newer, or an error)
+        }
+        more = truncated || page_len == CONFIG_AUTHZ_SYNC_PAGE_DELTAS;
+    }
+
+    mem_pool_free(&sync_resp_pool, resp);
+    mem_pool_free(&sync_ops_pool, ops);
+    return err;
+}
+
+/**
+ * @brief Finish a settings update: refresh the scan policy, map the result.
+ */
+static esp_err_t settings_updated(settings_result_t result) {
+    if (result == SETTINGS_REJECTED) {
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    if (result == SETTINGS_APPLIED) {
+        // The only live setting that is not read on use
+        esp_err_t err = rfid_scan_apply_settings();
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "Scan policy not updated: %s", esp_err_to_name(err));
+        }
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Pull this device's settings document and apply it.
+ */
+esp_err_t firebase_sync_settings(void) {
+    char *resp = mem_pool_alloc(&sync_resp_pool); // Free again once the allowlist sync is done
+    if (resp == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    char path[sizeof("device_config/") + FIREBASE_DEVICE_ID_LEN];
+    snprintf(path, sizeof(path), "device_config/%s", firebase_device_id());
+    esp_err_t err = rtdb_request(HTTP_METHOD_GET, path, NULL, NULL, resp, CONFIG_AUTHZ_SYNC_RESPONSE_MAX);
     if (err == ESP_OK) {
-        int status_code = esp_http_client_get_status_code(client);
-        ESP_LOGI(TAG, "POST Status = %d", status_code);
+        err = settings_updated(settings_apply_json(resp));
+    }
+
+    mem_pool_free(&sync_resp_pool, resp);
+    return err;
+}
+
+/**
+ * @brief Apply a settings change pushed by the RTDB stream.
+ */
+esp_err_t firebase_apply_settings_event(const char *json, bool patch) {
+    cJSON *root = cJSON_Parse(json);
+    const cJSON *path = cJSON_GetObjectItem(root, "path");
+    const cJSON *data = cJSON_GetObjectItem(root, "data");
+    if (!cJSON_IsString(path)) {
+        cJSON_Delete(root);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err;
+    if (!patch && strcmp(path->valuestring, "/") == 0) {
+        // The whole document (on connect and on every rewrite), or null if it was deleted
+        err = settings_updated(settings_apply_document(data));
     } else {
-        ESP_LOGE(TAG, "POST request failed: %s", esp_err_to_name(err));
+        // Some keys only: the document is applied as a whole, so pull it
+        err = ESP_ERR_NOT_FINISHED;
     }
 
-    // Clean up resources
-    esp_http_client_cleanup(client);
-    free(json_str);
-    free(url);
+    cJSON_Delete(root);
+    return err;
+}
+
+/**
+ * @brief Apply an allowlist change pushed by the RTDB stream.
+ */
+esp_err_t firebase_apply_allowlist_event(const char *json) {
+    cJSON *root = cJSON_Parse(json);
+    const cJSON *path = cJSON_GetObjectItem(root, "path");
+    const cJSON *data = cJSON_GetObjectItem(root, "data");
+    if (!cJSON_IsString(path)) {
+        cJSON_Delete(root);
+        return ESP_ERR_INVALID_ARG;
+    }
 
+    esp_err_t err = ESP_OK;
+    delta_ref_t page[CONFIG_AUTHZ_SYNC_PAGE_DELTAS];
+    size_t page_len = 0;
+    const char *p = path->valuestring;
+
+    if (strcmp(p, "/") == 0) {
+        // Initial snapshot or a multi-version patch: {"<version>": {...}, ...}
+        if (cJSON_IsObject(data)) {
+            if (cJSON_GetArraySize(data) > CONFIG_AUTHZ_SYNC_PAGE_DELTAS) {
+                err = ESP_ERR_NOT_FINISHED; // Too many for one pass: let the uploader page through them
+            } else {
+                page_len = collect_deltas(data, page, CONFIG_AUTHZ_SYNC_PAGE_DELTAS);
+            }
+        }
+    } else if (p[0] == '/' && strchr(p + 1, '/') == NULL && cJSON_IsObject(data)) {
+        // One new version: path "/<version>", data {"<uid>": "<role>", ...}
+        page[0].version = strtoul(p + 1, NULL, 10);
+        page[0].changes = data;
+        page_len = 1;
+    } else {
+        // A change inside an existing version cannot be applied incrementally
+        ESP_LOGW(TAG, "Ignoring allowlist stream update at %s", p);
+    }
+
+    if (page_len > 0) {
+        authz_entry_t *ops = mem_pool_alloc(&sync_ops_pool);
+        bool truncated = false;
+        if (ops == NULL) {
+            err = ESP_ERR_NO_MEM;
+        } else {
+            err = apply_deltas(page, page_len, ops, &truncated);
+            mem_pool_free(&sync_ops_pool, ops);
+        }
+        if (err == ESP_OK && truncated) {
+            err = ESP_ERR_NOT_FINISHED;
+        }
+    }
+
+    cJSON_Delete(root);
     return err;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Records per upload request: upload_batch_max, within the room we have.
+ */
+static size_t batch_limit(void) {
+    uint32_t max = settings_get()->upload_batch_max;
+    return (max > 0 && max < FIREBASE_BATCH_MAX_ENTRIES) ? max : FIREBASE_BATCH_MAX_ENTRIES;
+}
+
+/**
+ * @brief Date a record stamped with its uptime, once the clock is set.
+ *
+ * Only valid for records scanned in this boot.
+ */
+static void date_record(firebase_log_record_t *record) {
+    if (!(record->flags & FIREBASE_LOG_FLAG_UNSYNCED) || !timebase_is_synced()) {
+        return;
+    }
+    record->epoch_us = timebase_uptime_to_utc(record->epoch_us);
+    record->flags &= ~FIREBASE_LOG_FLAG_UNSYNCED;
+
+    portENTER_CRITICAL(&upload_stats_lock);
+    upload_stats.dated++;
+    portEXIT_CRITICAL(&upload_stats_lock);
+}
+
+/**
+ * @brief Check whether uploads should wait for the first time sync.
+ *
+ * Until the clock is set, and at most CONFIG_TIME_SYNC_UPLOAD_HOLD_S after
+ * boot, records wait in the journal so they can be dated before they are
+ * sent. Without a journal they are sent right away.
+ */
+static bool awaiting_time(void) {
+    if (timebase_is_synced() ||
+        esp_timer_get_time() >= (int64_t)CONFIG_TIME_SYNC_UPLOAD_HOLD_S * 1000000) {
+        return false;
+    }
+    journal_stats_t js;
+    journal_get_stats(&js);
+    return js.capacity > 0;
+}
+
+/**
+ * @brief Store records in the offline journal.
+ *
+ * Records already marked in journaled[] are skipped, so a later call only
+ * retries the ones an earlier call could not store.
+ *
+ * @param records   Records to store, oldest first.
+ * @param count     Number of records.
+ * @param[in,out] journaled Per record: already stored; set for each record stored now.
+ * @param[out] last_seq Sequence number of the last record stored now (0 if none); may be NULL.
+ *
+ * @return Number of records stored by this call.
+ */
+static size_t journal_records(const firebase_log_record_t *records, size_t count, bool *journaled,
+                              uint32_t *last_seq) {
+    size_t stored = 0;
+    size_t pending = 0;
+
+    if (last_seq != NULL) {
+        *last_seq = 0;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (journaled[i]) {
+            continue;
+        }
+        pending++;
+        journal_entry_t entry = {
+            .epoch_us = records[i].epoch_us,
+            .reader_id = records[i].reader_id,
+            .result = records[i].result,
+            .flags = (records[i].flags & FIREBASE_LOG_FLAG_UNSYNCED) ? JOURNAL_FLAG_UNSYNCED : 0,
+        };
+        entry.uid_len = uid_str_to_bytes(records[i].uid, entry.uid, sizeof(entry.uid));
+        if (journal_append(&entry) == ESP_OK) {
+            journaled[i] = true;
+            stored++;
+            if (last_seq != NULL) {
+                *last_seq = entry.seq;
+            }
+        }
+    }
+
+    portENTER_CRITICAL(&upload_stats_lock);
+    upload_stats.journaled += stored;
+    portEXIT_CRITICAL(&upload_stats_lock);
+
+    if (stored < pending) {
+        ESP_LOGE(TAG, "Journal unavailable, %u records not stored", (unsigned)(pending - stored));
+    }
+    return stored;
+}
+
+/**
+ * @brief Upload journaled records in batches until the journal is empty.
+ *
+ * Each record is reconciled against the current allowlist first
+ * (decision_reconcile()); records it now decides differently are uploaded
+ * with the conflict flag. Records of this boot stamped before the first
+ * time sync are dated; older ones keep the unsynced flag. Stops at the first
+ * failed upload; the remaining records stay in flash and are retried later.
+ *
+ * @return
+ *     - ESP_OK if the journal was drained completely.
+ *     - ESP_ERR_INVALID_STATE if uploads are waiting for the first time sync.
+ *     - Otherwise the upload error.
+ */
+static esp_err_t drain_journal(void) {
+    static journal_entry_t entries[FIREBASE_BATCH_MAX_ENTRIES];
+    static firebase_log_record_t replay[FIREBASE_BATCH_MAX_ENTRIES];
+
+    if (awaiting_time()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    while (journal_pending_count() > 0) {
+        size_t count = 0;
+        if (journal_read_pending(entries, batch_limit(), &count) != ESP_OK || count == 0) {
+            break;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            uid_bytes_to_str(entries[i].uid, entries[i].uid_len, replay[i].uid, sizeof(replay[i].uid));
+            replay[i].epoch_us = entries[i].epoch_us;
+            replay[i].reader_id = entries[i].reader_id;
+            replay[i].result = entries[i].result;
+            replay[i].flags = decision_reconcile(entries[i].uid, entries[i].uid_len, entries[i].result)
+                                  ? FIREBASE_LOG_FLAG_CONFLICT : 0;
+            if (entries[i].flags & JOURNAL_FLAG_UNSYNCED) {
+                replay[i].flags |= FIREBASE_LOG_FLAG_UNSYNCED;
+                if (journal_seq_this_boot(entries[i].seq)) {
+                    date_record(&replay[i]);
+                }
+            }
+        }
+
+        esp_err_t err = upload_batch(replay, count);
+        if (err != ESP_OK) {
+            return err;
+        }
+
+        journal_ack(entries[count - 1].seq);
+
+        portENTER_CRITICAL(&upload_stats_lock);
+        upload_stats.replayed += count;
+        portEXIT_CRITICAL(&upload_stats_lock);
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Check that the uploader can reach Firebase.
+ *
+ * Until Wi-Fi is connected and the auth task holds a valid ID token,
+ * records go straight to the journal. A token stays valid across a Wi-Fi
+ * drop, so the connection state is checked first: uploads pause while the
+ * station is offline instead of failing one request after another.
+ *
+ * @return true if uploads can be attempted.
+ */
+static bool ensure_online(void) {
+    return wifi_is_connected() && firebase_auth_get_token() != NULL;
+}
+
+/**
+ * @brief Upload a freshly gathered batch, falling back to the journal.
+ *
+ * With CONFIG_JOURNAL_ALL_DECISIONS, every record is written to the journal
+ * first (write-behind) and acknowledged once uploaded; otherwise only
+ * records that could not be uploaded are journaled. A record the journal
+ * refused is handled as without write-behind: uploaded with the batch, or
+ * journaled again if it cannot be. While older records are
+ * still waiting in the journal, new records are appended behind them
+ * instead of being sent first, so the database always receives records in
+ * scan order. Records stamped before the first time sync are dated first
+ * if the clock has been set since, and journaled until then (see
+ * awaiting_time()).
+ *
+ * @param records Records to upload, oldest first.
+ * @param count   Number of records.
+ * @param online  Whether Firebase is reachable (see ensure_online()).
+ */
+static void process_batch(firebase_log_record_t *records, size_t count, bool online) {
+    for (size_t i = 0; i < count; i++) {
+        date_record(&records[i]);
+    }
+    online = online && !awaiting_time();
+
+    bool backlog = journal_pending_count() > 0;
+    bool journaled[FIREBASE_BATCH_MAX_ENTRIES] = { false };
+    uint32_t last_seq = 0;
+    size_t stored = 0;
+#if CONFIG_JOURNAL_ALL_DECISIONS
+    // Write-behind; records the journal refused are uploaded or retried below
+    stored = journal_records(records, count, journaled, &last_seq);
+#endif
+
+    if (!online || backlog) {
+        if (stored < count) {
+            journal_records(records, count, journaled, NULL);
+        }
+        if (online) {
+            drain_journal();
+        }
+        return;
+    }
+
+    if (upload_batch(records, count) != ESP_OK) {
+        if (stored < count) {
+            journal_records(records, count, journaled, NULL);
+        }
+        return;
+    }
+    if (last_seq != 0) {
+        journal_ack(last_seq); // The journal held nothing older (no backlog)
+    }
+    for (size_t i = 0; i < count; i++) {
+        trace_record(TRACE_SPAN_CLOUD_ACK, records[i].tap_us);
+    }
+}
+
+#if CONFIG_TRACE_METRICS_INTERVAL_S > 0
+/**
+ * @brief PUT the latency histograms to device_metrics/<Wi-Fi MAC>/latency.
+ */
+static esp_err_t push_metrics(void) {
+    static char body[TRACE_JSON_MAX_LEN];
+    char path[sizeof("device_metrics//latency") + FIREBASE_DEVICE_ID_LEN];
+
+    snprintf(path, sizeof(path), "device_metrics/%s/latency", firebase_device_id());
+    if (trace_format_json(body, sizeof(body)) == 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return rtdb_request(HTTP_METHOD_PUT, path, NULL, body, NULL, 0);
+}
+#endif
+
+/**
+ * @brief Background task that uploads queued RFID logs.
+ *
+ * Blocks on the log queue. After the first record arrives it keeps gathering
+ * until upload_batch_max records are collected, the flush deadline
+ * (upload_batch_flush_ms) passes, or a flush is requested, then uploads them
+ * in one request. This keeps TLS and network latency away from the RFID
+ * event loop. While the journal holds records, the task also wakes up
+ * periodically to retry them, and every authz_sync_interval_s it pulls
+ * allowlist deltas and the device settings (settings.h). With
+ * CONFIG_TRACE_METRICS_INTERVAL_S set, it also pushes the latency histograms.
+ *
+ * The task starts before the network is up. Until the auth task has a valid
+ * ID token, records are journaled; once online, the allowlist is synced and
+ * then the journal is drained, reconciling each stored decision.
+ */
+static void firebase_uploader_task(void *arg) {
+    static firebase_log_record_t batch[FIREBASE_BATCH_MAX_ENTRIES];
+    firebase_log_record_t record;
+    TickType_t next_sync = xTaskGetTickCount();
+#if CONFIG_TRACE_METRICS_INTERVAL_S > 0
+    TickType_t next_metrics = xTaskGetTickCount() + pdMS_TO_TICKS(CONFIG_TRACE_METRICS_INTERVAL_S * 1000);
+#endif
+    bool was_online = false;
+    bool sync_requested = false;     // Allowlist pull requested by the stream task
+    bool settings_requested = false; // Settings pull requested by the stream task
+
+    while (true) {
+        bool online = ensure_online();
+        if (online && !was_online) {
+            // Bring the allowlist up to date first, so stored decisions are reconciled against it
+            esp_err_t err = firebase_sync_allowlist();
+            if (err != ESP_OK) {
+                ESP_LOGW(TAG, "Allowlist sync failed: %s", esp_err_to_name(err));
+            }
+            drain_journal(); // Records stored before we were online
+            err = firebase_sync_settings();
+            if (err != ESP_OK) {
+                ESP_LOGW(TAG, "Settings sync failed: %s", esp_err_to_name(err));
+            }
+            next_sync = xTaskGetTickCount() + pdMS_TO_TICKS(settings_get()->authz_sync_interval_s * 1000);
+        }
+        was_online = online;
+
+        TickType_t now = xTaskGetTickCount();
+        if (online && (int32_t)(next_sync - now) <= 0) {
+            // While a stream is live, its changes are pushed and polling is skipped
+            esp_err_t err = firebase_stream_is_live() && !sync_requested ? ESP_OK
+                                                                         : firebase_sync_allowlist();
+            sync_requested = false;
+            if (err != ESP_OK) {
+                ESP_LOGW(TAG, "Allowlist sync failed: %s", esp_err_to_name(err));
+            }
+            err = firebase_stream_settings_live() && !settings_requested ? ESP_OK
+                                                                        : firebase_sync_settings();
+            settings_requested = false;
+            if (err != ESP_OK) {
+                ESP_LOGW(TAG, "Settings sync failed: %s", esp_err_to_name(err));
+            }
+            now = xTaskGetTickCount();
+            next_sync = now + pdMS_TO_TICKS(settings_get()->authz_sync_interval_s * 1000);
+        }
+
+#if CONFIG_TRACE_METRICS_INTERVAL_S > 0
+        if (online && (int32_t)(next_metrics - now) <= 0) {
+            esp_err_t err = push_metrics();
+            if (err != ESP_OK) {
+                ESP_LOGW(TAG, "Metrics push failed: %s", esp_err_to_name(err));
+            }
+            now = xTaskGetTickCount();
+            next_metrics = now + pdMS_TO_TICKS(CONFIG_TRACE_METRICS_INTERVAL_S * 1000);
+        }
+#endif
+
+        TickType_t idle_wait = next_sync - now;
+#if CONFIG_TRACE_METRICS_INTERVAL_S > 0
+        if ((TickType_t)(next_metrics - now) < idle_wait) {
+            idle_wait = next_metrics - now;
+        }
+#endif
+        TickType_t retry_wait = pdMS_TO_TICKS(settings_get()->journal_retry_interval_ms);
+        if (journal_pending_count() > 0 && retry_wait < idle_wait) {
+            idle_wait = retry_wait;
+        }
+        if (!online) {
+            idle_wait = pdMS_TO_TICKS(FIREBASE_OFFLINE_POLL_MS); // Check connectivity again soon
+        }
+
+        if (xQueueReceive(log_queue, &record, idle_wait) != pdTRUE) {
+            if (online) {
+                drain_journal(); // Idle: retry records stored while offline
+            }
+            continue;
+        }
+
+        // Read once per batch: remote settings may change them meanwhile
+        size_t batch_max = batch_limit();
+        size_t count = 0;
+        bool flush_requested = false;
+        TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(settings_get()->upload_batch_flush_ms);
+
+        while (true) {
+            if (is_marker(&record)) {
+                if (record.result == FIREBASE_MARKER_SYNC) {
+                    sync_requested = true;
+                    next_sync = xTaskGetTickCount(); // Pull right away
+                } else if (record.result == FIREBASE_MARKER_SETTINGS) {
+                    settings_requested = true;
+                    next_sync = xTaskGetTickCount();
+                } else {
+                    flush_requested = true;
+                }
+                break;
+            }
+
+            batch[count++] = record;
+            if (count >= batch_max) {
+                break;
+            }
+
+            TickType_t now = xTaskGetTickCount();
+            if ((int32_t)(deadline - now) <= 0) {
+                break;
+            }
+            if (xQueueReceive(log_queue, &record, deadline - now) != pdTRUE) {
+                break; // Deadline reached
+            }
+        }
+
+        if (count > 0) {
+            process_batch(batch, count, online);
+        }
+
+        if (flush_requested) {
+            xSemaphoreGive(flush_done);
+        }
+    }
+}
+
+/**
+ * @brief Shutdown handler: upload the gathered records before esp_restart() resets the chip.
+ *
+ * Bounded by CONFIG_FIREBASE_SHUTDOWN_FLUSH_MS so a restart never hangs on
+ * the network; records that do not make it stay in the journal.
+ */
+static void flush_on_shutdown(void) {
+    if (firebase_flush_logs(pdMS_TO_TICKS(CONFIG_FIREBASE_SHUTDOWN_FLUSH_MS)) != ESP_OK) {
+        ESP_LOGW(TAG, "Restarting with records still queued");
+    }
+}
+
+/**
+ * @brief Create the log queue and start the uploader task.
+ *
+ * The task is pinned to the network core (TASK_LAYOUT_NET_CORE). The queue
+ * is flushed on every esp_restart().
+ *
+ * @return
+ *     - ESP_OK if the uploader is running.
+ *     - ESP_ERR_NO_MEM if the sync buffer pools could not be reserved.
+ *     - ESP_FAIL if the task could not be created.
+ */
+esp_err_t firebase_uploader_start(void) {
+    if (log_queue != NULL) {
+        return ESP_OK; // Already started
+    }
+
+    esp_err_t err = mem_pool_init(&sync_resp_pool);
+    if (err == ESP_OK) {
+        err = mem_pool_init(&sync_ops_pool);
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    flush_lock = xSemaphoreCreateMutexStatic(&flush_lock_struct);
+    flush_done = xSemaphoreCreateBinaryStatic(&flush_done_struct);
+    allowlist_lock = xSemaphoreCreateMutexStatic(&allowlist_lock_struct);
+    log_queue = xQueueCreateStatic(CONFIG_FIREBASE_LOG_QUEUE_LEN,
+                                   sizeof(firebase_log_record_t),
+                                   log_queue_storage,
+                                   &log_queue_struct);
+
+    TaskHandle_t task;
+    if (xTaskCreatePinnedToCore(firebase_uploader_task, "fb_uploader",
+                                CONFIG_FIREBASE_UPLOADER_STACK_SIZE, NULL,
+                                CONFIG_FIREBASE_UPLOADER_PRIORITY, &task,
+                                TASK_LAYOUT_NET_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create uploader task");
+        vQueueDelete(log_queue);
+        log_queue = NULL;
+        return ESP_FAIL;
+    }
+    task_layout_register(task, CONFIG_FIREBASE_UPLOADER_STACK_SIZE);
+
+    if (esp_register_shutdown_handler(flush_on_shutdown) != ESP_OK) {
+        ESP_LOGW(TAG, "Could not register the restart flush");
+    }
+
+    ESP_LOGI(TAG, "Uploader started (queue length %d)", CONFIG_FIREBASE_LOG_QUEUE_LEN);
+    return ESP_OK;
+}
+
+/**
+ * @brief Queue an RFID log entry for the uploader task.
+ *
+ * Never blocks: if the queue is full the record is dropped and counted.
+ *
+ * @param record The log entry to upload.
+ *
+ * @return
+ *     - ESP_OK if the record was queued.
+ *     - ESP_ERR_INVALID_STATE if the uploader has not been started.
+ *     - ESP_ERR_INVALID_ARG if the UID is empty.
+ *     - ESP_ERR_NO_MEM if the queue is full.
+ */
+esp_err_t firebase_enqueue_rfid_log(const firebase_log_record_t *record) {
+    if (log_queue == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (record->uid[0] == '\0') {
+        return ESP_ERR_INVALID_ARG; // An empty UID is reserved for control markers
+    }
+
+    BaseType_t queued = xQueueSend(log_queue, record, 0);
+    record_enqueue_result(queued, uxQueueMessagesWaiting(log_queue));
+
+    return queued == pdTRUE ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+/**
+ * @brief ISR-safe variant of firebase_enqueue_rfid_log().
+ */
+esp_err_t firebase_enqueue_rfid_log_from_isr(const firebase_log_record_t *record,
+                                             BaseType_t *higher_priority_task_woken) {
+    if (log_queue == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (record->uid[0] == '\0') {
+        return ESP_ERR_INVALID_ARG; // An empty UID is reserved for control markers
+    }
+
+    BaseType_t queued = xQueueSendFromISR(log_queue, record, higher_priority_task_woken);
+    record_enqueue_result(queued, uxQueueMessagesWaitingFromISR(log_queue));
+
+    return queued == pdTRUE ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+/**
+ * @brief Upload everything queued so far without waiting for the batch deadline.
+ *
+ * Queues a flush marker behind the pending records and waits until the
+ * uploader has sent them.
+ *
+ * @param timeout Maximum time to wait for the flush to complete.
+ *
+ * @return
+ *     - ESP_OK once all records queued before the call have been processed.
+ *     - ESP_ERR_INVALID_STATE if the uploader has not been started.
+ *     - ESP_ERR_TIMEOUT if the flush did not complete in time.
+ */
+esp_err_t firebase_flush_logs(TickType_t timeout) {
+    if (log_queue == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    if (xSemaphoreTake(flush_lock, timeout) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    esp_err_t err = ESP_ERR_TIMEOUT;
+    firebase_log_record_t marker = { .result = FIREBASE_MARKER_FLUSH }; // Empty UID: control record
+    TickType_t elapsed = xTaskGetTickCount() - start;
+    TickType_t remaining = (timeout == portMAX_DELAY) ? portMAX_DELAY
+                         : (elapsed < timeout ? timeout - elapsed : 0);
+
+    xSemaphoreTake(flush_done, 0); // Clear any stale completion
+    if (xQueueSend(log_queue, &marker, remaining) == pdTRUE) {
+        elapsed = xTaskGetTickCount() - start;
+        remaining = (timeout == portMAX_DELAY) ? portMAX_DELAY
+                  : (elapsed < timeout ? timeout - elapsed : 0);
+        if (xSemaphoreTake(flush_done, remaining) == pdTRUE) {
+            err = ESP_OK;
+        }
+    }
+
+    xSemaphoreGive(flush_lock);
+    return err;
+}
+
+/**
+ * @brief Ask the uploader to pull allowlist deltas now.
+ *
+ * Never blocks; if the queue is full the request is dropped (the stream
+ * task asks again after its next reconnect).
+ */
+void firebase_request_allowlist_sync(void) {
+    if (log_queue == NULL) {
+        return;
+    }
+    firebase_log_record_t marker = { .result = FIREBASE_MARKER_SYNC }; // Empty UID: control record
+    xQueueSend(log_queue, &marker, 0);
+}
+
+/**
+ * @brief Ask the uploader to pull the settings document now.
+ *
+ * Never blocks; if the queue is full the request is dropped (the regular
+ * pull picks the change up once the stream task reconnects).
+ */
+void firebase_request_settings_sync(void) {
+    if (log_queue == NULL) {
+        return;
+    }
+    firebase_log_record_t marker = { .result = FIREBASE_MARKER_SETTINGS }; // Empty UID: control record
+    xQueueSend(log_queue, &marker, 0);
+}
+
+/**
+ * @brief Get a snapshot of the upload queue counters.
+ *
+ * @param[out] stats Filled with the current counters.
+ */
+void firebase_get_upload_stats(firebase_upload_stats_t *stats) {
+    portENTER_CRITICAL(&upload_stats_lock);
+    *stats = upload_stats;
+    portEXIT_CRITICAL(&upload_stats_lock);
+
+    stats->queue_depth = log_queue ? uxQueueMessagesWaiting(log_queue) : 0;
+}
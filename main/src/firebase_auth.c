@@ -0,0 +1,409 @@
+/**
+ * @file firebase_auth.c
+ * @brief Firebase ID token manager: sign-in, expiry tracking and refresh.
+ *
+ * The auth task signs in with email/password once Wi-Fi is up, stores the
+ * refresh token and the token lifetime ("expiresIn"), and sleeps until
+ * CONFIG_FIREBASE_AUTH_REFRESH_MARGIN_S before expiry. It then exchanges the
+ * refresh token for a new ID token at securetoken.googleapis.com, which is a
+ * single small request instead of a full sign-in. The new token is written
+ * to the inactive buffer and published by switching an index, so readers
+ * never wait. Expiry is tracked on the monotonic esp_timer clock, so SNTP
+ * adjustments do not affect it.
+ */
+
+#include "firebase_auth.h"         // Our public header
+#include "firebase_credentials.h"  // API key, email and password
+#include "wifi.h"                  // Wait for the connection before signing in
+#include "boot.h"                  // Boot stage logs
+#include "json_extract.h"          // Streaming response parsing
+#include "task_layout.h"           // Auth task core and stack report
+
+#include "esp_http_client.h"       // ESP-IDF HTTP client
+#include "esp_log.h"               // ESP-IDF Logging
+#include "esp_timer.h"             // Monotonic time for token expiry
+#include "cJSON.h"                 // Sign-in request body
+#include "freertos/task.h"         // Auth task
+#include "freertos/event_groups.h" // Token-ready bit
+
+#include <stdio.h>                 // For snprintf()
+#include <stdlib.h>                // For strtol()
+#include <string.h>                // For string functions
+
+// Tag used for ESP_LOG messages
+static const char *TAG = "firebase_auth";
+
+// Longest refresh token accepted from Firebase
+#define FIREBASE_REFRESH_TOKEN_MAX_LEN 1024
+
+// Retry backoff after a failed sign-in or refresh
+#define AUTH_RETRY_MIN_MS 2000
+#define AUTH_RETRY_MAX_MS 60000
+
+// Set while a valid token is published
+#define AUTH_TOKEN_READY_BIT BIT0
+
+// DigiCert Global Root CA certificate (for HTTPS communication)
+const char *const firebase_root_cert = \
+"-----BEGIN CERTIFICATE-----\n"\
+"MIIFYjCCBEqgAwIBAgIQd70NbNs2+RrqIQ/E8FjTDTANBgkqhkiG9w0BAQsFADBX\n"\
+"MQswCQYDVQQGEwJCRTEZMBcGA1UEChMQR2xvYmFsU2lnbiBudi1zYTEQMA4GA1UE\n"\
+"CxMHUm9vdCBDQTEbMBkGA1UEAxMSR2xvYmFsU2lnbiBSb290IENBMB4XDTIwMDYx\n"\
+"OTAwMDA0MloXDTI4MDEyODAwMDA0MlowRzELMAkGA1UEBhMCVVMxIjAgBgNVBAoT\n"\
+"GUdvb2dsZSBUcnVzdCBTZXJ2aWNlcyBMTEMxFDASBgNVBAMTC0dUUyBSb290IFIx\n"\
+"MIICIjANBgkqhkiG9w0BAQEFAAOCAg8AMIICCgKCAgEAthECix7joXebO9y/lD63\n"\
+"ladAPKH9gvl9MgaCcfb2jH/76Nu8ai6Xl6OMS/kr9rH5zoQdsfnFl97vufKj6bwS\n"\
+"iV6nqlKr+CMny6SxnGPb15l+8Ape62im9MZaRw1NEDPjTrETo8gYbEvs/AmQ351k\n"\
+"KSUjB6G00j0uYODP0gmHu81I8E3CwnqIiru6z1kZ1q+PsAewnjHxgsHA3y6mbWwZ\n"\
+"DrXYfiYaRQM9sHmklCitD38m5agI/pboPGiUU+6DOogrFZYJsuB6jC511pzrp1Zk\n"\
+"j5ZPaK49l8KEj8C8QMALXL32h7M1bKwYUH+E4EzNktMg6TO8UpmvMrUpsyUqtEj5\n"\
+"cuHKZPfmghCN6J3Cioj6OGaK/GP5Afl4/Xtcd/p2h/rs37EOeZVXtL0m79YB0esW\n"\
+"CruOC7XFxYpVq9Os6pFLKcwZpDIlTirxZUTQAs6qzkm06p98g7BAe+dDq6dso499\n"\
+"iYH6TKX/1Y7DzkvgtdizjkXPdsDtQCv9Uw+wp9U7DbGKogPeMa3Md+pvez7W35Ei\n"\
+"Eua++tgy/BBjFFFy3l3WFpO9KWgz7zpm7AeKJt8T11dleCfeXkkUAKIAf5qoIbap\n"\
+"sZWwpbkNFhHax2xIPEDgfg1azVY80ZcFuctL7TlLnMQ/0lUTbiSw1nH69MG6zO0b\n"\
+"9f6BQdgAmD06yK56mDcYBZUCAwEAAaOCATgwggE0MA4GA1UdDwEB/wQEAwIBhjAP\n"\
+"BgNVHRMBAf8EBTADAQH/MB0GA1UdDgQWBBTkrysmcRorSCeFL1JmLO/wiRNxPjAf\n"\
+"BgNVHSMEGDAWgBRge2YaRQ2XyolQL30EzTSo//z9SzBgBggrBgEFBQcBAQRUMFIw\n"\
+"JQYIKwYBBQUHMAGGGWh0dHA6Ly9vY3NwLnBraS5nb29nL2dzcjEwKQYIKwYBBQUH\n"\
+"MAKGHWh0dHA6Ly9wa2kuZ29vZy9nc3IxL2dzcjEuY3J0MDIGA1UdHwQrMCkwJ6Al\n"\
+"oCOGIWh0dHA6Ly9jcmwucGtpLmdvb2cvZ3NyMS9nc3IxLmNybDA7BgNVHSAENDAy\n"\
+"MAgGBmeBDAECATAIBgZngQwBAgIwDQYLKwYBBAHWeQIFAwIwDQYLKwYBBAHWeQIF\n"\
+"AwMwDQYJKoZIhvcNAQELBQADggEBADSkHrEoo9C0dhemMXoh6dFSPsjbdBZBiLg9\n"\
+"NR3t5P+T4Vxfq7vqfM/b5A3Ri1fyJm9bvhdGaJQ3b2t6yMAYN/olUazsaL+yyEn9\n"\
+"WprKASOshIArAoyZl+tJaox118fessmXn1hIVw41oeQa1v1vg4Fv74zPl6/AhSrw\n"\
+"9U5pCZEt4Wi4wStz6dTZ/CLANx8LZh1J7QJVj2fhMtfTJr9w4z30Z209fOU0iOMy\n"\
+"+qduBmpvvYuR7hZL6Dupszfnw0Skfths18dG9ZKb59UhvmaSGZRVbNQpsg3BZlvi\n"\
+"d0lIKO2d1xozclOzgjXPYovJJIultzkMu34qQb9Sz/yilrbCgj8=\n"\
+"-----END CERTIFICATE-----\n";
+
+/**
+ * @brief One published ID token.
+ */
+typedef struct {
+    char id_token[FIREBASE_ID_TOKEN_MAX_LEN];
+    int64_t expires_at_us; // esp_timer time after which the token is invalid
+} token_slot_t;
+
+// Double buffer: readers use slots[active], the task fills the other one
+static token_slot_t slots[2];
+static volatile int active = -1; // -1: no token yet
+
+// Refresh token; only used by the auth task
+static char refresh_token[FIREBASE_REFRESH_TOKEN_MAX_LEN];
+
+// Auth responses are parsed as they arrive; only these fields are kept (auth task only)
+static char new_refresh_token[FIREBASE_REFRESH_TOKEN_MAX_LEN];
+static char new_expires_in[16];
+
+// Body of a refresh request
+static char refresh_body[sizeof("grant_type=refresh_token&refresh_token=") + FIREBASE_REFRESH_TOKEN_MAX_LEN];
+
+static TaskHandle_t auth_task = NULL;
+static StaticEventGroup_t auth_events_struct;
+static EventGroupHandle_t auth_events = NULL;
+
+static firebase_auth_stats_t stats;
+
+/**
+ * @brief HTTP event handler that streams the response into a JSON extractor.
+ *
+ * Each chunk is parsed as it arrives, so the response is never buffered and
+ * its size does not matter.
+ */
+static esp_err_t _http_event_handler(esp_http_client_event_t *evt) {
+    switch (evt->event_id) {
+        case HTTP_EVENT_ON_DATA:
+            if (evt->user_data && evt->data && evt->data_len > 0) {
+                json_extract_feed(evt->user_data, evt->data, evt->data_len);
+            }
+            break;
+        default:
+            break;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Index of the token slot that readers are not using.
+ */
+static int inactive_slot(void) {
+    return (active == 0) ? 1 : 0;
+}
+
+/**
+ * @brief POST a request to a Google auth endpoint and extract the tokens.
+ *
+ * Sign-in and refresh responses use different field names
+ * ("idToken"/"id_token", "refreshToken"/"refresh_token", "expiresIn"/"expires_in").
+ * The ID token is extracted straight into the inactive slot, the other
+ * fields into new_refresh_token and new_expires_in.
+ *
+ * @param url          Endpoint URL (including the API key).
+ * @param content_type Request content type.
+ * @param body         Request body.
+ * @param[out] status  HTTP status code (0 if the request failed).
+ *
+ * @return true if the request succeeded and the response held a usable ID token.
+ */
+static bool auth_post(const char *url, const char *content_type, const char *body,
+                      const char *id_key, const char *refresh_key, const char *expires_key, int *status) {
+    json_field_t fields[] = {
+        { .key = id_key, .out = slots[inactive_slot()].id_token, .cap = FIREBASE_ID_TOKEN_MAX_LEN },
+        { .key = refresh_key, .out = new_refresh_token, .cap = sizeof(new_refresh_token) },
+        { .key = expires_key, .out = new_expires_in, .cap = sizeof(new_expires_in) },
+    };
+    json_extractor_t extractor;
+    json_extract_init(&extractor, fields, sizeof(fields) / sizeof(fields[0]));
+
+    *status = 0;
+    esp_http_client_config_t config = {
+        .url = url,
+        .method = HTTP_METHOD_POST,
+        .cert_pem = firebase_root_cert,
+        .event_handler = _http_event_handler,
+        .user_data = &extractor,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (client == NULL) {
+        return false;
+    }
+
+    esp_http_client_set_header(client, "Content-Type", content_type);
+    esp_http_client_set_post_field(client, body, strlen(body));
+
+    esp_err_t err = esp_http_client_perform(client);
+    if (err == ESP_OK) {
+        *status = esp_http_client_get_status_code(client);
+    } else {
+        ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(err));
+    }
+    esp_http_client_cleanup(client);
+
+    if (err != ESP_OK || *status != 200) {
+        return false;
+    }
+    if (!json_extract_complete(&extractor)) {
+        ESP_LOGE(TAG, "Failed to parse JSON");
+        return false;
+    }
+    if (!fields[0].found || fields[0].truncated || fields[1].truncated) {
+        ESP_LOGE(TAG, "No usable %s in response", id_key);
+        return false;
+    }
+    if (!fields[1].found) {
+        new_refresh_token[0] = '\0';
+    }
+    return true;
+}
+
+/**
+ * @brief Publish the token extracted by auth_post().
+ *
+ * @param started_us esp_timer time when the request was sent (the lifetime counts from there).
+ */
+static void publish_tokens(int64_t started_us) {
+    long lifetime_s = strtol(new_expires_in, NULL, 10);
+    if (lifetime_s <= 0) {
+        lifetime_s = 3600; // Firebase ID tokens last one hour
+    }
+
+    int next = inactive_slot();
+    slots[next].expires_at_us = started_us + (int64_t)lifetime_s * 1000000;
+    __atomic_store_n(&active, next, __ATOMIC_RELEASE);
+
+    if (new_refresh_token[0] != '\0') {
+        strcpy(refresh_token, new_refresh_token);
+    }
+
+    xEventGroupSetBits(auth_events, AUTH_TOKEN_READY_BIT);
+    ESP_LOGI(TAG, "ID token valid for %ld s", lifetime_s);
+}
+
+/**
+ * @brief Sign in to Firebase Authentication using email and password.
+ *
+ * Sends a POST request to Firebase Authentication REST API to obtain
+ * a JWT idToken and a refresh token.
+ */
+esp_err_t firebase_sign_in(void) {
+    // Create JSON payload for the sign-in request
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "email", FIREBASE_EMAIL);
+    cJSON_AddStringToObject(root, "password", FIREBASE_PASSWORD);
+    cJSON_AddBoolToObject(root, "returnSecureToken", true);
+
+    char *json_str = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root); // Free the cJSON object
+    if (json_str == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (auth_events == NULL) {
+        auth_events = xEventGroupCreateStatic(&auth_events_struct);
+    }
+
+    int status;
+    int64_t started = esp_timer_get_time();
+    bool ok = auth_post("https://identitytoolkit.googleapis.com/v1/accounts:signInWithPassword?key="
+                        FIREBASE_API_KEY, "application/json", json_str,
+                        "idToken", "refreshToken", "expiresIn", &status);
+    cJSON_free(json_str);
+
+    ESP_LOGI(TAG, "Sign-in HTTP Status = %d", status);
+    if (!ok) {
+        stats.failures++;
+        return ESP_FAIL;
+    }
+
+    publish_tokens(started);
+    stats.sign_ins++;
+    return ESP_OK;
+}
+
+/**
+ * @brief Exchange the refresh token for a new ID token.
+ *
+ * @return
+ *     - ESP_OK on success.
+ *     - ESP_ERR_INVALID_STATE if the refresh token was rejected (sign in again).
+ *     - ESP_FAIL for network or parsing errors (retry later).
+ */
+static esp_err_t refresh_id_token(void) {
+    // grant_type=refresh_token&refresh_token=<token> (the token is URL-safe)
+    snprintf(refresh_body, sizeof(refresh_body), "grant_type=refresh_token&refresh_token=%s", refresh_token);
+
+    int status;
+    int64_t started = esp_timer_get_time();
+    bool ok = auth_post("https://securetoken.googleapis.com/v1/token?key=" FIREBASE_API_KEY,
+                        "application/x-www-form-urlencoded", refresh_body,
+                        "id_token", "refresh_token", "expires_in", &status);
+
+    ESP_LOGI(TAG, "Token refresh HTTP Status = %d", status);
+    if (!ok) {
+        stats.failures++;
+        // Revoked or expired refresh token
+        return (status == 400 || status == 401 || status == 403) ? ESP_ERR_INVALID_STATE : ESP_FAIL;
+    }
+
+    publish_tokens(started);
+    stats.refreshes++;
+    return ESP_OK;
+}
+
+/**
+ * @brief Token manager task.
+ *
+ * Waits for Wi-Fi, obtains a token, then sleeps until the refresh point.
+ * firebase_auth_invalidate() wakes it early.
+ */
+static void firebase_auth_task(void *arg) {
+    uint32_t backoff_ms = AUTH_RETRY_MIN_MS;
+    bool first = true;
+    int64_t boot_stage_start = esp_timer_get_time();
+
+    while (true) {
+        wifi_wait_connected(portMAX_DELAY); // Paused while Wi-Fi is down
+
+        esp_err_t err;
+        if (refresh_token[0] != '\0') {
+            err = refresh_id_token();
+            if (err == ESP_ERR_INVALID_STATE) {
+                ESP_LOGW(TAG, "Refresh token rejected, signing in again");
+                refresh_token[0] = '\0';
+                err = firebase_sign_in();
+            }
+        } else {
+            err = firebase_sign_in();
+        }
+
+        TickType_t wait;
+        if (err == ESP_OK) {
+            if (first) {
+                boot_log_stage("firebase_auth", boot_stage_start);
+                first = false;
+            }
+            backoff_ms = AUTH_RETRY_MIN_MS;
+
+            int64_t refresh_at = slots[active].expires_at_us - (int64_t)CONFIG_FIREBASE_AUTH_REFRESH_MARGIN_S * 1000000;
+            int64_t delay_ms = (refresh_at - esp_timer_get_time()) / 1000;
+            wait = pdMS_TO_TICKS(delay_ms > AUTH_RETRY_MIN_MS ? delay_ms : AUTH_RETRY_MIN_MS);
+        } else {
+            ESP_LOGW(TAG, "Token request failed, retrying in %lu ms", (unsigned long)backoff_ms);
+            wait = pdMS_TO_TICKS(backoff_ms);
+            backoff_ms = (backoff_ms * 2 > AUTH_RETRY_MAX_MS) ? AUTH_RETRY_MAX_MS : backoff_ms * 2;
+        }
+
+        ulTaskNotifyTake(pdTRUE, wait); // Woken early by firebase_auth_invalidate()
+    }
+}
+
+/**
+ * @brief Start the token manager task.
+ */
+esp_err_t firebase_auth_start(void) {
+    if (auth_task != NULL) {
+        return ESP_OK;
+    }
+    if (auth_events == NULL) {
+        auth_events = xEventGroupCreateStatic(&auth_events_struct);
+    }
+
+    if (xTaskCreatePinnedToCore(firebase_auth_task, "fb_auth", CONFIG_FIREBASE_AUTH_TASK_STACK_SIZE,
+                                NULL, CONFIG_FIREBASE_AUTH_TASK_PRIORITY, &auth_task,
+                                TASK_LAYOUT_NET_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create auth task");
+        return ESP_FAIL;
+    }
+    task_layout_register(auth_task, CONFIG_FIREBASE_AUTH_TASK_STACK_SIZE);
+    return ESP_OK;
+}
+
+/**
+ * @brief Get the current ID token without blocking.
+ */
+const char *firebase_auth_get_token(void) {
+    int idx = __atomic_load_n(&active, __ATOMIC_ACQUIRE);
+    if (idx < 0 || esp_timer_get_time() >= slots[idx].expires_at_us) {
+        return NULL;
+    }
+    return slots[idx].id_token;
+}
+
+/**
+ * @brief Report that a server rejected a token, so it is renewed right away.
+ */
+void firebase_auth_invalidate(const char *token) {
+    int idx = __atomic_load_n(&active, __ATOMIC_ACQUIRE);
+    if (idx < 0 || token != slots[idx].id_token) {
+        return; // Already replaced
+    }
+
+    slots[idx].expires_at_us = 0; // Stop handing out the rejected token
+    xEventGroupClearBits(auth_events, AUTH_TOKEN_READY_BIT);
+    stats.invalidations++;
+    if (auth_task != NULL) {
+        xTaskNotifyGive(auth_task);
+    }
+}
+
+/**
+ * @brief Wait until a valid ID token is available.
+ */
+bool firebase_auth_wait(TickType_t timeout) {
+    if (auth_events == NULL) {
+        return false;
+    }
+    xEventGroupWaitBits(auth_events, AUTH_TOKEN_READY_BIT, pdFALSE, pdTRUE, timeout);
+    return firebase_auth_get_token() != NULL;
+}
+
+/**
+ * @brief Get a snapshot of the token manager counters.
+ */
+void firebase_auth_get_stats(firebase_auth_stats_t *out) {
+    *out = stats;
+    int idx = __atomic_load_n(&active, __ATOMIC_ACQUIRE);
+    int64_t left = (idx < 0) ? 0 : slots[idx].expires_at_us - esp_timer_get_time();
+    out->expires_in_us = left > 0 ? left : 0;
+}
@@ -0,0 +1,417 @@
+/**
+ * @file firebase_stream.c
+ * @brief Realtime Database event streams for allowlist deltas and settings.
+ *
+ * Each stream (channel) has its own task and connection. A task opens its
+ * location with "Accept: text/event-stream" and reads it for as long as the
+ * server keeps the connection open. Events are parsed incrementally
+ * (sse_parser.h) and put/patch events are handed to the channel's handler:
+ * allowlist/deltas, filtered to versions newer than the local one, goes to
+ * firebase_apply_allowlist_event(); device_config/<Wi-Fi MAC> goes to
+ * firebase_apply_settings_event(). Changes that cannot be applied in place
+ * are turned into a pull on the uploader task.
+ *
+ * The server sends "keep-alive" every 30 seconds, so a read timeout longer
+ * than that means the connection is dead. "auth_revoked" (the ID token
+ * expired) reconnects with a fresh token; "cancel" (rules denied the read)
+ * backs off like any other failure.
+ */
+
+#include "firebase_stream.h"       // Our public header
+#include "firebase.h"              // Applying pushed deltas, pull sync fallback
+#include "firebase_auth.h"         // ID token and CA certificate
+#include "firebase_credentials.h"  // Project ID
+#include "authz.h"                 // Local allowlist version
+#include "sse_parser.h"            // text/event-stream parsing
+#include "task_layout.h"           // Stream task core and stack report
+#include "wifi.h"                  // Wait for the connection
+
+#include "esp_http_client.h"       // ESP-IDF HTTP client
+#include "esp_log.h"               // ESP-IDF Logging
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"         // Stream task
+#include <stdio.h>                 // For snprintf()
+#include <string.h>                // For strcmp()
+
+#if CONFIG_FIREBASE_STREAM
+
+// Tag used for ESP_LOG messages
+static const char *TAG = "firebase_stream";
+
+// Streamed locations
+#define FIREBASE_STREAM_BASE_URL "https://" FIREBASE_PROJECT_ID "-default-rtdb.firebaseio.com/"
+#define FIREBASE_STREAM_ALLOWLIST_URL FIREBASE_STREAM_BASE_URL "allowlist/deltas.json"
+#define FIREBASE_STREAM_SETTINGS_URL  FIREBASE_STREAM_BASE_URL "device_config/%s.json"
+
+// Settings documents are small; a larger event is pulled instead
+#define STREAM_SETTINGS_EVENT_MAX_LEN 1024
+
+// Reconnect backoff after a failed or cancelled stream
+#define STREAM_RETRY_MIN_MS 2000
+#define STREAM_RETRY_MAX_MS 60000
+
+// RTDB may redirect a stream to the server that holds the data
+#define STREAM_MAX_REDIRECTS 3
+
+typedef struct stream_channel stream_channel_t;
+
+/**
+ * @brief State of one stream connection, shared with the event callback.
+ */
+typedef struct {
+    stream_channel_t *channel; // Stream the session belongs to
+    const char *token;         // ID token used in the URL
+    bool live;                 // Initial snapshot received
+    bool end;                  // Server asked us to stop (cancel, auth_revoked)
+    bool failed;               // The session ended because of an error
+} stream_session_t;
+
+/**
+ * @brief One streamed location and its task.
+ */
+struct stream_channel {
+    const char *name;       // Task name
+    const char *what;       // What the stream carries, for the log
+    // Write the stream URL for an ID token; returns snprintf()'s result
+    int (*format_url)(char *url, size_t size, const char *token);
+    // Apply the data of a put/patch event
+    void (*on_update)(const char *data, bool patch, bool overflow);
+    char *event_data;       // Data of one event
+    size_t event_size;      // Capacity of event_data
+    char *url;              // Stream URL, rebuilt on every connect
+    size_t url_size;        // Capacity of url
+    char read_buf[512];     // Receive buffer for esp_http_client_read()
+    TaskHandle_t task;
+    volatile bool live;     // Connected, initial snapshot received
+};
+
+// Stream URL: base, path, ID token and query
+#define STREAM_URL_MAX_LEN (sizeof(FIREBASE_STREAM_BASE_URL) + FIREBASE_ID_TOKEN_MAX_LEN + 128)
+
+#endif // CONFIG_FIREBASE_STREAM
+
+static firebase_stream_stats_t stats;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+#if CONFIG_FIREBASE_STREAM
+
+/**
+ * @brief Add to one of the counters.
+ */
+static void count(uint32_t *counter) {
+    portENTER_CRITICAL(&stats_lock);
+    (*counter)++;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+/**
+ * @brief Apply the data of an allowlist put or patch event.
+ *
+ * Anything that cannot be applied from the event alone (it did not fit in
+ * the event buffer, or holds more deltas than one pass) becomes a pull sync.
+ */
+static void allowlist_update(const char *data, bool patch, bool overflow) {
+    esp_err_t err = overflow ? ESP_ERR_NOT_FINISHED : firebase_apply_allowlist_event(data);
+
+    if (err == ESP_OK) {
+        count(&stats.applied);
+    } else if (err == ESP_ERR_NOT_FINISHED) {
+        ESP_LOGI(TAG, "Pushed change too large, pulling it instead");
+        count(&stats.resyncs);
+        firebase_request_allowlist_sync();
+    } else {
+        ESP_LOGW(TAG, "Could not apply pushed change: %s", esp_err_to_name(err));
+    }
+}
+
+/**
+ * @brief Stream URL of the allowlist: deltas newer than the local version.
+ */
+static int allowlist_url(char *url, size_t size, const char *token) {
+    return snprintf(url, size,
+                    FIREBASE_STREAM_ALLOWLIST_URL "?auth=%s&orderBy=%%22%%24key%%22&startAt=%%22%lu%%22",
+                    token, (unsigned long)authz_get_version() + 1);
+}
+
+static char allowlist_event[CONFIG_FIREBASE_STREAM_EVENT_MAX_LEN];
+static char allowlist_stream_url[STREAM_URL_MAX_LEN];
+
+static stream_channel_t allowlist_channel = {
+    .name = "fb_stream",
+    .what = "allowlist",
+    .format_url = allowlist_url,
+    .on_update = allowlist_update,
+    .event_data = allowlist_event,
+    .event_size = sizeof(allowlist_event),
+    .url = allowlist_stream_url,
+    .url_size = sizeof(allowlist_stream_url),
+};
+
+#if CONFIG_FIREBASE_STREAM_SETTINGS
+/**
+ * @brief Apply the data of a settings put or patch event.
+ *
+ * A partial change (or one that did not fit in the event buffer) becomes a
+ * pull of the whole document.
+ */
+static void settings_update(const char *data, bool patch, bool overflow) {
+    esp_err_t err = overflow ? ESP_ERR_NOT_FINISHED : firebase_apply_settings_event(data, patch);
+
+    if (err == ESP_OK) {
+        count(&stats.applied);
+    } else if (err == ESP_ERR_NOT_FINISHED) {
+        count(&stats.resyncs);
+        firebase_request_settings_sync();
+    } else {
+        ESP_LOGW(TAG, "Could not apply pushed settings: %s", esp_err_to_name(err));
+    }
+}
+
+/**
+ * @brief Stream URL of this device's settings document.
+ */
+static int settings_url(char *url, size_t size, const char *token) {
+    int len = snprintf(url, size, FIREBASE_STREAM_SETTINGS_URL, firebase_device_id());
+    if (len < 0 || (size_t)len >= size) {
+        return len;
+    }
+    int rest = snprintf(url + len, size - (size_t)len, "?auth=%s", token);
+    return rest < 0 ? rest : len + rest;
+}
+
+static char settings_event[STREAM_SETTINGS_EVENT_MAX_LEN];
+static char settings_stream_url[STREAM_URL_MAX_LEN];
+
+static stream_channel_t settings_channel = {
+    .name = "fb_settings",
+    .what = "settings",
+    .format_url = settings_url,
+    .on_update = settings_update,
+    .event_data = settings_event,
+    .event_size = sizeof(settings_event),
+    .url = settings_stream_url,
+    .url_size = sizeof(settings_stream_url),
+};
+#endif // CONFIG_FIREBASE_STREAM_SETTINGS
+
+/**
+ * @brief SSE callback: one complete event from the stream.
+ */
+static void on_stream_event(const char *event, const char *data, size_t len, bool overflow,
+                            void *arg) {
+    stream_session_t *session = arg;
+
+    stream_channel_t *channel = session->channel;
+
+    if (strcmp(event, "put") == 0 || strcmp(event, "patch") == 0) {
+        count(&stats.events);
+        channel->on_update(data, strcmp(event, "patch") == 0, overflow);
+        if (!session->live) {
+            // The first put is the snapshot of the location (for the allowlist: what is newer)
+            session->live = true;
+            channel->live = true;
+            ESP_LOGI(TAG, "Stream live: %s", channel->what);
+        }
+    } else if (strcmp(event, "keep-alive") == 0) {
+        count(&stats.keepalives);
+    } else if (strcmp(event, "auth_revoked") == 0) {
+        ESP_LOGI(TAG, "ID token expired, reconnecting");
+        firebase_auth_invalidate(session->token);
+        session->end = true;
+    } else if (strcmp(event, "cancel") == 0) {
+        ESP_LOGW(TAG, "%s stream cancelled by the server: %s", channel->what, data);
+        session->end = true;
+        session->failed = true;
+    }
+}
+
+/**
+ * @brief Open the stream and read it until the connection ends.
+ *
+ * @param session Session state; channel and token must be set.
+ *
+ * @return
+ *     - ESP_OK if the stream was opened (it may have ended since).
+ *     - ESP_ERR_INVALID_SIZE if the URL is too long.
+ *     - ESP_ERR_NO_MEM if the client could not be created.
+ *     - ESP_FAIL if the request failed or the server rejected it.
+ */
+static esp_err_t stream_run(stream_session_t *session) {
+    stream_channel_t *channel = session->channel;
+    int url_len = channel->format_url(channel->url, channel->url_size, session->token);
+    if (url_len < 0 || (size_t)url_len >= channel->url_size) {
+        ESP_LOGE(TAG, "Stream URL too long");
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    esp_http_client_config_t config = {
+        .url = channel->url,
+        .method = HTTP_METHOD_GET,
+        .cert_pem = firebase_root_cert,
+        .timeout_ms = CONFIG_FIREBASE_STREAM_TIMEOUT_S * 1000,
+        .buffer_size = 1024,
+        .keep_alive_enable = true, // TCP keep-alive so dead connections are detected
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        .save_client_session = true, // Resume the TLS session on reconnect
+#endif
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (client == NULL) {
+        ESP_LOGE(TAG, "Failed to create stream client");
+        return ESP_ERR_NO_MEM;
+    }
+    esp_http_client_set_header(client, "Accept", "text/event-stream");
+
+    esp_err_t err = ESP_FAIL;
+    int status = 0;
+    for (int redirects = 0; redirects <= STREAM_MAX_REDIRECTS; redirects++) {
+        err = esp_http_client_open(client, 0);
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "%s stream connect failed: %s", channel->what, esp_err_to_name(err));
+            break;
+        }
+        esp_http_client_fetch_headers(client);
+        status = esp_http_client_get_status_code(client);
+        if (status != 301 && status != 302 && status != 307) {
+            break;
+        }
+        esp_http_client_set_redirection(client);
+        esp_http_client_close(client);
+    }
+
+    if (err == ESP_OK && status != 200) {
+        ESP_LOGW(TAG, "%s stream rejected, status %d", channel->what, status);
+        if (status == 401) {
+            firebase_auth_invalidate(session->token); // Rejected token: refresh now
+        }
+        err = ESP_FAIL;
+    }
+
+    if (err == ESP_OK) {
+        count(&stats.connects);
+        ESP_LOGI(TAG, "Stream open: %s", channel->what);
+
+        sse_parser_t parser;
+        sse_parser_init(&parser, channel->event_data, channel->event_size, on_stream_event, session);
+        while (!session->end) {
+            int n = esp_http_client_read(client, channel->read_buf, sizeof(channel->read_buf));
+            if (n <= 0) {
+                ESP_LOGW(TAG, "%s stream closed", channel->what);
+                break; // Server closed the stream, or no keep-alive within the timeout
+            }
+            sse_parser_feed(&parser, channel->read_buf, (size_t)n);
+        }
+    }
+
+    esp_http_client_close(client);
+    esp_http_client_cleanup(client);
+    return err;
+}
+
+/**
+ * @brief Background task that keeps one stream open.
+ *
+ * Waits for Wi-Fi and an ID token, then streams until the connection ends.
+ * A stream that went live is reopened after a short pause; failures back
+ * off exponentially. Until the stream is live again, the uploader's
+ * periodic pull keeps the allowlist (or the settings) current.
+ *
+ * @param arg The stream_channel_t to stream.
+ */
+static void firebase_stream_task(void *arg) {
+    stream_channel_t *channel = arg;
+    uint32_t backoff_ms = STREAM_RETRY_MIN_MS;
+
+    while (true) {
+        wifi_wait_connected(portMAX_DELAY);
+        firebase_auth_wait(portMAX_DELAY);
+
+        stream_session_t session = { .channel = channel, .token = firebase_auth_get_token() };
+        esp_err_t err = ESP_FAIL;
+        if (session.token != NULL) {
+            err = stream_run(&session);
+        }
+        channel->live = false;
+
+        uint32_t wait_ms = STREAM_RETRY_MIN_MS;
+        if (session.live && !session.failed) {
+            backoff_ms = STREAM_RETRY_MIN_MS; // Normal end of a working stream
+        } else {
+            count(&stats.failures);
+            ESP_LOGW(TAG, "%s stream failed (%s), retrying in %lu ms", channel->what,
+                     esp_err_to_name(err), (unsigned long)backoff_ms);
+            wait_ms = backoff_ms;
+            backoff_ms = (backoff_ms * 2 > STREAM_RETRY_MAX_MS) ? STREAM_RETRY_MAX_MS : backoff_ms * 2;
+        }
+        vTaskDelay(pdMS_TO_TICKS(wait_ms));
+    }
+}
+
+#endif // CONFIG_FIREBASE_STREAM
+
+#if CONFIG_FIREBASE_STREAM
+/**
+ * @brief Create the task of one stream.
+ */
+static esp_err_t start_channel(stream_channel_t *channel) {
+    if (channel->task != NULL) {
+        return ESP_OK;
+    }
+    if (xTaskCreatePinnedToCore(firebase_stream_task, channel->name, CONFIG_FIREBASE_STREAM_TASK_STACK_SIZE,
+                                channel, CONFIG_FIREBASE_STREAM_TASK_PRIORITY, &channel->task,
+                                TASK_LAYOUT_NET_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create %s stream task", channel->what);
+        return ESP_FAIL;
+    }
+    task_layout_register(channel->task, CONFIG_FIREBASE_STREAM_TASK_STACK_SIZE);
+    return ESP_OK;
+}
+#endif
+
+/**
+ * @brief Start the stream tasks.
+ */
+esp_err_t firebase_stream_start(void) {
+#if CONFIG_FIREBASE_STREAM
+    esp_err_t err = start_channel(&allowlist_channel);
+#if CONFIG_FIREBASE_STREAM_SETTINGS
+    if (err == ESP_OK) {
+        err = start_channel(&settings_channel);
+    }
+#endif
+    return err;
+#else
+    return ESP_OK;
+#endif
+}
+
+/**
+ * @brief Whether the allowlist stream is connected and has delivered its initial snapshot.
+ */
+bool firebase_stream_is_live(void) {
+#if CONFIG_FIREBASE_STREAM
+    return allowlist_channel.live;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Whether the settings stream is connected and has delivered the document.
+ */
+bool firebase_stream_settings_live(void) {
+#if CONFIG_FIREBASE_STREAM_SETTINGS
+    return settings_channel.live;
+#else
+    return false;
+#endif
+}
+
+/**
+ * @brief Get a snapshot of the stream counters.
+ */
+void firebase_stream_get_stats(firebase_stream_stats_t *out) {
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&stats_lock);
+}
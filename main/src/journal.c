@@ -0,0 +1,482 @@
+/**
+ * @file journal.c
+ * @brief Append-only flash journal for access logs that are waiting for upload.
+ *
+ * The journal partition is split into flash sectors and each sector into
+ * fixed 32-byte record slots. Records are written to consecutive slots; when
+ * the write position reaches a new sector, that sector is erased first, so
+ * the partition is used as a circular log and every sector wears evenly.
+ *
+ * Two record types exist:
+ * - ENTRY: one access record (UID bytes, epoch seconds + milliseconds, result code, reader).
+ * - ACK:   "every entry up to sequence N has been uploaded".
+ *
+ * Every record carries a CRC32 and a sequence number that increases with
+ * each write. At startup a sequential scan finds the newest sector, the
+ * write position, the last acknowledgement and the oldest pending entry.
+ */
+
+#include "journal.h"          // Our public header
+
+#include "esp_partition.h"    // Raw partition access
+#include "esp_rom_crc.h"      // CRC32 for record integrity
+#include "esp_log.h"          // ESP logging
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"  // Journal lock
+
+#include <string.h>           // For memory functions
+
+// Tag used for logging
+static const char *TAG = "journal";
+
+// Marks a written slot (an erased slot reads as 0xFF)
+#define JOURNAL_MAGIC 0xA5
+
+// Record types
+#define JOURNAL_TYPE_ENTRY 0x01
+#define JOURNAL_TYPE_ACK   0x02
+
+// Slots read per flash access during the recovery scan
+#define JOURNAL_SCAN_CHUNK_SLOTS 16
+
+/**
+ * @brief On-flash record layout (32 bytes, one slot).
+ */
+typedef struct {
+    uint8_t magic;                    // JOURNAL_MAGIC
+    uint8_t type;                     // JOURNAL_TYPE_ENTRY or JOURNAL_TYPE_ACK
+    uint8_t uid_len;                  // Valid bytes in uid (ENTRY)
+    uint8_t result;                   // Access result code (ENTRY)
+    uint32_t seq;                     // Write sequence number
+    uint32_t value;                   // ENTRY: epoch seconds, ACK: last acknowledged seq
+    uint8_t uid[JOURNAL_UID_MAX_LEN]; // UID bytes (ENTRY)
+    uint16_t epoch_ms;                // ENTRY: milliseconds part of the time (0xFFFF in older records)
+    uint8_t reader_id;                // ENTRY: reader index (0xFF in older records: reader 0)
+    uint8_t flags;                    // ENTRY: JOURNAL_FLAG_* (0xFF in older records: none)
+    uint8_t reserved[2];              // Written as 0xFF
+    uint32_t crc;                     // CRC32 of all preceding bytes
+} journal_record_t;
+
+_Static_assert(sizeof(journal_record_t) == 32, "journal record must be 32 bytes");
+
+#define JOURNAL_RECORD_SIZE sizeof(journal_record_t)
+
+// Journal partition and geometry
+static const esp_partition_t *partition = NULL;
+static uint32_t total_slots = 0;
+static uint32_t slots_per_sector = 0;
+
+// Runtime state, protected by lock
+static uint32_t head = 0;      // Slot of the next write
+static uint32_t tail = 0;      // Slot from which pending entries are searched
+static uint32_t next_seq = 1;  // Sequence number of the next record
+static uint32_t acked_seq = 0; // Every entry with seq <= acked_seq is uploaded
+static uint32_t boot_seq = 0;  // Sequence number of the first record written in this boot
+static journal_stats_t stats;
+
+static StaticSemaphore_t lock_struct;
+static SemaphoreHandle_t lock = NULL;
+
+/**
+ * @brief true if sequence number a was written after b (wrap-safe).
+ */
+static bool seq_after(uint32_t a, uint32_t b) {
+    return (int32_t)(a - b) > 0;
+}
+
+/**
+ * @brief CRC over every field except the CRC itself.
+ */
+static uint32_t record_crc(const journal_record_t *rec) {
+    return esp_rom_crc32_le(0, (const uint8_t *)rec, offsetof(journal_record_t, crc));
+}
+
+/**
+ * @brief true if every byte of the slot is still erased.
+ */
+static bool record_is_erased(const journal_record_t *rec) {
+    const uint8_t *bytes = (const uint8_t *)rec;
+    for (size_t i = 0; i < JOURNAL_RECORD_SIZE; i++) {
+        if (bytes[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief true if the slot holds a complete record with a matching CRC.
+ */
+static bool record_is_valid(const journal_record_t *rec) {
+    return rec->magic == JOURNAL_MAGIC && rec->crc == record_crc(rec);
+}
+
+/**
+ * @brief Read one slot.
+ */
+static esp_err_t read_slot(uint32_t slot, journal_record_t *rec) {
+    return esp_partition_read(partition, slot * JOURNAL_RECORD_SIZE, rec, JOURNAL_RECORD_SIZE);
+}
+
+/**
+ * @brief First slot of the sector following the one that contains slot.
+ */
+static uint32_t next_sector_start(uint32_t slot) {
+    return ((slot / slots_per_sector + 1) * slots_per_sector) % total_slots;
+}
+
+/**
+ * @brief true if the entry in rec still needs to be uploaded.
+ */
+static bool record_is_pending(const journal_record_t *rec) {
+    return rec->type == JOURNAL_TYPE_ENTRY && seq_after(rec->seq, acked_seq);
+}
+
+/**
+ * @brief Move the tail past the sector that is about to be erased.
+ *
+ * Pending entries in that sector are lost; they are counted in
+ * stats.overwritten.
+ *
+ * @param sector_start First slot of the sector being reclaimed.
+ */
+static void reclaim_sector(uint32_t sector_start) {
+    if (stats.pending == 0 || tail / slots_per_sector != sector_start / slots_per_sector) {
+        return;
+    }
+
+    uint32_t lost = 0;
+    journal_record_t rec;
+    for (uint32_t slot = tail; slot < sector_start + slots_per_sector; slot++) {
+        if (read_slot(slot, &rec) == ESP_OK && record_is_valid(&rec) && record_is_pending(&rec)) {
+            lost++;
+        }
+    }
+
+    stats.pending -= (lost < stats.pending) ? lost : stats.pending;
+    stats.overwritten += lost;
+    tail = next_sector_start(sector_start);
+
+    ESP_LOGW(TAG, "Journal full, %lu pending records overwritten", (unsigned long)lost);
+}
+
+/**
+ * @brief Write one record at the head, erasing the sector first if needed.
+ *
+ * Fills in the sequence number and CRC. Must be called with lock held.
+ */
+static esp_err_t write_record(journal_record_t *rec) {
+    if (head % slots_per_sector == 0) {
+        reclaim_sector(head);
+        esp_err_t err = esp_partition_erase_range(partition,
+                                                  (head / slots_per_sector) * partition->erase_size,
+                                                  partition->erase_size);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Sector erase failed: %s", esp_err_to_name(err));
+            return err;
+        }
+    }
+
+    rec->magic = JOURNAL_MAGIC;
+    rec->seq = next_seq;
+    memset(rec->reserved, 0xFF, sizeof(rec->reserved));
+    rec->crc = record_crc(rec);
+
+    esp_err_t err = esp_partition_write(partition, head * JOURNAL_RECORD_SIZE, rec, JOURNAL_RECORD_SIZE);
+
+    // Advance even on failure: a partially programmed slot cannot be rewritten
+    head = (head + 1) % total_slots;
+    next_seq++;
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Record write failed: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+/**
+ * @brief Sequentially scan the partition and rebuild the runtime state.
+ */
+static void recover(void) {
+    journal_record_t chunk[JOURNAL_SCAN_CHUNK_SLOTS];
+    uint32_t sectors = total_slots / slots_per_sector;
+
+    // Find the newest sector from the first record of every sector
+    int32_t newest = -1;
+    uint32_t newest_seq = 0;
+    for (uint32_t s = 0; s < sectors; s++) {
+        if (read_slot(s * slots_per_sector, &chunk[0]) != ESP_OK || !record_is_valid(&chunk[0])) {
+            continue;
+        }
+        if (newest < 0 || seq_after(chunk[0].seq, newest_seq)) {
+            newest = s;
+            newest_seq = chunk[0].seq;
+        }
+    }
+
+    if (newest < 0) {
+        head = tail = 0;
+        next_seq = 1;
+        acked_seq = 0;
+        return; // Empty journal
+    }
+
+    // Pass 1: oldest sector to newest, find the write position, last seq and last ack
+    uint32_t last_seq = newest_seq;
+    bool have_ack = false;
+    head = ((uint32_t)newest + 1) * slots_per_sector % total_slots;
+
+    for (uint32_t i = 1; i <= sectors; i++) {
+        uint32_t s = ((uint32_t)newest + i) % sectors;
+        for (uint32_t base = 0; base < slots_per_sector; base += JOURNAL_SCAN_CHUNK_SLOTS) {
+            uint32_t first = s * slots_per_sector + base;
+            if (esp_partition_read(partition, first * JOURNAL_RECORD_SIZE, chunk, sizeof(chunk)) != ESP_OK) {
+                continue;
+            }
+            for (uint32_t j = 0; j < JOURNAL_SCAN_CHUNK_SLOTS; j++) {
+                journal_record_t *rec = &chunk[j];
+                if (record_is_erased(rec)) {
+                    if (s == (uint32_t)newest) {
+                        head = first + j; // First free slot of the newest sector
+                        goto pass1_done;
+                    }
+                    base = slots_per_sector; // Rest of this sector is unused
+                    break;
+                }
+                if (!record_is_valid(rec)) {
+                    stats.corrupt++;
+                    continue;
+                }
+                if (seq_after(rec->seq, last_seq)) {
+                    last_seq = rec->seq;
+                }
+                if (rec->type == JOURNAL_TYPE_ACK && (!have_ack || seq_after(rec->value, acked_seq))) {
+                    acked_seq = rec->value;
+                    have_ack = true;
+                }
+            }
+        }
+    }
+pass1_done:
+    next_seq = last_seq + 1;
+    if (!have_ack) {
+        acked_seq = 0;
+    }
+
+    // Pass 2: find the oldest pending entry and count pending entries
+    tail = head;
+    bool found_tail = false;
+    for (uint32_t i = 1; i <= sectors; i++) {
+        uint32_t s = ((uint32_t)newest + i) % sectors;
+        for (uint32_t base = 0; base < slots_per_sector; base += JOURNAL_SCAN_CHUNK_SLOTS) {
+            uint32_t first = s * slots_per_sector + base;
+            if (esp_partition_read(partition, first * JOURNAL_RECORD_SIZE, chunk, sizeof(chunk)) != ESP_OK) {
+                continue;
+            }
+            for (uint32_t j = 0; j < JOURNAL_SCAN_CHUNK_SLOTS; j++) {
+                journal_record_t *rec = &chunk[j];
+                if (s == (uint32_t)newest && first + j == head) {
+                    goto pass2_done; // Reached the write position
+                }
+                if (record_is_erased(rec)) {
+                    base = slots_per_sector;
+                    break;
+                }
+                if (record_is_valid(rec) && record_is_pending(rec)) {
+                    if (!found_tail) {
+                        tail = first + j;
+                        found_tail = true;
+                    }
+                    stats.pending++;
+                }
+            }
+        }
+    }
+pass2_done:
+    return;
+}
+
+/**
+ * @brief Open the journal partition and recover its state.
+ */
+esp_err_t journal_init(void) {
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                         CONFIG_JOURNAL_PARTITION_LABEL);
+    if (partition == NULL) {
+        ESP_LOGW(TAG, "No '%s' partition, offline journal disabled", CONFIG_JOURNAL_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    lock = xSemaphoreCreateMutexStatic(&lock_struct);
+
+    slots_per_sector = partition->erase_size / JOURNAL_RECORD_SIZE;
+    total_slots = (partition->size / partition->erase_size) * slots_per_sector;
+    memset(&stats, 0, sizeof(stats)); // Counters start over with every scan
+    stats.capacity = total_slots;
+
+    recover();
+    boot_seq = next_seq;
+
+    ESP_LOGI(TAG, "Journal ready: %lu/%lu slots, %lu pending, next seq %lu",
+             (unsigned long)head, (unsigned long)total_slots,
+             (unsigned long)stats.pending, (unsigned long)next_seq);
+    return ESP_OK;
+}
+
+/**
+ * @brief Append one record to the journal.
+ */
+esp_err_t journal_append(journal_entry_t *entry) {
+    if (lock == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (entry->uid_len == 0 || entry->uid_len > JOURNAL_UID_MAX_LEN) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    journal_record_t rec = {
+        .type = JOURNAL_TYPE_ENTRY,
+        .uid_len = entry->uid_len,
+        .result = entry->result,
+        .value = (uint32_t)(entry->epoch_us / 1000000),
+        .epoch_ms = (uint16_t)((entry->epoch_us / 1000) % 1000),
+        .reader_id = entry->reader_id,
+        .flags = entry->flags,
+    };
+    memset(rec.uid, 0, sizeof(rec.uid));
+    memcpy(rec.uid, entry->uid, entry->uid_len);
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (stats.pending == 0) {
+        tail = head; // Nothing pending: the search can start at this record
+    }
+    entry->seq = next_seq;
+    esp_err_t err = write_record(&rec);
+    if (err == ESP_OK) {
+        stats.pending++;
+        stats.appended++;
+    }
+    xSemaphoreGive(lock);
+
+    return err;
+}
+
+/**
+ * @brief Read the oldest records that have not been acknowledged yet.
+ */
+esp_err_t journal_read_pending(journal_entry_t *entries, size_t max, size_t *count) {
+    *count = 0;
+    if (lock == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    uint32_t slot = tail;
+    journal_record_t rec;
+    for (uint32_t visited = 0; visited < total_slots && *count < max && *count < stats.pending; visited++) {
+        if (visited > 0 && slot == head) {
+            break; // Back at the write position (tail == head only when the journal is full)
+        }
+        if (read_slot(slot, &rec) != ESP_OK) {
+            break;
+        }
+        if (record_is_erased(&rec)) {
+            slot = next_sector_start(slot); // Unused rest of a sector
+            continue;
+        }
+        if (record_is_valid(&rec) && record_is_pending(&rec)) {
+            journal_entry_t *out = &entries[(*count)++];
+            out->seq = rec.seq;
+            out->epoch_us = (int64_t)rec.value * 1000000 +
+                            (rec.epoch_ms < 1000 ? (int64_t)rec.epoch_ms * 1000 : 0);
+            out->uid_len = rec.uid_len;
+            out->result = rec.result;
+            out->reader_id = (rec.reader_id == 0xFF) ? 0 : rec.reader_id;
+            out->flags = (rec.flags == 0xFF) ? 0 : rec.flags;
+            memcpy(out->uid, rec.uid, sizeof(out->uid));
+        }
+        slot = (slot + 1) % total_slots;
+    }
+
+    xSemaphoreGive(lock);
+    return ESP_OK;
+}
+
+/**
+ * @brief Mark every record up to and including last_seq as uploaded.
+ */
+esp_err_t journal_ack(uint32_t last_seq) {
+    if (lock == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+
+    // Advance the tail past every entry covered by this acknowledgement
+    uint32_t acked = 0;
+    journal_record_t rec;
+    for (uint32_t visited = 0; visited < total_slots && acked < stats.pending; visited++) {
+        if (visited > 0 && tail == head) {
+            break;
+        }
+        if (read_slot(tail, &rec) != ESP_OK) {
+            break;
+        }
+        if (record_is_erased(&rec)) {
+            tail = next_sector_start(tail);
+            continue;
+        }
+        if (record_is_valid(&rec) && rec.type == JOURNAL_TYPE_ENTRY && seq_after(rec.seq, last_seq)) {
+            break; // First entry not covered
+        }
+        if (record_is_valid(&rec) && record_is_pending(&rec)) {
+            acked++;
+        }
+        tail = (tail + 1) % total_slots;
+    }
+
+    acked_seq = last_seq;
+    stats.pending -= (acked < stats.pending) ? acked : stats.pending;
+    stats.acked += acked;
+
+    journal_record_t ack = {
+        .type = JOURNAL_TYPE_ACK,
+        .value = last_seq,
+        .epoch_ms = 0xFFFF,
+        .reader_id = 0xFF,
+        .flags = 0xFF,
+    };
+    memset(ack.uid, 0xFF, sizeof(ack.uid));
+    esp_err_t err = write_record(&ack);
+
+    xSemaphoreGive(lock);
+    return err;
+}
+
+/**
+ * @brief Number of records waiting to be uploaded.
+ */
+uint32_t journal_pending_count(void) {
+    return lock ? stats.pending : 0;
+}
+
+/**
+ * @brief Check whether a record was written since this boot.
+ */
+bool journal_seq_this_boot(uint32_t seq) {
+    return lock != NULL && !seq_after(boot_seq, seq);
+}
+
+/**
+ * @brief Get a snapshot of the journal counters.
+ */
+void journal_get_stats(journal_stats_t *out) {
+    if (lock == NULL) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    xSemaphoreTake(lock, portMAX_DELAY);
+    *out = stats;
+    xSemaphoreGive(lock);
+}
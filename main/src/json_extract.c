@@ -0,0 +1,232 @@
+/**
+ * @file json_extract.c
+ * @brief Streaming extraction of top-level fields from a JSON object.
+ *
+ * A character-level state machine: it tracks string/escape state and the
+ * nesting depth, collects top-level member names into a small buffer and
+ * copies the value of a matching member straight into its output buffer.
+ */
+
+#include "json_extract.h" // Our public header
+
+#include <string.h>       // For memcmp(), strlen()
+
+/**
+ * @brief Append one character to the value of the current field.
+ */
+static void put_value(json_extractor_t *x, char c) {
+    json_field_t *f = x->current;
+    if (f == NULL) {
+        return;
+    }
+    if (x->out_len + 1 < f->cap) {
+        f->out[x->out_len++] = c;
+        f->out[x->out_len] = '\0';
+    } else {
+        f->truncated = true;
+    }
+}
+
+/**
+ * @brief Append one character of a string, to the key or to the value.
+ */
+static void put_string_char(json_extractor_t *x, char c) {
+    if (x->in_key) {
+        if (x->key_len < JSON_EXTRACT_KEY_MAX_LEN) {
+            x->key[x->key_len++] = c;
+        }
+        // A name that fills the buffer is treated as too long and never matches
+    } else {
+        put_value(x, c);
+    }
+}
+
+/**
+ * @brief Start receiving the value of the member named by x->key.
+ */
+static void select_field(json_extractor_t *x) {
+    x->current = NULL;
+    if (x->key_len >= JSON_EXTRACT_KEY_MAX_LEN) {
+        return;
+    }
+    for (size_t i = 0; i < x->count; i++) {
+        json_field_t *f = &x->fields[i];
+        if (strlen(f->key) == x->key_len && memcmp(f->key, x->key, x->key_len) == 0) {
+            x->current = f;
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Handle one character inside a string.
+ */
+static void feed_string(json_extractor_t *x, char c) {
+    if (x->unicode_left > 0) {
+        unsigned digit;
+        if (c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if (c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if (c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            x->error = true;
+            return;
+        }
+        x->unicode_value = (x->unicode_value << 4) | digit;
+        if (--x->unicode_left == 0) {
+            put_string_char(x, x->unicode_value < 0x80 ? (char)x->unicode_value : '?');
+        }
+        return;
+    }
+
+    if (x->escape) {
+        x->escape = false;
+        switch (c) {
+            case 'b': put_string_char(x, '\b'); break;
+            case 'f': put_string_char(x, '\f'); break;
+            case 'n': put_string_char(x, '\n'); break;
+            case 'r': put_string_char(x, '\r'); break;
+            case 't': put_string_char(x, '\t'); break;
+            case 'u':
+                x->unicode_left = 4;
+                x->unicode_value = 0;
+                break;
+            default:  put_string_char(x, c); break; // \" \\ \/
+        }
+        return;
+    }
+
+    if (c == '\\') {
+        x->escape = true;
+    } else if (c == '"') {
+        x->in_string = false;
+        if (x->in_key) {
+            x->in_key = false;
+            select_field(x);
+        } else if (x->depth == 1 && x->current != NULL) {
+            x->current->found = true;
+            x->current = NULL;
+        }
+    } else {
+        put_string_char(x, c);
+    }
+}
+
+/**
+ * @brief End a top-level number or literal value.
+ */
+static void end_primitive(json_extractor_t *x) {
+    if (x->in_primitive) {
+        x->in_primitive = false;
+        if (x->current != NULL) {
+            x->current->found = true;
+        }
+    }
+    x->current = NULL;
+}
+
+/**
+ * @brief Handle one character outside strings.
+ */
+static void feed_structure(json_extractor_t *x, char c) {
+    switch (c) {
+        case ' ': case '\t': case '\r': case '\n':
+            if (x->in_primitive) {
+                end_primitive(x);
+            }
+            return;
+        case '"':
+            x->in_string = true;
+            x->in_key = (x->depth == 1 && x->expect_key);
+            x->key_len = 0;
+            x->out_len = 0;
+            if (!x->in_key && x->depth != 1) {
+                x->current = NULL; // Strings inside nested values are skipped
+            }
+            return;
+        case '{':
+        case '[':
+            if (x->depth == 0 && c != '{') {
+                x->error = true;
+                return;
+            }
+            x->depth++;
+            x->current = NULL; // Nested values are not extracted
+            if (x->depth == 1) {
+                x->expect_key = true;
+            }
+            return;
+        case '}':
+        case ']':
+            if (x->depth == 0) {
+                x->error = true;
+                return;
+            }
+            if (x->depth == 1) {
+                end_primitive(x);
+                x->done = true;
+            }
+            x->depth--;
+            return;
+        case ':':
+            if (x->depth == 1) {
+                x->expect_key = false;
+            }
+            return;
+        case ',':
+            if (x->depth == 1) {
+                end_primitive(x);
+                x->expect_key = true;
+            }
+            return;
+        default:
+            if (x->depth == 0) {
+                x->error = true;
+            } else if (x->depth == 1 && !x->expect_key) {
+                if (!x->in_primitive) {
+                    x->in_primitive = true;
+                    x->out_len = 0;
+                }
+                put_value(x, c);
+            }
+            return;
+    }
+}
+
+/**
+ * @brief Prepare an extractor.
+ */
+void json_extract_init(json_extractor_t *x, json_field_t *fields, size_t count) {
+    memset(x, 0, sizeof(*x));
+    x->fields = fields;
+    x->count = count;
+    for (size_t i = 0; i < count; i++) {
+        fields[i].found = false;
+        fields[i].truncated = false;
+        if (fields[i].cap > 0) {
+            fields[i].out[0] = '\0';
+        }
+    }
+}
+
+/**
+ * @brief Feed the next chunk of the document.
+ */
+void json_extract_feed(json_extractor_t *x, const char *data, size_t len) {
+    for (size_t i = 0; i < len && !x->error && !x->done; i++) {
+        if (x->in_string) {
+            feed_string(x, data[i]);
+        } else {
+            feed_structure(x, data[i]);
+        }
+    }
+}
+
+/**
+ * @brief Check whether a complete top-level object was read.
+ */
+bool json_extract_complete(const json_extractor_t *x) {
+    return x->done && !x->error;
+}
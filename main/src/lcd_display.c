@@ -1,18 +1,96 @@
+/**
+ * @file lcd_display.c
+ * @brief ST7735 driver: queued DMA transfers, windowed drawing and dirty tiles.
+ *
+ * All drawing goes through a ring of queued SPI transactions (DC is driven
+ * from the pre-transfer callback). For each 8x8 tile of the panel the driver
+ * keeps a hash of the last write to it: the covered part of the tile plus
+ * the pixels written there. If a draw call would repeat that exact write,
+ * the tile is not sent again. Dirty tiles are merged into spans, and each
+ * span gets its own CASET/RASET window.
+ */
+
 #include "lcd_display.h"
 
+#include "esp_attr.h"       // For IRAM_ATTR, DMA_ATTR
+#include "esp_heap_caps.h"  // DMA-capable pixel buffer
+#include "esp_log.h"        // ESP logging
+#include "esp_timer.h"      // Fill timing
+#include "settings.h"       // SPI clock
+#include <string.h>         // For memset()
+
+// Tag used for logging
+static const char *TAG = "lcd";
+
+// ST7735 commands used by the redraw path
+#define ST7735_CASET 0x2A // Column address set
+#define ST7735_RASET 0x2B // Row address set
+#define ST7735_RAMWR 0x2C // Memory write
+
+// DC level for a transaction, passed through spi_transaction_t.user
+#define LCD_DC_CMD  ((void *)0)
+#define LCD_DC_DATA ((void *)1)
+
+// Pixels per DMA transaction and transactions kept in flight
+#define LCD_CHUNK_PIXELS (LCD_H_RES * CONFIG_LCD_DMA_CHUNK_LINES)
+#define LCD_QUEUE_DEPTH  CONFIG_LCD_SPI_QUEUE_DEPTH
+
+// Dirty tracking granularity
+#define LCD_TILE_SIZE  8
+#define LCD_TILES_X    (LCD_H_RES / LCD_TILE_SIZE)
+#define LCD_TILES_Y    (LCD_V_RES / LCD_TILE_SIZE)
+#define LCD_TILE_UNKNOWN 0 // Never drawn
+
+_Static_assert(LCD_H_RES % LCD_TILE_SIZE == 0 && LCD_V_RES % LCD_TILE_SIZE == 0,
+               "resolution must be a multiple of the tile size");
+
 // SPI device handle for the LCD
 static spi_device_handle_t spi;
 
+// Two DMA-capable buffers of one chunk each (big-endian RGB565). Buffer 0 also
+// caches a solid color for fills; blits alternate between both.
+static uint16_t *dma_bufs[2] = { NULL, NULL };
+#if CONFIG_MEM_STATIC_POOLS
+// Reserved at link time instead of on the heap (internal RAM is DMA-capable)
+DMA_ATTR static uint16_t dma_buf_storage[2][LCD_CHUNK_PIXELS];
+#endif
+static uint32_t dma_buf_seq[2] = { 0, 0 }; // Last transaction reading each buffer
+static uint16_t dma_buf_color;
+static bool dma_buf_valid = false;
+static int blit_buf = 0;
+
+// Ring of queued transactions; results come back in queue order
+static spi_transaction_t trans_pool[LCD_QUEUE_DEPTH];
+static int trans_next = 0;
+static uint32_t trans_submitted = 0;
+static uint32_t trans_completed = 0;
+
+// Hash of the last write to every tile (area within the tile + pixels)
+static uint32_t tile_hash[LCD_TILES_Y][LCD_TILES_X];
+
+// Counters and the duration of the last fill_screen() call
+static lcd_stats_t stats;
+
+/**
+ * @brief SPI pre-transfer callback: drive DC from the transaction's user field.
+ *
+ * Runs in the SPI ISR right before each transaction starts, so commands and
+ * data can be queued back to back without waiting in between.
+ */
+static void IRAM_ATTR lcd_spi_pre_transfer_cb(spi_transaction_t *t) {
+    gpio_set_level(PIN_NUM_DC, (int)(intptr_t)t->user);
+}
+
 /**
  * @brief Send a command byte to the LCD.
  *
  * @param cmd The command byte to send.
  */
 static void lcd_cmd(const uint8_t cmd) {
-    gpio_set_level(PIN_NUM_DC, 0); // Set DC low to indicate command mode
     spi_transaction_t t = {
         .length = 8,               // 8 bits = 1 byte
         .tx_buffer = &cmd,          // Command data
+        .user = LCD_DC_CMD,         // DC low: command mode
     };
     spi_device_transmit(spi, &t);   // Transmit command
 }
@@ -24,15 +102,297 @@ static void lcd_cmd(const uint8_t cmd) {
  * @param len Number of bytes to send.
  */
 static void lcd_data(const uint8_t *data, int len) {
-
-    gpio_set_level(PIN_NUM_DC, 1); // Set DC high to indicate data mode
     spi_transaction_t t = {
         .length = len * 8,           // Total length in bits
         .tx_buffer = data,           // Data buffer
+        .user = LCD_DC_DATA,         // DC high: data mode
     };
     spi_device_transmit(spi, &t);    // Transmit data
 }
 
+/**
+ * @brief Collect the result of the oldest queued transaction.
+ */
+static void trans_complete_one(void) {
+    spi_transaction_t *done;
+    spi_device_get_trans_result(spi, &done, portMAX_DELAY);
+    trans_completed++;
+}
+
+/**
+ * @brief Get a free transaction from the ring, waiting for the oldest one if all are queued.
+ */
+static spi_transaction_t *trans_get(void) {
+    if (trans_submitted - trans_completed == LCD_QUEUE_DEPTH) {
+        trans_complete_one();
+    }
+
+    spi_transaction_t *t = &trans_pool[trans_next];
+    trans_next = (trans_next + 1) % LCD_QUEUE_DEPTH;
+    memset(t, 0, sizeof(*t));
+    return t;
+}
+
+/**
+ * @brief Queue a transaction without waiting for it to complete.
+ */
+static void trans_submit(spi_transaction_t *t) {
+    spi_device_queue_trans(spi, t, portMAX_DELAY);
+    trans_submitted++;
+    stats.bytes_sent += t->length / 8;
+}
+
+/**
+ * @brief Wait until every queued transaction has completed.
+ */
+static void trans_wait_all(void) {
+    while (trans_completed != trans_submitted) {
+        trans_complete_one();
+    }
+}
+
+/**
+ * @brief Wait until the DMA engine no longer reads a buffer, so it can be rewritten.
+ */
+static void wait_buffer(int buf) {
+    while ((int32_t)(dma_buf_seq[buf] - trans_completed) > 0) {
+        trans_complete_one();
+    }
+}
+
+/**
+ * @brief Queue a command byte followed by up to 4 parameter bytes.
+ */
+static void queue_cmd(uint8_t cmd, const uint8_t *params, int len) {
+    spi_transaction_t *t = trans_get();
+    t->flags = SPI_TRANS_USE_TXDATA;
+    t->length = 8;
+    t->tx_data[0] = cmd;
+    t->user = LCD_DC_CMD;
+    trans_submit(t);
+
+    if (len > 0) {
+        t = trans_get();
+        t->flags = SPI_TRANS_USE_TXDATA;
+        t->length = len * 8;
+        memcpy(t->tx_data, params, len);
+        t->user = LCD_DC_DATA;
+        trans_submit(t);
+    }
+}
+
+/**
+ * @brief Queue CASET/RASET/RAMWR for a window (inclusive coordinates).
+ */
+static void queue_window(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) {
+    const uint8_t col[] = { x0 >> 8, x0 & 0xFF, x1 >> 8, x1 & 0xFF };
+    const uint8_t row[] = { y0 >> 8, y0 & 0xFF, y1 >> 8, y1 & 0xFF };
+
+    queue_cmd(ST7735_CASET, col, sizeof(col));
+    queue_cmd(ST7735_RASET, row, sizeof(row));
+    queue_cmd(ST7735_RAMWR, NULL, 0);
+    stats.windows++;
+}
+
+/**
+ * @brief Queue pixel data from one of the DMA buffers.
+ */
+static void queue_pixels(int buf, size_t count) {
+    spi_transaction_t *t = trans_get();
+    t->length = count * 16; // 16 bits per pixel
+    t->tx_buffer = dma_bufs[buf];
+    t->user = LCD_DC_DATA;
+    trans_submit(t);
+    dma_buf_seq[buf] = trans_submitted;
+}
+
+/**
+ * @brief Make DMA buffer 0 hold one chunk of a solid color.
+ */
+static void prepare_solid(uint16_t color) {
+    if (dma_buf_valid && dma_buf_color == color) {
+        return;
+    }
+    wait_buffer(0);
+
+    // Swap bytes for LCD endian format (little-endian to big-endian)
+    uint16_t color_swapped = (color >> 8) | (color << 8);
+    for (int i = 0; i < LCD_CHUNK_PIXELS; i++) {
+        dma_bufs[0][i] = color_swapped;
+    }
+    dma_buf_color = color;
+    dma_buf_valid = true;
+}
+
+/**
+ * @brief Send a window of pixels: a solid color (src == NULL) or rows of src.
+ *
+ * @param x, y, w, h Window on the panel (already clipped).
+ * @param src        First source pixel of the window, or NULL.
+ * @param stride     Source pixels per row.
+ * @param color      Color used when src is NULL.
+ */
+static void send_window(int x, int y, int w, int h, const uint16_t *src, int stride, uint16_t color) {
+    queue_window(x, y, x + w - 1, y + h - 1);
+
+    if (src == NULL) {
+        prepare_solid(color);
+        size_t remaining = (size_t)w * h;
+        while (remaining > 0) {
+            size_t chunk = remaining > LCD_CHUNK_PIXELS ? LCD_CHUNK_PIXELS : remaining;
+            queue_pixels(0, chunk);
+            remaining -= chunk;
+        }
+        return;
+    }
+
+    // Copy (and byte-swap) whole rows into alternating buffers while the previous one is sent
+    int rows_per_chunk = LCD_CHUNK_PIXELS / w;
+    for (int row = 0; row < h; row += rows_per_chunk) {
+        int rows = (h - row < rows_per_chunk) ? h - row : rows_per_chunk;
+        int buf = blit_buf;
+        blit_buf ^= 1;
+
+        wait_buffer(buf);
+        if (buf == 0) {
+            dma_buf_valid = false;
+        }
+
+        uint16_t *dst = dma_bufs[buf];
+        for (int r = 0; r < rows; r++) {
+            const uint16_t *line = src + (size_t)(row + r) * stride;
+            for (int c = 0; c < w; c++) {
+                *dst++ = (line[c] >> 8) | (line[c] << 8);
+            }
+        }
+        queue_pixels(buf, (size_t)rows * w);
+    }
+}
+
+/**
+ * @brief FNV-1a hash of a write to (part of) one tile (never LCD_TILE_UNKNOWN).
+ *
+ * The area is part of the hash: a matching hash means the last write to the
+ * tile was this same write, so those pixels are still on the panel.
+ *
+ * @param src        First pixel of the area, or NULL for a solid color.
+ * @param stride     Source pixels per row.
+ * @param col, row   Top-left of the area relative to the tile.
+ * @param w, h       Size of the area.
+ */
+static uint32_t hash_tile(const uint16_t *src, int stride, uint16_t color, int col, int row, int w, int h) {
+    uint32_t hash = 2166136261u;
+    hash = (hash ^ (uint32_t)(col | row << 4 | (w - 1) << 8 | (h - 1) << 12)) * 16777619u;
+    for (int r = 0; r < h; r++) {
+        for (int c = 0; c < w; c++) {
+            uint16_t px = src ? src[r * stride + c] : color;
+            hash = (hash ^ (px & 0xFF)) * 16777619u;
+            hash = (hash ^ (px >> 8)) * 16777619u;
+        }
+    }
+    return hash == LCD_TILE_UNKNOWN ? 1 : hash;
+}
+
+/**
+ * @brief Pending window built from dirty tiles (merged across tile rows).
+ */
+typedef struct {
+    int x0, x1; // Columns, x1 exclusive
+    int y0, y1; // Rows, y1 exclusive
+} span_t;
+
+/**
+ * @brief Send a pending span of the rectangle being drawn.
+ *
+ * @param x, y Top-left corner of the rectangle src belongs to.
+ */
+static void send_span(const span_t *span, int x, int y, const uint16_t *src, int stride, uint16_t color) {
+    const uint16_t *first = src ? src + (size_t)(span->y0 - y) * stride + (span->x0 - x) : NULL;
+    send_window(span->x0, span->y0, span->x1 - span->x0, span->y1 - span->y0, first, stride, color);
+}
+
+/**
+ * @brief Draw a clipped rectangle, sending only tiles whose content changes.
+ *
+ * In every tile row the dirty tiles form one span (first to last dirty
+ * tile). Spans with the same columns in consecutive tile rows are merged
+ * into one window.
+ *
+ * @param src    Source pixels for the rectangle (row stride = stride), or NULL.
+ * @param color  Color used when src is NULL.
+ */
+static void draw_dirty(int x, int y, int w, int h, const uint16_t *src, int stride, uint16_t color) {
+    span_t pending = { 0, 0, 0, 0 }; // Empty while x1 == x0
+
+    for (int ty = y / LCD_TILE_SIZE; ty <= (y + h - 1) / LCD_TILE_SIZE; ty++) {
+        int row0 = ty * LCD_TILE_SIZE < y ? y : ty * LCD_TILE_SIZE;
+        int row1 = (ty + 1) * LCD_TILE_SIZE > y + h ? y + h : (ty + 1) * LCD_TILE_SIZE;
+        span_t span = { -1, -1, row0, row1 };
+
+        for (int tx = x / LCD_TILE_SIZE; tx <= (x + w - 1) / LCD_TILE_SIZE; tx++) {
+            int col0 = tx * LCD_TILE_SIZE < x ? x : tx * LCD_TILE_SIZE;
+            int col1 = (tx + 1) * LCD_TILE_SIZE > x + w ? x + w : (tx + 1) * LCD_TILE_SIZE;
+
+            // Skip the tile if its last write was exactly this one
+            const uint16_t *area = src ? src + (size_t)(row0 - y) * stride + (col0 - x) : NULL;
+            uint32_t hash = hash_tile(area, stride, color, col0 % LCD_TILE_SIZE, row0 % LCD_TILE_SIZE,
+                                      col1 - col0, row1 - row0);
+            bool dirty = (tile_hash[ty][tx] != hash);
+            tile_hash[ty][tx] = hash;
+
+            if (!dirty) {
+                stats.tiles_skipped++;
+            } else {
+                if (span.x0 < 0) {
+                    span.x0 = col0;
+                }
+                span.x1 = col1;
+            }
+        }
+
+        if (span.x0 < 0) {
+            continue; // Nothing changed in this tile row
+        }
+
+        if (pending.x1 > pending.x0 && pending.x0 == span.x0 && pending.x1 == span.x1 &&
+            pending.y1 == span.y0) {
+            pending.y1 = span.y1; // Same columns: extend the window downwards
+        } else {
+            if (pending.x1 > pending.x0) {
+                send_span(&pending, x, y, src, stride, color);
+            }
+            pending = span;
+        }
+    }
+
+    if (pending.x1 > pending.x0) {
+        send_span(&pending, x, y, src, stride, color);
+    }
+}
+
+/**
+ * @brief Clip a rectangle to the panel.
+ *
+ * @param[out] dx, dy Offset of the clipped rectangle inside the original one.
+ *
+ * @return false if nothing is left to draw.
+ */
+static bool clip_rect(int *x, int *y, int *w, int *h, int *dx, int *dy) {
+    *dx = (*x < 0) ? -*x : 0;
+    *dy = (*y < 0) ? -*y : 0;
+    *x += *dx;
+    *y += *dy;
+    *w -= *dx;
+    *h -= *dy;
+    if (*x + *w > LCD_H_RES) {
+        *w = LCD_H_RES - *x;
+    }
+    if (*y + *h > LCD_V_RES) {
+        *h = LCD_V_RES - *y;
+    }
+    return *w > 0 && *h > 0;
+}
+
 /**
  * @brief Initialize the ST7735 LCD display controller.
  *
@@ -100,14 +460,16 @@ void lcd_init(void) {
         .quadwp_io_num = -1,       // Not using Quad SPI
         .quadhd_io_num = -1,       // Not using Quad SPI
     };
+    buscfg.max_transfer_sz = LCD_CHUNK_PIXELS * sizeof(uint16_t); // Largest pixel transaction
     spi_bus_initialize(LCD_HOST, &buscfg, SPI_DMA_CH_AUTO);
 
     // Configure SPI device for the LCD
     spi_device_interface_config_t devcfg = {
-        .clock_speed_hz = 26 * 1000 * 1000, // 26 MHz
+        .clock_speed_hz = (int)settings_get()->lcd_spi_hz, // 26 MHz by default
         .mode = 0,                          // SPI mode 0
         .spics_io_num = PIN_NUM_CS,         // Chip select pin
-        .queue_size = 7,                    // Transaction queue size
+        .queue_size = LCD_QUEUE_DEPTH,      // Transactions in flight
+        .pre_cb = lcd_spi_pre_transfer_cb,  // Drives DC per transaction
     };
     spi_bus_add_device(LCD_HOST, &devcfg, &spi);
 
@@ -117,6 +479,18 @@ void lcd_init(void) {
     gpio_reset_pin(PIN_NUM_RST);
     gpio_set_direction(PIN_NUM_RST, GPIO_MODE_OUTPUT);
 
+    // Pixel buffers for the DMA engine (must be in internal, DMA-capable RAM)
+    for (int i = 0; i < 2; i++) {
+#if CONFIG_MEM_STATIC_POOLS
+        dma_bufs[i] = dma_buf_storage[i];
+#else
+        dma_bufs[i] = heap_caps_malloc(LCD_CHUNK_PIXELS * sizeof(uint16_t), MALLOC_CAP_DMA);
+        if (dma_bufs[i] == NULL) {
+            ESP_LOGE(TAG, "Failed to allocate %u-byte DMA buffer", (unsigned)(LCD_CHUNK_PIXELS * sizeof(uint16_t)));
+        }
+#endif
+    }
+
     // Initialize LCD controller
     st7735_init();
 }
@@ -134,59 +508,194 @@ uint16_t get_color_for_card(CardColor color) {
 /**
  * @brief Fill the entire LCD screen with a single color.
  *
+ * The address window is set once for the whole frame, then the same DMA
+ * buffer is queued repeatedly. While the SPI peripheral shifts one chunk
+ * out, the next ones are already queued, so the bus never waits on the CPU.
+ * Nothing is sent if the screen already shows exactly this color.
+ *
  * @param color 16-bit RGB565 color to fill the screen with.
  */
 void fill_screen(uint16_t color) {
-    
-    // Swap bytes for LCD endian format (little-endian to big-endian)
-    uint16_t color_swapped = (color >> 8) | (color << 8);
+    if (dma_bufs[0] == NULL || dma_bufs[1] == NULL) {
+        return;
+    }
+
+    int64_t start = esp_timer_get_time();
+
+    uint32_t hash = hash_tile(NULL, 0, color, 0, 0, LCD_TILE_SIZE, LCD_TILE_SIZE);
+    bool unchanged = true;
+    for (int ty = 0; ty < LCD_TILES_Y; ty++) {
+        for (int tx = 0; tx < LCD_TILES_X; tx++) {
+            unchanged &= (tile_hash[ty][tx] == hash);
+            tile_hash[ty][tx] = hash;
+        }
+    }
+    if (unchanged) {
+        stats.tiles_skipped += LCD_TILES_X * LCD_TILES_Y;
+        return;
+    }
+
+    // One CASET/RASET/RAMWR for the full frame
+    send_window(0, 0, LCD_H_RES, LCD_V_RES, NULL, 0, color);
+    trans_wait_all();
+
+    stats.fills++;
+    stats.last_fill_us = (uint32_t)(esp_timer_get_time() - start);
+    ESP_LOGD(TAG, "Full-screen fill took %lu us", (unsigned long)stats.last_fill_us);
+}
+
+/**
+ * @brief Fill a rectangle with a solid color.
+ *
+ * @param x, y  Top-left corner (clipped to the panel).
+ * @param w, h  Size in pixels.
+ * @param color RGB565 color.
+ */
+void lcd_draw_rect(int x, int y, int w, int h, uint16_t color) {
+    int dx, dy;
+    if (dma_bufs[0] == NULL || dma_bufs[1] == NULL || !clip_rect(&x, &y, &w, &h, &dx, &dy)) {
+        return;
+    }
+
+    draw_dirty(x, y, w, h, NULL, 0, color);
+    trans_wait_all();
+}
+
+/**
+ * @brief Copy a block of RGB565 pixels to the panel.
+ *
+ * @param x, y Top-left corner (clipped to the panel).
+ * @param w, h Size of buf in pixels.
+ * @param buf  w * h pixels, row by row, in native RGB565 (any memory).
+ */
+void lcd_blit(int x, int y, int w, int h, const uint16_t *buf) {
+    int stride = w;
+    int dx, dy;
+    if (buf == NULL || dma_bufs[0] == NULL || dma_bufs[1] == NULL ||
+        !clip_rect(&x, &y, &w, &h, &dx, &dy)) {
+        return;
+    }
 
-    // Static buffer to hold one chunk of pixel data
-    static uint16_t color_buf[LCD_H_RES * BUF_HEIGHT];
+    draw_dirty(x, y, w, h, buf + (size_t)dy * stride + dx, stride, 0);
+    trans_wait_all();
+}
 
-    // Fill the buffer with the chosen color
-    for (int i = 0; i < LCD_H_RES * BUF_HEIGHT; i++) {
-        color_buf[i] = color_swapped;
+/**
+ * @brief Draw a compressed image, decoding it straight into the SPI DMA buffers.
+ *
+ * Runs are expanded into alternating DMA buffers; while one chunk is being
+ * sent, the next one is decoded. The tiles covered by the image are tagged
+ * with the image and position, so redrawing the same screen is free.
+ */
+esp_err_t lcd_draw_image(int x, int y, const lcd_image_t *img) {
+    if (dma_bufs[0] == NULL || dma_bufs[1] == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (img == NULL || img->width == 0 || img->height == 0 || x < 0 || y < 0 ||
+        x + img->width > LCD_H_RES || y + img->height > LCD_V_RES) {
+        return ESP_ERR_INVALID_ARG;
     }
 
-    // Send buffer chunk by chunk to fill the screen
-    for (int y = 0; y < LCD_V_RES; y += BUF_HEIGHT) {
-        int draw_height = (y + BUF_HEIGHT <= LCD_V_RES) ? BUF_HEIGHT : (LCD_V_RES - y);
+    // Tag for "this image at this position"; skip the draw if every tile already has it
+    uint32_t tag = 2166136261u;
+    tag = (tag ^ (uint32_t)(uintptr_t)img) * 16777619u;
+    tag = (tag ^ (uint32_t)(x | y << 8)) * 16777619u;
+    tag = (tag == LCD_TILE_UNKNOWN) ? 1 : tag;
 
-        // Set column address range
-        uint8_t col_data[] = {0x00, 0x00, 0x00, LCD_H_RES - 1};
-        lcd_cmd(0x2A);
-        lcd_data(col_data, 4);
+    bool unchanged = true;
+    for (int ty = y / LCD_TILE_SIZE; ty <= (y + img->height - 1) / LCD_TILE_SIZE; ty++) {
+        for (int tx = x / LCD_TILE_SIZE; tx <= (x + img->width - 1) / LCD_TILE_SIZE; tx++) {
+            unchanged &= (tile_hash[ty][tx] == tag);
+            tile_hash[ty][tx] = tag;
+        }
+    }
+    if (unchanged) {
+        return ESP_OK;
+    }
 
-        // Set row address range
-        uint8_t row_data[] = {
-            (uint8_t)(y >> 8), (uint8_t)y,
-            (uint8_t)((y + draw_height - 1) >> 8), (uint8_t)(y + draw_height - 1)
-        };
-        lcd_cmd(0x2B);
-        lcd_data(row_data, 4);
+    queue_window(x, y, x + img->width - 1, y + img->height - 1);
 
-        // Write memory command
-        lcd_cmd(0x2C);
+    const uint8_t *p = img->data;
+    const uint8_t *end = img->data + img->data_len;
+    size_t remaining = (size_t)img->width * img->height;
+    uint32_t run = 0;
+    uint16_t color = 0;
+    esp_err_t err = ESP_OK;
 
-        gpio_set_level(PIN_NUM_DC, 1); // Data mode
+    while (remaining > 0) {
+        int buf = blit_buf;
+        blit_buf ^= 1;
+        wait_buffer(buf);
+        if (buf == 0) {
+            dma_buf_valid = false;
+        }
+
+        size_t chunk = remaining > LCD_CHUNK_PIXELS ? LCD_CHUNK_PIXELS : remaining;
+        uint16_t *dst = dma_bufs[buf];
+        size_t filled = 0;
 
-        int pixels_to_send = LCD_H_RES * draw_height;
-        int max_pixels_per_transfer = 1024; // Send in chunks to avoid SPI buffer overflow
+        while (filled < chunk) {
+            if (run == 0) {
+                if (p == end || (*p >> 4) >= img->palette_size) {
+                    err = ESP_ERR_INVALID_ARG;
+                    break;
+                }
+                color = img->palette[*p >> 4];
+                run = *p++ & 0x0F;
+                if (run == 0) {
+                    // Long run: 16 + LEB128 length
+                    uint32_t extra = 0;
+                    int shift = 0;
+                    do {
+                        if (p == end || shift > 21) {
+                            err = ESP_ERR_INVALID_ARG;
+                            break;
+                        }
+                        extra |= (uint32_t)(*p & 0x7F) << shift;
+                        shift += 7;
+                    } while (*p++ & 0x80);
+                    run = 16 + extra;
+                }
+                if (err != ESP_OK) {
+                    break;
+                }
+            }
 
-        int sent = 0;
-        while (sent < pixels_to_send) {
-            int chunk_size = (pixels_to_send - sent) > max_pixels_per_transfer
-                             ? max_pixels_per_transfer
-                             : (pixels_to_send - sent);
+            size_t n = (run < chunk - filled) ? run : chunk - filled;
+            for (size_t i = 0; i < n; i++) {
+                dst[filled + i] = color;
+            }
+            filled += n;
+            run -= n;
+        }
+
+        if (err != ESP_OK) {
+            // A new window is set before the next draw, so a short write is harmless
+            if (filled > 0) {
+                queue_pixels(buf, filled);
+            }
+            break;
+        }
+        queue_pixels(buf, chunk);
+        remaining -= chunk;
+    }
+    trans_wait_all();
 
-            spi_transaction_t t = {
-                .length = chunk_size * 16,        // 16 bits per pixel
-                .tx_buffer = &color_buf[sent],    // Pointer to start of the chunk
-                .flags = 0,
-            };
-            spi_device_transmit(spi, &t);         // Send chunk
-            sent += chunk_size;
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Corrupt image data at %p", img);
+        // Forget the tags so the next draw repaints these tiles
+        for (int ty = y / LCD_TILE_SIZE; ty <= (y + img->height - 1) / LCD_TILE_SIZE; ty++) {
+            for (int tx = x / LCD_TILE_SIZE; tx <= (x + img->width - 1) / LCD_TILE_SIZE; tx++) {
+                tile_hash[ty][tx] = LCD_TILE_UNKNOWN;
+            }
         }
     }
+    return err;
+}
+
+/**
+ * @brief Get the drawing counters.
+ */
+void lcd_get_stats(lcd_stats_t *out) {
+    *out = stats;
 }
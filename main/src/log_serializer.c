@@ -0,0 +1,190 @@
+/**
+ * @file log_serializer.c
+ * @brief Allocation-free JSON encoding of access log records.
+ */
+
+#include "log_serializer.h" // Our public header
+
+#include <ctype.h>          // For isxdigit()
+#include <stdint.h>
+#include <string.h>         // For memcpy(), strlen()
+
+/**
+ * @brief Append raw bytes.
+ */
+static void put_raw(log_writer_t *w, const char *s, size_t n) {
+    if (w->overflow) {
+        return;
+    }
+    if (n >= w->cap - w->len) {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buf + w->len, s, n);
+    w->len += n;
+    w->buf[w->len] = '\0';
+}
+
+/**
+ * @brief Append a NUL-terminated literal.
+ */
+static void put_str(log_writer_t *w, const char *s) {
+    put_raw(w, s, strlen(s));
+}
+
+/**
+ * @brief Append an unsigned decimal number.
+ */
+static void put_uint(log_writer_t *w, uint32_t value) {
+    char digits[10];
+    size_t n = 0;
+    do {
+        digits[sizeof(digits) - 1 - n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    put_raw(w, digits + sizeof(digits) - n, n);
+}
+
+/**
+ * @brief Append an unsigned 64-bit decimal number.
+ */
+static void put_uint64(log_writer_t *w, uint64_t value) {
+    char digits[20];
+    size_t n = 0;
+    do {
+        digits[sizeof(digits) - 1 - n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    put_raw(w, digits + sizeof(digits) - n, n);
+}
+
+#if CONFIG_FIREBASE_LOG_COMPACT
+
+/**
+ * @brief Append the hex digits of a UID string as a quoted string ("99 B6 B3 02" -> "99B6B302").
+ */
+static void put_hex_uid(log_writer_t *w, const char *uid) {
+    put_raw(w, "\"", 1);
+    for (; *uid != '\0'; uid++) {
+        if (isxdigit((unsigned char)*uid)) {
+            put_raw(w, uid, 1);
+        }
+    }
+    put_raw(w, "\"", 1);
+}
+
+#else
+
+/**
+ * @brief Append a quoted JSON string, escaping quotes, backslashes and control characters.
+ */
+static void put_json_string(log_writer_t *w, const char *s) {
+    static const char hex[] = "0123456789abcdef";
+
+    put_raw(w, "\"", 1);
+    const char *run = s; // Start of the current run of characters that need no escaping
+    for (; *s != '\0'; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        put_raw(w, run, s - run);
+        if (c == '"' || c == '\\') {
+            char esc[2] = { '\\', (char)c };
+            put_raw(w, esc, sizeof(esc));
+        } else {
+            char esc[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0x0F] };
+            put_raw(w, esc, sizeof(esc));
+        }
+        run = s + 1;
+    }
+    put_raw(w, run, s - run);
+    put_raw(w, "\"", 1);
+}
+
+#endif // CONFIG_FIREBASE_LOG_COMPACT
+
+/**
+ * @brief Start writing into a buffer.
+ */
+void log_writer_init(log_writer_t *w, char *buf, size_t cap) {
+    w->buf = buf;
+    w->cap = cap;
+    w->len = 0;
+    w->overflow = (cap == 0);
+    if (cap > 0) {
+        buf[0] = '\0';
+    }
+}
+
+/**
+ * @brief Write one record as a JSON object.
+ */
+void log_write_record(log_writer_t *w, const firebase_log_record_t *record) {
+#if CONFIG_FIREBASE_LOG_COMPACT
+    put_str(w, "{\"u\":");
+    put_hex_uid(w, record->uid);
+    // Undated scans carry their uptime ("m") instead of a time
+    put_str(w, (record->flags & FIREBASE_LOG_FLAG_UNSYNCED) ? ",\"m\":" : ",\"t\":");
+    put_uint64(w, record->epoch_us > 0 ? (uint64_t)record->epoch_us / 1000 : 0);
+    put_str(w, ",\"r\":");
+    put_uint(w, record->reader_id);
+    if (record->flags & FIREBASE_LOG_FLAG_CONFLICT) {
+        put_str(w, ",\"c\":1");
+    }
+    put_raw(w, "}", 1);
+#else
+    put_str(w, "{\"uid\":");
+    put_json_string(w, record->uid);
+    if (record->flags & FIREBASE_LOG_FLAG_UNSYNCED) {
+        // Scanned before the clock was set and not dated since: only the uptime is known
+        put_str(w, ",\"unsynced\":true,\"uptime_ms\":");
+        put_uint64(w, record->epoch_us > 0 ? (uint64_t)record->epoch_us / 1000 : 0);
+    } else {
+        char timestamp[TIMEBASE_ISO8601_MAX_LEN];
+        timebase_format_utc(record->epoch_us, timestamp, sizeof(timestamp));
+        put_str(w, ",\"timestamp\":");
+        put_json_string(w, timestamp);
+    }
+    put_str(w, ",\"reader\":");
+    put_uint(w, record->reader_id);
+    if (record->flags & FIREBASE_LOG_FLAG_CONFLICT) {
+        put_str(w, ",\"conflict\":true");
+    }
+    put_raw(w, "}", 1);
+#endif
+}
+
+/**
+ * @brief Open a multi-path update object.
+ */
+void log_write_batch_begin(log_writer_t *w) {
+    put_raw(w, "{", 1);
+}
+
+/**
+ * @brief Write one "<key>":{record} member of a multi-path update.
+ */
+void log_write_batch_entry(log_writer_t *w, const char *key, const firebase_log_record_t *record) {
+    if (w->len > 0 && w->buf[w->len - 1] != '{') {
+        put_raw(w, ",", 1);
+    }
+    put_raw(w, "\"", 1);
+    put_str(w, key);
+    put_str(w, "\":");
+    log_write_record(w, record);
+}
+
+/**
+ * @brief Close a multi-path update object.
+ */
+void log_write_batch_end(log_writer_t *w) {
+    put_raw(w, "}", 1);
+}
+
+/**
+ * @brief Finish writing.
+ */
+size_t log_writer_finish(const log_writer_t *w) {
+    return w->overflow ? 0 : w->len;
+}
@@ -3,104 +3,88 @@
  * @brief Main application entry point for the Access Control System.
  *
  * This file initializes the system:
+ * - Loads the settings (menuconfig defaults, NVS copy).
  * - Initializes LCD display.
- * - Connects to Wi-Fi.
- * - Authenticates to Firebase.
- * - Synchronizes system time via NTP.
- * - Initializes the RFID reader.
- * 
- * After initialization, the system enters a ready state to read RFID cards.
+ * - Loads the offline journal and the local authorization table.
+ * - Starts the log uploader and the RFID reader.
+ * - Starts Wi-Fi and SNTP in the background.
+ *
+ * The door reads cards as soon as the local stages are done; Firebase
+ * sign-in and time sync complete later without blocking it.
  */
 
 #include "nvs_flash.h"    // Non-volatile storage (Wi-Fi, system calibration data)
 #include "wifi.h"         // Wi-Fi connection setup
-#include "firebase.h"     // Firebase sign-in and logging
+#include "firebase.h"     // Firebase logging
+#include "firebase_auth.h" // Firebase ID token manager
+#include "firebase_stream.h" // Pushed allowlist changes
 #include "lcd_display.h"  // LCD display driver
+#include "display.h"      // LCD feedback task
 #include "rfid.h"         // RFID reader driver
+#include "journal.h"      // Offline journal for access logs
+#include "authz.h"        // Local authorization table
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"      // Logging
-#include "esp_sntp.h"     // SNTP (Simple Network Time Protocol) for time sync
+#include "esp_timer.h"    // Boot stage timing
+#include "boot.h"         // Boot stage logs
+#include "timebase.h"     // Event timestamps and time zone
+#include "time_sync.h"    // Background SNTP sync
+#include "task_layout.h"  // Stack high-water-mark report
+#include "diag_console.h" // Serial diagnostics commands
+#include "bench.h"        // Optional self-benchmark
+#include "mem_pool.h"     // Preallocated buffer pools
+#include "settings.h"     // Tunable settings
 #include <time.h>         // Time functions (standard C library)
 
-// Tag used for logging time synchronization events
-static const char *TIME_TAG = "time_sync";
-
-/**
- * @brief Initialize SNTP (Simple Network Time Protocol) for time synchronization.
- *
- * This function configures the ESP32 to synchronize its internal clock
- * using the NTP server "pool.ntp.org".
- */
-void initialize_sntp(void) {
-    ESP_LOGI(TIME_TAG, "Initializing SNTP");
-    esp_sntp_setoperatingmode(SNTP_OPMODE_POLL);   // Set SNTP to poll mode
-    esp_sntp_setservername(0, "pool.ntp.org");     // Set default NTP server
-    esp_sntp_init();                               // Initialize SNTP
-}
-
-/**
- * @brief Wait until system time is synchronized.
- *
- * This function blocks execution until the system clock is set.
- * It retries several times (up to retry_count) and waits between attempts.
- */
-void wait_for_time_sync(void) {
-    time_t now = 0;
-    struct tm timeinfo = { 0 };
-    int retry = 0;
-    const int retry_count = 10; // Max retries
-
-    while (timeinfo.tm_year < (2016 - 1900) && ++retry < retry_count) {
-        ESP_LOGI(TIME_TAG, "Waiting for system time to be set... (%d/%d)", retry, retry_count);
-        vTaskDelay(pdMS_TO_TICKS(2000)); // Wait 2 seconds between retries
-        time(&now);
-        localtime_r(&now, &timeinfo);
-    }
-
-    if (retry == retry_count) {
-        ESP_LOGW(TIME_TAG, "Failed to synchronize time after %d attempts", retry_count);
-    } else {
-        ESP_LOGI(TIME_TAG, "Time synchronized successfully");
-    }
-}
-
 /**
  * @brief Main application entry point.
  *
- * This function initializes all peripherals and services needed for the Access Control System:
- * - LCD display
- * - Wi-Fi connection
- * - Firebase sign-in
- * - SNTP time synchronization
- * - RFID reader
+ * Brings the door up locally first, then starts the network in the background:
+ * - NVS and the settings, which the following stages read
+ * - LCD display and its feedback task
+ * - Offline journal and local authorization table
+ * - Log uploader (queues and journals records until Firebase is reachable)
+ * - RFID reader: from here on cards are checked and logged, even offline
+ * - Wi-Fi, the Firebase token manager, the allowlist stream and SNTP, which complete
+ *   asynchronously; the token manager signs in once Wi-Fi is connected and keeps the
+ *   token fresh, and the stream then receives allowlist changes as they happen
  *
- * Once initialized, it sets the LCD to a "waiting for card" color.
+ * Every stage is timed (see boot.h).
  */
 void app_main(void) {
-    
+    int64_t boot_start = esp_timer_get_time();
+    int64_t stage = boot_start;
+
+    ESP_ERROR_CHECK(mem_pool_json_init()); // cJSON pools, reserved before the heap fragments
+    ESP_ERROR_CHECK(nvs_flash_init()); // Initialize NVS for settings, Wi-Fi and other system data
+    ESP_ERROR_CHECK(settings_init());  // Settings stored by the last remote update (SPI clock, time zone, ...)
+    timebase_init();             // Time zone and event clock (once, not per scan)
     lcd_init();                 // Initialize LCD display
+    ESP_ERROR_CHECK(display_start()); // Start the LCD feedback task ("waiting" screen)
     srand(time(NULL));           // Seed random number generator (for random colors, IDs, etc.)
+    boot_log_stage("display", stage);
 
-    ESP_ERROR_CHECK(nvs_flash_init()); // Initialize NVS for Wi-Fi and other system data
-    wifi_init_sta();                    // Initialize Wi-Fi in Station mode
-
-    // Wait for Wi-Fi connection
-    EventBits_t bits = xEventGroupWaitBits(get_wifi_event_group(),
-                                           WIFI_CONNECTED_BIT,
-                                           pdFALSE,
-                                           pdTRUE,
-                                           portMAX_DELAY);
-    if (bits & WIFI_CONNECTED_BIT) {
-        ESP_LOGI("main", "Wi-Fi Connected, proceeding to Firebase...");
-    }
-
-    ESP_ERROR_CHECK(firebase_sign_in()); // Sign-in to Firebase to obtain ID token
-
-    initialize_sntp();       // Start SNTP time sync
-    wait_for_time_sync();    // Block until system time is synchronized
+    stage = esp_timer_get_time();
+    journal_init();                     // Recover offline access logs (optional partition)
+    ESP_ERROR_CHECK(authz_init());      // Map the local allowlist (before the uploader syncs it)
+    ESP_ERROR_CHECK(firebase_uploader_start()); // Accept access logs from the first scan on
+    boot_log_stage("storage", stage);
 
+    stage = esp_timer_get_time();
     ESP_ERROR_CHECK(rfid_reader_init()); // Initialize RFID reader
+    boot_log_stage("rfid", stage);
+    boot_log_stage("door_ready", boot_start);
+
+    // Network bring-up runs in the background from here on
+    stage = esp_timer_get_time();
+    wifi_init_sta();         // Start Wi-Fi association (does not wait for it)
+    ESP_ERROR_CHECK(firebase_auth_start()); // Sign in and refresh the ID token in the background
+    ESP_ERROR_CHECK(firebase_stream_start()); // Allowlist and settings changes pushed once signed in
+    ESP_ERROR_CHECK(time_sync_start()); // SNTP syncs once the network is up, then periodically
+    boot_log_stage("net_start", stage);
 
-    fill_screen(get_color_for_card(COLOR_WAITING)); // Set LCD to "waiting" color
+    ESP_ERROR_CHECK(task_layout_start_report()); // Periodic stack usage log
+    ESP_ERROR_CHECK(diag_console_start());       // "latency" and "stacks" on the serial console
+    ESP_ERROR_CHECK(bench_start());              // Synthetic load run (CONFIG_BENCH_MODE only)
 }
@@ -0,0 +1,215 @@
+/**
+ * @file mem_pool.c
+ * @brief Fixed-size block pools and the cJSON allocator built on them.
+ *
+ * Free blocks of a static pool form a singly linked list threaded through
+ * the blocks themselves, so taking and returning a block is O(1) and needs
+ * no bookkeeping memory.
+ */
+
+#include "mem_pool.h"      // Our public header
+
+#include "cJSON.h"         // Allocation hooks
+#include "esp_log.h"       // ESP logging
+#include <stdlib.h>        // malloc() and free()
+
+// Tag used for logging
+static const char *TAG = "mem_pool";
+
+static mem_pool_t *pools[MEM_POOL_MAX_POOLS];
+static size_t pool_count;
+static portMUX_TYPE pools_lock = portMUX_INITIALIZER_UNLOCKED;
+
+#if CONFIG_MEM_STATIC_POOLS
+
+static mem_pool_t json_small = MEM_POOL_INIT("json_small", MEM_POOL_JSON_SMALL_SIZE,
+                                             CONFIG_MEM_POOL_JSON_SMALL_BLOCKS);
+static mem_pool_t json_large = MEM_POOL_INIT("json_large", MEM_POOL_JSON_LARGE_SIZE,
+                                             CONFIG_MEM_POOL_JSON_LARGE_BLOCKS);
+
+// cJSON allocations that did not fit in a pool
+static uint32_t json_heap_allocs;
+static portMUX_TYPE json_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Whether a block belongs to a static pool.
+ */
+static bool pool_owns(const mem_pool_t *pool, const void *block) {
+    const uint8_t *p = block;
+    return pool->storage != NULL && p >= pool->storage &&
+           p < pool->storage + pool->block_size * pool->block_count;
+}
+
+#endif // CONFIG_MEM_STATIC_POOLS
+
+/**
+ * @brief Reserve the pool's storage and add it to the report.
+ */
+esp_err_t mem_pool_init(mem_pool_t *pool) {
+    for (size_t i = 0; i < pool_count; i++) {
+        if (pools[i] == pool) {
+            return ESP_OK;
+        }
+    }
+
+    // Every block must be able to hold the free-list pointer, aligned
+    pool->block_size = (pool->block_size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+#if CONFIG_MEM_STATIC_POOLS
+    pool->storage = malloc(pool->block_size * pool->block_count);
+    if (pool->storage == NULL) {
+        ESP_LOGE(TAG, "No memory for pool %s (%u x %u bytes)", pool->name,
+                 (unsigned)pool->block_count, (unsigned)pool->block_size);
+        return ESP_ERR_NO_MEM;
+    }
+    pool->free_list = NULL;
+    for (size_t i = pool->block_count; i-- > 0;) {
+        void **block = (void **)(pool->storage + i * pool->block_size);
+        *block = pool->free_list;
+        pool->free_list = block;
+    }
+#endif
+
+    portENTER_CRITICAL(&pools_lock);
+    if (pool_count < MEM_POOL_MAX_POOLS) {
+        pools[pool_count++] = pool;
+    }
+    portEXIT_CRITICAL(&pools_lock);
+    return ESP_OK;
+}
+
+/**
+ * @brief Take one block.
+ */
+void *mem_pool_alloc(mem_pool_t *pool) {
+    void *block = NULL;
+
+#if CONFIG_MEM_STATIC_POOLS
+    portENTER_CRITICAL(&pool->lock);
+    block = pool->free_list;
+    if (block != NULL) {
+        pool->free_list = *(void **)block;
+    }
+#else
+    block = malloc(pool->block_size); // Not capped: the peak shows the size a static pool needs
+    portENTER_CRITICAL(&pool->lock);
+#endif
+    if (block != NULL) {
+        pool->used++;
+        if (pool->used > pool->peak) {
+            pool->peak = pool->used;
+        }
+    } else {
+        pool->failures++;
+    }
+    portEXIT_CRITICAL(&pool->lock);
+    return block;
+}
+
+/**
+ * @brief Return a block taken from this pool.
+ */
+void mem_pool_free(mem_pool_t *pool, void *block) {
+    if (block == NULL) {
+        return;
+    }
+
+    portENTER_CRITICAL(&pool->lock);
+#if CONFIG_MEM_STATIC_POOLS
+    *(void **)block = pool->free_list;
+    pool->free_list = block;
+#endif
+    pool->used--;
+    portEXIT_CRITICAL(&pool->lock);
+
+#if !CONFIG_MEM_STATIC_POOLS
+    free(block);
+#endif
+}
+
+/**
+ * @brief Get a snapshot of the pool's counters.
+ */
+void mem_pool_get_stats(mem_pool_t *pool, mem_pool_stats_t *out) {
+    portENTER_CRITICAL(&pool->lock);
+    out->block_count = pool->block_count;
+    out->used = pool->used;
+    out->peak = pool->peak;
+    out->failures = pool->failures;
+    portEXIT_CRITICAL(&pool->lock);
+}
+
+/**
+ * @brief Log the usage of every initialized pool and of the cJSON allocator.
+ */
+void mem_pool_report(void) {
+    ESP_LOGI(TAG, "%-12s %6s %6s %6s %6s %8s", "pool", "block", "count", "used", "peak", "refused");
+    for (size_t i = 0; i < pool_count; i++) {
+        mem_pool_stats_t s;
+        mem_pool_get_stats(pools[i], &s);
+        ESP_LOGI(TAG, "%-12s %6u %6u %6u %6u %8lu", pools[i]->name, (unsigned)pools[i]->block_size,
+                 (unsigned)s.block_count, (unsigned)s.used, (unsigned)s.peak, (unsigned long)s.failures);
+    }
+#if CONFIG_MEM_STATIC_POOLS
+    ESP_LOGI(TAG, "cJSON heap fallbacks: %lu", (unsigned long)json_heap_allocs);
+#endif
+}
+
+#if CONFIG_MEM_STATIC_POOLS
+
+/**
+ * @brief cJSON allocation hook: smallest pool that fits, else the heap.
+ */
+static void *json_malloc(size_t size) {
+    void *block = NULL;
+    if (size <= json_small.block_size) {
+        block = mem_pool_alloc(&json_small);
+    }
+    if (block == NULL && size <= json_large.block_size) {
+        block = mem_pool_alloc(&json_large);
+    }
+    if (block == NULL) {
+        portENTER_CRITICAL(&json_lock);
+        json_heap_allocs++;
+        portEXIT_CRITICAL(&json_lock);
+        block = malloc(size);
+    }
+    return block;
+}
+
+/**
+ * @brief cJSON free hook: back to the pool the block came from.
+ */
+static void json_free(void *block) {
+    if (pool_owns(&json_small, block)) {
+        mem_pool_free(&json_small, block);
+    } else if (pool_owns(&json_large, block)) {
+        mem_pool_free(&json_large, block);
+    } else {
+        free(block);
+    }
+}
+
+#endif // CONFIG_MEM_STATIC_POOLS
+
+/**
+ * @brief Route cJSON allocations through two block pools.
+ */
+esp_err_t mem_pool_json_init(void) {
+#if CONFIG_MEM_STATIC_POOLS
+    esp_err_t err = mem_pool_init(&json_small);
+    if (err == ESP_OK) {
+        err = mem_pool_init(&json_large);
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    cJSON_Hooks hooks = {
+        .malloc_fn = json_malloc,
+        .free_fn = json_free,
+    };
+    cJSON_InitHooks(&hooks);
+#endif
+    return ESP_OK;
+}
@@ -2,61 +2,253 @@
  * @file rfid.c
  * @brief RFID reader implementation using RC522 and ESP32.
  *
- * This module initializes the RC522 RFID scanner and listens for RFID tag detections.
- * When a valid tag is detected, it logs the UID and sends a timestamped event to Firebase.
+ * This module initializes the RC522 RFID scanners and listens for RFID tag detections.
+ * Several readers can share one SPI bus (separate chip selects) or use different buses;
+ * the driver polls each one from its own task, and events carry the reader index.
+ * The driver's event handler only passes the UID to the access task, which is pinned to the
+ * access core (task_layout.h) and runs authorization and display feedback at high priority.
+ * When a tag is detected, the decision module (decision.h) decides from the local allowlist and
+ * hands the timestamped decision to the uploader, which journals and uploads it in the background.
+ * Repeat reads of a card that stays on the reader are folded into one event by a small
+ * LRU cache of recently seen UIDs.
  */
 
 #include "rfid.h"              // Our public header
-#include "firebase.h"          // For sending data to Firebase
+#include "rfid_scan.h"         // Adaptive polling policy
 
 #include "rc522.h"              // RC522 driver
 #include "driver/rc522_spi.h"   // RC522 SPI interface
 #include "picc/rc522_mifare.h"  // RC522 PICC (card) handling
 #include "esp_log.h"            // ESP logging
-#include "lcd_display.h"        // LCD display interface
+#include "display.h"            // Non-blocking LCD feedback
+#include "decision.h"           // Local access decisions, write-behind logging
+#include "task_layout.h"        // Access task core and stack report
+#include "trace.h"              // Tap latency histograms
+#include "settings.h"           // Dedupe window, display hold, poll interval
+#include "esp_timer.h"          // Monotonic time for duplicate-tap suppression
+#include "freertos/FreeRTOS.h"  // Stats lock
+#include "freertos/task.h"      // Access task, staggered reader start
+#include "freertos/queue.h"     // Reads handed to the access task
 
-#include <stdlib.h>             // For setenv()
 #include <string.h>             // For memory functions
-#include <time.h>               // For timestamp functions
+#include <stdint.h>             // For intptr_t (reader index as handler argument)
 
 // Tag used for logging
 #define TAG "rfid_reader"
 
-// RC522 driver handle
-static rc522_driver_handle_t driver;
-// RC522 scanner handle
-static rc522_handle_t scanner;
+_Static_assert(CONFIG_RFID_READER_COUNT <= RFID_MAX_READERS, "reader wiring table too small");
 
-// Predefined UID values for known cards
-const uint8_t CARD_UID[4] = { 0x99, 0xB6, 0xB3, 0x02 };
-const uint8_t CHIP_UID[4] = { 0x25, 0x0F, 0xC5, 0x01 };
+/**
+ * @brief How one reader is connected.
+ *
+ * Readers on the same SPI host share its bus; the bus pins of the first
+ * reader on a host are used to initialize it.
+ */
+typedef struct {
+    spi_host_device_t host; // SPI bus
+    int miso_gpio;          // Bus pins
+    int mosi_gpio;
+    int sclk_gpio;
+    int cs_gpio;            // Chip select (SDA) of this reader
+    int rst_gpio;           // Reset of this reader
+} reader_wiring_t;
+
+static const reader_wiring_t wiring[RFID_MAX_READERS] = {
+    { SPI3_HOST, RC522_SPI_BUS_GPIO_MISO, RC522_SPI_BUS_GPIO_MOSI, RC522_SPI_BUS_GPIO_SCLK,
+      RC522_SPI_SCANNER_GPIO_SDA, RC522_SCANNER_GPIO_RST },
+    { SPI3_HOST, RC522_SPI_BUS_GPIO_MISO, RC522_SPI_BUS_GPIO_MOSI, RC522_SPI_BUS_GPIO_SCLK,
+      RC522_SPI_SCANNER1_GPIO_SDA, RC522_SCANNER1_GPIO_RST },
+};
+
+// RC522 driver handles (one per reader)
+static rc522_driver_handle_t drivers[CONFIG_RFID_READER_COUNT];
+// RC522 scanner handles (one per reader)
+static rc522_handle_t scanners[CONFIG_RFID_READER_COUNT];
+
+/**
+ * @brief One recently seen card.
+ */
+typedef struct {
+    uint8_t uid[RC522_PICC_UID_SIZE_MAX]; // UID bytes
+    uint8_t uid_len;                      // Valid bytes in uid (0: unused slot)
+    int64_t last_seen_us;                 // esp_timer time of the latest read
+    uint32_t dwell;                       // Reads folded into the current event
+} recent_card_t;
+
+/**
+ * @brief One card read, passed from the driver's event handler to the access task.
+ */
+typedef struct {
+    rc522_picc_uid_t uid; // UID as read
+    uint8_t reader;       // Reader index
+    int64_t tap_us;       // trace_tap_now() when the driver reported the card
+} card_read_t;
+
+// Reads waiting for the access task (preallocated, no heap use per read)
+static StaticQueue_t read_queue_struct;
+static uint8_t read_queue_storage[CONFIG_RFID_ACCESS_QUEUE_LEN * sizeof(card_read_t)];
+static QueueHandle_t read_queue = NULL;
+
+// Recently seen cards per reader (access task only)
+static recent_card_t recent[CONFIG_RFID_READER_COUNT][CONFIG_RFID_DEDUPE_CACHE_SIZE];
+
+static rfid_stats_t stats;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Record a read and decide whether it starts a new access event.
+ *
+ * A read is a repeat if the same UID was last read less than
+ * rfid_dedupe_window_ms (settings.h) ago. The window slides with every read,
+ * so a card held on the reader stays one event. Otherwise the UID takes the slot
+ * of the least recently seen card. Each reader has its own cache, so the
+ * same card on the entry and then the exit reader gives two events.
+ *
+ * @return true if the read is a new event, false if it is a repeat.
+ */
+static bool register_read(uint8_t reader, const rc522_picc_uid_t *uid) {
+    int64_t now = esp_timer_get_time();
+    recent_card_t *cache = recent[reader];
+    recent_card_t *slot = &cache[0];
+    bool repeat = false;
+
+    for (size_t i = 0; i < CONFIG_RFID_DEDUPE_CACHE_SIZE; i++) {
+        recent_card_t *c = &cache[i];
+        if (c->uid_len == uid->length && memcmp(c->uid, uid->value, uid->length) == 0) {
+            slot = c;
+            repeat = (now - c->last_seen_us) < (int64_t)settings_get()->rfid_dedupe_window_ms * 1000;
+            break;
+        }
+        if (c->uid_len == 0 || c->last_seen_us < slot->last_seen_us) {
+            slot = c; // Free slot or least recently seen card so far
+        }
+    }
+
+    if (!repeat) {
+        memcpy(slot->uid, uid->value, uid->length);
+        slot->uid_len = uid->length;
+        slot->dwell = 0;
+    }
+    slot->last_seen_us = now;
+    slot->dwell++;
+
+    portENTER_CRITICAL(&stats_lock);
+    stats.reads++;
+    if (repeat) {
+        stats.suppressed++;
+    } else {
+        stats.events++;
+        stats.reader_events[reader]++;
+    }
+    if (slot->dwell > stats.max_dwell) {
+        stats.max_dwell = slot->dwell;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+
+    if (repeat) {
+        ESP_LOGD(TAG, "Repeat read %lu of the same card, suppressed", (unsigned long)slot->dwell);
+    }
+    return !repeat;
+}
 
 /**
- * @brief Compare two UID arrays.
+ * @brief Map an authorization role to the colour shown on the LCD.
+ */
+static CardColor color_for_role(authz_role_t role) {
+    return (role == AUTHZ_ROLE_USER) ? COLOR_CARD : COLOR_CHIP;
+}
+
+/**
+ * @brief Handle one card read on the access task.
  *
- * @param uid1 Pointer to first UID array.
- * @param uid2 Pointer to second UID array.
- * @param size Number of bytes to compare.
- * @return true if UIDs are equal, false otherwise.
+ * Repeat reads of a card that is still on the reader are dropped here.
+ * The decision comes from the local allowlist only (decision.h). It logs the
+ * UID, posts the display color for the UID (without waiting), and hands the
+ * decision to the uploader.
  */
-static bool compare_uid(const uint8_t *uid1, const uint8_t *uid2, size_t size) {
-    for (size_t i = 0; i < size; i++) {
-        if (uid1[i] != uid2[i]) {
-            return false;
+static void handle_read(const card_read_t *read) {
+    uint8_t reader = read->reader;
+
+    // A badge held on the reader is one tap: no second redraw or upload
+    if (!register_read(reader, &read->uid)) {
+        return;
+    }
+    rfid_scan_on_detection(); // Poll fast for the next card
+
+    // Convert UID to string
+    char uid_str[RC522_PICC_UID_STR_BUFFER_SIZE_MAX];
+    rc522_picc_uid_to_str(&read->uid, uid_str, sizeof(uid_str));
+    ESP_LOGI(TAG, "Reader %u UID: %s", reader, uid_str);
+
+    // Decide locally and update the display accordingly
+    decision_t decision;
+    decision_make(read->uid.value, read->uid.length, &decision);
+    trace_record(TRACE_SPAN_DECISION, read->tap_us);
+    if (decision.known) {
+        // The display task reverts to "waiting" on its own; never block the event task
+        if (display_show(color_for_role(decision.role), settings_get()->display_hold_ms, read->tap_us) == ESP_OK) {
+            trace_record(TRACE_SPAN_DISPLAY_QUEUED, read->tap_us);
         }
     }
-    return true;
+
+    // Queue the decision for the uploader task (never blocks on network I/O)
+    if (decision_record(&decision, uid_str, reader, read->tap_us) == ESP_OK) {
+        trace_record(TRACE_SPAN_UPLOAD_QUEUED, read->tap_us);
+    } else {
+        ESP_LOGW(TAG, "Log upload queue full, dropping event for %s", uid_str);
+    }
+}
+
+/**
+ * @brief Access task: authorization, display and logging of card reads.
+ *
+ * Runs on the access core above the network tasks, so a TLS handshake on
+ * the other core never delays the screen.
+ */
+static void rfid_access_task(void *arg) {
+    card_read_t read;
+    while (true) {
+        if (xQueueReceive(read_queue, &read, portMAX_DELAY) == pdTRUE) {
+            handle_read(&read);
+        }
+    }
+}
+
+/**
+ * @brief Pass a read to the access task without blocking.
+ *
+ * Called from the RC522 driver task (and from the benchmark load generator).
+ * If the access task falls behind, the read is dropped and counted.
+ *
+ * @return true if the read was queued.
+ */
+static bool submit_read(const card_read_t *read) {
+    bool queued = (xQueueSend(read_queue, read, 0) == pdTRUE);
+    uint32_t depth = uxQueueMessagesWaiting(read_queue);
+
+    portENTER_CRITICAL(&stats_lock);
+    if (!queued) {
+        stats.dropped++;
+    }
+    if (depth > stats.queue_high_water) {
+        stats.queue_high_water = depth;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+
+    if (!queued) {
+        ESP_LOGW(TAG, "Access task busy, dropping read on reader %u", read->reader);
+    }
+    return queued;
 }
 
 /**
  * @brief Callback function called when the RFID card state changes.
  *
- * This function is triggered when a new RFID tag is detected.
- * It checks if the detected UID matches predefined known UIDs.
- * It logs the UID, updates the display color based on the UID,
- * generates the current timestamp, and sends the event to Firebase.
+ * Runs on the RC522 driver task. Only hands active cards to the access
+ * task and never blocks; if the access task falls behind, the read is
+ * dropped and counted.
  *
- * @param arg Unused user argument.
+ * @param arg Reader index (as registered in rfid_reader_init()).
  * @param base Event base (unused).
  * @param event_id Event ID (unused).
  * @param data Pointer to event data containing the detected PICC information.
@@ -71,81 +263,130 @@ static void on_picc_state_changed(void *arg, esp_event_base_t base, int32_t even
         return;
     }
 
-    // Convert UID to string
-    char uid_str[RC522_PICC_UID_STR_BUFFER_SIZE_MAX];
-    rc522_picc_uid_to_str(&picc->uid, uid_str, sizeof(uid_str));
-    ESP_LOGI(TAG, "UID: %s", uid_str);
-
-    // Check if UID matches known cards and update the display accordingly
-    if (picc->uid.length == 4) {
-        if (compare_uid(picc->uid.value, CARD_UID, 4)) {
-            fill_screen(get_color_for_card(COLOR_CARD));
-        } else if (compare_uid(picc->uid.value, CHIP_UID, 4)) {
-            fill_screen(get_color_for_card(COLOR_CHIP));
-        }
-
-        vTaskDelay(pdMS_TO_TICKS(3000)); // Hold color for 3 seconds
-        fill_screen(get_color_for_card(COLOR_WAITING)); // Reset display
-    }
-
-    // 🕒 Get current timestamp
-    time_t now;
-    struct tm timeinfo;
-    char timestamp[25]; // Buffer for ISO8601 time format
-
-    // Set timezone to Israel (UTC+2 / UTC+3 for DST)
-    setenv("TZ", "IST-2IDT,M3.4.4/26,M10.5.0", 1);
-    tzset(); // Apply timezone settings
-
-    time(&now); // Get current time
-    localtime_r(&now, &timeinfo); // Convert to local time
+    card_read_t read = {
+        .uid = picc->uid,
+        .reader = (uint8_t)(intptr_t)arg,
+        .tap_us = trace_tap_now(),
+    };
+    submit_read(&read);
+}
 
-    // Format time as ISO8601
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", &timeinfo);
+/**
+ * @brief Create the read queue and start the access task.
+ */
+static esp_err_t start_access_task(void) {
+    read_queue = xQueueCreateStatic(CONFIG_RFID_ACCESS_QUEUE_LEN, sizeof(card_read_t),
+                                    read_queue_storage, &read_queue_struct);
 
-    // Send UID and timestamp to Firebase
-    send_rfid_log_to_firebase(uid_str, timestamp);
+    TaskHandle_t task;
+    if (xTaskCreatePinnedToCore(rfid_access_task, "rfid_access", CONFIG_RFID_ACCESS_TASK_STACK_SIZE,
+                                NULL, CONFIG_RFID_ACCESS_TASK_PRIORITY, &task,
+                                TASK_LAYOUT_ACCESS_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create access task");
+        return ESP_ERR_NO_MEM;
+    }
+    task_layout_register(task, CONFIG_RFID_ACCESS_TASK_STACK_SIZE);
+    return ESP_OK;
 }
 
 /**
- * @brief Initialize the RFID reader.
+ * @brief Initialize the RFID readers.
+ *
+ * This function starts the access task, initializes the SPI driver and sets up
+ * each RC522 RFID reader.
+ * It also registers the event handler for card detection events, with the
+ * reader index as the handler argument.
  *
- * This function initializes the SPI driver and sets up the RC522 RFID reader.
- * It also registers the event handler for card detection events.
+ * The readers are started one fraction of the poll interval apart, so their
+ * polls interleave on a shared bus instead of colliding.
  *
  * @return ESP_OK on success, or an error code on failure.
  */
 esp_err_t rfid_reader_init(void) {
+    esp_err_t err = start_access_task();
+    if (err != ESP_OK) {
+        return err;
+    }
 
-    // Configure RC522 SPI driver
-    rc522_spi_config_t driver_config = {
-        .host_id = SPI3_HOST, // SPI3 bus
-        .bus_config = &(spi_bus_config_t){
-            .miso_io_num = RC522_SPI_BUS_GPIO_MISO,
-            .mosi_io_num = RC522_SPI_BUS_GPIO_MOSI,
-            .sclk_io_num = RC522_SPI_BUS_GPIO_SCLK,
-        },
-        .dev_config = {
-            .spics_io_num = RC522_SPI_SCANNER_GPIO_SDA, // SPI chip select (SDA)
-        },
-        .rst_io_num = RC522_SCANNER_GPIO_RST, // Reset pin
-    };
+    for (int i = 0; i < CONFIG_RFID_READER_COUNT; i++) {
+        const reader_wiring_t *w = &wiring[i];
 
-    // Create and install the SPI driver
-    rc522_spi_create(&driver_config, &driver);
-    rc522_driver_install(driver);
+        // Only the first reader on a host initializes its bus
+        bool bus_ready = false;
+        for (int j = 0; j < i; j++) {
+            bus_ready |= (wiring[j].host == w->host);
+        }
+        spi_bus_config_t bus_config = {
+            .miso_io_num = w->miso_gpio,
+            .mosi_io_num = w->mosi_gpio,
+            .sclk_io_num = w->sclk_gpio,
+        };
 
-    // Configure the RC522 scanner
-    rc522_config_t scanner_config = {
-        .driver = driver,
-    };
+        // Configure RC522 SPI driver
+        rc522_spi_config_t driver_config = {
+            .host_id = w->host,
+            .bus_config = bus_ready ? NULL : &bus_config,
+            .dev_config = {
+                .spics_io_num = w->cs_gpio, // SPI chip select (SDA)
+            },
+            .rst_io_num = w->rst_gpio, // Reset pin
+        };
 
-    // Create the scanner and register event handler
-    rc522_create(&scanner_config, &scanner);
-    rc522_register_events(scanner, RC522_EVENT_PICC_STATE_CHANGED, on_picc_state_changed, NULL);
+        // Create and install the SPI driver
+        rc522_spi_create(&driver_config, &drivers[i]);
+        rc522_driver_install(drivers[i]);
 
-    // Start the scanner
-    rc522_start(scanner);
+        // Configure the RC522 scanner
+        rc522_config_t scanner_config = {
+            .driver = drivers[i],
+            .poll_interval_ms = settings_get()->rfid_poll_interval_ms, // Fast-mode cadence
+            .task_stack_size = CONFIG_RFID_DRIVER_TASK_STACK_SIZE,
+            .task_priority = CONFIG_RFID_DRIVER_TASK_PRIORITY,
+        };
 
-    return ESP_OK;
+        // Create the scanner and register event handler
+        rc522_create(&scanner_config, &scanners[i]);
+        rc522_register_events(scanners[i], RC522_EVENT_PICC_STATE_CHANGED, on_picc_state_changed,
+                              (void *)(intptr_t)i);
+    }
+
+    // Start the scanners staggered; the scan policy pauses them between idle windows
+    for (int i = 0; i < CONFIG_RFID_READER_COUNT; i++) {
+        if (i > 0) {
+            vTaskDelay(pdMS_TO_TICKS(settings_get()->rfid_poll_interval_ms / CONFIG_RFID_READER_COUNT));
+        }
+        rc522_start(scanners[i]);
+    }
+
+    return rfid_scan_init(scanners, CONFIG_RFID_READER_COUNT);
+}
+
+/**
+ * @brief Hand a synthetic card read to the access task.
+ */
+esp_err_t rfid_inject_read(uint8_t reader, const uint8_t *uid, uint8_t uid_len) {
+    if (reader >= CONFIG_RFID_READER_COUNT || uid == NULL || uid_len == 0 ||
+        uid_len > RC522_PICC_UID_SIZE_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (read_queue == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    card_read_t read = {
+        .reader = reader,
+        .tap_us = trace_tap_now(),
+    };
+    memcpy(read.uid.value, uid, uid_len);
+    read.uid.length = uid_len;
+    return submit_read(&read) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+/**
+ * @brief Get a snapshot of the duplicate-tap filter counters.
+ */
+void rfid_get_stats(rfid_stats_t *out) {
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&stats_lock);
 }
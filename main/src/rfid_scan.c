@@ -0,0 +1,340 @@
+/**
+ * @file rfid_scan.c
+ * @brief Adaptive RC522 polling: fast after detections, sparse scan windows when idle.
+ *
+ * The RC522 driver polls at a fixed interval while it is running, so the
+ * idle cadence is produced by pausing and resuming the scanners (all readers
+ * together) from a one-shot esp_timer. All mode changes happen in that timer
+ * callback; the event handler and the policy setter only update the state
+ * and re-run it.
+ *
+ * With CONFIG_RFID_IDLE_LIGHT_SLEEP, automatic light sleep and frequency
+ * scaling are enabled and a CPU_FREQ_MAX lock keeps the chip awake at full
+ * clock while the scanner is running, so only the paused idle windows
+ * trade speed for current.
+ */
+
+#include "rfid_scan.h"         // Our public header
+#include "timebase.h"          // Clock state for busy hours
+#include "settings.h"          // Initial policy, poll interval
+
+#include "esp_log.h"           // ESP logging
+#include "esp_timer.h"         // Policy timer
+#include "freertos/FreeRTOS.h" // State lock
+#if CONFIG_RFID_IDLE_LIGHT_SLEEP
+#include "esp_pm.h"            // Light sleep and low clock between idle windows
+#endif
+
+#include <time.h>              // For localtime_r() (busy hours)
+
+// Tag used for logging
+static const char *TAG = "rfid_scan";
+
+// How often busy hours are re-checked while they keep the reader in fast mode
+#define BUSY_RECHECK_US (60LL * 1000000)
+
+/**
+ * @brief Raw per-mode accounting.
+ */
+typedef struct {
+    int64_t time_us;     // Time spent in the mode
+    int64_t scan_us;     // Part of it with the scanner running
+    uint32_t detections; // Events detected in the mode
+    uint32_t wakeups;    // Idle windows opened
+} mode_counters_t;
+
+static const rc522_handle_t *scanners = NULL;
+static size_t scanner_count = 0;
+static esp_timer_handle_t policy_timer = NULL;
+
+// State shared between the timer callback, the event handler and the API
+static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+static rfid_scan_policy_t policy; // Set from settings.h by rfid_scan_init()
+static rfid_scan_mode_t mode = RFID_SCAN_MODE_FAST;
+static bool scanning = true;     // Scanner running (the caller starts it)
+static int64_t fast_until_us = 0; // Fast mode held until this esp_timer time
+static int64_t accounted_us = 0;  // Counters are up to date until this time
+static mode_counters_t counters[RFID_SCAN_MODE_COUNT];
+
+#if CONFIG_RFID_IDLE_LIGHT_SLEEP
+static esp_pm_lock_handle_t awake_lock = NULL;
+#endif
+
+/**
+ * @brief Add the time since the last call to the current mode. Call with lock held.
+ */
+static void account(int64_t now) {
+    int64_t elapsed = now - accounted_us;
+    counters[mode].time_us += elapsed;
+    if (scanning) {
+        counters[mode].scan_us += elapsed;
+    }
+    accounted_us = now;
+}
+
+/**
+ * @brief Check whether the local time is within the busy hours.
+ *
+ * Busy hours are ignored until the clock has been set.
+ */
+static bool in_busy_hours(uint8_t start, uint8_t end) {
+    if (start == end || !timebase_is_synced()) {
+        return false;
+    }
+
+    time_t now = time(NULL);
+    struct tm local;
+    localtime_r(&now, &local);
+    int h = local.tm_hour;
+    return (start < end) ? (h >= start && h < end) : (h >= start || h < end);
+}
+
+/**
+ * @brief Run the policy timer callback as soon as possible.
+ */
+static void reevaluate_now(void) {
+    esp_timer_stop(policy_timer); // Fails harmlessly if the timer is not armed
+    esp_timer_start_once(policy_timer, 0);
+}
+
+/**
+ * @brief Policy timer callback: pick the mode and start or pause the scanner.
+ *
+ * The timer is re-armed for the next point at which the decision can change
+ * (end of the fast hold, end of an idle window or of an idle interval).
+ */
+static void policy_evaluate(void *arg) {
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&lock);
+    rfid_scan_policy_t p = policy;
+    portEXIT_CRITICAL(&lock);
+    bool busy = in_busy_hours(p.busy_start_hour, p.busy_end_hour);
+
+    bool start = false;
+    bool pause = false;
+    uint64_t next_us = 0;
+
+    portENTER_CRITICAL(&lock);
+    account(now);
+    rfid_scan_mode_t previous = mode;
+    if (p.idle_interval_ms == 0 || busy || now < fast_until_us) {
+        mode = RFID_SCAN_MODE_FAST;
+        start = !scanning;
+        if (now < fast_until_us) {
+            next_us = fast_until_us - now;
+        } else if (p.idle_interval_ms != 0) {
+            next_us = BUSY_RECHECK_US;
+        }
+    } else if (scanning) {
+        // Fast hold expired or idle window over
+        mode = RFID_SCAN_MODE_IDLE;
+        pause = true;
+        next_us = (uint64_t)p.idle_interval_ms * 1000;
+    } else {
+        // Idle and paused: open the next scan window
+        start = true;
+        counters[RFID_SCAN_MODE_IDLE].wakeups++;
+        next_us = (uint64_t)p.idle_window_ms * 1000;
+    }
+    scanning = (scanning || start) && !pause;
+    portEXIT_CRITICAL(&lock);
+
+    if (mode != previous) {
+        ESP_LOGI(TAG, "%s mode", (mode == RFID_SCAN_MODE_FAST) ? "Fast" : "Idle");
+    }
+
+    if (start) {
+#if CONFIG_RFID_IDLE_LIGHT_SLEEP
+        esp_pm_lock_acquire(awake_lock);
+#endif
+        for (size_t i = 0; i < scanner_count; i++) {
+            rc522_start(scanners[i]);
+        }
+    }
+    if (pause) {
+        for (size_t i = 0; i < scanner_count; i++) {
+            rc522_pause(scanners[i]);
+        }
+#if CONFIG_RFID_IDLE_LIGHT_SLEEP
+        esp_pm_lock_release(awake_lock);
+#endif
+    }
+
+    if (next_us > 0) {
+        // ESP_ERR_INVALID_STATE: a re-evaluation was requested meanwhile and is already armed
+        esp_timer_start_once(policy_timer, next_us);
+    }
+}
+
+/**
+ * @brief Scan policy described by the settings in effect.
+ */
+static void policy_from_settings(rfid_scan_policy_t *p) {
+    const settings_t *s = settings_get();
+    p->idle_interval_ms = s->scan_idle_interval_ms;
+    p->idle_window_ms = s->scan_idle_window_ms;
+    p->fast_hold_ms = s->scan_fast_hold_ms;
+    p->busy_start_hour = s->scan_busy_start_hour;
+    p->busy_end_hour = s->scan_busy_end_hour;
+}
+
+/**
+ * @brief Start applying the scan policy to running scanners.
+ */
+esp_err_t rfid_scan_init(const rc522_handle_t *handles, size_t count) {
+    policy_from_settings(&policy);
+    scanners = handles;
+    scanner_count = count;
+    accounted_us = esp_timer_get_time();
+
+#if CONFIG_RFID_IDLE_LIGHT_SLEEP
+    // CPU_FREQ_MAX rather than NO_LIGHT_SLEEP: while scanning, decisions, the
+    // display and TLS must not run at XTAL speed (it also blocks light sleep)
+    esp_err_t err = esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "rfid_scan", &awake_lock);
+    if (err != ESP_OK) {
+        return err;
+    }
+    esp_pm_lock_acquire(awake_lock); // The scanner is running
+
+    esp_pm_config_t pm_config = {
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = CONFIG_XTAL_FREQ,
+        .light_sleep_enable = true,
+    };
+    err = esp_pm_configure(&pm_config);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Automatic light sleep not available: %s", esp_err_to_name(err));
+    }
+#endif
+
+    esp_timer_create_args_t timer_args = {
+        .callback = policy_evaluate,
+        .name = "rfid_scan",
+    };
+    esp_err_t ret = esp_timer_create(&timer_args, &policy_timer);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    reevaluate_now();
+    return ESP_OK;
+}
+
+/**
+ * @brief Report an access event, switching to fast mode.
+ */
+void rfid_scan_on_detection(void) {
+    if (policy_timer == NULL) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+
+    portENTER_CRITICAL(&lock);
+    account(now);
+    counters[mode].detections++;
+    fast_until_us = now + (int64_t)policy.fast_hold_ms * 1000;
+    bool switch_mode = (mode != RFID_SCAN_MODE_FAST);
+    portEXIT_CRITICAL(&lock);
+
+    if (switch_mode) {
+        reevaluate_now();
+    }
+}
+
+/**
+ * @brief Replace the scan policy.
+ */
+esp_err_t rfid_scan_set_policy(const rfid_scan_policy_t *p) {
+    if (p->busy_start_hour > 23 || p->busy_end_hour > 23 ||
+        (p->idle_interval_ms != 0 && p->idle_window_ms < settings_get()->rfid_poll_interval_ms)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (policy_timer == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    portENTER_CRITICAL(&lock);
+    policy = *p;
+    portEXIT_CRITICAL(&lock);
+
+    ESP_LOGI(TAG, "Policy: idle %lu ms / window %lu ms, hold %lu ms, busy %u-%u h",
+             (unsigned long)p->idle_interval_ms, (unsigned long)p->idle_window_ms,
+             (unsigned long)p->fast_hold_ms, p->busy_start_hour, p->busy_end_hour);
+    reevaluate_now();
+    return ESP_OK;
+}
+
+/**
+ * @brief Replace the scan policy with the one in the settings.
+ */
+esp_err_t rfid_scan_apply_settings(void) {
+    rfid_scan_policy_t p;
+    policy_from_settings(&p);
+    return rfid_scan_set_policy(&p);
+}
+
+/**
+ * @brief Get the current scan policy.
+ */
+void rfid_scan_get_policy(rfid_scan_policy_t *out) {
+    portENTER_CRITICAL(&lock);
+    *out = policy;
+    portEXIT_CRITICAL(&lock);
+}
+
+/**
+ * @brief Expected detection latency of a mode under the current policy.
+ *
+ * Assumes cards arrive at uniformly random times. In idle mode a card that
+ * arrives while the scanner is paused waits for the rest of the interval,
+ * then for the first poll of the window.
+ */
+static uint32_t expected_latency_ms(rfid_scan_mode_t m, const rfid_scan_policy_t *p) {
+    uint64_t poll = settings_get()->rfid_poll_interval_ms;
+    if (m == RFID_SCAN_MODE_FAST || p->idle_interval_ms == 0) {
+        return poll / 2;
+    }
+    uint64_t sleep = p->idle_interval_ms;
+    uint64_t window = p->idle_window_ms;
+    return (uint32_t)((sleep * (sleep + poll) / 2 + window * poll / 2) / (sleep + window));
+}
+
+/**
+ * @brief Get a snapshot of the scan policy counters.
+ */
+void rfid_scan_get_stats(rfid_scan_stats_t *out) {
+    mode_counters_t snapshot[RFID_SCAN_MODE_COUNT];
+    rfid_scan_policy_t p;
+
+    portENTER_CRITICAL(&lock);
+    if (policy_timer != NULL) {
+        account(esp_timer_get_time());
+    }
+    for (int i = 0; i < RFID_SCAN_MODE_COUNT; i++) {
+        snapshot[i] = counters[i];
+    }
+    p = policy;
+    out->mode = mode;
+    portEXIT_CRITICAL(&lock);
+
+    for (int i = 0; i < RFID_SCAN_MODE_COUNT; i++) {
+        rfid_scan_mode_stats_t *s = &out->modes[i];
+        s->time_ms = snapshot[i].time_us / 1000;
+        s->scan_ms = snapshot[i].scan_us / 1000;
+        s->detections = snapshot[i].detections;
+        s->wakeups = snapshot[i].wakeups;
+        s->est_latency_ms = expected_latency_ms((rfid_scan_mode_t)i, &p);
+
+        // Average of the scanning and sleeping currents, weighted by the measured duty cycle
+        uint64_t scan_ua = (uint64_t)CONFIG_RFID_SCAN_CURRENT_MA * 1000;
+        uint64_t sleep_ua = (uint64_t)CONFIG_RFID_SLEEP_CURRENT_MA * 1000;
+        if (snapshot[i].time_us > 0) {
+            uint64_t paused_us = snapshot[i].time_us - snapshot[i].scan_us;
+            s->avg_current_ua = (uint32_t)((scan_ua * snapshot[i].scan_us + sleep_ua * paused_us) /
+                                           snapshot[i].time_us);
+        } else {
+            s->avg_current_ua = 0;
+        }
+    }
+}
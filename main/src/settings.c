@@ -0,0 +1,421 @@
+/**
+ * @file settings.c
+ * @brief Settings table, NVS persistence and remote overrides.
+ *
+ * Every setting is described once in a table (JSON key, offset in
+ * settings_t, range), which drives loading, validation, remote overrides and
+ * the report. The stored copy is the raw settings_t, prefixed by the schema
+ * version; since fields are only appended, the common prefix of two layouts
+ * always means the same.
+ */
+
+#include "settings.h"      // Our public header
+
+#include "cJSON.h"         // Remote settings documents
+#include "esp_log.h"       // ESP logging
+#include "nvs.h"           // Stored copy
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h" // Update lock
+#include <stdlib.h>        // For malloc(), free()
+#include <string.h>        // For memcpy(), strcmp(), strlcpy()
+
+// Tag used for logging
+static const char *TAG = "settings";
+
+#define SETTINGS_NVS_NAMESPACE  "settings"
+#define SETTINGS_NVS_KEY_SCHEMA "schema"
+#define SETTINGS_NVS_KEY_VALUES "values"
+
+// Records per upload request the uploader has room for
+#if CONFIG_FIREBASE_BATCH_UPLOAD
+#define SETTINGS_BATCH_CAPACITY CONFIG_FIREBASE_BATCH_MAX_ENTRIES
+#define SETTINGS_BATCH_FLUSH_MS CONFIG_FIREBASE_BATCH_FLUSH_MS
+#else
+#define SETTINGS_BATCH_CAPACITY 1
+#define SETTINGS_BATCH_FLUSH_MS 0
+#endif
+
+/**
+ * @brief Description of one setting.
+ */
+typedef struct {
+    const char *key;     // JSON key and name in the report
+    uint16_t offset;     // offsetof(settings_t, <field>)
+    uint8_t size;        // Field size: 1 or 4 (numbers), SETTINGS_TZ_MAX_LEN (string)
+    bool boot;           // Takes effect at the next restart
+    uint32_t min;        // Smallest valid value (numbers)
+    uint32_t max;        // Largest valid value (numbers)
+} setting_desc_t;
+
+#define NUMBER(field, lo, hi, at_boot) \
+    { #field, offsetof(settings_t, field), sizeof(((settings_t *)0)->field), at_boot, lo, hi }
+#define STRING(field, at_boot) \
+    { #field, offsetof(settings_t, field), sizeof(((settings_t *)0)->field), at_boot, 0, 0 }
+
+// Ranges match menuconfig
+static const setting_desc_t table[] = {
+    NUMBER(lcd_spi_hz, 1000000, 40000000, true),
+    NUMBER(rfid_poll_interval_ms, 20, 1000, true),
+    STRING(timezone, true),
+    NUMBER(rfid_dedupe_window_ms, 0, 60000, false),
+    NUMBER(display_hold_ms, 100, 60000, false),
+    NUMBER(upload_batch_max, 1, SETTINGS_BATCH_CAPACITY, false),
+    NUMBER(upload_batch_flush_ms, 0, 60000, false),
+    NUMBER(authz_sync_interval_s, 30, 86400, false),
+    NUMBER(journal_retry_interval_ms, 1000, 600000, false),
+    NUMBER(wifi_retry_base_ms, 100, 10000, false),
+    NUMBER(wifi_retry_max_ms, 1000, 600000, false),
+    NUMBER(scan_idle_interval_ms, 0, 10000, false),
+    NUMBER(scan_idle_window_ms, 20, 5000, false),
+    NUMBER(scan_fast_hold_ms, 0, 600000, false),
+    NUMBER(scan_busy_start_hour, 0, 23, false),
+    NUMBER(scan_busy_end_hour, 0, 23, false),
+};
+
+#define SETTINGS_COUNT (sizeof(table) / sizeof(table[0]))
+
+static const settings_t defaults = {
+    .revision = 0,
+    .lcd_spi_hz = 26 * 1000 * 1000, // 26 MHz
+    .rfid_poll_interval_ms = CONFIG_RFID_POLL_INTERVAL_MS,
+    .timezone = CONFIG_TIMEBASE_TZ,
+    .rfid_dedupe_window_ms = CONFIG_RFID_DEDUPE_WINDOW_MS,
+    .display_hold_ms = CONFIG_DISPLAY_HOLD_MS,
+    .upload_batch_max = SETTINGS_BATCH_CAPACITY,
+    .upload_batch_flush_ms = SETTINGS_BATCH_FLUSH_MS,
+    .authz_sync_interval_s = CONFIG_AUTHZ_SYNC_INTERVAL_S,
+    .journal_retry_interval_ms = CONFIG_JOURNAL_RETRY_INTERVAL_MS,
+    .wifi_retry_base_ms = CONFIG_WIFI_RETRY_BASE_MS,
+    .wifi_retry_max_ms = CONFIG_WIFI_RETRY_MAX_MS,
+#if CONFIG_RFID_ADAPTIVE_SCAN
+    .scan_idle_interval_ms = CONFIG_RFID_IDLE_INTERVAL_MS,
+#else
+    .scan_idle_interval_ms = 0,
+#endif
+    .scan_idle_window_ms = CONFIG_RFID_IDLE_WINDOW_MS,
+    .scan_fast_hold_ms = CONFIG_RFID_FAST_HOLD_MS,
+    .scan_busy_start_hour = CONFIG_RFID_BUSY_START_HOUR,
+    .scan_busy_end_hour = CONFIG_RFID_BUSY_END_HOUR,
+};
+
+// Double buffer: readers use slots[active], updates fill the other one and switch
+static settings_t slots[2];      // In effect (boot fields as of this boot)
+static volatile int active = 0;
+static settings_t stored;        // Last values written to NVS (boot fields for the next boot)
+
+// Serializes updates (uploader pull, settings stream) and the report
+static StaticSemaphore_t update_lock_struct;
+static SemaphoreHandle_t update_lock = NULL;
+
+/**
+ * @brief Read a numeric setting.
+ */
+static uint32_t get_number(const settings_t *s, const setting_desc_t *d) {
+    const uint8_t *p = (const uint8_t *)s + d->offset;
+    return d->size == sizeof(uint8_t) ? *p : *(const uint32_t *)p;
+}
+
+/**
+ * @brief Write a numeric setting.
+ */
+static void set_number(settings_t *s, const setting_desc_t *d, uint32_t value) {
+    uint8_t *p = (uint8_t *)s + d->offset;
+    if (d->size == sizeof(uint8_t)) {
+        *p = (uint8_t)value;
+    } else {
+        *(uint32_t *)p = value;
+    }
+}
+
+/**
+ * @brief Whether a setting is a string.
+ */
+static bool is_string(const setting_desc_t *d) {
+    return d->size == SETTINGS_TZ_MAX_LEN;
+}
+
+/**
+ * @brief Check one setting of a settings_t.
+ */
+static bool setting_valid(const settings_t *s, const setting_desc_t *d) {
+    if (is_string(d)) {
+        const char *str = (const char *)s + d->offset;
+        return str[0] != '\0' && memchr(str, '\0', d->size) != NULL;
+    }
+    uint32_t v = get_number(s, d);
+    return v >= d->min && v <= d->max;
+}
+
+/**
+ * @brief Whether a setting differs between two settings_t.
+ */
+static bool setting_differs(const settings_t *a, const settings_t *b, const setting_desc_t *d) {
+    if (is_string(d)) {
+        return strcmp((const char *)a + d->offset, (const char *)b + d->offset) != 0;
+    }
+    return get_number(a, d) != get_number(b, d);
+}
+
+/**
+ * @brief Check the rules that tie several settings together.
+ *
+ * @param s               Settings to check.
+ * @param poll_interval_ms RC522 poll interval the scan policy will run with.
+ */
+static bool settings_consistent(const settings_t *s, uint32_t poll_interval_ms) {
+    if (s->wifi_retry_base_ms > s->wifi_retry_max_ms) {
+        ESP_LOGE(TAG, "wifi_retry_base_ms is larger than wifi_retry_max_ms");
+        return false;
+    }
+    if (s->scan_idle_interval_ms != 0 && s->scan_idle_window_ms < poll_interval_ms) {
+        ESP_LOGE(TAG, "scan_idle_window_ms is shorter than the %lu ms poll interval",
+                 (unsigned long)poll_interval_ms);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Find a setting by key.
+ */
+static const setting_desc_t *find(const char *key) {
+    for (size_t i = 0; i < SETTINGS_COUNT; i++) {
+        if (strcmp(table[i].key, key) == 0) {
+            return &table[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Read the stored copy over the defaults.
+ *
+ * Copies written by another schema version share the common prefix of the
+ * layout; fields beyond it keep their defaults.
+ */
+static void load(settings_t *out) {
+    *out = defaults;
+
+    nvs_handle_t nvs;
+    if (nvs_open(SETTINGS_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return; // Nothing stored yet
+    }
+    uint16_t schema = 0;
+    size_t len = 0;
+    if (nvs_get_u16(nvs, SETTINGS_NVS_KEY_SCHEMA, &schema) != ESP_OK ||
+        nvs_get_blob(nvs, SETTINGS_NVS_KEY_VALUES, NULL, &len) != ESP_OK || len == 0) {
+        nvs_close(nvs);
+        return;
+    }
+
+    uint8_t *blob = malloc(len); // Boot only; may be larger than ours (newer firmware)
+    if (blob != NULL && nvs_get_blob(nvs, SETTINGS_NVS_KEY_VALUES, blob, &len) == ESP_OK) {
+        memcpy(out, blob, len < sizeof(*out) ? len : sizeof(*out));
+        if (schema != SETTINGS_SCHEMA_VERSION) {
+            ESP_LOGW(TAG, "Stored settings are schema %u (this firmware: %d)", schema,
+                     SETTINGS_SCHEMA_VERSION);
+        }
+    }
+    free(blob);
+    nvs_close(nvs);
+
+    // A copy from a firmware with other ranges (or a torn one) keeps only valid values
+    for (size_t i = 0; i < SETTINGS_COUNT; i++) {
+        if (!setting_valid(out, &table[i])) {
+            ESP_LOGW(TAG, "Stored %s is invalid, using the default", table[i].key);
+            memcpy((uint8_t *)out + table[i].offset, (const uint8_t *)&defaults + table[i].offset,
+                   table[i].size);
+        }
+    }
+    if (!settings_consistent(out, out->rfid_poll_interval_ms)) {
+        ESP_LOGW(TAG, "Stored settings are inconsistent, using the defaults");
+        *out = defaults;
+    }
+}
+
+/**
+ * @brief Write the settings to NVS.
+ */
+static esp_err_t save(const settings_t *s) {
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(SETTINGS_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = nvs_set_u16(nvs, SETTINGS_NVS_KEY_SCHEMA, SETTINGS_SCHEMA_VERSION);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(nvs, SETTINGS_NVS_KEY_VALUES, s, sizeof(*s));
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    return err;
+}
+
+/**
+ * @brief Load the settings: menuconfig defaults overlaid with the NVS copy.
+ */
+esp_err_t settings_init(void) {
+    if (update_lock == NULL) {
+        update_lock = xSemaphoreCreateMutexStatic(&update_lock_struct);
+    }
+    load(&stored);
+    slots[active] = stored; // Before any reader runs
+    if (stored.revision != 0) {
+        ESP_LOGI(TAG, "Using remote settings revision %lu", (unsigned long)stored.revision);
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief The settings in effect.
+ */
+const settings_t *settings_get(void) {
+    return &slots[__atomic_load_n(&active, __ATOMIC_ACQUIRE)];
+}
+
+/**
+ * @brief Parse a remote document over the defaults.
+ *
+ * @return true if every known key had a valid value and the values agree.
+ */
+static bool parse_document(const cJSON *root, settings_t *out) {
+    const cJSON *schema = cJSON_GetObjectItemCaseSensitive(root, "schema");
+    if (cJSON_IsNumber(schema) && schema->valuedouble > SETTINGS_SCHEMA_VERSION) {
+        ESP_LOGW(TAG, "Document is schema %d, applying the keys of schema %d",
+                 (int)schema->valuedouble, SETTINGS_SCHEMA_VERSION);
+    }
+
+    *out = defaults;
+    const cJSON *item;
+    cJSON_ArrayForEach(item, root) {
+        if (strcmp(item->string, "schema") == 0 || strcmp(item->string, "revision") == 0) {
+            continue;
+        }
+        const setting_desc_t *d = find(item->string);
+        if (d == NULL) {
+            ESP_LOGW(TAG, "Unknown setting \"%s\" skipped", item->string);
+            continue;
+        }
+
+        if (is_string(d)) {
+            if (!cJSON_IsString(item) ||
+                strlcpy((char *)out + d->offset, item->valuestring, d->size) >= d->size) {
+                ESP_LOGE(TAG, "%s: expected a string shorter than %u", d->key, (unsigned)d->size);
+                return false;
+            }
+        } else {
+            if (!cJSON_IsNumber(item) || item->valuedouble < d->min || item->valuedouble > d->max) {
+                ESP_LOGE(TAG, "%s: expected a number in [%lu, %lu]", d->key,
+                         (unsigned long)d->min, (unsigned long)d->max);
+                return false;
+            }
+            set_number(out, d, (uint32_t)item->valuedouble);
+        }
+        if (!setting_valid(out, d)) {
+            ESP_LOGE(TAG, "%s: invalid value", d->key);
+            return false;
+        }
+    }
+
+    // Live settings apply at once, against the poll interval of this boot
+    return settings_consistent(out, out->rfid_poll_interval_ms) &&
+           settings_consistent(out, slots[active].rfid_poll_interval_ms);
+}
+
+/**
+ * @brief Apply a parsed settings document. Call with update_lock held.
+ */
+static settings_result_t apply_locked(const cJSON *doc) {
+    settings_t next;
+
+    if (doc == NULL || cJSON_IsNull(doc)) {
+        if (stored.revision == 0) {
+            return SETTINGS_UNCHANGED;
+        }
+        next = defaults; // Document deleted: back to menuconfig
+    } else {
+        const cJSON *revision = cJSON_GetObjectItemCaseSensitive(doc, "revision");
+        if (!cJSON_IsObject(doc) || !cJSON_IsNumber(revision) || revision->valuedouble < 1) {
+            ESP_LOGE(TAG, "Settings document without a revision rejected");
+            return SETTINGS_REJECTED;
+        }
+        uint32_t rev = (uint32_t)revision->valuedouble;
+        if (rev == stored.revision) {
+            return SETTINGS_UNCHANGED;
+        }
+        if (!parse_document(doc, &next)) {
+            ESP_LOGE(TAG, "Settings revision %lu rejected", (unsigned long)rev);
+            return SETTINGS_REJECTED;
+        }
+        next.revision = rev;
+    }
+
+    // Live settings now, boot settings from the next restart on: the new copy
+    // is complete before it is published, so readers never mix two revisions
+    const settings_t *old = &slots[active];
+    settings_t *copy = &slots[active ^ 1];
+    *copy = *old;
+    unsigned live = 0, boot = 0;
+    for (size_t i = 0; i < SETTINGS_COUNT; i++) {
+        const setting_desc_t *d = &table[i];
+        if (d->boot) {
+            boot += setting_differs(&next, &stored, d);
+        } else if (setting_differs(&next, old, d)) {
+            set_number(copy, d, get_number(&next, d));
+            live++;
+        }
+    }
+    copy->revision = next.revision;
+    __atomic_store_n(&active, active ^ 1, __ATOMIC_RELEASE);
+    stored = next;
+
+    esp_err_t err = save(&stored);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Settings not stored: %s", esp_err_to_name(err));
+    }
+    ESP_LOGI(TAG, "Settings revision %lu applied: %u live changes, %u after restart",
+             (unsigned long)next.revision, live, boot);
+    return SETTINGS_APPLIED;
+}
+
+/**
+ * @brief Apply a parsed remote settings document and store it in NVS.
+ */
+settings_result_t settings_apply_document(const cJSON *doc) {
+    xSemaphoreTake(update_lock, portMAX_DELAY);
+    settings_result_t result = apply_locked(doc);
+    xSemaphoreGive(update_lock);
+    return result;
+}
+
+/**
+ * @brief Apply a remote settings document and store it in NVS.
+ */
+settings_result_t settings_apply_json(const char *json) {
+    cJSON *root = cJSON_Parse(json);
+    settings_result_t result = settings_apply_document(root);
+    cJSON_Delete(root);
+    return result;
+}
+
+/**
+ * @brief Log the settings in effect.
+ */
+void settings_report(void) {
+    xSemaphoreTake(update_lock, portMAX_DELAY); // stored and the slots are replaced by updates
+    const settings_t *current = &slots[active];
+    ESP_LOGI(TAG, "Schema %d, remote revision %lu", SETTINGS_SCHEMA_VERSION,
+             (unsigned long)current->revision);
+    for (size_t i = 0; i < SETTINGS_COUNT; i++) {
+        const setting_desc_t *d = &table[i];
+        const char *pending = setting_differs(current, &stored, d) ? " (changes at restart)" : "";
+        if (is_string(d)) {
+            ESP_LOGI(TAG, "%-26s \"%s\"%s", d->key, (const char *)current + d->offset, pending);
+        } else {
+            ESP_LOGI(TAG, "%-26s %lu%s", d->key, (unsigned long)get_number(current, d), pending);
+        }
+    }
+    xSemaphoreGive(update_lock);
+}
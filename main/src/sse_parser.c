@@ -0,0 +1,148 @@
+/**
+ * @file sse_parser.c
+ * @brief Incremental parser for text/event-stream (Server-Sent Events).
+ *
+ * A line-level state machine: the field name is collected into a small
+ * buffer, the value goes straight to the event type or the data buffer, and
+ * an empty line dispatches the event. Lines may end in LF, CR or CRLF.
+ */
+
+#include "sse_parser.h" // Our public header
+
+#include <string.h>     // For memcmp(), memset(), strlen()
+
+/**
+ * @brief Forget the current event.
+ */
+static void reset_event(sse_parser_t *p) {
+    p->len = 0;
+    p->data[0] = '\0';
+    p->overflow = false;
+    p->has_data = false;
+    p->event_len = 0;
+    p->event[0] = '\0';
+}
+
+/**
+ * @brief Prepare a parser.
+ */
+void sse_parser_init(sse_parser_t *p, char *buf, size_t cap, sse_event_cb_t cb, void *arg) {
+    memset(p, 0, sizeof(*p));
+    p->cb = cb;
+    p->arg = arg;
+    p->data = buf;
+    p->cap = cap;
+    p->state = SSE_FIELD;
+    reset_event(p);
+}
+
+/**
+ * @brief Check whether the current field name is name.
+ */
+static bool field_is(const sse_parser_t *p, const char *name) {
+    size_t n = strlen(name);
+    return p->field_len == n && memcmp(p->field, name, n) == 0;
+}
+
+/**
+ * @brief Append one character to the data of the current event.
+ */
+static void put_data(sse_parser_t *p, char c) {
+    if (p->len + 1 < p->cap) {
+        p->data[p->len++] = c;
+        p->data[p->len] = '\0';
+    } else {
+        p->overflow = true;
+    }
+}
+
+/**
+ * @brief Start the value of the current field.
+ */
+static void begin_value(sse_parser_t *p) {
+    if (field_is(p, "data")) {
+        if (p->has_data) {
+            put_data(p, '\n'); // Data lines are joined with a newline
+        }
+        p->has_data = true;
+    } else if (field_is(p, "event")) {
+        p->event_len = 0;
+        p->event[0] = '\0';
+    }
+}
+
+/**
+ * @brief Append one character to the value of the current field.
+ */
+static void put_value(sse_parser_t *p, char c) {
+    if (field_is(p, "data")) {
+        put_data(p, c);
+    } else if (field_is(p, "event") && p->event_len + 1 < SSE_EVENT_MAX_LEN) {
+        p->event[p->event_len++] = c;
+        p->event[p->event_len] = '\0';
+    }
+}
+
+/**
+ * @brief Handle the end of a line.
+ */
+static void end_line(sse_parser_t *p) {
+    if (p->state == SSE_FIELD) {
+        if (p->field_len == 0) {
+            // Empty line: dispatch the event collected so far
+            if (p->has_data && p->cb != NULL) {
+                p->cb(p->event_len ? p->event : "message", p->data, p->len, p->overflow, p->arg);
+            }
+            reset_event(p);
+        } else {
+            begin_value(p); // A field without a colon has an empty value
+        }
+    }
+    p->state = SSE_FIELD;
+    p->field_len = 0;
+}
+
+/**
+ * @brief Feed the next chunk of the stream.
+ */
+void sse_parser_feed(sse_parser_t *p, const char *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        char c = data[i];
+
+        if (c == '\n' && p->after_cr) {
+            p->after_cr = false; // Second half of a CRLF
+            continue;
+        }
+        p->after_cr = (c == '\r');
+        if (c == '\r' || c == '\n') {
+            end_line(p);
+            continue;
+        }
+
+        switch (p->state) {
+            case SSE_FIELD:
+                if (c == ':') {
+                    if (p->field_len == 0) {
+                        p->field_len = sizeof(p->field); // Comment line: ignore the rest
+                        p->state = SSE_VALUE;
+                    } else {
+                        begin_value(p);
+                        p->state = SSE_VALUE_START;
+                    }
+                } else if (p->field_len < sizeof(p->field)) {
+                    p->field[p->field_len++] = c;
+                }
+                break;
+            case SSE_VALUE_START:
+                p->state = SSE_VALUE;
+                if (c == ' ') {
+                    break; // One space after the colon is not part of the value
+                }
+                put_value(p, c);
+                break;
+            case SSE_VALUE:
+                put_value(p, c);
+                break;
+        }
+    }
+}
@@ -0,0 +1,159 @@
+/**
+ * @file task_layout.c
+ * @brief Registry of application tasks and periodic stack high-water-mark log.
+ */
+
+#include "task_layout.h"       // Our public header
+
+#include "esp_log.h"           // ESP logging
+#include "esp_timer.h"         // Periodic report
+#include <stdlib.h>            // malloc() for the system task snapshot
+#include <string.h>            // For strlcpy()
+#include <inttypes.h>          // PRIu32 for logging
+
+// Tag used for logging
+static const char *TAG = "task_layout";
+
+/**
+ * @brief One registered application task.
+ */
+typedef struct {
+    TaskHandle_t handle; // Task handle
+    uint32_t stack_size; // Configured stack size (bytes)
+} layout_task_t;
+
+static layout_task_t tasks[TASK_LAYOUT_MAX_TASKS];
+static size_t task_count;
+static portMUX_TYPE tasks_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static esp_timer_handle_t report_timer;
+
+/**
+ * @brief Add a task to the stack report.
+ */
+void task_layout_register(TaskHandle_t task, uint32_t stack_size) {
+    bool added = false;
+
+    portENTER_CRITICAL(&tasks_lock);
+    if (task_count < TASK_LAYOUT_MAX_TASKS) {
+        tasks[task_count].handle = task;
+        tasks[task_count].stack_size = stack_size;
+        task_count++;
+        added = true;
+    }
+    portEXIT_CRITICAL(&tasks_lock);
+
+    if (!added) {
+        ESP_LOGW(TAG, "Task table full, %s not reported", pcTaskGetName(task));
+    }
+}
+
+/**
+ * @brief Remove a task from the stack report.
+ */
+void task_layout_unregister(TaskHandle_t task) {
+    portENTER_CRITICAL(&tasks_lock);
+    for (size_t i = 0; i < task_count; i++) {
+        if (tasks[i].handle == task) {
+            tasks[i] = tasks[--task_count];
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&tasks_lock);
+}
+
+/**
+ * @brief Stack figures of a registered task, taken under the lock.
+ */
+typedef struct {
+    TaskHandle_t handle;                    // Task handle (only compared after the snapshot)
+    char name[configMAX_TASK_NAME_LEN];     // Task name
+    uint32_t stack_size;                    // Configured stack size (bytes)
+    uint32_t free_min;                      // Stack high-water mark (bytes)
+} task_snapshot_t;
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+/**
+ * @brief Whether a task is one of the registered application tasks.
+ */
+static bool is_registered(TaskHandle_t task, const task_snapshot_t *snap, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (snap[i].handle == task) {
+            return true;
+        }
+    }
+    return false;
+}
+#endif
+
+/**
+ * @brief Log the stack high-water mark of every registered task.
+ *
+ * ESP-IDF reports stack sizes and high-water marks in bytes. The figures
+ * are read under the lock, so a task that unregisters and deletes itself
+ * is never read after its TCB is freed.
+ */
+void task_layout_report_stacks(void) {
+    task_snapshot_t snap[TASK_LAYOUT_MAX_TASKS];
+
+    portENTER_CRITICAL(&tasks_lock);
+    size_t count = task_count;
+    for (size_t i = 0; i < count; i++) {
+        snap[i].handle = tasks[i].handle;
+        strlcpy(snap[i].name, pcTaskGetName(tasks[i].handle), sizeof(snap[i].name));
+        snap[i].stack_size = tasks[i].stack_size;
+        snap[i].free_min = uxTaskGetStackHighWaterMark(tasks[i].handle);
+    }
+    portEXIT_CRITICAL(&tasks_lock);
+
+    ESP_LOGI(TAG, "%-14s %6s %6s %6s", "task", "stack", "peak", "free");
+    for (size_t i = 0; i < count; i++) {
+        ESP_LOGI(TAG, "%-14s %6" PRIu32 " %6" PRIu32 " %6" PRIu32,
+                 snap[i].name, snap[i].stack_size,
+                 snap[i].stack_size - snap[i].free_min, snap[i].free_min);
+    }
+
+#if CONFIG_FREERTOS_USE_TRACE_FACILITY
+    // System tasks: only the remaining headroom is known
+    UBaseType_t n = uxTaskGetNumberOfTasks();
+    TaskStatus_t *status = malloc(n * sizeof(*status));
+    if (status == NULL) {
+        return;
+    }
+    n = uxTaskGetSystemState(status, n, NULL);
+    for (UBaseType_t i = 0; i < n; i++) {
+        if (!is_registered(status[i].xHandle, snap, count)) {
+            ESP_LOGI(TAG, "%-14s %6s %6s %6" PRIu32, status[i].pcTaskName, "-", "-",
+                     (uint32_t)status[i].usStackHighWaterMark);
+        }
+    }
+    free(status);
+#endif
+}
+
+/**
+ * @brief Timer callback: log the stack report.
+ */
+static void report_timer_cb(void *arg) {
+    task_layout_report_stacks();
+}
+
+/**
+ * @brief Log the stack report every CONFIG_TASK_STACK_REPORT_INTERVAL_S seconds.
+ */
+esp_err_t task_layout_start_report(void) {
+    if (CONFIG_TASK_STACK_REPORT_INTERVAL_S == 0 || report_timer != NULL) {
+        return ESP_OK;
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = report_timer_cb,
+        .name = "stack_report",
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &report_timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create report timer: %s", esp_err_to_name(err));
+        return ESP_ERR_NO_MEM;
+    }
+    return esp_timer_start_periodic(report_timer, (uint64_t)CONFIG_TASK_STACK_REPORT_INTERVAL_S * 1000000);
+}
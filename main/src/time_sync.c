@@ -0,0 +1,107 @@
+/**
+ * @file time_sync.c
+ * @brief Background SNTP synchronization with drift tracking.
+ */
+
+#include "time_sync.h"     // Our public header
+#include "boot.h"          // Boot stage log of the first sync
+#include "timebase.h"      // Event clock correction
+
+#include "esp_log.h"       // ESP logging
+#include "esp_sntp.h"      // SNTP (Simple Network Time Protocol) client
+#include "esp_timer.h"     // Monotonic time of each sync
+#include "freertos/FreeRTOS.h" // Stats lock
+#include <sys/time.h>      // For struct timeval
+
+// Tag used for logging time synchronization events
+static const char *TAG = "time_sync";
+
+#define TIME_SYNC_SERVER "pool.ntp.org"
+
+static time_sync_stats_t stats;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// Time SNTP was started, for the boot timing log
+static int64_t sntp_start_us;
+
+/**
+ * @brief SNTP notification: a server answer has been applied to the system clock.
+ *
+ * The first answer is logged as a boot stage. At every later one, the
+ * correction over the time since the previous answer gives the drift.
+ */
+static void on_time_sync(struct timeval *tv) {
+    int64_t now = esp_timer_get_time();
+    int64_t correction = timebase_resync((int64_t)tv->tv_sec * 1000000 + tv->tv_usec);
+
+    portENTER_CRITICAL(&stats_lock);
+    bool first = (stats.syncs == 0);
+    int64_t elapsed = now - stats.last_sync_us;
+    stats.syncs++;
+    if (first) {
+        stats.first_sync_us = now;
+    } else {
+        stats.last_correction_us = correction;
+        if (correction > TIMEBASE_STEP_THRESHOLD_US || correction < -TIMEBASE_STEP_THRESHOLD_US) {
+            stats.steps++; // Not drift: the server or the network disagreed
+        } else if (elapsed > 0) {
+            stats.drift_ppb = (int32_t)(correction * 1000000000 / elapsed);
+        }
+    }
+    stats.last_sync_us = now;
+    time_sync_stats_t s = stats;
+    portEXIT_CRITICAL(&stats_lock);
+
+    if (first) {
+        boot_log_stage("time_sync", sntp_start_us);
+        ESP_LOGI(TAG, "Time synchronized");
+    } else {
+        ESP_LOGI(TAG, "Resync: corrected %lld us after %lld s, drift %ld ppb",
+                 (long long)s.last_correction_us, (long long)(elapsed / 1000000), (long)s.drift_ppb);
+    }
+}
+
+/**
+ * @brief Start SNTP in the background.
+ */
+esp_err_t time_sync_start(void) {
+    ESP_LOGI(TAG, "Initializing SNTP (resync every %d s)", CONFIG_TIME_SYNC_INTERVAL_S);
+    sntp_start_us = esp_timer_get_time();
+    esp_sntp_setoperatingmode(SNTP_OPMODE_POLL);   // Set SNTP to poll mode
+    esp_sntp_setservername(0, TIME_SYNC_SERVER);   // Set default NTP server
+    sntp_set_sync_mode(SNTP_SYNC_MODE_SMOOTH);     // Resyncs slew the system clock
+    sntp_set_sync_interval(CONFIG_TIME_SYNC_INTERVAL_S * 1000);
+    sntp_set_time_sync_notification_cb(on_time_sync);
+    esp_sntp_init();                               // Initialize SNTP
+    return ESP_OK;
+}
+
+/**
+ * @brief Get a snapshot of the counters.
+ */
+void time_sync_get_stats(time_sync_stats_t *out) {
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+/**
+ * @brief Log the sync state, the last correction and the drift.
+ */
+void time_sync_report(void) {
+    time_sync_stats_t s;
+    time_sync_get_stats(&s);
+
+    char now[TIMEBASE_ISO8601_MAX_LEN];
+    timebase_format_utc(timebase_now_us(), now, sizeof(now));
+    if (s.syncs == 0) {
+        ESP_LOGI(TAG, "%s (not synced yet, events are stamped with their uptime)", now);
+        return;
+    }
+
+    int64_t since = (esp_timer_get_time() - s.last_sync_us) / 1000000;
+    ESP_LOGI(TAG, "%s, %lu syncs (%lu steps), last %lld s ago", now, (unsigned long)s.syncs,
+             (unsigned long)s.steps, (long long)since);
+    ESP_LOGI(TAG, "Last correction %lld us, drift %ld ppb", (long long)s.last_correction_us,
+             (long)s.drift_ppb);
+}
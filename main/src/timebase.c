@@ -0,0 +1,143 @@
+/**
+ * @file timebase.c
+ * @brief esp_timer-plus-offset UTC clock and ISO 8601 formatting.
+ */
+
+#include "timebase.h"          // Our public header
+#include "settings.h"          // Time zone
+
+#include "esp_timer.h"         // Monotonic microsecond clock
+#include "esp_log.h"           // ESP logging
+#include "freertos/FreeRTOS.h" // Critical section for the 64-bit offset
+
+#include <stdio.h>             // For snprintf()
+#include <stdlib.h>            // For setenv()
+#include <sys/time.h>          // For gettimeofday()
+#include <time.h>              // For tzset(), gmtime_r()
+
+// Tag used for logging
+static const char *TAG = "timebase";
+
+// UTC time minus esp_timer time, in microseconds, before the running slew
+static int64_t epoch_offset_us = 0;
+// Correction still being slewed in, and the esp_timer time the slew started
+static int64_t slew_us = 0;
+static int64_t slew_start_us = 0;
+static bool synced = false;
+static portMUX_TYPE offset_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Part of the slew applied by esp_timer time t (call with offset_lock held).
+ */
+static int64_t slew_applied(int64_t t) {
+    int64_t max = (t - slew_start_us) * TIMEBASE_SLEW_PPM / 1000000;
+    if (slew_us > max) {
+        return max;
+    }
+    if (slew_us < -max) {
+        return -max;
+    }
+    return slew_us;
+}
+
+/**
+ * @brief Offset between UTC and esp_timer at esp_timer time t.
+ */
+static int64_t offset_at(int64_t t) {
+    portENTER_CRITICAL_SAFE(&offset_lock);
+    int64_t offset = epoch_offset_us + slew_applied(t);
+    portEXIT_CRITICAL_SAFE(&offset_lock);
+    return offset;
+}
+
+/**
+ * @brief Configure the time zone and the epoch offset.
+ */
+void timebase_init(void) {
+    // Only local-time formatting depends on this; event timestamps are UTC
+    setenv("TZ", settings_get()->timezone, 1);
+    tzset();
+
+    // RTC time (kept across a software reset, otherwise 1970) until the first sync
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    epoch_offset_us = (int64_t)tv.tv_sec * 1000000 + tv.tv_usec - esp_timer_get_time();
+}
+
+/**
+ * @brief Correct the clock to a new UTC reference.
+ */
+int64_t timebase_resync(int64_t utc_us) {
+    int64_t t = esp_timer_get_time();
+    bool first = !synced;
+
+    portENTER_CRITICAL(&offset_lock);
+    int64_t correction = (utc_us - t) - (epoch_offset_us + slew_us);
+    bool step = first || correction > TIMEBASE_STEP_THRESHOLD_US ||
+                correction < -TIMEBASE_STEP_THRESHOLD_US;
+    if (step) {
+        epoch_offset_us = utc_us - t;
+        slew_us = 0;
+    } else {
+        // Keep what has been slewed so far and slew the rest plus the new correction
+        int64_t applied = slew_applied(t);
+        epoch_offset_us += applied;
+        slew_us += correction - applied;
+    }
+    slew_start_us = t;
+    synced = true;
+    portEXIT_CRITICAL(&offset_lock);
+
+    if (first) {
+        ESP_LOGI(TAG, "Clock set, event timestamps are now valid");
+    } else if (step) {
+        ESP_LOGW(TAG, "Clock stepped by %lld ms", (long long)(correction / 1000));
+    }
+    return correction;
+}
+
+/**
+ * @brief Check whether the clock has been set by SNTP since boot.
+ */
+bool timebase_is_synced(void) {
+    return synced;
+}
+
+/**
+ * @brief Current UTC time in microseconds since 1970-01-01.
+ */
+int64_t timebase_now_us(void) {
+    int64_t t = esp_timer_get_time();
+    return t + offset_at(t);
+}
+
+/**
+ * @brief UTC time of an earlier esp_timer reading of this boot.
+ */
+int64_t timebase_uptime_to_utc(int64_t uptime_us) {
+    return uptime_us + offset_at(esp_timer_get_time());
+}
+
+/**
+ * @brief Format a timestamp as ISO 8601 UTC with milliseconds.
+ */
+size_t timebase_format_utc(int64_t epoch_us, char *buf, size_t cap) {
+    if (epoch_us < 0) {
+        epoch_us = 0;
+    }
+    time_t secs = (time_t)(epoch_us / 1000000);
+    int ms = (int)((epoch_us / 1000) % 1000);
+
+    struct tm tm;
+    gmtime_r(&secs, &tm);
+    int len = snprintf(buf, cap, "%04d-%02d-%02dT%02d:%02d:%02d.%03dZ",
+                       tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+                       tm.tm_hour, tm.tm_min, tm.tm_sec, ms);
+    if (len < 0 || (size_t)len >= cap) {
+        if (cap > 0) {
+            buf[0] = '\0';
+        }
+        return 0;
+    }
+    return (size_t)len;
+}
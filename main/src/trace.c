@@ -0,0 +1,166 @@
+/**
+ * @file trace.c
+ * @brief Fixed-bucket latency histograms for the tap hot path.
+ */
+
+#include "trace.h"           // Our public header
+
+#include "esp_log.h"         // ESP logging
+#include "freertos/FreeRTOS.h"
+#include <stdio.h>           // For snprintf()
+#include <string.h>          // For memset()
+#include <inttypes.h>        // PRIu32/PRIu64 for formatting
+
+// Tag used for logging
+static const char *TAG = "trace";
+
+static const char *const span_names[TRACE_SPAN_COUNT] = {
+    [TRACE_SPAN_DECISION]       = "decision",
+    [TRACE_SPAN_DISPLAY_QUEUED] = "display_queued",
+    [TRACE_SPAN_DISPLAY_DONE]   = "display_done",
+    [TRACE_SPAN_UPLOAD_QUEUED]  = "upload_queued",
+    [TRACE_SPAN_CLOUD_ACK]      = "cloud_ack",
+};
+
+static trace_histogram_t histograms[TRACE_SPAN_COUNT];
+static portMUX_TYPE histograms_lock = portMUX_INITIALIZER_UNLOCKED;
+
+#if CONFIG_TRACE_LATENCY
+/**
+ * @brief Bucket index of a latency (log2 scale).
+ */
+static size_t bucket_for(uint32_t us) {
+    size_t b = 0;
+    while (b < TRACE_BUCKETS - 1 && us >= trace_bucket_limit_us(b)) {
+        b++;
+    }
+    return b;
+}
+#endif
+
+/**
+ * @brief Record the time since a tap for one stage.
+ */
+void trace_record(trace_span_t span, int64_t tap_us) {
+#if CONFIG_TRACE_LATENCY
+    if (tap_us == 0 || span >= TRACE_SPAN_COUNT) {
+        return;
+    }
+    int64_t elapsed = esp_timer_get_time() - tap_us;
+    uint32_t us = (elapsed < 0) ? 0 : (elapsed > UINT32_MAX) ? UINT32_MAX : (uint32_t)elapsed;
+    size_t b = bucket_for(us);
+
+    portENTER_CRITICAL(&histograms_lock);
+    trace_histogram_t *h = &histograms[span];
+    if (h->count == 0 || us < h->min_us) {
+        h->min_us = us;
+    }
+    if (us > h->max_us) {
+        h->max_us = us;
+    }
+    h->count++;
+    h->total_us += us;
+    h->buckets[b]++;
+    portEXIT_CRITICAL(&histograms_lock);
+#endif
+}
+
+/**
+ * @brief Get a snapshot of one histogram.
+ */
+void trace_get_histogram(trace_span_t span, trace_histogram_t *out) {
+    portENTER_CRITICAL(&histograms_lock);
+    *out = histograms[span];
+    portEXIT_CRITICAL(&histograms_lock);
+}
+
+/**
+ * @brief Clear all histograms.
+ */
+void trace_reset(void) {
+    portENTER_CRITICAL(&histograms_lock);
+    memset(histograms, 0, sizeof(histograms));
+    portEXIT_CRITICAL(&histograms_lock);
+}
+
+/**
+ * @brief Short name of a stage.
+ */
+const char *trace_span_name(trace_span_t span) {
+    return (span < TRACE_SPAN_COUNT) ? span_names[span] : "?";
+}
+
+/**
+ * @brief Upper bound of a bucket in microseconds.
+ */
+uint32_t trace_bucket_limit_us(size_t bucket) {
+    return (bucket < TRACE_BUCKETS - 1) ? (1u << (bucket + TRACE_BUCKET_SHIFT)) : UINT32_MAX;
+}
+
+/**
+ * @brief Estimate a percentile from the bucket counts (upper bound of its bucket).
+ */
+static uint32_t percentile_us(const trace_histogram_t *h, uint32_t pct) {
+    uint64_t rank = ((uint64_t)h->count * pct + 99) / 100;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < TRACE_BUCKETS; b++) {
+        seen += h->buckets[b];
+        if (seen >= rank) {
+            uint32_t limit = trace_bucket_limit_us(b);
+            return (limit < h->max_us) ? limit : h->max_us;
+        }
+    }
+    return h->max_us;
+}
+
+/**
+ * @brief Print all histograms to the log.
+ */
+void trace_print(void) {
+    ESP_LOGI(TAG, "%-15s %7s %9s %9s %9s %9s %9s", "stage", "count", "min_us", "avg_us",
+             "p50_us", "p99_us", "max_us");
+    for (int s = 0; s < TRACE_SPAN_COUNT; s++) {
+        trace_histogram_t h;
+        trace_get_histogram(s, &h);
+        uint32_t avg = h.count ? (uint32_t)(h.total_us / h.count) : 0;
+        ESP_LOGI(TAG, "%-15s %7" PRIu32 " %9" PRIu32 " %9" PRIu32 " %9" PRIu32 " %9" PRIu32 " %9" PRIu32,
+                 span_names[s], h.count, h.min_us, avg, percentile_us(&h, 50), percentile_us(&h, 99),
+                 h.max_us);
+    }
+}
+
+/**
+ * @brief Format all histograms as a JSON object.
+ *
+ * {"decision":{"count":3,"min_us":..,"max_us":..,"avg_us":..,"buckets":[..]},...}
+ */
+size_t trace_format_json(char *buf, size_t cap) {
+    size_t len = 0;
+    int n = snprintf(buf, cap, "{");
+    for (int s = 0; s < TRACE_SPAN_COUNT && n >= 0 && len + n < cap; s++) {
+        len += n;
+        trace_histogram_t h;
+        trace_get_histogram(s, &h);
+        n = snprintf(buf + len, cap - len,
+                     "%s\"%s\":{\"count\":%" PRIu32 ",\"min_us\":%" PRIu32 ",\"max_us\":%" PRIu32
+                     ",\"avg_us\":%" PRIu64 ",\"buckets\":[",
+                     s ? "," : "", span_names[s], h.count, h.min_us, h.max_us,
+                     h.count ? h.total_us / h.count : 0);
+        for (size_t b = 0; b < TRACE_BUCKETS && n >= 0 && len + n < cap; b++) {
+            len += n;
+            n = snprintf(buf + len, cap - len, b ? ",%" PRIu32 : "%" PRIu32, h.buckets[b]);
+        }
+        if (n >= 0 && len + n < cap) {
+            len += n;
+            n = snprintf(buf + len, cap - len, "]}");
+        }
+    }
+    if (n >= 0 && len + n < cap) {
+        len += n;
+        n = snprintf(buf + len, cap - len, "}");
+    }
+    if (n < 0 || len + n >= cap) {
+        return 0;
+    }
+    return len + n;
+}
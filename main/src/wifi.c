@@ -5,6 +5,11 @@
  * This file implements Wi-Fi initialization and connection handling.
  * It connects the ESP32 to a predefined access point using credentials provided
  * in wifi_credentials.h, and manages reconnection automatically upon disconnection.
+ *
+ * Reconnects are spaced by an esp_timer with jittered exponential backoff, so an
+ * AP outage does not keep the radio and the event task busy. The access point's
+ * BSSID and channel are kept in NVS: the first attempt of every connection episode
+ * targets them directly, and later attempts fall back to a full scan.
  */
 
 #include "wifi.h"                // Header for public Wi-Fi API
@@ -13,18 +18,145 @@
 #include "esp_event.h"            // ESP-IDF Event loop API
 #include "esp_log.h"              // ESP-IDF logging
 #include "nvs_flash.h"            // Non-volatile storage (Wi-Fi calibration data)
+#include "nvs.h"                  // Fast-connect cache
 #include "lwip/err.h"             // lwIP error codes
 #include "lwip/sys.h"             // lwIP system functions
+#include "esp_timer.h"            // Boot stage timing, reconnect backoff
+#include "esp_random.h"           // Backoff jitter
+#include "boot.h"                 // Boot stage logs
+#include "settings.h"             // Reconnect backoff
+#include <string.h>               // For memcmp(), memcpy()
 
-// Bit used to indicate a successful Wi-Fi connection (internal)
-#define WIFI_CONNECTED_BIT BIT0
+// NVS namespace and key of the fast-connect cache
+#define WIFI_NVS_NAMESPACE "wifi"
+#define WIFI_NVS_KEY_AP    "ap"
+
+/**
+ * @brief Access point remembered for fast connect.
+ */
+typedef struct {
+    uint8_t bssid[6]; // MAC address of the access point
+    uint8_t channel;  // Primary channel
+} wifi_ap_cache_t;
 
 // Event group to signal when connected
 static EventGroupHandle_t wifi_event_group;
+static StaticEventGroup_t wifi_event_group_struct;
 
 // Tag used for logging
 static const char *TAG = "wifi_station";
 
+// When wifi_init_sta() started, for the boot timing log (0 once logged)
+static int64_t wifi_start_us = 0;
+
+// One-shot timer that issues the next connection attempt
+static esp_timer_handle_t retry_timer;
+// Connection attempts since the last successful connection
+static uint32_t attempts;
+
+// Last known access point (valid: cache holds a usable entry)
+static wifi_ap_cache_t ap_cache;
+static bool ap_cache_valid;
+// Whether the attempt in progress targets the cached access point
+static bool fast_attempt;
+
+static wifi_stats_t stats;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/**
+ * @brief Load the cached access point from NVS.
+ */
+static void load_ap_cache(void) {
+#if CONFIG_WIFI_FAST_CONNECT
+    nvs_handle_t nvs;
+    if (nvs_open(WIFI_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return; // Nothing stored yet
+    }
+    size_t len = sizeof(ap_cache);
+    ap_cache_valid = nvs_get_blob(nvs, WIFI_NVS_KEY_AP, &ap_cache, &len) == ESP_OK &&
+                     len == sizeof(ap_cache) && ap_cache.channel != 0;
+    nvs_close(nvs);
+#endif
+}
+
+/**
+ * @brief Store the access point we are connected to, if it changed.
+ */
+static void save_ap_cache(const uint8_t *bssid, uint8_t channel) {
+#if CONFIG_WIFI_FAST_CONNECT
+    if (ap_cache_valid && ap_cache.channel == channel && memcmp(ap_cache.bssid, bssid, 6) == 0) {
+        return; // Unchanged: no flash write
+    }
+    memcpy(ap_cache.bssid, bssid, 6);
+    ap_cache.channel = channel;
+    ap_cache_valid = true;
+
+    nvs_handle_t nvs;
+    if (nvs_open(WIFI_NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+        return;
+    }
+    if (nvs_set_blob(nvs, WIFI_NVS_KEY_AP, &ap_cache, sizeof(ap_cache)) == ESP_OK) {
+        nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    ESP_LOGI(TAG, "Cached AP on channel %u for fast connect", channel);
+#endif
+}
+
+/**
+ * @brief Apply the station configuration and start a connection attempt.
+ *
+ * Only the first attempt after boot or after a connection loss targets the
+ * cached access point; if that fails, the following ones scan all channels.
+ */
+static void start_connect(void) {
+    wifi_config_t wifi_config = {
+        .sta = {
+            .ssid = WIFI_SSID,
+            .password = WIFI_PASS,
+        },
+    };
+
+    fast_attempt = (attempts == 0) && ap_cache_valid;
+    attempts++;
+    if (fast_attempt) {
+        wifi_config.sta.scan_method = WIFI_FAST_SCAN;
+        wifi_config.sta.bssid_set = true;
+        memcpy(wifi_config.sta.bssid, ap_cache.bssid, 6);
+        wifi_config.sta.channel = ap_cache.channel;
+    } else {
+        wifi_config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+    }
+
+    esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+    esp_wifi_connect();
+}
+
+/**
+ * @brief Backoff delay before the next attempt.
+ *
+ * The delay doubles with every failed attempt up to wifi_retry_max_ms
+ * (settings.h).
+ * A random value between half and all of it is used, so many devices behind
+ * one access point do not retry in lockstep after an outage.
+ */
+static uint32_t next_retry_delay_ms(void) {
+    uint32_t failed = (attempts > 0) ? attempts - 1 : 0; // 0 right after losing a connection
+    const settings_t *s = settings_get();
+    uint32_t delay = s->wifi_retry_max_ms;
+    if (failed < 16 && (s->wifi_retry_base_ms << failed) < delay) {
+        delay = s->wifi_retry_base_ms << failed;
+    }
+    return delay / 2 + esp_random() % (delay / 2 + 1);
+}
+
+/**
+ * @brief Retry timer callback: next connection attempt.
+ */
+static void retry_timer_cb(void *arg) {
+    start_connect();
+}
+
 /**
  * @brief Wi-Fi event handler.
  *
@@ -38,16 +170,54 @@ static const char *TAG = "wifi_station";
  */
 static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data) {
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
-        // Wi-Fi station started; attempt to connect to AP
-        esp_wifi_connect();
+        // Wi-Fi station started; attempt to connect to AP (cached one first)
+        start_connect();
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
+        // Associated; remember the AP so the next connect can skip the scan
+        wifi_event_sta_connected_t *event = (wifi_event_sta_connected_t *)event_data;
+        save_ap_cache(event->bssid, event->channel);
+        if (fast_attempt) {
+            fast_attempt = false; // A later disconnect is not a fast-connect miss
+            portENTER_CRITICAL(&stats_lock);
+            stats.fast_connects++;
+            portEXIT_CRITICAL(&stats_lock);
+        }
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        // Wi-Fi disconnected; attempt to reconnect
-        esp_wifi_connect();
-        ESP_LOGI(TAG, "Retrying connection to the AP...");
+        // Wi-Fi disconnected: report offline and retry after a backoff delay
+        wifi_event_sta_disconnected_t *event = (wifi_event_sta_disconnected_t *)event_data;
+        xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT);
+
+        uint32_t delay_ms = next_retry_delay_ms();
+        portENTER_CRITICAL(&stats_lock);
+        stats.disconnects++;
+        stats.retry_delay_ms = delay_ms;
+        stats.last_reason = event->reason;
+        if (fast_attempt) {
+            stats.fast_misses++;
+        }
+        portEXIT_CRITICAL(&stats_lock);
+        fast_attempt = false;
+
+        esp_timer_stop(retry_timer); // Not running unless events raced; ignore the result
+        esp_timer_start_once(retry_timer, (uint64_t)delay_ms * 1000);
+        ESP_LOGI(TAG, "Disconnected (reason %u), retrying in %lu ms...",
+                 event->reason, (unsigned long)delay_ms);
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         // Successfully got an IP address; set the connection bit
+        attempts = 0; // The next loss starts again with a short, fast-connect retry
         xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_BIT);
+        portENTER_CRITICAL(&stats_lock);
+        stats.connects++;
+        portEXIT_CRITICAL(&stats_lock);
         ESP_LOGI(TAG, "Got IP Address");
+        if (wifi_start_us != 0) {
+            boot_log_stage("wifi", wifi_start_us);
+            wifi_start_us = 0;
+        }
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_LOST_IP) {
+        // Associated but without an address: not usable for uploads
+        xEventGroupClearBits(wifi_event_group, WIFI_CONNECTED_BIT);
+        ESP_LOGW(TAG, "Lost IP Address");
     }
 }
 
@@ -56,10 +226,22 @@ static void event_handler(void *arg, esp_event_base_t event_base, int32_t event_
  *
  * This function initializes the TCP/IP stack, Wi-Fi driver, event loop,
  * configures Wi-Fi with SSID and password, and starts the Wi-Fi connection.
+ * It returns without waiting; WIFI_CONNECTED_BIT is set once an IP is assigned.
+ * nvs_flash_init() must have been called first.
  */
 void wifi_init_sta(void) {
+    wifi_start_us = esp_timer_get_time();
+
     // Create an event group to manage Wi-Fi connection state
-    wifi_event_group = xEventGroupCreate();
+    wifi_event_group = xEventGroupCreateStatic(&wifi_event_group_struct);
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = retry_timer_cb,
+        .name = "wifi_retry",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &retry_timer));
+
+    load_ap_cache();
 
     // Initialize network interface and event loop
     esp_netif_init();
@@ -81,23 +263,19 @@ void wifi_init_sta(void) {
                                         &event_handler,
                                         NULL,
                                         NULL);
+    esp_event_handler_instance_register(IP_EVENT,
+                                        IP_EVENT_STA_LOST_IP,
+                                        &event_handler,
+                                        NULL,
+                                        NULL);
 
-    // Set Wi-Fi configuration (SSID and password from credentials header)
-    wifi_config_t wifi_config = {
-        .sta = {
-            .ssid = WIFI_SSID,
-            .password = WIFI_PASS,
-        },
-    };
-
-    // Set Wi-Fi mode to Station (client)
+    // Set Wi-Fi mode to Station (client); the configuration is applied per attempt
     esp_wifi_set_mode(WIFI_MODE_STA);
-    // Apply Wi-Fi configuration
-    esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
     // Start Wi-Fi
     esp_wifi_start();
 
-    ESP_LOGI(TAG, "wifi_init_sta finished. Wi-Fi initialization complete.");
+    ESP_LOGI(TAG, "wifi_init_sta finished. Wi-Fi initialization complete%s.",
+             ap_cache_valid ? " (fast connect)" : "");
 }
 
 /**
@@ -111,3 +289,32 @@ void wifi_init_sta(void) {
 EventGroupHandle_t get_wifi_event_group(void) {
     return wifi_event_group;
 }
+
+/**
+ * @brief Whether the station is connected and has an IP address.
+ */
+bool wifi_is_connected(void) {
+    return wifi_event_group != NULL &&
+           (xEventGroupGetBits(wifi_event_group) & WIFI_CONNECTED_BIT) != 0;
+}
+
+/**
+ * @brief Wait until the station is connected.
+ */
+bool wifi_wait_connected(TickType_t timeout) {
+    if (wifi_event_group == NULL) {
+        return false;
+    }
+    EventBits_t bits = xEventGroupWaitBits(wifi_event_group, WIFI_CONNECTED_BIT,
+                                           pdFALSE, pdTRUE, timeout);
+    return (bits & WIFI_CONNECTED_BIT) != 0;
+}
+
+/**
+ * @brief Get a snapshot of the connection counters.
+ */
+void wifi_get_stats(wifi_stats_t *out) {
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&stats_lock);
+}
@@ -0,0 +1,207 @@
+#!/usr/bin/env python3
+"""Convert status screen images into palette + RLE tables for the LCD driver.
+
+Usage: gen_screens.py OUT_C OUT_H NAME=IMAGE [NAME=IMAGE ...]
+
+Each image (8-bit PNG or binary PPM) becomes a `const lcd_image_t screen_<name>`
+placed in flash. Pixels are stored as runs of palette indices (the decoder
+is lcd_draw_image() in lcd_display.c):
+
+    byte = (index << 4) | n     n = 1..15: run of n pixels
+                                n = 0: run length follows as LEB128, plus 16
+
+The palette holds at most 16 RGB565 colors, already byte-swapped for the
+ST7735, so the decoder can copy entries straight into the DMA buffer.
+Only the Python standard library is used.
+"""
+
+import os
+import struct
+import sys
+import zlib
+
+
+def read_png(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    if data[:8] != b'\x89PNG\r\n\x1a\n':
+        raise ValueError(f'{path}: not a PNG file')
+
+    pos = 8
+    idat = b''
+    palette = None
+    while pos < len(data):
+        length, ctype = struct.unpack('>I4s', data[pos:pos + 8])
+        body = data[pos + 8:pos + 8 + length]
+        pos += 12 + length
+        if ctype == b'IHDR':
+            width, height, depth, color, _, _, interlace = struct.unpack('>IIBBBBB', body)
+        elif ctype == b'PLTE':
+            palette = [tuple(body[i:i + 3]) for i in range(0, len(body), 3)]
+        elif ctype == b'IDAT':
+            idat += body
+        elif ctype == b'IEND':
+            break
+
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}.get(color)
+    if depth != 8 or interlace != 0 or channels is None:
+        raise ValueError(f'{path}: only 8-bit, non-interlaced PNGs are supported')
+
+    raw = zlib.decompress(idat)
+    stride = width * channels
+    rows = []
+    prev = bytearray(stride)
+    for y in range(height):
+        start = y * (stride + 1)
+        ftype = raw[start]
+        line = bytearray(raw[start + 1:start + 1 + stride])
+        for i in range(stride):
+            a = line[i - channels] if i >= channels else 0
+            b = prev[i]
+            c = prev[i - channels] if i >= channels else 0
+            if ftype == 1:
+                line[i] = (line[i] + a) & 0xFF
+            elif ftype == 2:
+                line[i] = (line[i] + b) & 0xFF
+            elif ftype == 3:
+                line[i] = (line[i] + ((a + b) >> 1)) & 0xFF
+            elif ftype == 4:
+                p = a + b - c
+                pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+                pred = a if pa <= pb and pa <= pc else (b if pb <= pc else c)
+                line[i] = (line[i] + pred) & 0xFF
+        prev = line
+
+        pixels = []
+        for x in range(width):
+            px = line[x * channels:(x + 1) * channels]
+            if color == 3:
+                pixels.append(palette[px[0]])
+            elif channels <= 2:
+                pixels.append((px[0], px[0], px[0]))
+            else:
+                pixels.append(tuple(px[:3]))
+        rows.append(pixels)
+    return width, height, rows
+
+
+def read_ppm(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    fields = []
+    pos = 0
+    while len(fields) < 4:
+        while data[pos:pos + 1].isspace():
+            pos += 1
+        if data[pos:pos + 1] == b'#':
+            pos = data.index(b'\n', pos)
+            continue
+        end = pos
+        while not data[end:end + 1].isspace():
+            end += 1
+        fields.append(data[pos:end])
+        pos = end
+    if fields[0] != b'P6' or int(fields[3]) != 255:
+        raise ValueError(f'{path}: only binary 8-bit PPM (P6) is supported')
+    width, height = int(fields[1]), int(fields[2])
+    pix = data[pos + 1:]
+    return width, height, [[tuple(pix[(y * width + x) * 3:(y * width + x) * 3 + 3])
+                            for x in range(width)] for y in range(height)]
+
+
+def rgb565_swapped(rgb):
+    r, g, b = rgb
+    v = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3)
+    return ((v & 0xFF) << 8) | (v >> 8)
+
+
+def encode(name, width, height, rows):
+    palette = []
+    indices = []
+    for row in rows:
+        for rgb in row:
+            color = rgb565_swapped(rgb)
+            if color not in palette:
+                palette.append(color)
+                if len(palette) > 16:
+                    raise ValueError(f'{name}: more than 16 colors')
+            indices.append(palette.index(color))
+
+    out = bytearray()
+    i = 0
+    while i < len(indices):
+        run = 1
+        while i + run < len(indices) and indices[i + run] == indices[i]:
+            run += 1
+        if run < 16:
+            out.append(indices[i] << 4 | run)
+        else:
+            out.append(indices[i] << 4)
+            extra = run - 16
+            while True:
+                byte = extra & 0x7F
+                extra >>= 7
+                out.append(byte | (0x80 if extra else 0))
+                if not extra:
+                    break
+        i += run
+    return palette, bytes(out)
+
+
+def main(argv):
+    if len(argv) < 4:
+        sys.exit(__doc__)
+    out_c, out_h, specs = argv[1], argv[2], argv[3:]
+
+    c_lines = [
+        '// Generated by main/tools/gen_screens.py -- do not edit.',
+        f'#include "{os.path.basename(out_h)}"',
+        '',
+    ]
+    h_lines = [
+        '// Generated by main/tools/gen_screens.py -- do not edit.',
+        '#pragma once',
+        '',
+        '#include "lcd_display.h" // For lcd_image_t',
+        '',
+    ]
+
+    for spec in specs:
+        name, path = spec.split('=', 1)
+        reader = read_ppm if path.lower().endswith('.ppm') else read_png
+        width, height, rows = reader(path)
+        palette, data = encode(name, width, height, rows)
+
+        raw_bytes = width * height * 2
+        print(f'gen_screens: {name}: {width}x{height}, {len(palette)} colors, '
+              f'{len(data)} bytes RLE (raw RGB565 {raw_bytes} bytes, {100.0 * len(data) / raw_bytes:.1f}%)')
+
+        c_lines.append(f'static const uint16_t {name}_palette[] = {{')
+        c_lines.append('    ' + ', '.join(f'0x{c:04X}' for c in palette))
+        c_lines.append('};')
+        c_lines.append('')
+        c_lines.append(f'static const uint8_t {name}_data[] = {{')
+        for i in range(0, len(data), 16):
+            c_lines.append('    ' + ', '.join(f'0x{b:02X}' for b in data[i:i + 16]) + ',')
+        c_lines.append('};')
+        c_lines.append('')
+        c_lines.append(f'const lcd_image_t screen_{name} = {{')
+        c_lines.append(f'    .width = {width},')
+        c_lines.append(f'    .height = {height},')
+        c_lines.append(f'    .palette = {name}_palette,')
+        c_lines.append(f'    .palette_size = {len(palette)},')
+        c_lines.append(f'    .data = {name}_data,')
+        c_lines.append(f'    .data_len = sizeof({name}_data),')
+        c_lines.append('};')
+        c_lines.append('')
+
+        h_lines.append(f'extern const lcd_image_t screen_{name}; // {os.path.basename(path)}')
+
+    with open(out_c, 'w') as f:
+        f.write('\n'.join(c_lines))
+    with open(out_h, 'w') as f:
+        f.write('\n'.join(h_lines) + '\n')
+
+
+if __name__ == '__main__':
+    main(sys.argv)